@@ -28,6 +28,8 @@
 #define __VW_BUNDLEADJUSTMENT_ADJUST_BASE_H__
 
 #include <vw/BundleAdjustment/ModelBase.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <boost/foreach.hpp>
 
 namespace vw {
@@ -109,9 +111,10 @@ namespace ba {
   // Returns cholesky factor L, D in lower left hand corner and
   // diagonal modifies in place returns 1 if original matrix was
   // positive definite, 0 otherwise has verbose output if not positive
-  // definite
-  template<class T>
-  inline unsigned mod_cholesky(Matrix<T>& M){
+  // definite. Works on fixed-size blocks as well, which keeps the
+  // per-point 3x3 factorizations off the heap.
+  template<class T, size_t RowsN, size_t ColsN>
+  inline unsigned mod_cholesky(Matrix<T,RowsN,ColsN>& M){
     unsigned n = M.rows();
     for(unsigned i = 0; i < n; i++){
       for(unsigned j = i; j < n; j++){
@@ -150,8 +153,8 @@ namespace ba {
 
   // Replaces lower triangle of A with that of L^{-1} Replaces upper
   // triangle of A with zeros Returns 0 if A is not positive definite
-  template<class T>
-  inline unsigned chol_inverse(Matrix<T>& A){
+  template<class T, size_t RowsN, size_t ColsN>
+  inline unsigned chol_inverse(Matrix<T,RowsN,ColsN>& A){
     unsigned n = A.rows();
     unsigned ret = mod_cholesky(A);
     if (ret == 0)
@@ -217,6 +220,91 @@ namespace ba {
     return ret;
   };
 
+  // PARALLEL EVALUATION
+  //--------------------------------------------------------
+  // The adjusters split their per measure work into contiguous
+  // chunks of an index range and run each chunk as
+  // func(chunk, begin, end) on its own thread. A chunk may only write
+  // to outputs no other chunk touches; results that have to be
+  // summed are kept per chunk and reduced in chunk order, so the
+  // answer only depends on the number of chunks. An exception thrown
+  // by a chunk is kept and rethrown, unchanged, on the calling thread.
+
+  template <class FuncT>
+  class AdjustChunkTask : public Task {
+    FuncT& m_func;
+    size_t m_chunk, m_begin, m_end;
+    TaskFailure& m_failure;
+  public:
+    AdjustChunkTask( FuncT& func, size_t chunk, size_t begin, size_t end,
+                     TaskFailure& failure ) :
+      m_func(func), m_chunk(chunk), m_begin(begin), m_end(end), m_failure(failure) {}
+
+    void operator()() {
+      try {
+        m_func( m_chunk, m_begin, m_end );
+      } catch ( ... ) {
+        m_failure.capture();
+      }
+    }
+  };
+
+  // Number of chunks to split [0,size) into.
+  inline size_t adjust_num_chunks( size_t size, int num_threads ) {
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+    return std::max( size_t(1), std::min( size, size_t(num_threads) ) );
+  }
+
+  // Run func over [0,size) in num_chunks chunks. A single chunk runs
+  // on the calling thread.
+  template <class FuncT>
+  void adjust_in_chunks( FuncT& func, size_t size, size_t num_chunks ) {
+    if ( num_chunks <= 1 ) {
+      func( 0, 0, size );
+      return;
+    }
+    std::vector<TaskFailure> failures( num_chunks );
+    {
+      FifoWorkQueue queue( num_chunks );
+      for ( size_t c = 0; c < num_chunks; ++c ) {
+        boost::shared_ptr<Task>
+          task( new AdjustChunkTask<FuncT>( func, c, c * size / num_chunks,
+                                            (c + 1) * size / num_chunks, failures[c] ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
+    }
+    BOOST_FOREACH( TaskFailure const& failure, failures )
+      if ( failure.failed() )
+        failure.rethrow();
+  }
+
+  // Reprojection error of point i in camera j, or zero if the point
+  // can't be projected into the camera.
+  template <class ModelT>
+  inline Vector2 reprojection_error( ModelT& model, size_t i, size_t j, Vector2 const& location,
+                                     Vector<double, ModelT::camera_params_n> const& cam_j,
+                                     Vector<double, ModelT::point_params_n> const& point_i ) {
+    try {
+      return location - model.cam_pixel( i, j, cam_j, point_i );
+    } catch (const camera::PointToPixelErr& e) {}
+    return Vector2();
+  }
+
+  // The jacobians and the reprojection error of one measure. Shared
+  // by all the adjusters, and called from several threads at once.
+  template <class ModelT>
+  inline void evaluate_measure( ModelT& model, size_t i, size_t j, Vector2 const& location,
+                                Vector<double, ModelT::camera_params_n> const& cam_j,
+                                Vector<double, ModelT::point_params_n> const& point_i,
+                                Matrix<double, 2, ModelT::camera_params_n>& A,
+                                Matrix<double, 2, ModelT::point_params_n>& B,
+                                Vector2& error ) {
+    model.jacobians( i, j, cam_j, point_i, A, B );
+    error = reprojection_error( model, i, j, location, cam_j, point_i );
+  }
+
   // BUNDLE ADJUSTMENT BASE
   //--------------------------------------------------------
   // This is a base class for the item which actually performs the
@@ -236,6 +324,7 @@ namespace ba {
     double g_tol;       // Surprisingly not used (8/22/09)
     double d_tol;       // Surprisingly not used (8/22/09)
     int m_iterations;
+    int m_num_threads;
 
     bool m_use_camera_constraint;
     bool m_use_gcp_constraint;
@@ -251,6 +340,7 @@ namespace ba {
       m_use_gcp_constraint(use_gcp_constraint) {
 
       m_iterations = 0;
+      m_num_threads = 1;
       m_control_net = m_model.control_network();
 
       m_lambda = 1e-3;
@@ -334,6 +424,14 @@ namespace ba {
     bool camera_constraint() const { return m_use_camera_constraint; }
     bool gcp_constraint() const { return m_use_gcp_constraint; }
 
+    // Number of threads used to evaluate measures and assemble the
+    // normal equations. The default is 1. Zero uses the Vision
+    // Workbench default thread count. With more than one thread the
+    // model's cam_pixel() and jacobians() are called from several
+    // threads at once, so only raise this for thread safe models.
+    int num_threads() const { return m_num_threads; }
+    void set_num_threads(int num_threads) { m_num_threads = num_threads; }
+
     // Additional Information
     int iterations() const { return m_iterations; }
     RobustCostT costfunction() const { return m_robust_cost_func; }
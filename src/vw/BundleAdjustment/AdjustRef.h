@@ -56,6 +56,75 @@ namespace ba {
     // Need to save S for covariance calculations
     math::Matrix<double> m_S;
 
+    typedef Vector<double, BundleAdjustModelT::camera_params_n> vector_camera;
+    typedef Vector<double, BundleAdjustModelT::point_params_n> vector_point;
+
+    // Evaluates the measures of a range of control points. Measure m
+    // of point i owns rows 2*(first_measure[i]+m) of J and the error
+    // vectors, so ranges can be evaluated concurrently.
+    struct MeasureFunc {
+      BundleAdjustModelT& model;
+      ControlNetwork const& cnet;
+      RobustCostT cost_func;
+      std::vector<unsigned> const& first_measure;
+      Vector<double> const* delta;
+      Matrix<double>* J;
+      Matrix<double>* sigma;
+      Vector<double>& error;
+
+      MeasureFunc( BundleAdjustModelT& model, ControlNetwork const& cnet,
+                   RobustCostT const& cost_func, std::vector<unsigned> const& first_measure,
+                   Vector<double> const* delta, Matrix<double>* J, Matrix<double>* sigma,
+                   Vector<double>& error ) :
+        model(model), cnet(cnet), cost_func(cost_func), first_measure(first_measure),
+        delta(delta), J(J), sigma(sigma), error(error) {}
+
+      void operator()( size_t /*chunk*/, size_t begin, size_t end ) {
+        const unsigned num_cam_params = BundleAdjustModelT::camera_params_n;
+        const unsigned num_pt_params = BundleAdjustModelT::point_params_n;
+        const unsigned num_cameras = model.num_cameras();
+        Matrix<double, 2, BundleAdjustModelT::camera_params_n> J_a;
+        Matrix<double, 2, BundleAdjustModelT::point_params_n> J_b;
+        for ( size_t i = begin; i < end; ++i ) {
+          for ( unsigned m = 0; m < cnet[i].size(); ++m ) {
+            unsigned idx = first_measure[i] + m;
+            int camera_idx = cnet[i][m].image_id();
+
+            Vector2 unweighted_error;
+            if ( delta ) {
+              // Evaluating a potential update step
+              vector_camera cam_params = model.cam_params(camera_idx) -
+                subvector(*delta, num_cam_params*camera_idx, num_cam_params);
+              vector_point point_params = model.point_params(i) -
+                subvector(*delta, num_cam_params*num_cameras + num_pt_params*i, num_pt_params);
+              unweighted_error = reprojection_error( model, i, camera_idx, cnet[i][m].dominant(),
+                                                     cam_params, point_params );
+            } else {
+              evaluate_measure( model, i, camera_idx, cnet[i][m].dominant(),
+                                model.cam_params(camera_idx), model.point_params(i),
+                                J_a, J_b, unweighted_error );
+
+              // Populate the Jacobian Matrix
+              submatrix(*J, 2*idx, num_cam_params*camera_idx, 2, num_cam_params) = J_a;
+              submatrix(*J, 2*idx, num_cam_params*num_cameras + i*num_pt_params, 2, num_pt_params) = J_b;
+
+              // Fill in the entries of the sigma matrix with the uncertainty of the observations.
+              Matrix2x2 inverse_cov;
+              Vector2 pixel_sigma = cnet[i][m].sigma();
+              inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
+              inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
+              submatrix(*sigma, 2*idx, 2*idx, 2, 2) = inverse_cov;
+            }
+
+            // Apply robust cost function weighting and populate the error vector
+            double mag = norm_2(unweighted_error);
+            double weight = sqrt(cost_func(mag)) / mag;
+            subvector(error,2*idx,2) = unweighted_error * weight;
+          }
+        }
+      }
+    };
+
   public:
 
     AdjustRef( BundleAdjustModelT & model,
@@ -142,46 +211,16 @@ namespace ba {
 
       // --- SETUP STEP ----
       // Add rows to J and error for the imaged pixel observations
-      int idx = 0;
-      for (unsigned i = 0; i < this->m_control_net->size(); ++i) {       // Iterate over control points
-        for (unsigned m = 0; m < (*(this->m_control_net))[i].size();
-             ++m) {  // Iterate over control measures
-          int camera_idx = (*(this->m_control_net))[i][m].image_id();
-
-          Matrix<double> J_a = this->m_model.cam_jacobian(i,camera_idx,
-                                                        this->m_model.cam_params(camera_idx),
-                                                        this->m_model.point_params(i));
-          Matrix<double> J_b = this->m_model.point_jacobian(i,camera_idx,
-                                                        this->m_model.cam_params(camera_idx),
-                                                        this->m_model.point_params(i));
-
-          // Populate the Jacobian Matrix
-          submatrix(J, 2*idx, num_cam_params*camera_idx, 2, num_cam_params) = J_a;
-          submatrix(J, 2*idx, num_cam_params*num_cameras + i*num_pt_params, 2, num_pt_params) = J_b;
-
-          // Apply robust cost function weighting and populate the error vector
-          Vector2 unweighted_error;
-          try {
-            unweighted_error = (*(this->m_control_net))[i][m].dominant() -
-              this->m_model.cam_pixel(i, camera_idx,
-                            this->m_model.cam_params(camera_idx),
-                            this->m_model.point_params(i));
-          } catch (const camera::PointToPixelErr& e) {}
-          double mag = norm_2(unweighted_error);
-          double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
-          subvector(error,2*idx,2) = unweighted_error * weight;
-
-          // Fill in the entries of the sigma matrix with the uncertainty of the observations.
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (*(this->m_control_net))[i][m].sigma();
-
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-          submatrix(sigma, 2*idx, 2*idx, 2, 2) = inverse_cov;
-
-          ++idx;
-        }
+      std::vector<unsigned> first_measure( this->m_control_net->size() + 1, 0 );
+      for (unsigned i = 0; i < this->m_control_net->size(); ++i)
+        first_measure[i+1] = first_measure[i] + (*(this->m_control_net))[i].size();
+      size_t num_chunks = adjust_num_chunks( this->m_control_net->size(), this->m_num_threads );
+      {
+        MeasureFunc func( this->m_model, *this->m_control_net, this->m_robust_cost_func,
+                          first_measure, 0, &J, &sigma, error );
+        adjust_in_chunks( func, this->m_control_net->size(), num_chunks );
       }
+      int idx = 0;
 
       double max = 0.0;
       if (this->m_iterations == 1 && this->m_lambda == 1e-3){
@@ -291,29 +330,10 @@ namespace ba {
 
       // --- EVALUATE POTENTIAL UPDATE STEP ---
       Vector<double> new_error(num_observations);                  // Error vector
-      idx = 0;
-      for (unsigned i = 0; i < this->m_control_net->size(); ++i) {
-        for (unsigned m = 0; m < (*this->m_control_net)[i].size(); ++m) {
-          int camera_idx = (*this->m_control_net)[i][m].image_id();
-
-          Vector<double> cam_delta = subvector(delta, num_cam_params*camera_idx, num_cam_params);
-          Vector<double> pt_delta = subvector(delta, num_cam_params*num_cameras + num_pt_params*i,
-                                              num_pt_params);
-
-          // Apply robust cost function weighting and populate the error vector
-          Vector2 unweighted_error;
-          try {
-            unweighted_error = (*this->m_control_net)[i][m].dominant() -
-              this->m_model.cam_pixel(i, camera_idx,
-                            this->m_model.cam_params(camera_idx)-cam_delta,
-                            this->m_model.point_params(i)-pt_delta);
-          } catch (const camera::PointToPixelErr& e) {}
-          double mag = norm_2(unweighted_error);
-          double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
-          subvector(new_error,2*idx,2) = unweighted_error * weight;
-
-          ++idx;
-        }
+      {
+        MeasureFunc func( this->m_model, *this->m_control_net, this->m_robust_cost_func,
+                          first_measure, &delta, 0, 0, new_error );
+        adjust_in_chunks( func, this->m_control_net->size(), num_chunks );
       }
 
       // Add rows to J and error for a priori position/pose constraints...
@@ -164,12 +164,11 @@ namespace ba {
         for (unsigned m = 0; m < (*(this->m_control_net))[i].size(); ++m) {
           int camera_idx = (*(this->m_control_net))[i][m].image_id();
 
-          Matrix<double> J_a = this->m_model.cam_jacobian(i,camera_idx,
-                                                        this->m_model.cam_params(camera_idx),
-                                                        this-> m_model.point_params(i));
-          Matrix<double> J_b = this->m_model.point_jacobian(i,camera_idx,
-                                                        this->m_model.cam_params(camera_idx),
-                                                        this->m_model.point_params(i));
+          Matrix<double, 2, BundleAdjustModelT::camera_params_n> J_a;
+          Matrix<double, 2, BundleAdjustModelT::point_params_n> J_b;
+          this->m_model.jacobians(i,camera_idx,
+                                  this->m_model.cam_params(camera_idx),
+                                  this->m_model.point_params(i), J_a, J_b);
 
           // Apply robust cost function weighting and populate the error vector
           Vector2 unweighted_error;
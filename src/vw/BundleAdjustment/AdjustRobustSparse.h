@@ -26,6 +26,7 @@
 // Vision Workbench
 #include <vw/BundleAdjustment/AdjustBase.h>
 #include <vw/Math/MatrixSparseSkyline.h>
+#include <vw/BundleAdjustment/SparseAssembly.h>
 
 // Boost
 #include <boost/numeric/ublas/matrix_sparse.hpp>
@@ -64,7 +65,7 @@ namespace ba {
     Vector<size_t> m_ideal_skyline;
     bool m_found_ideal_ordering;
     CameraRelationNetwork<JFeature> m_crn;
-    typedef CameraNode<JFeature>::iterator crn_iter;
+    SparseAssembly<BundleAdjustModelT> m_assembly;
 
     // Reused structures
     std::vector< matrix_camera_camera > U;
@@ -72,6 +73,26 @@ namespace ba {
     std::vector< vector_camera > epsilon_a;
     std::vector< vector_point > epsilon_b;
 
+    // Student's t weighting of a measure with t_df degrees of
+    // freedom. The error itself is not scaled, only its weight.
+    struct StudentWeight {
+      double m_df, m_dim;
+      StudentWeight( double df, double dim ) : m_df(df), m_dim(dim) {}
+
+      void operator()( Vector2 const& error, Matrix2x2 const& inverse_cov,
+                       double& hessian_weight, Vector2& residual, double& objective ) const {
+        double S_weight = transpose(error) * inverse_cov * error;
+        hessian_weight = (m_df + m_dim)/(m_df + S_weight);
+        residual = hessian_weight * error;
+        objective = 0.5*(m_df + m_dim)*log(1 + S_weight/m_df);
+      }
+
+      double cost( Vector2 const& error, Matrix2x2 const& inverse_cov ) const {
+        double S_weight = transpose(error) * inverse_cov * error;
+        return 0.5*(m_df + m_dim)*log(1 + S_weight/m_df);
+      }
+    };
+
   public:
 
     AdjustRobustSparse( BundleAdjustModelT & model,
@@ -86,6 +107,7 @@ namespace ba {
       epsilon_a( this->m_model.num_cameras() ), epsilon_b( this->m_model.num_points() ) {
       vw_out(DebugMessage,"ba") << "Constructed Robust Sparse Bundle Adjuster.\n";
       m_crn.read_controlnetwork( *(this->m_control_net).get() );
+      m_assembly.index( m_crn, this->m_model.num_points() );
       m_found_ideal_ordering = false;
     }
 
@@ -157,44 +179,10 @@ namespace ba {
       // matrices A & B, as well as the error matrix and the W
       // matrix.
       time.reset(new Timer("Solve for Image Error, Jacobian, U, V, and W:", DebugMessage, "ba"));
-      double robust_objective = 0.0;
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          size_t i = (**fiter).m_point_id;
-
-          matrix_2_camera A = this->m_model.cam_jacobian(i,j,this->m_model.cam_params(j),
-                                                       this->m_model.point_params(i));
-          matrix_2_point B = this->m_model.point_jacobian(i,j,this->m_model.cam_params(j),
-                                                      this->m_model.point_params(i));
-
-          // Apply robust cost function weighting
-          Vector2 unweighted_error;
-          try {
-            unweighted_error = (**fiter).m_location -
-              this->m_model.cam_pixel(i,j,this->m_model.cam_params(j),
-                            this->m_model.point_params(i));
-          } catch (const camera::PointToPixelErr& e) {}
-
-          Vector2 pixel_sigma = (**fiter).m_scale;
-          Matrix2x2 inverse_cov;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-
-          double S_weight = transpose(unweighted_error) * inverse_cov * unweighted_error;
-          double mu_weight = (t_df + t_dim_pixel)/(t_df + S_weight);
-
-          // do NOT want epsilon_inst scaled
-          robust_objective += 0.5*(t_df + t_dim_pixel)*log(1 + S_weight/t_df);
-
-          // Storing intermediate values
-          U[j] += mu_weight * transpose(A) * inverse_cov * A;
-          V[i] += mu_weight * transpose(B) * inverse_cov * B;
-          (**fiter).m_w = mu_weight * transpose(A) * inverse_cov * B;
-          epsilon_a[j] += mu_weight * transpose(A) * inverse_cov * unweighted_error;
-          epsilon_b[i] += mu_weight * transpose(B) * inverse_cov * unweighted_error;
-        }
-      }
+      StudentWeight weight( t_df, t_dim_pixel );
+      double robust_objective =
+        m_assembly.assemble( this->m_model, weight, this->m_num_threads,
+                             U, V, epsilon_a, epsilon_b );
       time.reset();
 
       // Add in the camera position and pose constraint terms and covariances.
@@ -280,23 +268,13 @@ namespace ba {
 
       // Compute V inverse
       for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
-        Matrix<double> V_temp = V[i];
+        matrix_point_point V_temp = V[i];
         chol_inverse( V_temp );
         V_inverse[i] = transpose(V_temp)*V_temp;
       }
 
       // Compute Y and finish constructing e.
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          size_t i = (**fiter).m_point_id;
-          // Compute the blocks of Y
-          (**fiter).m_y = (**fiter).m_w * V_inverse[i];
-          // Flatten the block structure to compute 'e'
-          subvector(e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
-            * epsilon_b[i];
-        }
-      }
+      m_assembly.compute_y( V_inverse, epsilon_b, e, this->m_num_threads );
       time.reset();
 
       // --- BUILD SPARSE, SOLVE A'S UPDATE STEP -------------------------
@@ -309,57 +287,7 @@ namespace ba {
       // below.
       math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
                                           this->m_model.num_cameras()*num_cam_params);
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        { // Filling in diagonal
-          matrix_camera_camera S_jj;
-
-          // Iterate across all features seen by the camera
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
-          }
-
-          // Augmenting Diagonal
-          S_jj += U[j];
-
-          // Loading into sparse matrix
-          size_t offset = j * num_cam_params;
-          for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
-            for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
-              S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
-            }
-          }
-        }
-
-        // Filling in off diagonal
-        for ( size_t k = j+1; k < m_crn.size(); k++ ) {
-          typedef boost::weak_ptr<JFeature> w_ptr;
-          typedef boost::shared_ptr<JFeature> f_ptr;
-          typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
-          std::pair< mm_iterator, mm_iterator > feature_range;
-          feature_range = m_crn[j].map.equal_range( k );
-
-          // Iterating through all features in camera j that have
-          // connections to camera k.
-          matrix_camera_camera S_jk;
-          bool found = false;
-          for ( mm_iterator f_j_iter = feature_range.first;
-                f_j_iter != feature_range.second; f_j_iter++ ) {
-            w_ptr f_k = (*f_j_iter).second->m_map[k];
-            found = true;
-            S_jk -= (*f_j_iter).second->m_y *
-              transpose( f_k.lock()->m_w );
-          }
-
-          // Loading into sparse matrix
-          // - if it seems we are loading in oddly, it's because the sparse
-          //   matrix is row major.
-          if ( found ) {
-            submatrix( S, k*num_cam_params, j*num_cam_params,
-                       num_cam_params, num_cam_params ) = transpose(S_jk);
-          }
-        }
-      }
+      m_assembly.build_S( S, U, this->m_num_threads );
 
       m_S = S; // S is modified in sparse solve. Keeping a copy;
       time.reset();
@@ -398,13 +326,7 @@ namespace ba {
 
         // Building right half, sum( WijT * delta_aj )
         std::vector< vector_point > right_delta_b( this->m_model.num_points() );
-        for ( size_t j = 0; j < m_crn.size(); j++ ) {
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            right_delta_b[ (**fiter).m_point_id ] += transpose( (**fiter).m_w ) *
-              subvector( delta_a, j*num_cam_params, num_cam_params );
-          }
-        }
+        m_assembly.right_delta_b( delta_a, right_delta_b, this->m_num_threads );
 
         // Solving for delta b
         for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
@@ -432,36 +354,8 @@ namespace ba {
       // Compute the update error vector and predicted change
       // -------------------------------
       time.reset(new Timer("Solve for Updated Error", DebugMessage, "ba"));
-      double new_robust_objective = 0;
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          size_t i = (**fiter).m_point_id;
-
-          // Computer error vector
-          vector_camera new_a = this->m_model.cam_params(j) +
-            subvector( delta_a, num_cam_params*j, num_cam_params );
-          vector_point new_b = this->m_model.point_params(i) +
-            subvector( delta_b, num_pt_params*i, num_pt_params );
-
-          // Apply robust cost function weighting
-          Vector2 unweighted_error;
-          try {
-            unweighted_error = (**fiter).m_location -
-              this->m_model.cam_pixel(i,j,new_a,new_b);
-          } catch (const camera::PointToPixelErr& e) {}
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (**fiter).m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-
-          // Populate the S_weights, mu_weights vectors
-          double S_weight = transpose(unweighted_error) * inverse_cov * unweighted_error;
-
-          new_robust_objective += 0.5*(t_df + t_dim_pixel)*log(1 + S_weight/t_df);
-        }
-      }
+      double new_robust_objective =
+        m_assembly.objective( this->m_model, weight, this->m_num_threads, delta_a, delta_b );
 
       // Camera Constraints
       if ( this->m_use_camera_constraint )
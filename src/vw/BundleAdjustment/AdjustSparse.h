@@ -28,6 +28,7 @@
 #include <vw/Core/Debugging.h>
 #include <vw/BundleAdjustment/AdjustBase.h>
 #include <vw/BundleAdjustment/CameraRelation.h>
+#include <vw/BundleAdjustment/SparseAssembly.h>
 
 // Boost
 #include <boost/numeric/ublas/matrix_sparse.hpp>
@@ -62,11 +63,14 @@ namespace ba {
     typedef Vector<double,BundleAdjustModelT::point_params_n> vector_point;
 
     math::MatrixSparseSkyline<double> m_S;
+    bool m_use_conjugate_gradient;
+    math::EisenstatWalkerForcing m_forcing;
+    int m_cg_max_iterations;
     std::vector<size_t> m_ideal_ordering;
     Vector<size_t> m_ideal_skyline;
     bool m_found_ideal_ordering;
     CameraRelationNetwork<JFeature> m_crn;
-    typedef CameraNode<JFeature>::iterator crn_iter;
+    SparseAssembly<BundleAdjustModelT> m_assembly;
 
     // Reused structures
     std::vector< matrix_camera_camera > U;
@@ -74,6 +78,87 @@ namespace ba {
     std::vector< vector_camera > epsilon_a;
     std::vector< vector_point > epsilon_b;
 
+    // The error of a measure is scaled so that its squared norm is the
+    // robust cost.
+    struct RobustWeight {
+      mutable RobustCostT m_cost_func;
+      RobustWeight( RobustCostT const& cost_func ) : m_cost_func(cost_func) {}
+
+      void operator()( Vector2 const& error, Matrix2x2 const& inverse_cov,
+                       double& hessian_weight, Vector2& residual, double& objective ) const {
+        hessian_weight = 1;
+        residual = error;
+        if ( error != Vector2() ) {
+          double mag = norm_2(error);
+          residual *= sqrt(m_cost_func(mag)) / mag;
+        }
+        objective = .5 * transpose(residual) * inverse_cov * residual;
+      }
+
+      double cost( Vector2 const& error, Matrix2x2 const& inverse_cov ) const {
+        double mag = norm_2( error );
+        Vector2 residual = error * ( sqrt( m_cost_func(mag)) / mag );
+        return .5 * transpose(residual) * inverse_cov * residual;
+      }
+    };
+
+    // Solve S * delta_a = e by forming S
+    Vector<double> solve_direct( Vector<double> const& e ) {
+      boost::scoped_ptr<Timer> time;
+      size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+
+      time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
+
+      // The S matrix is a m x m block matrix with blocks that are
+      // camera_params_n x camera_params_n in size.  It has a sparse
+      // skyline structure, which makes it more efficient to solve
+      // through L*D*L^T decomposition and forward/back substitution
+      // below.
+      math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
+                                          this->m_model.num_cameras()*num_cam_params);
+      m_assembly.build_S( S, U, this->m_num_threads );
+
+      m_S = S; // S is modified in sparse solve. Keeping a copy.
+      time.reset();
+
+      // Computing ideal ordering
+      if (!m_found_ideal_ordering) {
+        time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
+        m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
+        math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
+        m_ideal_skyline = solve_for_skyline(mod_S);
+
+        m_found_ideal_ordering = true;
+        time.reset();
+      }
+
+      time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
+
+      // Compute the LDL^T decomposition and solve using sparse methods.
+      math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
+      Vector<double> delta_a = sparse_solve( modified_S,
+                                             reorganize(e, m_ideal_ordering),
+                                             m_ideal_skyline );
+      return reorganize(delta_a, modified_S.inverse());
+    }
+
+    // Solve S * delta_a = e without forming S
+    Vector<double> solve_iterative( Vector<double> const& e ) {
+      Timer time("Solve Delta A by Conjugate Gradient", DebugMessage, "ba");
+      typedef SparseAssembly<BundleAdjustModelT> assembly_type;
+      double tolerance = m_forcing( norm_2( e ) );
+      int max_iterations = m_cg_max_iterations > 0 ? m_cg_max_iterations : int(e.size());
+
+      Vector<double> delta_a( e.size() );
+      typename assembly_type::SchurOperator S( m_assembly, U, this->m_num_threads );
+      typename assembly_type::BlockJacobiPreconditioner M( m_assembly, U, this->m_num_threads );
+      int iterations = math::preconditioned_conjugate_gradient( S, M, e, delta_a,
+                                                                 tolerance, max_iterations );
+      vw_out(DebugMessage,"ba") << "Conjugate gradient: " << iterations
+                                << " iterations to a relative tolerance of " << tolerance << "\n";
+      return delta_a;
+    }
+
   public:
 
     AdjustSparse( BundleAdjustModelT & model,
@@ -88,10 +173,38 @@ namespace ba {
       epsilon_a( this->m_model.num_cameras() ), epsilon_b( this->m_model.num_points() ) {
       vw_out(DebugMessage,"ba") << "Constructed Sparse Bundle Adjuster.\n";
       m_crn.read_controlnetwork( *(this->m_control_net).get() );
+      m_assembly.index( m_crn, this->m_model.num_points() );
       m_found_ideal_ordering = false;
+      set_use_conjugate_gradient( false );
+    }
+
+    // The reduced camera matrix of the last update. The iterative
+    // solver never forms it, so in that case it is built here.
+    math::MatrixSparseSkyline<double> S() const {
+      if ( !m_use_conjugate_gradient )
+        return m_S;
+      size_t size = this->m_model.num_cameras()*BundleAdjustModelT::camera_params_n;
+      math::MatrixSparseSkyline<double> S( size, size );
+      m_assembly.build_S( S, U, this->m_num_threads );
+      return S;
     }
 
-    math::MatrixSparseSkyline<double> S() const { return m_S; }
+    // Solve the reduced camera system with block Jacobi preconditioned
+    // conjugate gradient on the implicit S, instead of with an LDL^T
+    // decomposition of the skyline matrix. Use this when the cameras
+    // aren't connected in a banded pattern and the skyline fills in.
+    //
+    // Each system is only solved to the tolerance of an inexact
+    // Newton method (see math::EisenstatWalkerForcing), never looser
+    // than max_tolerance, and with at most max_iterations iterations.
+    // Zero iterations means as many as there are camera parameters.
+    void set_use_conjugate_gradient( bool use, double max_tolerance = 0.1,
+                                     int max_iterations = 0 ) {
+      m_use_conjugate_gradient = use;
+      m_forcing = math::EisenstatWalkerForcing( max_tolerance );
+      m_cg_max_iterations = max_iterations;
+    }
+    bool use_conjugate_gradient() const { return m_use_conjugate_gradient; }
 
     // Covariance Calculator
     // ___________________________________________________________
@@ -150,49 +263,10 @@ namespace ba {
       // matrices A & B, as well as the error matrix and the W
       // matrix.
       time.reset(new Timer("Solve for Image Error, Jacobian, U, V, and W:", DebugMessage, "ba"));
-      double error_total = 0; // assume this is r^T\Sigma^{-1}r
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        BOOST_FOREACH( boost::shared_ptr<JFeature> measure, m_crn[j] ) {
-          size_t i = measure->m_point_id;
-
-          matrix_2_camera A =
-            this->m_model.cam_jacobian( i, j,
-                                      this->m_model.cam_params(j),
-                                      this->m_model.point_params(i) );
-          matrix_2_point B =
-            this->m_model.point_jacobian( i, j,
-                                      this->m_model.cam_params(j),
-                                      this->m_model.point_params(i) );
-
-          // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = measure->m_location -
-              this->m_model.cam_pixel(i,j,this->m_model.cam_params(j),
-                            this->m_model.point_params(i) );
-          } catch (const camera::PointToPixelErr& e) {}
-
-          if ( error != Vector2() ) {
-            double mag = norm_2(error);
-            double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
-            error *= weight;
-          }
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = measure->m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-          error_total += .5 * transpose(error) *
-            inverse_cov * error;
-
-          // Storing intermediate values
-          U[j] += transpose(A) * inverse_cov * A;
-          V[i] += transpose(B) * inverse_cov * B;
-          epsilon_a[j] += transpose(A) * inverse_cov * error;
-          epsilon_b[i] += transpose(B) * inverse_cov * error;
-          measure->m_w = transpose(A) * inverse_cov * B;
-        }
-      }
+      RobustWeight weight( this->m_robust_cost_func );
+      double error_total = // assume this is r^T\Sigma^{-1}r
+        m_assembly.assemble( this->m_model, weight, this->m_num_threads,
+                             U, V, epsilon_a, epsilon_b );
       time.reset();
 
       // Add in the camera position and pose constraint terms and covariances.
@@ -274,112 +348,21 @@ namespace ba {
 
       // Compute V inverse
       for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
-        Matrix<double> V_temp = V[i];
+        matrix_point_point V_temp = V[i];
         chol_inverse( V_temp );
         V_inverse[i] = transpose(V_temp)*V_temp;
       }
 
       // Compute Y and finish constructing e.
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute the blocks of Y
-          (**fiter).m_y = (**fiter).m_w * V_inverse[(**fiter).m_point_id];
-          // Flatten the block structure to compute 'e'
-          subvector(e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
-            * epsilon_b[ (**fiter).m_point_id ];
-        }
-      }
-
-      time.reset();
-
-      // --- BUILD SPARSE, SOLVE A'S UPDATE STEP -------------------------
-      time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
-
-      // The S matrix is a m x m block matrix with blocks that are
-      // camera_params_n x camera_params_n in size.  It has a sparse
-      // skyline structure, which makes it more efficient to solve
-      // through L*D*L^T decomposition and forward/back substitution
-      // below.
-      math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
-                                          this->m_model.num_cameras()*num_cam_params);
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        { // Filling in diagonal
-          matrix_camera_camera S_jj;
-
-          // Iterate across all features seen by the camera
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
-          }
-
-          // Augmenting Diagonal
-          S_jj += U[j];
-
-          // Loading into sparse matrix
-          size_t offset = j * num_cam_params;
-          for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
-            for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
-              S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
-            }
-          }
-        }
-
-        // Filling in off diagonal
-        for ( size_t k = j+1; k < m_crn.size(); k++ ) {
-          typedef boost::weak_ptr<JFeature> w_ptr;
-          typedef boost::shared_ptr<JFeature> f_ptr;
-          typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
-          std::pair< mm_iterator, mm_iterator > feature_range;
-          feature_range = m_crn[j].map.equal_range( k );
-
-          // Iterating through all features in camera j that have
-          // connections to camera k.
-          matrix_camera_camera S_jk;
-          bool found = false;
-          for ( mm_iterator f_j_iter = feature_range.first;
-                f_j_iter != feature_range.second; f_j_iter++ ) {
-            w_ptr f_k = (*f_j_iter).second->m_map[k];
-            found = true;
-            S_jk -= (*f_j_iter).second->m_y *
-              transpose( f_k.lock()->m_w );
-          }
-
-          // Loading into sparse matrix
-          // - if it seems we are loading in oddly, it's because the sparse
-          //   matrix is row major.
-          if ( found ) {
-            submatrix( S, k*num_cam_params, j*num_cam_params,
-                       num_cam_params, num_cam_params ) = transpose(S_jk);
-          }
-        }
-      }
+      m_assembly.compute_y( V_inverse, epsilon_b, e, this->m_num_threads );
 
-      m_S = S; // S is modified in sparse solve. Keeping a copy.
       time.reset();
 
-      // Computing ideal ordering
-      if (!m_found_ideal_ordering) {
-        time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
-        m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
-        math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
-        m_ideal_skyline = solve_for_skyline(mod_S);
-
-        m_found_ideal_ordering = true;
-        time.reset();
-      }
-
-      time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
-
-      // Compute the LDL^T decomposition and solve using sparse methods.
-      math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
-      Vector<double> delta_a = sparse_solve( modified_S,
-                                             reorganize(e, m_ideal_ordering),
-                                             m_ideal_skyline );
-      delta_a = reorganize(delta_a, modified_S.inverse());
+      // --- SOLVE A'S UPDATE STEP ------------------------------
+      Vector<double> delta_a = m_use_conjugate_gradient ?
+        solve_iterative( e ) : solve_direct( e );
       BOOST_FOREACH( double& e, delta_a )
         if ( std::isnan( e ) ) e = 0;
-      time.reset();
 
       // --- SOLVE B'S UPDATE STEP ---------------------------------
 
@@ -391,13 +374,7 @@ namespace ba {
 
         // Building right half, sum( WijT * delta_aj )
         std::vector< vector_point > right_delta_b( this->m_model.num_points() );
-        for ( size_t j = 0; j < m_crn.size(); j++ ) {
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            right_delta_b[ (**fiter).m_point_id ] += transpose( (**fiter).m_w ) *
-              subvector( delta_a, j*num_cam_params, num_cam_params );
-          }
-        }
+        m_assembly.right_delta_b( delta_a, right_delta_b, this->m_num_threads );
 
         // Solving for delta b
         for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
@@ -425,35 +402,8 @@ namespace ba {
       // Compute the update error vector and predicted change
       // -------------------------------
       time.reset(new Timer("Solve for Updated Error", DebugMessage, "ba"));
-      double new_error_total = 0;
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute error vector
-          vector_camera new_a = this->m_model.cam_params(j) +
-            subvector( delta_a, num_cam_params*j, num_cam_params );
-          vector_point new_b = this->m_model.point_params((**fiter).m_point_id) +
-            subvector( delta_b, num_pt_params*(**fiter).m_point_id, num_pt_params );
-
-          // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = (**fiter).m_location -
-              this->m_model.cam_pixel((**fiter).m_point_id,j,new_a,new_b);
-          } catch (const camera::PointToPixelErr& e) {}
-          double mag = norm_2( error );
-          double weight = sqrt( this->m_robust_cost_func(mag)) / mag;
-          error *= weight;
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (**fiter).m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-
-          new_error_total += .5 * transpose(error) *
-            inverse_cov * error;
-        }
-      }
+      double new_error_total =
+        m_assembly.objective( this->m_model, weight, this->m_num_threads, delta_a, delta_b );
 
       // Camera Constraints
       if ( this->m_use_camera_constraint )
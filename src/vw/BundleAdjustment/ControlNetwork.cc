@@ -20,6 +20,7 @@
 ///
 
 #include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/BundleAdjustment/ControlNetworkView.h>
 #include <vw/Core/Log.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
@@ -32,29 +33,25 @@
 #include <unistd.h>
 #endif
 
- ///////////////////////////////////
-// Global only to Control Network //
-///////////////////////////////////
-
-inline std::string current_posix_time_string() {
-  char time_string[2048];
-  time_t t = time(0);
-  struct tm* time_struct = localtime(&t);
-  strftime(time_string, 2048, "%F %T", time_struct);
-  return std::string(time_string);
-}
-
-inline std::string isis_style_time_string() {
-  std::string time = current_posix_time_string();
-  boost::erase_all( time, "\n" );
-  boost::trim( time );
-  boost::replace_all( time, " ", "T" );
-  return time;
-}
-
 namespace vw {
 namespace ba {
 
+  inline std::string current_posix_time_string() {
+    char time_string[2048];
+    time_t t = time(0);
+    struct tm* time_struct = localtime(&t);
+    strftime(time_string, 2048, "%F %T", time_struct);
+    return std::string(time_string);
+  }
+
+  std::string isis_style_time_string() {
+    std::string time = current_posix_time_string();
+    boost::erase_all( time, "\n" );
+    boost::trim( time );
+    boost::replace_all( time, " ", "T" );
+    return time;
+  }
+
   ////////////////////////////
   // Control Measure        //
   ////////////////////////////
@@ -593,6 +590,11 @@ namespace ba {
   /// Reading a compressed binary style control network
   void ControlNetwork::read_binary( std::string const& filename ) {
 
+    if ( ControlNetworkView::is_view_file( filename ) ) {
+      ControlNetworkView( filename ).get_network( *this );
+      return;
+    }
+
     // Opening file
     std::ifstream f( filename.c_str() );
     if ( !f.is_open() )
@@ -128,7 +128,7 @@ namespace ba {
         m_focalplane_x = location[0]; m_focalplane_y = location[1];
       }
     }
-    bool is_pixels_dominant() { return m_pixels_dominant; }
+    bool is_pixels_dominant() const { return m_pixels_dominant; }
     void set_pixels_dominant( bool state ) { m_pixels_dominant = state; }
 
     /// Setting/Reading the pixel error for this point.
@@ -176,6 +176,10 @@ namespace ba {
     double ephemeris_time() const { return m_ephemeris_time; }
     void set_ephemeris_time( double const& time ) { m_ephemeris_time = time; }
 
+    /// Setting/Reading the diameter of the feature in pixels
+    float diameter() const { return m_diameter; }
+    void set_diameter( float diameter ) { m_diameter = diameter; }
+
     /// File I/O
     void read_binary ( std::istream& f );
     void read_isis   ( std::istream& f );
@@ -306,6 +310,8 @@ namespace ba {
   /// - assoc. with image list/serial number
   ///
   class ControlNetwork {
+    friend class ControlNetworkView;
+
     std::vector<ControlPoint> m_control_points;
     std::string m_targetName;         // Name of the target
     std::string m_networkId;          // Network Id
@@ -351,6 +357,14 @@ namespace ba {
     ControlNetworkType type() const { return m_type; }
     void set_type( ControlNetworkType type ) { m_type = type; }
 
+    /// Reading the network's descriptive strings
+    std::string network_id () const { return m_networkId;   }
+    std::string target_name() const { return m_targetName;  }
+    std::string created    () const { return m_created;     }
+    std::string modified   () const { return m_modified;    }
+    std::string description() const { return m_description; }
+    std::string user_name  () const { return m_userName;    }
+
     /// Returns the number of control measures associated with this
     /// control point.
     size_t size() const { return m_control_points.size(); }
@@ -407,6 +421,9 @@ namespace ba {
     size_t find_measure(ControlMeasure const& query);
 
     /// File I/O
+    ///
+    /// read_binary() also accepts the columnar format written by
+    /// ControlNetworkWriter (see ControlNetworkView.h).
     void read_binary ( std::string const& filename );
     void read_isis   ( std::string const& filename );
     void write_binary( std::string        filename ) const;
@@ -416,6 +433,10 @@ namespace ba {
 
   std::ostream& operator<<( std::ostream& os, ControlNetwork const& cnet);
 
+  /// The current time in the form used for the ISIS Created and
+  /// LastModified fields.
+  std::string isis_style_time_string();
+
   /// I/O for ISIS Pvl file
   void read_pvl_property( std::ostringstream& ostr,
                           std::vector< std::string >& tokens );
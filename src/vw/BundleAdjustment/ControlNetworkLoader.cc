@@ -17,6 +17,8 @@
 
 
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Stereo/StereoModel.h>
 #include <vw/InterestPoint/Matcher.h>
 
@@ -24,20 +26,13 @@ using namespace vw;
 using namespace vw::ba;
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
 
-namespace fs = boost::filesystem;
-
-struct ContainsEqualIP {
-  ip::InterestPoint& m_compare;
-  ContainsEqualIP( ip::InterestPoint& comp ) : m_compare(comp) {}
+#include <algorithm>
+#include <limits>
 
-  bool operator()( boost::shared_ptr<IPFeature> in ) {
-    if (  m_compare.x == in->m_ip.x &&
-          m_compare.y == in->m_ip.y )
-      return true;
-    return false;
-  }
-};
+namespace fs = boost::filesystem;
 
 // Utility for checking that the point is BA safe
 void safe_measurement( ip::InterestPoint& ip ) {
@@ -96,6 +91,210 @@ double vw::ba::triangulate_control_point( ControlPoint& cp,
   }
 }
 
+namespace {
+
+  // Matches read from one match file. Only the geometry of the
+  // interest points is kept.
+  struct PairMatches {
+    std::vector<Vector3f> ip1, ip2; // x, y, scale
+    std::string error;              // Set if the file couldn't be read
+  };
+
+  // Reads a group of match files.
+  class ReadMatchesTask : public Task {
+    std::vector<std::string> const& m_files;
+    std::vector<PairMatches>      & m_matches;
+    size_t m_begin, m_end;
+
+    static void copy_geometry( std::vector<ip::InterestPoint>& ip, std::vector<Vector3f>& out ) {
+      out.resize( ip.size() );
+      for ( size_t i = 0; i < ip.size(); i++ ) {
+        safe_measurement( ip[i] );
+        out[i] = Vector3f( ip[i].x, ip[i].y, ip[i].scale );
+      }
+    }
+  public:
+    ReadMatchesTask( std::vector<std::string> const& files, std::vector<PairMatches>& matches,
+                     size_t begin, size_t end ) :
+      m_files(files), m_matches(matches), m_begin(begin), m_end(end) {}
+
+    void operator()() {
+      for ( size_t i = m_begin; i < m_end; i++ ) {
+        try {
+          std::vector<ip::InterestPoint> ip1, ip2;
+          vw_out(DebugMessage,"ba") << "Loading: " << m_files[i] << std::endl;
+          ip::read_binary_match_file( m_files[i], ip1, ip2 );
+          copy_geometry( ip1, m_matches[i].ip1 );
+          copy_geometry( ip2, m_matches[i].ip2 );
+        } catch ( const std::exception& e ) {
+          m_matches[i].error = e.what();
+        }
+      }
+    }
+  };
+
+  // A feature is an interest point in a given image. Matches refer to
+  // the same feature when they share the image and pixel location.
+  struct FeatureKey {
+    size_t image;
+    float  x, y;
+    FeatureKey( size_t image, float x, float y ) : image(image), x(x), y(y) {}
+    bool operator==( FeatureKey const& other ) const {
+      return image == other.image && x == other.x && y == other.y;
+    }
+  };
+
+  struct FeatureKeyHash {
+    size_t operator()( FeatureKey const& key ) const {
+      size_t seed = 0;
+      boost::hash_combine( seed, key.image );
+      // Equal keys must hash equally, and -0 == 0
+      boost::hash_combine( seed, key.x == 0 ? 0.0f : key.x );
+      boost::hash_combine( seed, key.y == 0 ? 0.0f : key.y );
+      return seed;
+    }
+  };
+
+  // Union-find over the features, linking the ones that form a track.
+  class FeatureTracks {
+    std::vector<size_t> m_parent, m_size;
+  public:
+    size_t add() {
+      m_parent.push_back( m_parent.size() );
+      m_size.push_back( 1 );
+      return m_parent.size() - 1;
+    }
+    size_t find( size_t i ) {
+      size_t root = i;
+      while ( m_parent[root] != root )
+        root = m_parent[root];
+      while ( m_parent[i] != root ) {
+        size_t next = m_parent[i];
+        m_parent[i] = root;
+        i = next;
+      }
+      return root;
+    }
+    void join( size_t i, size_t j ) {
+      i = find(i);
+      j = find(j);
+      if ( i == j )
+        return;
+      if ( m_size[i] < m_size[j] )
+        std::swap( i, j );
+      m_parent[j] = i;
+      m_size[i] += m_size[j];
+    }
+  };
+
+  // Features and the links between them, in the order they were matched.
+  struct FeatureGraph {
+    std::vector<size_t>   image;
+    std::vector<Vector3f> geometry; // x, y, scale of the first match
+    // Links of feature i are neighbors[offset[i]] to neighbors[offset[i+1]]
+    std::vector<size_t>   offset, neighbors;
+  };
+
+  // Builds the control points of a range of tracks. The measures are
+  // listed in depth first order from the track's first feature, and
+  // tracks that visit an image twice (spiral errors) are dropped.
+  class AssembleTask : public Task {
+    FeatureGraph        const& m_graph;
+    std::vector<size_t> const& m_starts;
+    ControlMeasure      const& m_prototype;
+    size_t                     m_num_images;
+    std::vector<uint8>       & m_visited;
+    std::vector<ControlPoint>& m_points;
+    std::vector<uint8>       & m_spiral;
+    size_t m_begin, m_end;
+  public:
+    AssembleTask( FeatureGraph const& graph, std::vector<size_t> const& starts,
+                  ControlMeasure const& prototype, size_t num_images,
+                  std::vector<uint8>& visited, std::vector<ControlPoint>& points,
+                  std::vector<uint8>& spiral, size_t begin, size_t end ) :
+      m_graph(graph), m_starts(starts), m_prototype(prototype), m_num_images(num_images),
+      m_visited(visited), m_points(points), m_spiral(spiral), m_begin(begin), m_end(end) {}
+
+    void operator()() {
+      const size_t none = std::numeric_limits<size_t>::max();
+      std::vector<size_t> last_track( m_num_images, none );
+      std::vector<size_t> features;
+      std::vector<std::pair<size_t,size_t> > stack;
+      for ( size_t t = m_begin; t < m_end; t++ ) {
+        // Tracks are disjoint, so each task only touches its own
+        // entries of m_visited.
+        const size_t start = m_starts[t];
+        features.clear();
+        features.push_back( start );
+        m_visited[start] = 1;
+        stack.push_back( std::make_pair( start, m_graph.offset[start] ) );
+        while ( !stack.empty() ) {
+          std::pair<size_t,size_t>& top = stack.back();
+          if ( top.second == m_graph.offset[top.first+1] ) {
+            stack.pop_back();
+            continue;
+          }
+          size_t next = m_graph.neighbors[top.second++];
+          if ( !m_visited[next] ) {
+            m_visited[next] = 1;
+            features.push_back( next );
+            stack.push_back( std::make_pair( next, m_graph.offset[next] ) );
+          }
+        }
+
+        m_spiral[t] = 0;
+        for ( size_t i = 0; i < features.size(); i++ ) {
+          size_t image = m_graph.image[features[i]];
+          if ( last_track[image] == t )
+            m_spiral[t] = 1;
+          last_track[image] = t;
+        }
+        if ( m_spiral[t] )
+          continue;
+
+        ControlPoint& cpoint = m_points[t];
+        for ( size_t i = 0; i < features.size(); i++ ) {
+          Vector3f const& g = m_graph.geometry[features[i]];
+          ControlMeasure cm( m_prototype );
+          cm.set_position( g[0], g[1] );
+          cm.set_sigma( g[2], g[2] );
+          cm.set_image_id( m_graph.image[features[i]] );
+          cpoint.add_measure( cm );
+        }
+      }
+    }
+  };
+
+  class TriangulateTask : public Task {
+    ControlNetwork& m_cnet;
+    std::vector<boost::shared_ptr<camera::CameraModel> > const& m_camera_models;
+    double m_min_angle;
+    size_t m_begin, m_end;
+    Mutex& m_mutex;
+    TerminalProgressCallback& m_progress;
+  public:
+    TriangulateTask( ControlNetwork& cnet,
+                     std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models,
+                     double min_angle, size_t begin, size_t end,
+                     Mutex& mutex, TerminalProgressCallback& progress ) :
+      m_cnet(cnet), m_camera_models(camera_models), m_min_angle(min_angle),
+      m_begin(begin), m_end(end), m_mutex(mutex), m_progress(progress) {}
+
+    void operator()() {
+      for ( size_t i = m_begin; i < m_end; i++ )
+        ba::triangulate_control_point( m_cnet[i], m_camera_models, m_min_angle );
+      Mutex::Lock lock( m_mutex );
+      m_progress.report_incremental_progress( double(m_end - m_begin) / double(m_cnet.size()) );
+    }
+  };
+
+  // Splits [0,size) into chunks for the work queue.
+  size_t num_chunks( size_t size, int num_threads ) {
+    return std::max( size_t(1), std::min( size, size_t(num_threads) * 8 ) );
+  }
+
+} // end anonymous namespace
+
 bool vw::ba::build_control_network( bool triangulate_control_points,
                                     ba::ControlNetwork& cnet,
                                     std::vector<boost::shared_ptr<camera::CameraModel> >
@@ -103,19 +302,21 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
                                     std::vector<std::string> const& image_files,
                                     std::map< std::pair<int, int>, std::string> const& match_files,
                                     size_t min_matches,
-                                    double min_angle) {
+                                    double min_angle,
+                                    int num_threads ) {
   cnet.clear();
+  if ( image_files.empty() )
+    vw_throw( ArgumentErr() << "CameraRelation network is empty." );
+  if ( num_threads <= 0 )
+    num_threads = vw_settings().default_num_threads();
 
   // We can't guarantee that image_files is sorted, so we make a
   // std::map to give ourselves a sorted list and access to a binary search.
   std::map<std::string,size_t> image_prefix_map;
   size_t count = 0;
-  ba::CameraRelationNetwork<ba::IPFeature> crn;
   BOOST_FOREACH( std::string const& file, image_files ) {
     fs::path file_path(file);
     image_prefix_map[file_path.replace_extension().string()] = count;
-    crn.add_node( ba::CameraNode<ba::IPFeature>( count,
-                                                 file_path.stem().string() ) );
     count++;
   }
 
@@ -158,85 +359,182 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
     }
   }
 
-  size_t num_load_rejected = 0, num_loaded = 0;
-  for (size_t file_iter = 0; file_iter < match_files_vec.size(); file_iter++){
-    std::string match_file = match_files_vec[file_iter];
-    size_t index1 = index1_vec[file_iter];
-    size_t index2 = index2_vec[file_iter];
-
-    // Actually read in the file as it seems we've found something correct
-    std::vector<ip::InterestPoint> ip1, ip2;
-    vw_out(DebugMessage,"ba") << "Loading: " << match_file << std::endl;
-    ip::read_binary_match_file( match_file, ip1, ip2 );
-    if ( ip1.size() < min_matches ) {
-      vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
-                                << ip1.size() << " matches. [rejected]\n";
-      num_load_rejected += ip1.size();
-    } else {
+  // 1.) Reading all the match files in parallel
+  std::vector<PairMatches> matches( match_files_vec.size() );
+  {
+    FifoWorkQueue queue( num_threads );
+    size_t chunks = num_chunks( match_files_vec.size(), num_threads );
+    for ( size_t c = 0; c < chunks; c++ ) {
+      boost::shared_ptr<Task>
+        task( new ReadMatchesTask( match_files_vec, matches,
+                                   c * match_files_vec.size() / chunks,
+                                   (c + 1) * match_files_vec.size() / chunks ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+  }
+
+  // 2.) Merging the matches into features, in match file order. A
+  //     hash index finds existing features, and the union-find links
+  //     them into tracks.
+  FeatureGraph graph;
+  FeatureTracks tracks;
+  std::vector<std::pair<size_t,size_t> > links;
+  {
+    typedef boost::unordered_map<FeatureKey, size_t, FeatureKeyHash> FeatureIndex;
+    FeatureIndex feature_index;
+
+    size_t num_load_rejected = 0, num_loaded = 0;
+    TerminalProgressCallback progress("ba", "Building: ");
+    progress.report_progress(0);
+    for (size_t file_iter = 0; file_iter < match_files_vec.size(); file_iter++){
+      progress.report_progress( double(file_iter) / double(match_files_vec.size()) );
+      PairMatches& pair = matches[file_iter];
+      if ( !pair.error.empty() )
+        vw_throw( IOErr() << pair.error );
+
+      std::string const& match_file = match_files_vec[file_iter];
+      const size_t index[2] = { index1_vec[file_iter], index2_vec[file_iter] };
+      if ( pair.ip1.size() < min_matches ) {
+        vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
+                                  << pair.ip1.size() << " matches. [rejected]\n";
+        num_load_rejected += pair.ip1.size();
+        continue;
+      }
       vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
-                                << ip1.size() << " matches.\n";
-      num_loaded += ip1.size();
-
-      // Remove descriptors from interest points and correct scale
-      std::for_each( ip1.begin(), ip1.end(), ip::remove_descriptor );
-      std::for_each( ip2.begin(), ip2.end(), ip::remove_descriptor );
-      std::for_each( ip1.begin(), ip1.end(), safe_measurement );
-      std::for_each( ip2.begin(), ip2.end(), safe_measurement );
-
-      typedef boost::shared_ptr< ba::IPFeature > f_ptr;
-      typedef std::list< f_ptr >::iterator f_itr;
-
-      // Checking to see if features already exist, adding if they
-      // don't, then linking them.
-      vw_out() << "Building the control network for " << match_file <<".\n";
-      TerminalProgressCallback progress("ba", "Building: ");
-      progress.report_progress(0);
-      double inc_prog = 1.0/double(ip1.size());
-      for ( size_t k = 0; k < ip1.size(); k++ ) {
-        f_itr ipfeature1 = std::find_if( crn[index1].begin(),
-                                         crn[index1].end(),
-                                         ContainsEqualIP( ip1[k] ) );
-        f_itr ipfeature2 = std::find_if( crn[index2].begin(),
-                                         crn[index2].end(),
-                                         ContainsEqualIP( ip2[k] ) );
-        if ( ipfeature1 == crn[index1].end() ) {
-          crn[index1].relations.push_front( f_ptr( new ba::IPFeature( ip1[k], index1 ) ) );
-          ipfeature1 = crn[index1].begin();
-        }
-        if ( ipfeature2 == crn[index2].end() ) {
-          crn[index2].relations.push_front( f_ptr( new ba::IPFeature( ip2[k], index2 ) ) );
-          ipfeature2 = crn[index2].begin();
+                                << pair.ip1.size() << " matches.\n";
+      num_loaded += pair.ip1.size();
+
+      for ( size_t k = 0; k < pair.ip1.size(); k++ ) {
+        size_t feature[2];
+        for ( int side = 0; side < 2; side++ ) {
+          Vector3f const& ip = side == 0 ? pair.ip1[k] : pair.ip2[k];
+          std::pair<FeatureIndex::iterator, bool> inserted =
+            feature_index.insert( std::make_pair( FeatureKey( index[side], ip[0], ip[1] ),
+                                                  graph.image.size() ) );
+          feature[side] = inserted.first->second;
+          if ( inserted.second ) {
+            graph.image.push_back( index[side] );
+            graph.geometry.push_back( ip );
+            tracks.add();
+          }
         }
+        links.push_back( std::make_pair( feature[0], feature[1] ) );
+        tracks.join( feature[0], feature[1] );
+      }
 
-        // Doubly linking
-        (*ipfeature1)->connection( *ipfeature2, false );
-        (*ipfeature2)->connection( *ipfeature1, false );
-	progress.report_incremental_progress(inc_prog );
-      } // End loop through ip1
-      progress.report_finished();
+      // Release the file's matches as soon as they are merged
+      std::vector<Vector3f>().swap( pair.ip1 );
+      std::vector<Vector3f>().swap( pair.ip2 );
+    } // End loop through match files
+    progress.report_finished();
+
+    if ( num_load_rejected != 0 ) {
+      vw_out(WarningMessage,"ba") << "\tDidn't load " << num_load_rejected
+                                  << " matches due to inadequacy. Decrease the"
+                                  << " --min-matches parameter to load smaller "
+                                  << "sets of matches.\n";
+      vw_out(WarningMessage,"ba") << "\tLoaded " << num_loaded << " matches.\n";
+    }
+  }
+  std::vector<PairMatches>().swap( matches );
+
+  // Links of each feature in the order they were made
+  const size_t num_features = graph.image.size();
+  graph.offset.assign( num_features + 1, 0 );
+  for ( size_t i = 0; i < links.size(); i++ ) {
+    graph.offset[links[i].first  + 1]++;
+    graph.offset[links[i].second + 1]++;
+  }
+  for ( size_t i = 0; i < num_features; i++ )
+    graph.offset[i+1] += graph.offset[i];
+  graph.neighbors.resize( graph.offset[num_features] );
+  {
+    std::vector<size_t> fill( graph.offset.begin(), graph.offset.end() - 1 );
+    for ( size_t i = 0; i < links.size(); i++ ) {
+      graph.neighbors[fill[links[i].first ]++] = links[i].second;
+      graph.neighbors[fill[links[i].second]++] = links[i].first;
     }
-  } // End loop through match files
-
-  if ( num_load_rejected != 0 ) {
-    vw_out(WarningMessage,"ba") << "\tDidn't load " << num_load_rejected
-                                << " matches due to inadequacy. Decrease the"
-                                << " --min-matches parameter to load smaller "
-                                << "sets of matches.\n";
-    vw_out(WarningMessage,"ba") << "\tLoaded " << num_loaded << " matches.\n";
+  }
+  std::vector<std::pair<size_t,size_t> >().swap( links );
+
+  // 3.) Ordering the tracks. Control points are listed by image, and
+  //     within an image the most recently matched feature comes
+  //     first. Each track starts at its first feature in that order.
+  const size_t none = std::numeric_limits<size_t>::max();
+  std::vector<size_t> track_start( num_features, none );
+  for ( size_t i = 0; i < num_features; i++ ) {
+    size_t& start = track_start[ tracks.find(i) ];
+    if ( start == none || graph.image[i] < graph.image[start] ||
+         ( graph.image[i] == graph.image[start] && i > start ) )
+      start = i;
+  }
+  std::vector<std::pair<size_t,size_t> > ordered_starts;
+  for ( size_t i = 0; i < num_features; i++ )
+    if ( track_start[i] != none )
+      ordered_starts.push_back( std::make_pair( graph.image[track_start[i]],
+                                                none - track_start[i] ) );
+  std::vector<size_t>().swap( track_start );
+  std::sort( ordered_starts.begin(), ordered_starts.end() );
+  std::vector<size_t> starts( ordered_starts.size() );
+  for ( size_t i = 0; i < starts.size(); i++ )
+    starts[i] = none - ordered_starts[i].second;
+  std::vector<std::pair<size_t,size_t> >().swap( ordered_starts );
+
+  // 4.) Assembling the control points of the tracks in parallel
+  std::vector<ControlPoint> points( starts.size() );
+  std::vector<uint8> spiral( starts.size(), 0 );
+  {
+    ControlMeasure prototype( 0, 0, 0, 0, 0 );
+    std::vector<uint8> visited( num_features, 0 );
+    FifoWorkQueue queue( num_threads );
+    size_t chunks = num_chunks( starts.size(), num_threads );
+    for ( size_t c = 0; c < chunks; c++ ) {
+      boost::shared_ptr<Task>
+        task( new AssembleTask( graph, starts, prototype, image_files.size(), visited,
+                                points, spiral, c * starts.size() / chunks,
+                                (c + 1) * starts.size() / chunks ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
   }
 
-  // Building control network
-  bool success = crn.write_controlnetwork( cnet );
+  int spiral_error_count = 0;
+  for ( size_t t = 0; t < points.size(); t++ ) {
+    if ( spiral[t] ) {
+      spiral_error_count++;
+      continue;
+    }
+    cnet.add_control_point( points[t] );
+  }
+  std::vector<ControlPoint>().swap( points );
+  if ( spiral_error_count != 0 )
+    vw_out(WarningMessage,"ba") << "\t"
+                                << spiral_error_count
+                                << " control points removed due to spiral errors.\n";
+
+  bool success = true;
+  if ( cnet.size() == 0) {
+    vw_out(WarningMessage,"ba")
+      << "Failed to load any points, control network is empty.";
+    success = false;
+  }
 
-  // Triangulating Positions
+  // 5.) Triangulating Positions
   if (triangulate_control_points){
     TerminalProgressCallback progress("ba", "Triangulating: ");
     progress.report_progress(0);
-    double inc_prog = 1.0/double(cnet.size());
-    BOOST_FOREACH( ba::ControlPoint& cpoint, cnet ) {
-      progress.report_incremental_progress(inc_prog );
-      ba::triangulate_control_point( cpoint, camera_models, min_angle );
+    Mutex mutex;
+    FifoWorkQueue queue( num_threads );
+    size_t chunks = num_chunks( cnet.size(), num_threads );
+    for ( size_t c = 0; c < chunks && cnet.size(); c++ ) {
+      boost::shared_ptr<Task>
+        task( new TriangulateTask( cnet, camera_models, min_angle,
+                                   c * cnet.size() / chunks, (c + 1) * cnet.size() / chunks,
+                                   mutex, progress ) );
+      queue.add_task( task );
     }
+    queue.join_all();
     progress.report_finished();
   }
   return success;
@@ -36,6 +36,10 @@ namespace ba {
   /// image names. This function uses Boost::FS to then find match files
   /// that would have been created by 'ipmatch' by searching the entire
   /// permutation of the image_files vector.
+  ///
+  /// The match files are read, and the control points assembled and
+  /// triangulated, using num_threads threads (the VW default if zero).
+  /// The camera models must then be safe to use from several threads.
   bool build_control_network(bool triangulate_points,
                              ControlNetwork& cnet,
                              std::vector<boost::shared_ptr<camera::CameraModel> >
@@ -43,7 +47,8 @@ namespace ba {
                              std::vector<std::string> const& image_files,
                              std::map< std::pair<int, int>, std::string> const& match_files,
                              size_t min_matches,
-                             double min_angle);
+                             double min_angle,
+                             int num_threads = 0);
   
   /// Recomputes the world location of a point based on camera observations.
   /// - Returns the mean triangulation error.
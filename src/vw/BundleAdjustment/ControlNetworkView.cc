@@ -0,0 +1,523 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ControlNetworkView.cc
+///
+
+#include <vw/config.h>
+#include <vw/BundleAdjustment/ControlNetworkView.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#if VW_HAVE_PKG_BOOST_IOSTREAMS
+#include <boost/iostreams/device/mapped_file.hpp>
+#endif
+
+namespace vw {
+namespace ba {
+
+  namespace {
+
+    const char   CNET_MAGIC[8] = { 'V','W','C','N','E','T','C','L' };
+    const uint32 CNET_VERSION   = 1;
+    const uint64 CNET_ALIGNMENT = 64;
+
+    enum CnetField {
+      // Point table
+      CNET_POINT_POSITION, CNET_POINT_SIGMA, CNET_POINT_ID, CNET_POINT_TYPE,
+      CNET_POINT_IGNORE, CNET_POINT_MEASURES,
+      // Measure table, sorted by point
+      CNET_POSITION, CNET_SIGMA, CNET_DIAMETER, CNET_FOCALPLANE, CNET_EPHEMERIS_TIME,
+      CNET_CAMERA, CNET_TYPE, CNET_FLAGS, CNET_STRINGS,
+      // Camera table, sorted by image id
+      CNET_CAMERA_IMAGE_ID, CNET_CAMERA_MEASURES, CNET_CAMERA_INDEX,
+      // String table
+      CNET_STRING_OFFSETS, CNET_STRING_DATA,
+      CNET_NUM_FIELDS };
+
+    // Bits of the measure flags column
+    const uint8 CNET_IGNORE          = 1;
+    const uint8 CNET_PIXELS_DOMINANT = 2;
+
+    // All values are stored in native byte order, like the original format.
+    struct CnetHeader {
+      char   magic[8];
+      uint32 version;
+      uint32 header_size;
+      uint64 num_points, num_measures, num_cameras, num_strings, string_bytes;
+      int32  network_type;
+      uint32 network_strings[6]; // Id, target, created, modified, description, user
+      uint32 reserved;
+      uint64 offset[CNET_NUM_FIELDS]; // Byte offset of each array in the file
+      uint64 file_size;
+    };
+
+    uint64 cnet_align( uint64 pos ) {
+      return (pos + CNET_ALIGNMENT - 1) / CNET_ALIGNMENT * CNET_ALIGNMENT;
+    }
+
+    CnetHeader cnet_header( uint64 num_points, uint64 num_measures, uint64 num_cameras,
+                            uint64 num_strings, uint64 string_bytes ) {
+      CnetHeader header;
+      std::memset( &header, 0, sizeof(header) );
+      std::memcpy( header.magic, CNET_MAGIC, sizeof(CNET_MAGIC) );
+      header.version      = CNET_VERSION;
+      header.header_size  = sizeof(CnetHeader);
+      header.num_points   = num_points;
+      header.num_measures = num_measures;
+      header.num_cameras  = num_cameras;
+      header.num_strings  = num_strings;
+      header.string_bytes = string_bytes;
+
+      const uint64 N = num_points, M = num_measures, C = num_cameras;
+      const uint64 size[CNET_NUM_FIELDS] =
+        { 3*N*sizeof(double), 3*N*sizeof(double), N*sizeof(uint32), N, N, (N+1)*sizeof(uint64),
+          2*M*sizeof(float), 2*M*sizeof(float), M*sizeof(float), 2*M*sizeof(double),
+          M*sizeof(double), M*sizeof(uint32), M, M, 4*M*sizeof(uint32),
+          C*sizeof(uint64), (C+1)*sizeof(uint64), M*sizeof(uint64),
+          (num_strings+1)*sizeof(uint64), string_bytes };
+      uint64 pos = cnet_align( sizeof(CnetHeader) );
+      for ( int i = 0; i < CNET_NUM_FIELDS; ++i ) {
+        header.offset[i] = pos;
+        pos = cnet_align( pos + size[i] );
+      }
+      header.file_size = pos;
+      return header;
+    }
+
+    // Zero pad the stream up to an absolute position.
+    void pad_to( std::ostream& f, uint64 pos ) {
+      static const char zeros[CNET_ALIGNMENT] = {0};
+      uint64 current = f.tellp();
+      while ( current < pos ) {
+        uint64 count = std::min( pos - current, CNET_ALIGNMENT );
+        f.write( zeros, count );
+        current += count;
+      }
+    }
+
+    template <class T>
+    void write_block( std::ostream& f, uint64 offset, std::vector<T> const& data ) {
+      pad_to( f, offset );
+      if ( !data.empty() )
+        f.write( (char const*)&data[0], data.size() * sizeof(T) );
+    }
+
+    // Reads the header strings and point count of a network in the
+    // original binary format, leaving the stream at the first point.
+    struct BinaryNetworkHeader {
+      std::string target_name, network_id, created, modified, description, user_name;
+      ControlNetwork::ControlNetworkType type;
+      int size;
+
+      void read( std::istream& f ) {
+        std::getline( f, target_name, '\0' );
+        std::getline( f, network_id,  '\0' );
+        std::getline( f, created,     '\0' );
+        std::getline( f, modified,    '\0' );
+        std::getline( f, description, '\0' );
+        std::getline( f, user_name,   '\0' );
+        f.read((char*)&(type), sizeof(type));
+        f.read((char*)&(size), sizeof(size));
+      }
+    };
+
+  } // anonymous namespace
+
+  ////////////////////////////
+  // Control Network Writer //
+  ////////////////////////////
+
+  ControlNetworkWriter::ControlNetworkWriter( std::string const& filename, std::string id,
+                                              ControlNetwork::ControlNetworkType type,
+                                              std::string target_name,
+                                              std::string descrip, std::string user_name )
+    : m_filename( filename ), m_closed( false ), m_type( type ) {
+    m_file.open( filename.c_str(), std::ios::binary | std::ios::out );
+    if ( !m_file.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << filename << "\" for writing." );
+
+    m_network_strings[0] = id;
+    m_network_strings[1] = target_name;
+    m_network_strings[2] = isis_style_time_string();
+    m_network_strings[4] = descrip;
+    m_network_strings[5] = user_name;
+    m_point_measures.push_back( 0 );
+  }
+
+  ControlNetworkWriter::~ControlNetworkWriter() {
+    if ( m_closed )
+      return;
+    try {
+      close();
+    } catch ( const Exception& e ) {
+      vw_out(ErrorMessage) << "ControlNetworkWriter: failed to write \""
+                           << m_filename << "\": " << e.what() << std::endl;
+    }
+  }
+
+  uint32 ControlNetworkWriter::intern( std::string const& str ) {
+    std::map<std::string, uint32>::iterator iter = m_string_ids.find( str );
+    if ( iter != m_string_ids.end() )
+      return iter->second;
+    uint32 id = m_string_list.size();
+    m_string_ids.insert( std::make_pair( str, id ) );
+    m_string_list.push_back( str );
+    return id;
+  }
+
+  void ControlNetworkWriter::add_control_point( ControlPoint const& point ) {
+    VW_ASSERT( !m_closed, LogicErr() << "ControlNetworkWriter: the file has been closed." );
+
+    // Same rule as ControlNetwork::add_control_point
+    if ( point.type() == ControlPoint::GroundControlPoint )
+      m_type = ControlNetwork::ImageToGround;
+
+    Vector3 position = point.position(), sigma = point.sigma();
+    for ( int i = 0; i < 3; ++i ) {
+      m_point_position.push_back( position[i] );
+      m_point_sigma   .push_back( sigma[i]    );
+    }
+    m_point_id    .push_back( intern( point.id() ) );
+    m_point_type  .push_back( uint8( point.type() ) );
+    m_point_ignore.push_back( point.ignore() );
+
+    for ( ControlPoint::const_iterator cm = point.begin(); cm != point.end(); ++cm ) {
+      m_position      .push_back( cm->position()[0]   );
+      m_position      .push_back( cm->position()[1]   );
+      m_sigma         .push_back( cm->sigma()[0]      );
+      m_sigma         .push_back( cm->sigma()[1]      );
+      m_diameter      .push_back( cm->diameter()      );
+      m_focalplane    .push_back( cm->focalplane()[0] );
+      m_focalplane    .push_back( cm->focalplane()[1] );
+      m_ephemeris_time.push_back( cm->ephemeris_time() );
+      m_image_id      .push_back( cm->image_id()      );
+      m_type_column   .push_back( uint8( cm->type() ) );
+      m_flags.push_back( (cm->ignore() ? CNET_IGNORE : 0) |
+                         (cm->is_pixels_dominant() ? CNET_PIXELS_DOMINANT : 0) );
+      m_strings.push_back( intern( cm->serial()      ) );
+      m_strings.push_back( intern( cm->date_time()   ) );
+      m_strings.push_back( intern( cm->description() ) );
+      m_strings.push_back( intern( cm->chooser()     ) );
+    }
+    m_point_measures.push_back( m_image_id.size() );
+  }
+
+  void ControlNetworkWriter::close() {
+    if ( m_closed )
+      return;
+    m_closed = true;
+
+    if ( m_network_strings[3].empty() )
+      m_network_strings[3] = isis_style_time_string();
+    uint32 network_strings[6];
+    for ( int i = 0; i < 6; ++i )
+      network_strings[i] = intern( m_network_strings[i] );
+
+    // Camera table: the distinct image ids, and each camera's measures
+    // gathered with a counting sort so they stay in index order.
+    std::vector<uint64> camera_image_id( m_image_id );
+    std::sort( camera_image_id.begin(), camera_image_id.end() );
+    camera_image_id.erase( std::unique( camera_image_id.begin(), camera_image_id.end() ),
+                           camera_image_id.end() );
+    const size_t num_measures = m_image_id.size();
+    std::vector<uint32> camera( num_measures );
+    std::vector<uint64> camera_measures( camera_image_id.size() + 1, 0 );
+    for ( size_t m = 0; m < num_measures; ++m ) {
+      camera[m] = std::lower_bound( camera_image_id.begin(), camera_image_id.end(),
+                                    m_image_id[m] ) - camera_image_id.begin();
+      ++camera_measures[camera[m]+1];
+    }
+    for ( size_t c = 0; c < camera_image_id.size(); ++c )
+      camera_measures[c+1] += camera_measures[c];
+    std::vector<uint64> camera_index( num_measures );
+    {
+      std::vector<uint64> next( camera_measures.begin(), camera_measures.end() - 1 );
+      for ( size_t m = 0; m < num_measures; ++m )
+        camera_index[next[camera[m]]++] = m;
+    }
+    std::vector<uint64>().swap( m_image_id );
+
+    // String table
+    std::vector<uint64> string_offsets( 1, 0 );
+    std::string string_data;
+    for ( size_t s = 0; s < m_string_list.size(); ++s ) {
+      string_data += m_string_list[s];
+      string_offsets.push_back( string_data.size() );
+    }
+
+    CnetHeader header = cnet_header( m_point_id.size(), num_measures, camera_image_id.size(),
+                                     m_string_list.size(), string_data.size() );
+    header.network_type = m_type;
+    std::copy( network_strings, network_strings + 6, header.network_strings );
+
+    std::ofstream& f = m_file;
+    f.write( (char const*)&header, sizeof(header) );
+    write_block( f, header.offset[CNET_POINT_POSITION ], m_point_position );
+    write_block( f, header.offset[CNET_POINT_SIGMA    ], m_point_sigma    );
+    write_block( f, header.offset[CNET_POINT_ID       ], m_point_id       );
+    write_block( f, header.offset[CNET_POINT_TYPE     ], m_point_type     );
+    write_block( f, header.offset[CNET_POINT_IGNORE   ], m_point_ignore   );
+    write_block( f, header.offset[CNET_POINT_MEASURES ], m_point_measures );
+    write_block( f, header.offset[CNET_POSITION       ], m_position       );
+    write_block( f, header.offset[CNET_SIGMA          ], m_sigma          );
+    write_block( f, header.offset[CNET_DIAMETER       ], m_diameter       );
+    write_block( f, header.offset[CNET_FOCALPLANE     ], m_focalplane     );
+    write_block( f, header.offset[CNET_EPHEMERIS_TIME ], m_ephemeris_time );
+    write_block( f, header.offset[CNET_CAMERA         ], camera           );
+    write_block( f, header.offset[CNET_TYPE           ], m_type_column    );
+    write_block( f, header.offset[CNET_FLAGS          ], m_flags          );
+    write_block( f, header.offset[CNET_STRINGS        ], m_strings        );
+    write_block( f, header.offset[CNET_CAMERA_IMAGE_ID], camera_image_id  );
+    write_block( f, header.offset[CNET_CAMERA_MEASURES], camera_measures  );
+    write_block( f, header.offset[CNET_CAMERA_INDEX   ], camera_index     );
+    write_block( f, header.offset[CNET_STRING_OFFSETS ], string_offsets   );
+    pad_to( f, header.offset[CNET_STRING_DATA] );
+    f.write( string_data.data(), string_data.size() );
+    pad_to( f, header.file_size );
+    f.close();
+    if ( !f )
+      vw_throw( IOErr() << "Failed to write \"" << m_filename << "\"." );
+  }
+
+  void write_control_network_view( std::string const& filename, ControlNetwork const& cnet ) {
+    ControlNetworkWriter writer( filename, cnet.network_id(), cnet.type(), cnet.target_name(),
+                                 cnet.description(), cnet.user_name() );
+    writer.set_created( cnet.created() );
+    for ( ControlNetwork::const_iterator cp = cnet.begin(); cp != cnet.end(); ++cp )
+      writer.add_control_point( *cp );
+    writer.close();
+  }
+
+  void convert_control_network( std::string const& input, ControlStorageFmt fmt,
+                                std::string const& output ) {
+    if ( fmt == FmtIsisPvl ) {
+      ControlNetwork cnet( "Null" );
+      cnet.read_isis( input );
+      write_control_network_view( output, cnet );
+      return;
+    }
+
+    std::ifstream f( input.c_str(), std::ios::binary | std::ios::in );
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << input << "\" as a Control Network." );
+    BinaryNetworkHeader header;
+    header.read( f );
+    if ( !f || header.size < 0 )
+      vw_throw( IOErr() << "Control Network \"" << input << "\" is truncated or corrupt." );
+
+    ControlNetworkWriter writer( output, header.network_id, header.type, header.target_name,
+                                 header.description, header.user_name );
+    writer.set_created ( header.created  );
+    writer.set_modified( header.modified );
+    for ( int p = 0; p < header.size; ++p ) {
+      ControlPoint point( f, FmtBinary );
+      if ( !f )
+        vw_throw( IOErr() << "Control Network \"" << input << "\" is truncated." );
+      writer.add_control_point( point );
+    }
+    writer.close();
+  }
+
+  ////////////////////////////
+  // Control Network View   //
+  ////////////////////////////
+
+  struct ControlNetworkView::Storage {
+#if VW_HAVE_PKG_BOOST_IOSTREAMS
+    boost::iostreams::mapped_file_source file;
+#endif
+    std::string buffer; // Used when the file can't be mapped
+  };
+
+  bool ControlNetworkView::is_view_file( std::string const& filename ) {
+    std::ifstream f( filename.c_str(), std::ios::binary | std::ios::in );
+    char magic[8];
+    f.read( magic, sizeof(magic) );
+    return f.gcount() == sizeof(magic) && std::memcmp( magic, CNET_MAGIC, sizeof(magic) ) == 0;
+  }
+
+  ControlNetworkView::ControlNetworkView( std::string const& filename )
+    : m_storage( new Storage ) {
+
+    if ( !is_view_file( filename ) )
+      vw_throw( IOErr() << "\"" << filename << "\" is not a columnar Control Network." );
+
+    char const* data;
+    uint64      data_size;
+#if VW_HAVE_PKG_BOOST_IOSTREAMS
+    m_storage->file.open( filename );
+    data      = m_storage->file.data();
+    data_size = m_storage->file.size();
+#else
+    std::ifstream in( filename.c_str(), std::ios::binary | std::ios::in );
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    m_storage->buffer = contents.str();
+    data      = m_storage->buffer.data();
+    data_size = m_storage->buffer.size();
+#endif
+
+    if ( data_size < sizeof(CnetHeader) )
+      vw_throw( IOErr() << "Control Network \"" << filename << "\" is truncated or corrupt." );
+    CnetHeader header;
+    std::memcpy( &header, data, sizeof(header) );
+    if ( header.version != CNET_VERSION || header.header_size != sizeof(CnetHeader) )
+      vw_throw( IOErr() << "Unsupported Control Network version in \"" << filename << "\"." );
+    CnetHeader expected = cnet_header( header.num_points, header.num_measures, header.num_cameras,
+                                       header.num_strings, header.string_bytes );
+    if ( std::memcmp( expected.offset, header.offset, sizeof(header.offset) ) != 0 ||
+         header.file_size != expected.file_size || data_size < header.file_size )
+      vw_throw( IOErr() << "Control Network \"" << filename << "\" is truncated or corrupt." );
+
+    m_num_points   = header.num_points;
+    m_num_measures = header.num_measures;
+    m_num_cameras  = header.num_cameras;
+    m_num_strings  = header.num_strings;
+    m_type         = ControlNetwork::ControlNetworkType( header.network_type );
+    std::copy( header.network_strings, header.network_strings + 6, m_network_strings );
+
+    m_point_position  = (double const*)( data + header.offset[CNET_POINT_POSITION ] );
+    m_point_sigma     = (double const*)( data + header.offset[CNET_POINT_SIGMA    ] );
+    m_point_id        = (uint32 const*)( data + header.offset[CNET_POINT_ID       ] );
+    m_point_type      = (uint8  const*)( data + header.offset[CNET_POINT_TYPE     ] );
+    m_point_ignore    = (uint8  const*)( data + header.offset[CNET_POINT_IGNORE   ] );
+    m_point_measures  = (uint64 const*)( data + header.offset[CNET_POINT_MEASURES ] );
+    m_position        = (float  const*)( data + header.offset[CNET_POSITION       ] );
+    m_sigma           = (float  const*)( data + header.offset[CNET_SIGMA          ] );
+    m_diameter        = (float  const*)( data + header.offset[CNET_DIAMETER       ] );
+    m_focalplane      = (double const*)( data + header.offset[CNET_FOCALPLANE     ] );
+    m_ephemeris_time  = (double const*)( data + header.offset[CNET_EPHEMERIS_TIME ] );
+    m_camera          = (uint32 const*)( data + header.offset[CNET_CAMERA         ] );
+    m_type_column     = (uint8  const*)( data + header.offset[CNET_TYPE           ] );
+    m_flags           = (uint8  const*)( data + header.offset[CNET_FLAGS          ] );
+    m_strings         = (uint32 const*)( data + header.offset[CNET_STRINGS        ] );
+    m_camera_image_id = (uint64 const*)( data + header.offset[CNET_CAMERA_IMAGE_ID] );
+    m_camera_measures = (uint64 const*)( data + header.offset[CNET_CAMERA_MEASURES] );
+    m_camera_index    = (uint64 const*)( data + header.offset[CNET_CAMERA_INDEX   ] );
+    m_string_offsets  = (uint64 const*)( data + header.offset[CNET_STRING_OFFSETS ] );
+    m_string_data     = (char   const*)( data + header.offset[CNET_STRING_DATA    ] );
+
+    // Only the ends of the index arrays are checked, so that opening a
+    // view does not touch the whole file.
+    bool valid = m_point_measures[0] == 0 && m_point_measures[m_num_points] == m_num_measures &&
+      m_camera_measures[0] == 0 && m_camera_measures[m_num_cameras] == m_num_measures &&
+      m_string_offsets[m_num_strings] == header.string_bytes;
+    for ( int i = 0; i < 6; ++i )
+      valid = valid && m_network_strings[i] < m_num_strings;
+    if ( !valid )
+      vw_throw( IOErr() << "Control Network \"" << filename << "\" is corrupt." );
+  }
+
+  size_t ControlNetworkView::measure_point( size_t m ) const {
+    VW_ASSERT( m < m_num_measures, ArgumentErr() << "ControlNetworkView: measure index "
+               << m << " exceeds " << m_num_measures << " measures." );
+    return std::upper_bound( m_point_measures, m_point_measures + m_num_points + 1, uint64(m) )
+      - m_point_measures - 1;
+  }
+
+  size_t ControlNetworkView::find_camera( uint64 image_id ) const {
+    uint64 const* iter = std::lower_bound( m_camera_image_id, m_camera_image_id + m_num_cameras,
+                                           image_id );
+    if ( iter != m_camera_image_id + m_num_cameras && *iter == image_id )
+      return iter - m_camera_image_id;
+    return m_num_cameras;
+  }
+
+  void ControlNetworkView::fill_measure( size_t m, ControlMeasure& cm ) const {
+    cm.set_position( measure_position(m) );
+    cm.set_sigma( measure_sigma(m) );
+    cm.set_diameter( measure_diameter(m) );
+    cm.set_focalplane( measure_focalplane(m) );
+    cm.set_ephemeris_time( measure_ephemeris_time(m) );
+    cm.set_image_id( measure_image_id(m) );
+    cm.set_type( measure_type(m) );
+    cm.set_ignore( measure_ignore(m) );
+    cm.set_pixels_dominant( measure_pixels_dominant(m) );
+    cm.set_serial( measure_serial(m) );
+    cm.set_date_time( measure_date_time(m) );
+    cm.set_description( measure_description(m) );
+    cm.set_chooser( measure_chooser(m) );
+  }
+
+  ControlMeasure ControlNetworkView::measure( size_t m ) const {
+    ControlMeasure cm;
+    fill_measure( m, cm );
+    return cm;
+  }
+
+  // The ControlMeasure constructors look up the current time, so
+  // measures are filled in from a scratch copy rather than constructed.
+  ControlPoint ControlNetworkView::make_point( size_t p, ControlMeasure& scratch ) const {
+    ControlPoint point( point_type(p) );
+    point.set_id( point_id(p) );
+    point.set_ignore( point_ignore(p) );
+    point.set_position( point_position(p) );
+    point.set_sigma( point_sigma(p) );
+    point.reserve( measures_end(p) - measures_begin(p) );
+    for ( size_t m = measures_begin(p); m < measures_end(p); ++m ) {
+      fill_measure( m, scratch );
+      point.add_measure( scratch );
+    }
+    return point;
+  }
+
+  ControlPoint ControlNetworkView::point( size_t p ) const {
+    ControlMeasure scratch;
+    return make_point( p, scratch );
+  }
+
+  void ControlNetworkView::get_network( ControlNetwork& cnet ) const {
+    cnet.m_type        = m_type;
+    cnet.m_networkId   = network_id();
+    cnet.m_targetName  = target_name();
+    cnet.m_created     = created();
+    cnet.m_modified    = modified();
+    cnet.m_description = description();
+    cnet.m_userName    = user_name();
+
+    cnet.m_control_points.clear();
+    cnet.m_control_points.reserve( m_num_points );
+    ControlMeasure scratch;
+    for ( size_t p = 0; p < m_num_points; ++p )
+      cnet.m_control_points.push_back( make_point( p, scratch ) );
+  }
+
+  void ControlNetworkView::write_binary( std::string const& filename ) const {
+    std::ofstream f( filename.c_str(), std::ios::binary | std::ios::out );
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << filename << "\" for writing." );
+
+    f << target_name() << char(0) << network_id() << char(0)
+      << created() << char(0) << modified() << char(0)
+      << description() << char(0) << user_name() << char(0);
+    f.write((char*)&(m_type), sizeof(m_type));
+    int size = m_num_points;
+    f.write((char*)&(size), sizeof(size));
+
+    ControlMeasure scratch;
+    for ( size_t p = 0; p < m_num_points; ++p )
+      make_point( p, scratch ).write_binary( f );
+    f.close();
+  }
+
+}} // namespace vw::ba
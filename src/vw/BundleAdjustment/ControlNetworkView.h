@@ -0,0 +1,240 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ControlNetworkView.h
+///
+/// A columnar file format for control networks and a read-only view
+/// of it that works straight off the file.
+///
+/// The file holds a point table, a measure table, a camera table and a
+/// string table, each stored as one array per field. A point's
+/// measures are a contiguous range of the measure table, and the
+/// camera table keeps the measure indices of each camera sorted in a
+/// range of its own, so both can be walked without creating any
+/// ControlPoint or ControlMeasure objects. Strings that repeat across
+/// measures (serial numbers, dates, chooser names) are stored once.
+///
+/// The file is memory mapped when Boost.Iostreams is available and
+/// read into a single buffer otherwise.
+
+#ifndef __VW_BUNDLEADJUSTMENT_CONTROL_NETWORK_VIEW_H__
+#define __VW_BUNDLEADJUSTMENT_CONTROL_NETWORK_VIEW_H__
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <vw/BundleAdjustment/ControlNetwork.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+namespace ba {
+
+  /// Writes a columnar control network file one control point at a
+  /// time. Only the compact column arrays are kept in memory; the
+  /// camera table is built and the file is written by close(), which
+  /// the destructor calls if needed.
+  class ControlNetworkWriter {
+    std::string   m_filename;
+    std::ofstream m_file;
+    bool          m_closed;
+
+    ControlNetwork::ControlNetworkType m_type;
+    std::string m_network_strings[6];
+
+    // Point table
+    std::vector<double> m_point_position, m_point_sigma;
+    std::vector<uint32> m_point_id;
+    std::vector<uint8 > m_point_type, m_point_ignore;
+    std::vector<uint64> m_point_measures;
+
+    // Measure table
+    std::vector<float > m_position, m_sigma, m_diameter;
+    std::vector<double> m_focalplane, m_ephemeris_time;
+    std::vector<uint64> m_image_id;
+    std::vector<uint8 > m_type_column, m_flags;
+    std::vector<uint32> m_strings;
+
+    // String table
+    std::map<std::string, uint32> m_string_ids;
+    std::vector<std::string>      m_string_list;
+
+    uint32 intern( std::string const& str );
+
+  public:
+    /// The arguments match those of the ControlNetwork constructor.
+    ControlNetworkWriter( std::string const& filename, std::string id,
+                          ControlNetwork::ControlNetworkType type = ControlNetwork::ImageToImage,
+                          std::string target_name = "Unknown",
+                          std::string descrip = "Null",
+                          std::string user_name = "VW" );
+    ~ControlNetworkWriter();
+
+    /// Override the creation and modification times. By default the
+    /// network is created now and modified when it is closed.
+    void set_created ( std::string const& created  ) { m_network_strings[2] = created;  }
+    void set_modified( std::string const& modified ) { m_network_strings[3] = modified; }
+
+    void add_control_point( ControlPoint const& point );
+
+    size_t num_points  () const { return m_point_id.size(); }
+    size_t num_measures() const { return m_image_id.size(); }
+
+    void close();
+  };
+
+  /// Write a control network in the columnar format.
+  void write_control_network_view( std::string const& filename, ControlNetwork const& cnet );
+
+  /// Convert a control network stored in one of the original formats
+  /// into the columnar format. Binary networks are converted one
+  /// control point at a time; ISIS networks are loaded in full first.
+  void convert_control_network( std::string const& input, ControlStorageFmt fmt,
+                                std::string const& output );
+
+  /// A read-only view of a columnar control network file. Nothing is
+  /// copied out of the file until it is asked for: points, measures
+  /// and cameras are addressed by index, and the ControlPoint and
+  /// ControlMeasure objects are only built by point(), measure() and
+  /// get_network().
+  ///
+  /// Copies of a view share the underlying file.
+  class ControlNetworkView {
+    struct Storage;
+    boost::shared_ptr<Storage> m_storage;
+
+    size_t m_num_points, m_num_measures, m_num_cameras, m_num_strings;
+    ControlNetwork::ControlNetworkType m_type;
+    uint32 m_network_strings[6];
+
+    double const * m_point_position, * m_point_sigma;
+    uint32 const * m_point_id;
+    uint8  const * m_point_type, * m_point_ignore;
+    uint64 const * m_point_measures;
+
+    float  const * m_position, * m_sigma, * m_diameter;
+    double const * m_focalplane, * m_ephemeris_time;
+    uint32 const * m_camera, * m_strings;
+    uint8  const * m_type_column, * m_flags;
+
+    uint64 const * m_camera_image_id, * m_camera_measures, * m_camera_index;
+
+    uint64 const * m_string_offsets;
+    char   const * m_string_data;
+
+    void fill_measure( size_t m, ControlMeasure& cm ) const;
+    ControlPoint make_point( size_t p, ControlMeasure& scratch ) const;
+
+  public:
+    explicit ControlNetworkView( std::string const& filename );
+
+    /// Returns true if the file starts like a columnar control network.
+    static bool is_view_file( std::string const& filename );
+
+    size_t num_points  () const { return m_num_points;   }
+    size_t num_measures() const { return m_num_measures; }
+    size_t num_cameras () const { return m_num_cameras;  }
+
+    /// Network information
+    ControlNetwork::ControlNetworkType type() const { return m_type; }
+    std::string network_id () const { return get_string(m_network_strings[0]); }
+    std::string target_name() const { return get_string(m_network_strings[1]); }
+    std::string created    () const { return get_string(m_network_strings[2]); }
+    std::string modified   () const { return get_string(m_network_strings[3]); }
+    std::string description() const { return get_string(m_network_strings[4]); }
+    std::string user_name  () const { return get_string(m_network_strings[5]); }
+
+    /// Point table
+    Vector3 point_position( size_t p ) const {
+      return Vector3( m_point_position[3*p], m_point_position[3*p+1], m_point_position[3*p+2] );
+    }
+    Vector3 point_sigma( size_t p ) const {
+      return Vector3( m_point_sigma[3*p], m_point_sigma[3*p+1], m_point_sigma[3*p+2] );
+    }
+    std::string point_id( size_t p ) const { return get_string( m_point_id[p] ); }
+    bool point_ignore( size_t p ) const { return m_point_ignore[p] != 0; }
+    ControlPoint::ControlPointType point_type( size_t p ) const {
+      return ControlPoint::ControlPointType( m_point_type[p] );
+    }
+
+    /// The measures of point p are [measures_begin(p), measures_end(p)).
+    size_t measures_begin( size_t p ) const { return m_point_measures[p];   }
+    size_t measures_end  ( size_t p ) const { return m_point_measures[p+1]; }
+
+    /// The point that measure m belongs to.
+    size_t measure_point( size_t m ) const;
+
+    /// Measure table
+    Vector2 measure_position( size_t m ) const { return Vector2( m_position[2*m], m_position[2*m+1] ); }
+    Vector2 measure_sigma   ( size_t m ) const { return Vector2( m_sigma[2*m], m_sigma[2*m+1] ); }
+    Vector2 measure_focalplane( size_t m ) const {
+      return Vector2( m_focalplane[2*m], m_focalplane[2*m+1] );
+    }
+    Vector2 measure_dominant( size_t m ) const {
+      return measure_pixels_dominant(m) ? measure_position(m) : measure_focalplane(m);
+    }
+    float  measure_diameter      ( size_t m ) const { return m_diameter[m];       }
+    double measure_ephemeris_time( size_t m ) const { return m_ephemeris_time[m]; }
+    bool   measure_ignore         ( size_t m ) const { return (m_flags[m] & 1) != 0; }
+    bool   measure_pixels_dominant( size_t m ) const { return (m_flags[m] & 2) != 0; }
+    ControlMeasure::ControlMeasureType measure_type( size_t m ) const {
+      return ControlMeasure::ControlMeasureType( m_type_column[m] );
+    }
+    std::string measure_serial     ( size_t m ) const { return get_string( m_strings[4*m]   ); }
+    std::string measure_date_time  ( size_t m ) const { return get_string( m_strings[4*m+1] ); }
+    std::string measure_description( size_t m ) const { return get_string( m_strings[4*m+2] ); }
+    std::string measure_chooser    ( size_t m ) const { return get_string( m_strings[4*m+3] ); }
+
+    /// The camera table index and image id of measure m.
+    size_t measure_camera  ( size_t m ) const { return m_camera[m]; }
+    uint64 measure_image_id( size_t m ) const { return m_camera_image_id[m_camera[m]]; }
+
+    /// Camera table. Cameras are sorted by image id, and the measures
+    /// of camera c are the sorted measure indices in
+    /// [camera_measures_begin(c), camera_measures_end(c)).
+    uint64 camera_image_id( size_t c ) const { return m_camera_image_id[c]; }
+    uint64 const* camera_measures_begin( size_t c ) const { return m_camera_index + m_camera_measures[c];   }
+    uint64 const* camera_measures_end  ( size_t c ) const { return m_camera_index + m_camera_measures[c+1]; }
+
+    /// Locate the camera with the given image id. Returns
+    /// num_cameras() if there is none.
+    size_t find_camera( uint64 image_id ) const;
+
+    /// String table
+    size_t num_strings() const { return m_num_strings; }
+    std::string get_string( size_t s ) const {
+      return std::string( m_string_data + m_string_offsets[s],
+                          m_string_data + m_string_offsets[s+1] );
+    }
+
+    /// Build objects from the view.
+    ControlMeasure measure( size_t m ) const;
+    ControlPoint   point  ( size_t p ) const;
+    void get_network( ControlNetwork& cnet ) const;
+
+    /// Write the network in the original binary format, one control
+    /// point at a time. Unlike ControlNetwork::write_binary() the file
+    /// name is used as given.
+    void write_binary( std::string const& filename ) const;
+  };
+
+}} // namespace vw::ba
+
+#endif // __VW_BUNDLEADJUSTMENT_CONTROL_NETWORK_VIEW_H__
@@ -30,6 +30,7 @@
 // Vision Workbench
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
+#include <vw/Math/DualNumber.h>
 #include <vw/BundleAdjustment/ControlNetwork.h>
 #include <vw/Core/Log.h>
 #include <vw/Camera/CameraModel.h>
@@ -140,6 +141,20 @@ namespace ba {
       return J;
     }
 
+    // Both jacobians of a measure. The adjusters call this rather
+    // than cam_jacobian() and point_jacobian(), so a model with
+    // analytic derivatives can override it and fill in both from one
+    // evaluation, for instance with dual_number_jacobians(). The
+    // default falls back to the finite differences above.
+    inline void jacobians( size_t i, size_t j,
+                           Vector<double, CameraParamsN> const& cam_j,
+                           Vector<double, PointParamsN> const& point_i,
+                           Matrix<double, 2, CameraParamsN>& A,
+                           Matrix<double, 2, PointParamsN>& B ) {
+      A = impl().cam_jacobian(i,j,cam_j,point_i);
+      B = impl().point_jacobian(i,j,cam_j,point_i);
+    }
+
     // -- Report Functions -------------------------------------------
 
     std::string image_unit          () { return "pixels";  }
@@ -169,6 +184,55 @@ namespace ba {
     }
   };
 
+  // Both jacobians of a measure by forward mode automatic
+  // differentiation, from a single evaluation of the projection. The
+  // model has to provide its projection as a template over the scalar
+  // type, next to cam_pixel():
+  //
+  //   template <class T>
+  //   Vector<T,2> project( size_t i, size_t j,
+  //                        Vector<T,camera_params_n> const& cam_j,
+  //                        Vector<T,point_params_n> const& point_i ) const;
+  //
+  // and can then override jacobians() to call this. As with the
+  // finite differences, the jacobians are zero if the point can't be
+  // projected into the camera.
+  template <class ModelT>
+  inline void dual_number_jacobians( ModelT const& model, size_t i, size_t j,
+                                     Vector<double, ModelT::camera_params_n> const& cam_j,
+                                     Vector<double, ModelT::point_params_n> const& point_i,
+                                     Matrix<double, 2, ModelT::camera_params_n>& A,
+                                     Matrix<double, 2, ModelT::point_params_n>& B ) {
+    const size_t camera_params_n = ModelT::camera_params_n;
+    const size_t point_params_n  = ModelT::point_params_n;
+    typedef math::DualNumber<ModelT::camera_params_n + ModelT::point_params_n> dual_type;
+
+    // The camera parameters are variables 0 to camera_params_n-1,
+    // followed by the point parameters.
+    Vector<dual_type, ModelT::camera_params_n> cam;
+    Vector<dual_type, ModelT::point_params_n> point;
+    for ( size_t n = 0; n < camera_params_n; ++n )
+      cam[n] = dual_type( cam_j[n], n );
+    for ( size_t n = 0; n < point_params_n; ++n )
+      point[n] = dual_type( point_i[n], camera_params_n + n );
+
+    Vector<dual_type, 2> pixel;
+    try {
+      pixel = model.template project<dual_type>( i, j, cam, point );
+    } catch (const camera::PointToPixelErr& e) {
+      A = Matrix<double, 2, ModelT::camera_params_n>();
+      B = Matrix<double, 2, ModelT::point_params_n>();
+      return;
+    }
+
+    for ( size_t r = 0; r < 2; ++r ) {
+      for ( size_t n = 0; n < camera_params_n; ++n )
+        A(r,n) = pixel[r].derivative( n );
+      for ( size_t n = 0; n < point_params_n; ++n )
+        B(r,n) = pixel[r].derivative( camera_params_n + n );
+    }
+  }
+
 }} // namespace vw::ba
 
 #endif//__VW_BUNDLEADJUSTMENT_MODEL_BASE_H__
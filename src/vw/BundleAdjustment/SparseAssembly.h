@@ -0,0 +1,448 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file SparseAssembly.h
+///
+/// Parallel assembly of the sparse normal equations, shared by
+/// AdjustSparse and AdjustRobustSparse.
+///
+/// Work on the point blocks (V, epsilon_b, W, Y) is split by point, so
+/// each thread owns the blocks it writes. The camera blocks (U,
+/// epsilon_a) are shared by every point a camera sees; each chunk of
+/// points sums into its own copy of them, and the copies are added up
+/// in chunk order afterwards. There are far fewer cameras than points,
+/// so the copies are cheap.
+///
+/// It also provides the reduced camera matrix S as a linear operator
+/// and its block Jacobi preconditioner, so that the reduced camera
+/// system can be solved by conjugate gradient without forming S.
+
+#ifndef __VW_BUNDLEADJUSTMENT_SPARSE_ASSEMBLY_H__
+#define __VW_BUNDLEADJUSTMENT_SPARSE_ASSEMBLY_H__
+
+#include <vw/Math/MatrixSparseSkyline.h>
+#include <vw/Math/ConjugateGradient.h>
+#include <vw/BundleAdjustment/AdjustBase.h>
+#include <vw/BundleAdjustment/CameraRelation.h>
+
+namespace vw {
+namespace ba {
+
+  template <class ModelT>
+  class SparseAssembly {
+  public:
+    typedef Matrix<double, 2, ModelT::camera_params_n> matrix_2_camera;
+    typedef Matrix<double, 2, ModelT::point_params_n> matrix_2_point;
+    typedef Matrix<double, ModelT::camera_params_n, ModelT::camera_params_n> matrix_camera_camera;
+    typedef Matrix<double, ModelT::point_params_n, ModelT::point_params_n> matrix_point_point;
+    typedef Vector<double, ModelT::camera_params_n> vector_camera;
+    typedef Vector<double, ModelT::point_params_n> vector_point;
+
+  private:
+    CameraRelationNetwork<JFeature>* m_crn;
+
+    // The measures of point i are m_features[m_point_begin[i]] up to
+    // m_features[m_point_begin[i+1]], in camera order.
+    std::vector<size_t>    m_point_begin;
+    std::vector<JFeature*> m_features;
+
+    static Matrix2x2 inverse_covariance( JFeature const& feature ) {
+      Matrix2x2 inverse_cov;
+      inverse_cov(0,0) = 1/(feature.m_scale[0]*feature.m_scale[0]);
+      inverse_cov(1,1) = 1/(feature.m_scale[1]*feature.m_scale[1]);
+      return inverse_cov;
+    }
+
+    // -- Chunk functions ----------------------------------------------
+
+    template <class WeightT>
+    struct AssembleFunc {
+      SparseAssembly const& self;
+      ModelT& model;
+      WeightT const& weight;
+      std::vector<matrix_point_point>& V;
+      std::vector<vector_point>& epsilon_b;
+      std::vector<std::vector<matrix_camera_camera> > U;
+      std::vector<std::vector<vector_camera> > epsilon_a;
+      std::vector<double> objective;
+
+      AssembleFunc( SparseAssembly const& self, ModelT& model, WeightT const& weight,
+                    std::vector<matrix_point_point>& V, std::vector<vector_point>& epsilon_b,
+                    size_t num_cameras, size_t num_chunks ) :
+        self(self), model(model), weight(weight), V(V), epsilon_b(epsilon_b),
+        U( num_chunks, std::vector<matrix_camera_camera>(num_cameras) ),
+        epsilon_a( num_chunks, std::vector<vector_camera>(num_cameras) ),
+        objective( num_chunks, 0 ) {}
+
+      void operator()( size_t chunk, size_t begin, size_t end ) {
+        matrix_2_camera A;
+        matrix_2_point B;
+        Vector2 error, residual;
+        for ( size_t i = begin; i < end; i++ ) {
+          vector_point point_i = model.point_params(i);
+          for ( size_t k = self.m_point_begin[i]; k < self.m_point_begin[i+1]; k++ ) {
+            JFeature& feature = *self.m_features[k];
+            size_t j = feature.m_camera_id;
+            evaluate_measure( model, i, j, feature.m_location, model.cam_params(j), point_i,
+                              A, B, error );
+
+            Matrix2x2 inverse_cov = inverse_covariance( feature );
+            double hessian_weight, cost;
+            weight( error, inverse_cov, hessian_weight, residual, cost );
+            objective[chunk] += cost;
+
+            U[chunk][j] += hessian_weight * transpose(A) * inverse_cov * A;
+            V[i] += hessian_weight * transpose(B) * inverse_cov * B;
+            epsilon_a[chunk][j] += transpose(A) * inverse_cov * residual;
+            epsilon_b[i] += transpose(B) * inverse_cov * residual;
+            feature.m_w = hessian_weight * transpose(A) * inverse_cov * B;
+          }
+        }
+      }
+    };
+
+    template <class WeightT>
+    struct ObjectiveFunc {
+      SparseAssembly const& self;
+      ModelT& model;
+      WeightT const& weight;
+      Vector<double> const& delta_a, & delta_b;
+      std::vector<double> objective;
+
+      ObjectiveFunc( SparseAssembly const& self, ModelT& model, WeightT const& weight,
+                     Vector<double> const& delta_a, Vector<double> const& delta_b,
+                     size_t num_chunks ) :
+        self(self), model(model), weight(weight), delta_a(delta_a), delta_b(delta_b),
+        objective( num_chunks, 0 ) {}
+
+      void operator()( size_t chunk, size_t begin, size_t end ) {
+        const size_t num_cam_params = ModelT::camera_params_n;
+        const size_t num_pt_params = ModelT::point_params_n;
+        for ( size_t i = begin; i < end; i++ ) {
+          vector_point new_b = model.point_params(i) +
+            subvector( delta_b, num_pt_params*i, num_pt_params );
+          for ( size_t k = self.m_point_begin[i]; k < self.m_point_begin[i+1]; k++ ) {
+            JFeature const& feature = *self.m_features[k];
+            size_t j = feature.m_camera_id;
+            vector_camera new_a = model.cam_params(j) +
+              subvector( delta_a, num_cam_params*j, num_cam_params );
+            Vector2 error = reprojection_error( model, i, j, feature.m_location, new_a, new_b );
+            objective[chunk] += weight.cost( error, inverse_covariance( feature ) );
+          }
+        }
+      }
+    };
+
+    struct YFunc {
+      SparseAssembly const& self;
+      std::vector<matrix_point_point> const& V_inverse;
+      YFunc( SparseAssembly const& self, std::vector<matrix_point_point> const& V_inverse ) :
+        self(self), V_inverse(V_inverse) {}
+
+      void operator()( size_t /*chunk*/, size_t begin, size_t end ) {
+        for ( size_t i = begin; i < end; i++ )
+          for ( size_t k = self.m_point_begin[i]; k < self.m_point_begin[i+1]; k++ )
+            self.m_features[k]->m_y = self.m_features[k]->m_w * V_inverse[i];
+      }
+    };
+
+    struct EFunc {
+      CameraRelationNetwork<JFeature>& crn;
+      std::vector<vector_point> const& epsilon_b;
+      Vector<double>& e;
+      EFunc( CameraRelationNetwork<JFeature>& crn, std::vector<vector_point> const& epsilon_b,
+             Vector<double>& e ) : crn(crn), epsilon_b(epsilon_b), e(e) {}
+
+      void operator()( size_t /*chunk*/, size_t begin, size_t end ) {
+        const size_t num_cam_params = ModelT::camera_params_n;
+        for ( size_t j = begin; j < end; j++ )
+          for ( CameraNode<JFeature>::iterator fiter = crn[j].begin();
+                fiter != crn[j].end(); fiter++ )
+            subvector(e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
+              * epsilon_b[ (**fiter).m_point_id ];
+      }
+    };
+
+    // The blocks of S in camera j's column: the diagonal block and
+    // the blocks of every camera k > j that shares a point with j.
+    struct SFunc {
+      CameraRelationNetwork<JFeature>& crn;
+      std::vector<matrix_camera_camera> const& U;
+      std::vector<matrix_camera_camera>& diagonal;
+      std::vector<std::vector<std::pair<size_t, matrix_camera_camera> > >& off_diagonal;
+      SFunc( CameraRelationNetwork<JFeature>& crn, std::vector<matrix_camera_camera> const& U,
+             std::vector<matrix_camera_camera>& diagonal,
+             std::vector<std::vector<std::pair<size_t, matrix_camera_camera> > >& off_diagonal ) :
+        crn(crn), U(U), diagonal(diagonal), off_diagonal(off_diagonal) {}
+
+      void operator()( size_t /*chunk*/, size_t begin, size_t end ) {
+        typedef std::multimap< size_t, boost::shared_ptr<JFeature> >::const_iterator mm_iterator;
+        for ( size_t j = begin; j < end; j++ ) {
+          // Iterate across all features seen by the camera
+          matrix_camera_camera S_jj;
+          for ( CameraNode<JFeature>::iterator fiter = crn[j].begin();
+                fiter != crn[j].end(); fiter++ )
+            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
+          diagonal[j] = S_jj + U[j];
+
+          // The features of camera j that are connected to camera k
+          // are consecutive in the map.
+          mm_iterator f_j_iter = crn[j].map.upper_bound( j );
+          while ( f_j_iter != crn[j].map.end() ) {
+            size_t k = f_j_iter->first;
+            matrix_camera_camera S_jk;
+            for ( ; f_j_iter != crn[j].map.end() && f_j_iter->first == k; f_j_iter++ ) {
+              typename std::map<size_t, boost::weak_ptr<JFeature> >::const_iterator f_k =
+                f_j_iter->second->m_map.find( k );
+              VW_ASSERT( f_k != f_j_iter->second->m_map.end(),
+                         LogicErr() << "SparseAssembly: feature is missing its link to camera " << k );
+              S_jk -= f_j_iter->second->m_y * transpose( f_k->second.lock()->m_w );
+            }
+            off_diagonal[j].push_back( std::make_pair( k, S_jk ) );
+          }
+        }
+      }
+    };
+
+    struct RightDeltaBFunc {
+      SparseAssembly const& self;
+      Vector<double> const& delta_a;
+      std::vector<vector_point>& right_delta_b;
+      RightDeltaBFunc( SparseAssembly const& self, Vector<double> const& delta_a,
+                       std::vector<vector_point>& right_delta_b ) :
+        self(self), delta_a(delta_a), right_delta_b(right_delta_b) {}
+
+      void operator()( size_t /*chunk*/, size_t begin, size_t end ) {
+        const size_t num_cam_params = ModelT::camera_params_n;
+        for ( size_t i = begin; i < end; i++ )
+          for ( size_t k = self.m_point_begin[i]; k < self.m_point_begin[i+1]; k++ ) {
+            JFeature const& feature = *self.m_features[k];
+            right_delta_b[i] += transpose( feature.m_w ) *
+              subvector( delta_a, feature.m_camera_id*num_cam_params, num_cam_params );
+          }
+      }
+    };
+
+    // S*x for camera j, given z_i = sum over k of transpose(W_ik)*x_k
+    // for every point i.
+    struct SchurProductFunc {
+      CameraRelationNetwork<JFeature>& crn;
+      std::vector<matrix_camera_camera> const& U;
+      std::vector<vector_point> const& z;
+      Vector<double> const& x;
+      Vector<double>& y;
+      SchurProductFunc( CameraRelationNetwork<JFeature>& crn, std::vector<matrix_camera_camera> const& U,
+                        std::vector<vector_point> const& z, Vector<double> const& x, Vector<double>& y ) :
+        crn(crn), U(U), z(z), x(x), y(y) {}
+
+      void operator()( size_t /*chunk*/, size_t begin, size_t end ) {
+        const size_t num_cam_params = ModelT::camera_params_n;
+        for ( size_t j = begin; j < end; j++ ) {
+          vector_camera y_j = U[j] * subvector( x, j*num_cam_params, num_cam_params );
+          for ( CameraNode<JFeature>::iterator fiter = crn[j].begin();
+                fiter != crn[j].end(); fiter++ )
+            y_j -= (**fiter).m_y * z[ (**fiter).m_point_id ];
+          subvector( y, j*num_cam_params, num_cam_params ) = y_j;
+        }
+      }
+    };
+
+    struct DiagonalInverseFunc {
+      CameraRelationNetwork<JFeature>& crn;
+      std::vector<matrix_camera_camera> const& U;
+      std::vector<matrix_camera_camera>& inverse;
+      DiagonalInverseFunc( CameraRelationNetwork<JFeature>& crn, std::vector<matrix_camera_camera> const& U,
+                           std::vector<matrix_camera_camera>& inverse ) :
+        crn(crn), U(U), inverse(inverse) {}
+
+      void operator()( size_t /*chunk*/, size_t begin, size_t end ) {
+        for ( size_t j = begin; j < end; j++ ) {
+          matrix_camera_camera S_jj = U[j];
+          for ( CameraNode<JFeature>::iterator fiter = crn[j].begin();
+                fiter != crn[j].end(); fiter++ )
+            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
+          matrix_camera_camera S_temp = S_jj;
+          if ( chol_inverse( S_temp ) )
+            inverse[j] = transpose(S_temp)*S_temp;
+          else
+            inverse[j].set_identity();
+        }
+      }
+    };
+
+  public:
+    SparseAssembly() : m_crn(0) {}
+
+    /// Index the measures of a camera relation network by point. The
+    /// network must outlive this object.
+    void index( CameraRelationNetwork<JFeature>& crn, size_t num_points ) {
+      m_crn = &crn;
+      m_point_begin.assign( num_points + 1, 0 );
+      for ( size_t j = 0; j < crn.size(); j++ )
+        BOOST_FOREACH( boost::shared_ptr<JFeature> const& feature, crn[j] )
+          m_point_begin[ feature->m_point_id + 1 ]++;
+      for ( size_t i = 0; i < num_points; i++ )
+        m_point_begin[i+1] += m_point_begin[i];
+      m_features.resize( m_point_begin[num_points] );
+      std::vector<size_t> next( m_point_begin.begin(), m_point_begin.end() - 1 );
+      for ( size_t j = 0; j < crn.size(); j++ )
+        BOOST_FOREACH( boost::shared_ptr<JFeature> const& feature, crn[j] )
+          m_features[ next[feature->m_point_id]++ ] = feature.get();
+    }
+
+    size_t num_points() const { return m_point_begin.size() - 1; }
+
+    /// Add the reprojection terms of every measure to U, V, epsilon_a
+    /// and epsilon_b, and store W in the features. WeightT turns the
+    /// error of a measure into the weight of its hessian terms, the
+    /// residual that enters epsilon, and its part of the objective.
+    /// Returns the sum of the objective parts.
+    template <class WeightT>
+    double assemble( ModelT& model, WeightT const& weight, int num_threads,
+                     std::vector<matrix_camera_camera>& U, std::vector<matrix_point_point>& V,
+                     std::vector<vector_camera>& epsilon_a, std::vector<vector_point>& epsilon_b ) const {
+      size_t num_chunks = adjust_num_chunks( num_points(), num_threads );
+      AssembleFunc<WeightT> func( *this, model, weight, V, epsilon_b, U.size(), num_chunks );
+      adjust_in_chunks( func, num_points(), num_chunks );
+
+      double objective = 0;
+      for ( size_t c = 0; c < num_chunks; c++ ) {
+        for ( size_t j = 0; j < U.size(); j++ ) {
+          U[j] += func.U[c][j];
+          epsilon_a[j] += func.epsilon_a[c][j];
+        }
+        objective += func.objective[c];
+      }
+      return objective;
+    }
+
+    /// The objective of the reprojection terms after applying an update.
+    template <class WeightT>
+    double objective( ModelT& model, WeightT const& weight, int num_threads,
+                      Vector<double> const& delta_a, Vector<double> const& delta_b ) const {
+      size_t num_chunks = adjust_num_chunks( num_points(), num_threads );
+      ObjectiveFunc<WeightT> func( *this, model, weight, delta_a, delta_b, num_chunks );
+      adjust_in_chunks( func, num_points(), num_chunks );
+      double objective = 0;
+      for ( size_t c = 0; c < num_chunks; c++ )
+        objective += func.objective[c];
+      return objective;
+    }
+
+    /// Compute Y = W * inverse(V) for every measure and subtract
+    /// Y * epsilon_b from e.
+    void compute_y( std::vector<matrix_point_point> const& V_inverse,
+                    std::vector<vector_point> const& epsilon_b,
+                    Vector<double>& e, int num_threads ) const {
+      YFunc y_func( *this, V_inverse );
+      adjust_in_chunks( y_func, num_points(), adjust_num_chunks( num_points(), num_threads ) );
+      EFunc e_func( *m_crn, epsilon_b, e );
+      adjust_in_chunks( e_func, m_crn->size(), adjust_num_chunks( m_crn->size(), num_threads ) );
+    }
+
+    /// Fill in the lower triangle of the reduced camera matrix S.
+    void build_S( math::MatrixSparseSkyline<double>& S,
+                  std::vector<matrix_camera_camera> const& U, int num_threads ) const {
+      const size_t num_cam_params = ModelT::camera_params_n;
+      const size_t num_cameras = m_crn->size();
+      std::vector<matrix_camera_camera> diagonal( num_cameras );
+      std::vector<std::vector<std::pair<size_t, matrix_camera_camera> > > off_diagonal( num_cameras );
+      SFunc func( *m_crn, U, diagonal, off_diagonal );
+      adjust_in_chunks( func, num_cameras, adjust_num_chunks( num_cameras, num_threads ) );
+
+      // The skyline matrix is filled on one thread
+      for ( size_t j = 0; j < num_cameras; j++ ) {
+        size_t offset = j * num_cam_params;
+        for ( size_t aa = 0; aa < num_cam_params; aa++ )
+          for ( size_t bb = aa; bb < num_cam_params; bb++ )
+            S( offset+bb, offset+aa ) = diagonal[j](aa,bb);  // Transposing
+
+        // - if it seems we are loading in oddly, it's because the sparse
+        //   matrix is row major.
+        for ( size_t b = 0; b < off_diagonal[j].size(); b++ )
+          submatrix( S, off_diagonal[j][b].first*num_cam_params, offset,
+                     num_cam_params, num_cam_params ) = transpose(off_diagonal[j][b].second);
+      }
+    }
+
+    /// right_delta_b[i] = sum over the measures of point i of
+    /// transpose(W) * delta_a.
+    void right_delta_b( Vector<double> const& delta_a, std::vector<vector_point>& right_delta_b,
+                        int num_threads ) const {
+      RightDeltaBFunc func( *this, delta_a, right_delta_b );
+      adjust_in_chunks( func, num_points(), adjust_num_chunks( num_points(), num_threads ) );
+    }
+
+    /// y = S*x, where S = U - sum over points of Y*transpose(W) is the
+    /// reduced camera matrix. Needs W and Y from assemble() and
+    /// compute_y().
+    void schur_product( std::vector<matrix_camera_camera> const& U, Vector<double> const& x,
+                        Vector<double>& y, int num_threads ) const {
+      std::vector<vector_point> z( num_points() );
+      right_delta_b( x, z, num_threads );
+      if ( y.size() != x.size() )
+        y = Vector<double>( x.size() );
+      SchurProductFunc func( *m_crn, U, z, x, y );
+      adjust_in_chunks( func, m_crn->size(), adjust_num_chunks( m_crn->size(), num_threads ) );
+    }
+
+    /// The inverses of the diagonal blocks of S. A block that isn't
+    /// positive definite is replaced by the identity.
+    void schur_diagonal_inverse( std::vector<matrix_camera_camera> const& U,
+                                 std::vector<matrix_camera_camera>& inverse, int num_threads ) const {
+      inverse.resize( m_crn->size() );
+      DiagonalInverseFunc func( *m_crn, U, inverse );
+      adjust_in_chunks( func, m_crn->size(), adjust_num_chunks( m_crn->size(), num_threads ) );
+    }
+
+    /// S as a linear operator for math::preconditioned_conjugate_gradient().
+    class SchurOperator {
+      SparseAssembly const& m_assembly;
+      std::vector<matrix_camera_camera> const& m_U;
+      int m_num_threads;
+    public:
+      SchurOperator( SparseAssembly const& assembly, std::vector<matrix_camera_camera> const& U,
+                     int num_threads ) : m_assembly(assembly), m_U(U), m_num_threads(num_threads) {}
+      void operator()( Vector<double> const& x, Vector<double>& y ) const {
+        m_assembly.schur_product( m_U, x, y, m_num_threads );
+      }
+    };
+
+    /// Block Jacobi preconditioner for S: applies the inverse of each
+    /// camera's diagonal block.
+    class BlockJacobiPreconditioner {
+      std::vector<matrix_camera_camera> m_inverse;
+    public:
+      BlockJacobiPreconditioner( SparseAssembly const& assembly,
+                                 std::vector<matrix_camera_camera> const& U, int num_threads ) {
+        assembly.schur_diagonal_inverse( U, m_inverse, num_threads );
+      }
+      void operator()( Vector<double> const& r, Vector<double>& z ) const {
+        const size_t num_cam_params = ModelT::camera_params_n;
+        if ( z.size() != r.size() )
+          z = Vector<double>( r.size() );
+        for ( size_t j = 0; j < m_inverse.size(); j++ )
+          subvector( z, j*num_cam_params, num_cam_params ) =
+            m_inverse[j] * subvector( r, j*num_cam_params, num_cam_params );
+      }
+    };
+  };
+
+}} // namespace vw::ba
+
+#endif//__VW_BUNDLEADJUSTMENT_SPARSE_ASSEMBLY_H__
@@ -45,11 +45,12 @@ class TestBAModel : public ba::ModelBase< TestBAModel, 6, 3 > {
   std::vector<camera_vector_t> m_cam_vec, m_cam_target_vec;
   std::vector<point_vector_t> m_point_vec, m_point_target_vec;
   size_t m_num_pixel_observations;
+  bool m_analytic;
 
 public:
   // Constructor
   TestBAModel( std::vector< boost::shared_ptr<PinholeModel> > const& cameras,
-               boost::shared_ptr<ControlNetwork> network ) : m_cameras(cameras), m_cnet(network) {
+               boost::shared_ptr<ControlNetwork> network ) : m_cameras(cameras), m_cnet(network), m_analytic(false) {
 
     // Compute the number of observations from the bundle.
     m_num_pixel_observations = 0;
@@ -88,6 +89,50 @@ public:
     return cam.point_to_pixel( point_i );
   }
 
+  // The same projection as cam_pixel(), written out over the scalar
+  // type so it can be differentiated with dual numbers. The test
+  // cameras have no lens distortion and unit pixel pitch.
+  template <class T>
+  Vector<T,2> project( size_t /*i*/, size_t j,
+                       Vector<T,6> const& cam_j,
+                       Vector<T,3> const& point_i ) const {
+    using std::sin; using std::cos;
+    Vector3 center = m_cameras[j]->camera_center( Vector2() );
+    Matrix<double,3,4> P = m_cameras[j]->camera_matrix();
+
+    // Undo the adjustment: R^T ( p - c - t ) + c, with R = Rz*Ry*Rx
+    Vector<T,3> d;
+    for ( size_t n = 0; n < 3; ++n )
+      d[n] = point_i[n] - center[n] - cam_j[n];
+    T cx = cos(cam_j[3]), sx = sin(cam_j[3]);
+    T cy = cos(cam_j[4]), sy = sin(cam_j[4]);
+    T cz = cos(cam_j[5]), sz = sin(cam_j[5]);
+    T u0 =  cz*d[0] + sz*d[1], u1 = cz*d[1] - sz*d[0];
+    T v0 =  cy*u0 - sy*d[2],   v2 = sy*u0 + cy*d[2];
+    Vector<T,3> p;
+    p[0] = v0 + center[0];
+    p[1] = cx*u1 + sx*v2 + center[1];
+    p[2] = cx*v2 - sx*u1 + center[2];
+
+    T denominator = P(2,0)*p[0] + P(2,1)*p[1] + P(2,2)*p[2] + P(2,3);
+    Vector<T,2> pixel;
+    pixel[0] = ( P(0,0)*p[0] + P(0,1)*p[1] + P(0,2)*p[2] + P(0,3) ) / denominator;
+    pixel[1] = ( P(1,0)*p[0] + P(1,1)*p[1] + P(1,2)*p[2] + P(1,3) ) / denominator;
+    return pixel;
+  }
+
+  // Use dual numbers instead of finite differences
+  void set_analytic( bool analytic ) { m_analytic = analytic; }
+
+  void jacobians( size_t i, size_t j, camera_vector_t const& cam_j,
+                  point_vector_t const& point_i,
+                  Matrix<double,2,6>& A, Matrix<double,2,3>& B ) {
+    if ( m_analytic )
+      dual_number_jacobians( *this, i, j, cam_j, point_i, A, B );
+    else
+      ba::ModelBase<TestBAModel,6,3>::jacobians( i, j, cam_j, point_i, A, B );
+  }
+
   inline Matrix<double,6,6> cam_inverse_covariance( size_t /*j*/ ) {
     Matrix<double,6,6> result;
     result.set_identity();
@@ -360,3 +405,166 @@ TEST_F( ComparisonTest, RobustRef_VS_RobustSparse ) {
                         spr_solution[i],
                         1e-2 );
 }
+
+// Threaded assembly sums in a different order, so only expect the
+// same answer up to round off. The camera and point constraints are
+// on so that the gauge freedom doesn't amplify it.
+template <class AdjusterT>
+std::vector<Vector<double> > adjust_with_threads( std::vector<boost::shared_ptr<PinholeModel> > const& cameras,
+                                                  boost::shared_ptr<ControlNetwork> cnet,
+                                                  int num_threads ) {
+  TestBAModel model( cameras, cnet );
+  AdjusterT adjuster( model, L2Error(), true, true );
+  adjuster.set_num_threads( num_threads );
+
+  double abs_tol = 1e10, rel_tol = 1e10;
+  for ( unsigned i = 0; i < 5; i++ )
+    adjuster.update(abs_tol,rel_tol);
+
+  std::vector<Vector<double> > solution;
+  for ( uint32 i = 0; i < 5; i++ )
+    solution.push_back( model.cam_params(i) );
+  return solution;
+}
+
+TEST_F( ComparisonTest, Threaded ) {
+  typedef AdjustRef< TestBAModel, L2Error > RefT;
+  typedef AdjustSparse< TestBAModel, L2Error > SparseT;
+  typedef AdjustRobustSparse< TestBAModel, L2Error > RobustSparseT;
+
+  std::vector<Vector<double> > single, multi;
+  single = adjust_with_threads<RefT>( cameras, cnet, 1 );
+  multi  = adjust_with_threads<RefT>( cameras, cnet, 3 );
+  for ( uint32 i = 0; i < 5; i++ )
+    EXPECT_VECTOR_NEAR( single[i], multi[i], 1e-6 );
+
+  single = adjust_with_threads<SparseT>( cameras, cnet, 1 );
+  multi  = adjust_with_threads<SparseT>( cameras, cnet, 3 );
+  for ( uint32 i = 0; i < 5; i++ )
+    EXPECT_VECTOR_NEAR( single[i], multi[i], 1e-6 );
+
+  single = adjust_with_threads<RobustSparseT>( cameras, cnet, 1 );
+  multi  = adjust_with_threads<RobustSparseT>( cameras, cnet, 3 );
+  for ( uint32 i = 0; i < 5; i++ )
+    EXPECT_VECTOR_NEAR( single[i], multi[i], 1e-6 );
+}
+
+// A chunk that fails with a specific error type
+struct ThrowingChunk {
+  void operator()( size_t chunk, size_t /*begin*/, size_t /*end*/ ) {
+    if ( chunk == 1 )
+      vw_throw( ArgumentErr() << "Bad chunk." );
+  }
+};
+
+TEST( AdjustBase, ChunkExceptionsPropagate ) {
+  ThrowingChunk func;
+  EXPECT_THROW( adjust_in_chunks( func, 10, 3 ), ArgumentErr );
+  EXPECT_NO_THROW( adjust_in_chunks( func, 10, 1 ) );
+}
+
+TEST_F( ComparisonTest, ConjugateGradient ) {
+  typedef AdjustSparse< TestBAModel, L2Error > SparseT;
+  std::vector<Vector<double> > direct_solution, cg_solution;
+  double direct_error, cg_error;
+
+  { // Solving the reduced camera system directly
+    TestBAModel model( cameras, cnet );
+    SparseT adjuster( model, L2Error(), true, true );
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 5; i++ )
+      adjuster.update(abs_tol,rel_tol);
+    direct_error = abs_tol;
+    for ( uint32 i = 0; i < 5; i++ )
+      direct_solution.push_back( model.cam_params(i) );
+  }
+
+  { // ... and to a tight tolerance with conjugate gradient
+    TestBAModel model( cameras, cnet );
+    SparseT adjuster( model, L2Error(), true, true );
+    adjuster.set_use_conjugate_gradient( true, 1e-12 );
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 5; i++ )
+      adjuster.update(abs_tol,rel_tol);
+    cg_error = abs_tol;
+    for ( uint32 i = 0; i < 5; i++ )
+      cg_solution.push_back( model.cam_params(i) );
+
+    // The skyline matrix can still be had for covariances
+    EXPECT_EQ( 5u*6u, adjuster.S().rows() );
+  }
+
+  EXPECT_NEAR( direct_error, cg_error, 1e-6 * direct_error );
+  for ( uint32 i = 0; i < 5; i++ )
+    EXPECT_VECTOR_NEAR( direct_solution[i], cg_solution[i], 1e-6 );
+}
+
+TEST_F( NullTest, AdjustSparseConjugateGradient ) {
+  TestBAModel model( cameras, cnet );
+  Vector<double,6> offset;
+  subvector(offset,0,3) = Vector3(0.1,-0.2,0.1);
+  subvector(offset,3,3) = Vector3(0.01,0,-0.01);
+  for ( uint32 j = 0; j < 5; j++ )
+    model.set_cam_params( j, model.cam_params(j) + offset );
+  AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), true, true );
+  adjuster.set_use_conjugate_gradient( true );
+
+  // Running BA with inexact steps
+  double abs_tol = 1e10, rel_tol = 1e10;
+  for ( uint32 i = 0; i < 10; i++ )
+    adjuster.update(abs_tol,rel_tol);
+
+  // Checking solutions
+  Vector<double,6> zero_vector;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    Vector<double> solution = model.cam_params(i);
+    EXPECT_VECTOR_NEAR( solution, zero_vector, 1e-1 );
+  }
+}
+
+TEST_F( ComparisonTest, DualNumberJacobians ) {
+  TestBAModel model( cameras, cnet );
+  Vector<double,6> cam_j;
+  subvector(cam_j,0,3) = Vector3(0.3,-0.2,0.5);
+  subvector(cam_j,3,3) = Vector3(0.02,-0.01,0.03);
+
+  for ( uint32 i = 0; i < cnet->size(); i++ ) {
+    for ( uint32 m = 0; m < (*cnet)[i].size(); m++ ) {
+      size_t j = (*cnet)[i][m].image_id();
+      Vector3 point_i = model.point_params(i);
+
+      // The templated projection agrees with the camera models
+      EXPECT_VECTOR_NEAR( model.cam_pixel( i, j, cam_j, point_i ),
+                          model.project<double>( i, j, cam_j, point_i ), 1e-8 );
+
+      Matrix<double,2,6> A_numeric, A_dual;
+      Matrix<double,2,3> B_numeric, B_dual;
+      model.set_analytic( false );
+      model.jacobians( i, j, cam_j, point_i, A_numeric, B_numeric );
+      model.set_analytic( true );
+      model.jacobians( i, j, cam_j, point_i, A_dual, B_dual );
+
+      EXPECT_MATRIX_NEAR( A_numeric, A_dual, 1e-3 * ( 1 + norm_frobenius(A_dual) ) );
+      EXPECT_MATRIX_NEAR( B_numeric, B_dual, 1e-3 * ( 1 + norm_frobenius(B_dual) ) );
+    }
+  }
+}
+
+TEST_F( ComparisonTest, DualNumberAdjustment ) {
+  typedef AdjustSparse< TestBAModel, L2Error > SparseT;
+  std::vector<Vector<double> > numeric, dual;
+
+  for ( int analytic = 0; analytic < 2; analytic++ ) {
+    TestBAModel model( cameras, cnet );
+    model.set_analytic( analytic );
+    SparseT adjuster( model, L2Error(), true, true );
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 5; i++ )
+      adjuster.update(abs_tol,rel_tol);
+    for ( uint32 j = 0; j < 5; j++ )
+      ( analytic ? dual : numeric ).push_back( model.cam_params(j) );
+  }
+
+  for ( uint32 j = 0; j < 5; j++ )
+    EXPECT_VECTOR_NEAR( numeric[j], dual[j], 1e-3 );
+}
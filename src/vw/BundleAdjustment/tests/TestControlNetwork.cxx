@@ -20,11 +20,13 @@
 
 #include <sstream>
 #include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/BundleAdjustment/ControlNetworkView.h>
 
 #include <test/Helpers.h>
 
 using namespace vw;
 using namespace vw::ba;
+using namespace vw::test;
 
 TEST( ControlNetwork, Construction ) {
 
@@ -88,3 +90,168 @@ TEST( ControlNetwork, Construction ) {
   cnet.clear();
   ASSERT_EQ( cnet.size(), 0u );
 }
+
+// A network that sets every field the file formats store
+ControlNetwork make_test_network() {
+  ControlNetwork cnet( "TestCNET", ControlNetwork::ImageToImage, "Moon", "Testing", "Tester" );
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ControlPoint cpoint( i == 3 ? ControlPoint::GroundControlPoint : ControlPoint::TiePoint );
+    cpoint.set_position( i, 2*i, 1000+i );
+    cpoint.set_sigma( 1, 2, 3+i );
+    cpoint.set_ignore( i == 1 );
+    if ( i != 2 ) {
+      std::ostringstream id;
+      id << "Point" << i;
+      cpoint.set_id( id.str() );
+    }
+    // Point 4 has no measures
+    for ( uint32 j = 0; j < i+1 && i != 4; j++ ) {
+      ControlMeasure cm( 10*i+j, 20*i-j, 0.5, 1.5, (i+j) % 3 == 0 ? 42 : 7+j );
+      cm.set_focalplane( 0.25*j, -0.5*i );
+      cm.set_ephemeris_time( 1e8 + j );
+      cm.set_diameter( j );
+      cm.set_ignore( j == 1 );
+      cm.set_pixels_dominant( i != 2 );
+      cm.set_type( j == 0 ? ControlMeasure::Manual : ControlMeasure::Automatic );
+      cm.set_serial( j % 2 ? "CameraA" : "CameraB" );
+      cm.set_chooser( "pprc" );
+      cm.set_date_time( "2013-01-01T00:00:00" );
+      cpoint.add_measure( cm );
+    }
+    cnet.add_control_point( cpoint );
+  }
+  return cnet;
+}
+
+void expect_networks_equal( ControlNetwork const& a, ControlNetwork const& b ) {
+  EXPECT_EQ( a.type(), b.type() );
+  EXPECT_EQ( a.network_id(), b.network_id() );
+  EXPECT_EQ( a.target_name(), b.target_name() );
+  EXPECT_EQ( a.description(), b.description() );
+  EXPECT_EQ( a.user_name(), b.user_name() );
+  EXPECT_EQ( a.created(), b.created() );
+  ASSERT_EQ( a.size(), b.size() );
+  for ( size_t p = 0; p < a.size(); p++ ) {
+    EXPECT_EQ( a[p].type(), b[p].type() );
+    EXPECT_EQ( a[p].id(), b[p].id() );
+    EXPECT_EQ( a[p].ignore(), b[p].ignore() );
+    EXPECT_VECTOR_DOUBLE_EQ( a[p].position(), b[p].position() );
+    EXPECT_VECTOR_DOUBLE_EQ( a[p].sigma(), b[p].sigma() );
+    ASSERT_EQ( a[p].size(), b[p].size() );
+    for ( size_t m = 0; m < a[p].size(); m++ ) {
+      ControlMeasure const& ma = a[p][m], & mb = b[p][m];
+      EXPECT_TRUE( ma == mb );
+      EXPECT_VECTOR_DOUBLE_EQ( ma.focalplane(), mb.focalplane() );
+      EXPECT_EQ( ma.diameter(), mb.diameter() );
+      EXPECT_EQ( ma.ignore(), mb.ignore() );
+      EXPECT_EQ( ma.is_pixels_dominant(), mb.is_pixels_dominant() );
+      EXPECT_EQ( ma.type(), mb.type() );
+      EXPECT_EQ( ma.serial(), mb.serial() );
+      EXPECT_EQ( ma.chooser(), mb.chooser() );
+      EXPECT_EQ( ma.date_time(), mb.date_time() );
+      EXPECT_EQ( ma.description(), mb.description() );
+    }
+  }
+}
+
+TEST( ControlNetwork, ViewTables ) {
+  ControlNetwork cnet = make_test_network();
+  UnlinkName view_file( "test.cnetv" );
+  write_control_network_view( view_file, cnet );
+
+  ControlNetworkView view( view_file );
+  EXPECT_EQ( view.type(), ControlNetwork::ImageToGround );
+  EXPECT_EQ( view.network_id(), "TestCNET" );
+  EXPECT_EQ( view.target_name(), "Moon" );
+  ASSERT_EQ( view.num_points(), 5u );
+  ASSERT_EQ( view.num_measures(), 10u );
+
+  // Walk the measures of each point
+  for ( size_t p = 0; p < view.num_points(); p++ ) {
+    EXPECT_VECTOR_DOUBLE_EQ( view.point_position(p), cnet[p].position() );
+    EXPECT_EQ( view.point_id(p), cnet[p].id() );
+    EXPECT_EQ( view.point_type(p), cnet[p].type() );
+    ASSERT_EQ( view.measures_end(p) - view.measures_begin(p), cnet[p].size() );
+    for ( size_t m = view.measures_begin(p); m < view.measures_end(p); m++ ) {
+      ControlMeasure const& cm = cnet[p][m - view.measures_begin(p)];
+      EXPECT_EQ( view.measure_point(m), p );
+      EXPECT_VECTOR_DOUBLE_EQ( view.measure_position(m), cm.position() );
+      EXPECT_VECTOR_DOUBLE_EQ( view.measure_dominant(m), cm.dominant() );
+      EXPECT_EQ( view.measure_image_id(m), cm.image_id() );
+      EXPECT_EQ( view.measure_ignore(m), cm.ignore() );
+      EXPECT_EQ( view.measure_serial(m), cm.serial() );
+    }
+  }
+
+  // Walk the measures of each camera
+  size_t count = 0;
+  for ( size_t c = 0; c < view.num_cameras(); c++ ) {
+    if ( c > 0 ) {
+      EXPECT_LT( view.camera_image_id(c-1), view.camera_image_id(c) );
+    }
+    EXPECT_EQ( view.find_camera( view.camera_image_id(c) ), c );
+    for ( uint64 const* m = view.camera_measures_begin(c); m != view.camera_measures_end(c); ++m ) {
+      if ( m != view.camera_measures_begin(c) ) {
+        EXPECT_LT( *(m-1), *m );
+      }
+      EXPECT_EQ( view.measure_camera(*m), c );
+      EXPECT_EQ( view.measure_image_id(*m), view.camera_image_id(c) );
+      count++;
+    }
+  }
+  EXPECT_EQ( count, view.num_measures() );
+  EXPECT_EQ( view.find_camera( 1000 ), view.num_cameras() );
+  size_t camera = view.find_camera( 42 );
+  ASSERT_LT( camera, view.num_cameras() );
+  EXPECT_EQ( view.camera_measures_end(camera) - view.camera_measures_begin(camera), 4 );
+
+  // Repeated strings are only stored once
+  EXPECT_LT( view.num_strings(), 15u );
+
+  // Objects built from the view
+  EXPECT_TRUE( view.measure(3) == cnet[2][0] );
+  ControlNetwork loaded( "Empty" );
+  view.get_network( loaded );
+  expect_networks_equal( cnet, loaded );
+  EXPECT_EQ( loaded.type(), ControlNetwork::ImageToGround );
+
+  // read_binary accepts the columnar format too
+  ControlNetwork read( view_file, FmtBinary );
+  expect_networks_equal( cnet, read );
+}
+
+TEST( ControlNetwork, ViewConversion ) {
+  ControlNetwork cnet = make_test_network();
+
+  // Original binary format -> columnar -> original binary format
+  UnlinkName binary_file( "test.cnet" ), view_file( "test.cnetv" ), binary_copy( "copy.cnet" );
+  cnet.write_binary( binary_file );
+  convert_control_network( binary_file, FmtBinary, view_file );
+  ControlNetworkView view( view_file );
+  EXPECT_EQ( view.modified(), cnet.modified() );
+  view.write_binary( binary_copy );
+  ControlNetwork copy( binary_copy, FmtBinary );
+  expect_networks_equal( cnet, copy );
+  EXPECT_EQ( copy.modified(), cnet.modified() );
+
+  // ISIS -> columnar
+  UnlinkName isis_file( "test.net" );
+  cnet.write_isis( isis_file );
+  ControlNetwork isis( isis_file, FmtIsisPvl );
+  convert_control_network( isis_file, FmtIsisPvl, view_file );
+  ControlNetwork from_isis( "Empty" );
+  ControlNetworkView( view_file ).get_network( from_isis );
+  expect_networks_equal( isis, from_isis );
+
+  // An empty network
+  ControlNetwork empty( "Empty" );
+  write_control_network_view( view_file, empty );
+  ControlNetworkView empty_view( view_file );
+  EXPECT_EQ( empty_view.num_points(), 0u );
+  EXPECT_EQ( empty_view.num_measures(), 0u );
+  EXPECT_EQ( empty_view.num_cameras(), 0u );
+
+  // Anything else is rejected
+  EXPECT_FALSE( ControlNetworkView::is_view_file( binary_file ) );
+  EXPECT_THROW( ControlNetworkView view2( binary_file ), IOErr );
+}
@@ -19,7 +19,9 @@
 #include <gtest/gtest_VW.h>
 
 #include <sstream>
+#include <cstdlib>
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
+#include <vw/InterestPoint/InterestData.h>
 
 #include <test/Helpers.h>
 
@@ -78,3 +80,103 @@ TEST( ControlNetworkLoad, LoadingGCPNET ) {
   ASSERT_EQ( 2u, net.size() );
   EXPECT_EQ( ControlPoint::GroundControlPoint, net[1].type() );
 }
+
+// Builds the network the way build_control_network did before it was
+// parallelized: by linking features in a CameraRelationNetwork.
+void reference_control_network( ControlNetwork& cnet, size_t num_images,
+                                std::vector<std::pair<size_t,size_t> > const& pairs,
+                                std::vector<std::string> const& match_files,
+                                size_t min_matches ) {
+  typedef boost::shared_ptr<IPFeature> f_ptr;
+  typedef std::list<f_ptr>::iterator f_itr;
+  CameraRelationNetwork<IPFeature> crn;
+  for ( size_t i = 0; i < num_images; i++ )
+    crn.add_node( CameraNode<IPFeature>( i, "" ) );
+
+  for ( size_t f = 0; f < match_files.size(); f++ ) {
+    std::vector<ip::InterestPoint> ip[2];
+    ip::read_binary_match_file( match_files[f], ip[0], ip[1] );
+    if ( ip[0].size() < min_matches )
+      continue;
+    size_t index[2] = { pairs[f].first, pairs[f].second };
+    for ( size_t k = 0; k < ip[0].size(); k++ ) {
+      f_itr feature[2];
+      for ( int side = 0; side < 2; side++ ) {
+        ip::InterestPoint& point = ip[side][k];
+        point.descriptor.set_size(0);
+        if ( point.scale <= 0 )
+          point.scale = 10;
+        feature[side] = crn[index[side]].end();
+        for ( f_itr it = crn[index[side]].begin(); it != crn[index[side]].end(); it++ )
+          if ( (*it)->m_ip.x == point.x && (*it)->m_ip.y == point.y ) {
+            feature[side] = it;
+            break;
+          }
+        if ( feature[side] == crn[index[side]].end() ) {
+          crn[index[side]].relations.push_front( f_ptr( new IPFeature( point, index[side] ) ) );
+          feature[side] = crn[index[side]].begin();
+        }
+      }
+      (*feature[0])->connection( *feature[1], false );
+      (*feature[1])->connection( *feature[0], false );
+    }
+  }
+  crn.write_controlnetwork( cnet );
+}
+
+TEST( ControlNetworkLoad, BuildFromMatches ) {
+  const size_t num_images = 4, pool_size = 12;
+  std::vector<std::string> image_names;
+  for ( size_t i = 0; i < num_images; i++ ) {
+    std::ostringstream name;
+    name << "cnet_image" << i << ".tif";
+    image_names.push_back( name.str() );
+  }
+
+  // Matches between random features of a small pool per image, so
+  // that tracks span several images and some loop back on an image.
+  srand(5);
+  std::map<std::pair<int,int>, std::string> match_map;
+  std::vector<std::pair<size_t,size_t> > pairs;
+  std::vector<std::string> match_files;
+  std::list<UnlinkName> unlink;
+  for ( size_t i = 0; i < num_images; i++ ) {
+    for ( size_t j = i+1; j < num_images; j++ ) {
+      std::vector<ip::InterestPoint> ip1, ip2;
+      size_t num_matches = (i == 0 && j == 3) ? 3 : 8;
+      for ( size_t k = 0; k < num_matches; k++ ) {
+        int a = rand() % pool_size, b = rand() % pool_size;
+        ip1.push_back( ip::InterestPoint( a * 1.5, a + 2, a % 3 ) );
+        ip2.push_back( ip::InterestPoint( b * 2.5, 7 - b, 2 ) );
+      }
+      std::ostringstream name;
+      name << "cnet_image" << i << "__cnet_image" << j << ".match";
+      unlink.push_back( UnlinkName( name.str() ) );
+      ip::write_binary_match_file( unlink.back(), ip1, ip2 );
+      match_map[std::make_pair(int(i), int(j))] = unlink.back();
+      pairs.push_back( std::make_pair( i, j ) );
+      match_files.push_back( unlink.back() );
+    }
+  }
+
+  ControlNetwork reference("reference");
+  reference_control_network( reference, num_images, pairs, match_files, 5 );
+
+  std::vector<boost::shared_ptr<camera::CameraModel> > cameras;
+  for ( int threads = 1; threads <= 3; threads += 2 ) {
+    ControlNetwork cnet("built");
+    EXPECT_TRUE( build_control_network( false, cnet, cameras, image_names,
+                                        match_map, 5, 0, threads ) );
+    ASSERT_EQ( reference.size(), cnet.size() );
+    EXPECT_LT( 1u, cnet.size() );
+    for ( size_t p = 0; p < cnet.size(); p++ ) {
+      ASSERT_EQ( reference[p].size(), cnet[p].size() );
+      EXPECT_EQ( reference[p].type(), cnet[p].type() );
+      for ( size_t m = 0; m < cnet[p].size(); m++ ) {
+        EXPECT_EQ( reference[p][m].image_id(), cnet[p][m].image_id() );
+        EXPECT_VECTOR_EQ( reference[p][m].position(), cnet[p][m].position() );
+        EXPECT_VECTOR_EQ( reference[p][m].sigma(), cnet[p][m].sigma() );
+      }
+    }
+  }
+}
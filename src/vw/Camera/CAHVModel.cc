@@ -150,6 +150,35 @@ namespace camera {
     return C;
   };
 
+  void CAHVModel::points_to_pixels(std::vector<Vector3> const& points,
+                                   std::vector<Vector2>      & pixels) const {
+    pixels.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+      pixels[i] = CAHVModel::point_to_pixel(points[i]);
+  }
+
+  void CAHVModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                    std::vector<Vector3>      & vectors) const {
+    // The handedness check in pixel_to_vector() is the same for every pixel.
+    const bool flip = dot_prod(cross_prod(V, H), A) < 0.0;
+    vectors.resize(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++) {
+      Vector3 vec =
+        normalize(cross_prod(V - pixels[i].y() * A,
+                             H - pixels[i].x() * A));
+      if (flip)
+        vec *= -1.0;
+      vectors[i] = vec;
+    }
+  }
+
+  void CAHVModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                 std::vector<Vector3>      & centers,
+                                 std::vector<Vector3>      & directions) const {
+    pixels_to_vectors(pixels, directions);
+    centers.assign(pixels.size(), C);
+  }
+
   // --------------------------------------------------
   //                 Private Methods
   // --------------------------------------------------
@@ -349,6 +349,27 @@ Vector3 CAHVORModel::pixel_to_vector(Vector2 const& pix) const {
 
 Vector3 CAHVORModel::camera_center( Vector2 const& pix ) const { return C; }
 
+void CAHVORModel::points_to_pixels(std::vector<Vector3> const& points,
+                                   std::vector<Vector2>      & pixels) const {
+  pixels.resize(points.size());
+  for (size_t i = 0; i < points.size(); i++)
+    pixels[i] = CAHVORModel::point_to_pixel(points[i]);
+}
+
+void CAHVORModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                    std::vector<Vector3>      & vectors) const {
+  vectors.resize(pixels.size());
+  for (size_t i = 0; i < pixels.size(); i++)
+    vectors[i] = CAHVORModel::pixel_to_vector(pixels[i]);
+}
+
+void CAHVORModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                 std::vector<Vector3>      & centers,
+                                 std::vector<Vector3>      & directions) const {
+  pixels_to_vectors(pixels, directions);
+  centers.assign(pixels.size(), C);
+}
+
 // vector_to_pixel with partial_derivatives
 Vector2 CAHVORModel::point_to_pixel(Vector3 const& point,
                                     Matrix<double> &partial_derivatives) const {
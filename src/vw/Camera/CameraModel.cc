@@ -32,16 +32,56 @@ CameraModel::camera_pose(Vector2 const& pix) const {
   return Quaternion<double>();
 }
 
+void CameraModel::points_to_pixels(std::vector<Vector3> const& points,
+                                   std::vector<Vector2>      & pixels) const {
+  pixels.resize(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    try {
+      pixels[i] = point_to_pixel(points[i]);
+    } catch (const PointToPixelErr& /*e*/) {
+      pixels[i] = invalid_pixel();
+    }
+  }
+}
+
+void CameraModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                    std::vector<Vector3>      & vectors) const {
+  vectors.resize(pixels.size());
+  for (size_t i = 0; i < pixels.size(); i++) {
+    try {
+      vectors[i] = pixel_to_vector(pixels[i]);
+    } catch (const PixelToRayErr& /*e*/) {
+      vectors[i] = Vector3();
+    }
+  }
+}
+
+void CameraModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                 std::vector<Vector3>      & centers,
+                                 std::vector<Vector3>      & directions) const {
+  centers.resize(pixels.size());
+  directions.resize(pixels.size());
+  for (size_t i = 0; i < pixels.size(); i++) {
+    try {
+      directions[i] = pixel_to_vector(pixels[i]);
+      centers   [i] = camera_center  (pixels[i]);
+    } catch (const PixelToRayErr& /*e*/) {
+      directions[i] = Vector3();
+      centers   [i] = Vector3();
+    }
+  }
+}
+
 AdjustedCameraModel::AdjustedCameraModel(boost::shared_ptr<CameraModel> camera_model,
                                          Vector3 const& translation, Quat const& rotation,
                                          Vector2 const& pixel_offset, double scale) :
   m_camera(camera_model),
   m_translation(translation),
-  m_rotation(rotation),
-  m_rotation_inverse(inverse(rotation)),
   m_pixel_offset(pixel_offset),
   m_scale(scale) {
 
+  set_rotation(rotation);
+
   // Set as the rotation center the old camera center for pixel (0,0).
   // It is important to note that for linescan cameras, each line has
   // its own camera center. It is not a problem that we use a single
@@ -76,6 +116,8 @@ Vector3 AdjustedCameraModel::axis_angle_rotation() const {
 void AdjustedCameraModel::set_rotation(Quat const& rotation) {
   m_rotation = rotation;
   m_rotation_inverse = inverse(m_rotation);
+  m_rotation_matrix = normalize(m_rotation).rotation_matrix();
+  m_rotation_inverse_matrix = transpose(m_rotation_matrix);
 }
 
 Vector2 AdjustedCameraModel::pixel_offset() const { return m_pixel_offset; }
@@ -84,17 +126,17 @@ double AdjustedCameraModel::scale() const { return m_scale; }
 
 Vector2 AdjustedCameraModel::point_to_pixel (Vector3 const& point) const {
   Vector3 offset_pt = point-m_rotation_center-m_translation;
-  Vector3 new_pt = m_rotation_inverse.rotate(offset_pt) + m_rotation_center;
+  Vector3 new_pt = m_rotation_inverse_matrix*offset_pt + m_rotation_center;
   return (m_camera->point_to_pixel(new_pt) - m_pixel_offset)/m_scale;
 }
 
 Vector3 AdjustedCameraModel::pixel_to_vector (Vector2 const& pix) const {
-  return m_rotation.rotate(m_camera->pixel_to_vector(m_scale*pix + m_pixel_offset));
+  return m_rotation_matrix*m_camera->pixel_to_vector(m_scale*pix + m_pixel_offset);
 }
 
 Vector3 AdjustedCameraModel::camera_center(Vector2 const& pix) const {
   Vector3 old_ct = m_camera->camera_center(m_scale*pix + m_pixel_offset);
-  return m_rotation.rotate(old_ct - m_rotation_center) + m_rotation_center + m_translation;
+  return m_rotation_matrix*(old_ct - m_rotation_center) + m_rotation_center + m_translation;
   // Old and incorrect formula below
   //return m_camera->camera_center(m_scale*pix + m_pixel_offset) + m_translation;
 }
@@ -103,6 +145,50 @@ Quat AdjustedCameraModel::camera_pose(Vector2 const& pix) const {
   return m_rotation*m_camera->camera_pose(m_scale*pix + m_pixel_offset);
 }
 
+// The batch versions transform all the points, then make one batch
+// call to the underlying camera.
+
+void AdjustedCameraModel::points_to_pixels(std::vector<Vector3> const& points,
+                                           std::vector<Vector2>      & pixels) const {
+  std::vector<Vector3> new_pts(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    Vector3 offset_pt = points[i]-m_rotation_center-m_translation;
+    new_pts[i] = m_rotation_inverse_matrix*offset_pt + m_rotation_center;
+  }
+  m_camera->points_to_pixels(new_pts, pixels);
+  for (size_t i = 0; i < pixels.size(); i++)
+    if (pixels[i] != invalid_pixel())
+      pixels[i] = (pixels[i] - m_pixel_offset)/m_scale;
+}
+
+void AdjustedCameraModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                            std::vector<Vector3>      & vectors) const {
+  std::vector<Vector2> old_pixels(pixels.size());
+  for (size_t i = 0; i < pixels.size(); i++)
+    old_pixels[i] = m_scale*pixels[i] + m_pixel_offset;
+  m_camera->pixels_to_vectors(old_pixels, vectors);
+  for (size_t i = 0; i < vectors.size(); i++)
+    vectors[i] = m_rotation_matrix*vectors[i];
+}
+
+void AdjustedCameraModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                         std::vector<Vector3>      & centers,
+                                         std::vector<Vector3>      & directions) const {
+  std::vector<Vector2> old_pixels(pixels.size());
+  for (size_t i = 0; i < pixels.size(); i++)
+    old_pixels[i] = m_scale*pixels[i] + m_pixel_offset;
+  m_camera->pixels_to_rays(old_pixels, centers, directions);
+  const Vector3 no_ray;
+  for (size_t i = 0; i < directions.size(); i++) {
+    if (directions[i] == no_ray) {
+      centers[i] = Vector3();
+      continue;
+    }
+    directions[i] = m_rotation_matrix*directions[i];
+    centers   [i] = m_rotation_matrix*(centers[i] - m_rotation_center) + m_rotation_center + m_translation;
+  }
+}
+
 void AdjustedCameraModel::write(std::string const& filename) {
   std::ofstream ostr(filename.c_str());
   ostr.precision(18);
@@ -25,6 +25,7 @@
 #define __VW_CAMERA_CAMERAMODEL_H__
 
 #include <fstream>
+#include <vector>
 #include <vw/Core/Exception.h>
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
@@ -88,6 +89,30 @@ namespace camera {
     /// - Generally the input pixel is only used for linescan cameras.
     virtual Vector3 camera_center(Vector2 const& pix) const = 0;
 
+    //------------------------------------------------------------------
+    // Batch Interface
+    //------------------------------------------------------------------
+    // These do the same as the methods above for many points at once,
+    // for callers like image transforms and stereo triangulation that
+    // work on whole tiles. Instead of throwing, a point that can't be
+    // projected gets invalid_pixel() and a pixel that can't be
+    // projected gets a zero vector.
+    // - The defaults call the single point methods. Subclasses can
+    //   override them to skip the virtual call and any per point setup.
+
+    /// Batch version of point_to_pixel().
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>      & pixels) const;
+
+    /// Batch version of pixel_to_vector().
+    virtual void pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>      & vectors) const;
+
+    /// Batch version of camera_center() and pixel_to_vector() together.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>      & centers,
+                                std::vector<Vector3>      & directions) const;
+
     /// Subclasses must define a method that return the camera type as a string.
     virtual std::string type() const = 0;
 
@@ -123,6 +148,10 @@ namespace camera {
     Quat m_rotation;
     Quat m_rotation_inverse;
 
+    // The rotations as matrices, which are much faster to apply.
+    Matrix3x3 m_rotation_matrix;
+    Matrix3x3 m_rotation_inverse_matrix;
+
     // apply the rotations in respect to this point.
     Vector3 m_rotation_center;
 
@@ -159,8 +188,7 @@ namespace camera {
 
     template <class MatrixT>
     void set_rotation(MatrixBase<MatrixT> const& m) {
-      m_rotation = Quat(m.impl());
-      m_rotation_inverse = inverse(m_rotation);
+      this->set_rotation( Quat(m.impl()) );
     }
     template <class VectorT>
     void set_translation(VectorBase<VectorT> const& v) {
@@ -185,6 +213,14 @@ namespace camera {
     virtual Vector3 camera_center  (Vector2 const&) const;
     virtual Quat    camera_pose    (Vector2 const&) const;
 
+    virtual void points_to_pixels (std::vector<Vector3> const& points,
+                                   std::vector<Vector2>      & pixels) const;
+    virtual void pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>      & vectors) const;
+    virtual void pixels_to_rays   (std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>      & centers,
+                                   std::vector<Vector3>      & directions) const;
+
     boost::shared_ptr<CameraModel> unadjusted_model(){
       return m_camera;
     }
@@ -27,9 +27,37 @@
 #include <vw/Camera/CameraModel.h>
 #include <vw/Image/Transform.h>
 
+#include <vector>
+
 namespace vw {
 namespace camera{
 
+  /// Maps pixels in one camera to pixels in another camera with the
+  /// same center, using one batch call to each camera. Every pixel is
+  /// checked like the single point transform: the camera centers must
+  /// match (LogicErr), and a pixel that has no ray (PixelToRayErr) or
+  /// does not project into to_camera (PointToPixelErr) throws.
+  inline void camera_transform_points(CameraModel const& from_camera,
+                                      CameraModel const& to_camera,
+                                      std::vector<Vector2> const& pixels,
+                                      std::vector<Vector2>      & results) {
+    std::vector<Vector3> centers, points;
+    from_camera.pixels_to_rays(pixels, centers, points);
+    for (size_t i = 0; i < points.size(); i++) {
+      const bool no_ray = (points[i] == Vector3());
+      Vector3 from_center = no_ray ? from_camera.camera_center(pixels[i]) : centers[i];
+      VW_ASSERT(from_center == to_camera.camera_center(pixels[i]),
+                LogicErr() << "CameraTransformFunctor: Camera transformation require that the camera center is always the same for both cameras.");
+      if (no_ray)
+        vw_throw(PixelToRayErr() << "CameraTransformFunctor: Pixel " << pixels[i] << " has no ray.");
+      points[i] += centers[i];
+    }
+    to_camera.points_to_pixels(points, results);
+    for (size_t i = 0; i < results.size(); i++)
+      if (results[i] == CameraModel::invalid_pixel())
+        vw_throw(PointToPixelErr() << "CameraTransformFunctor: Pixel " << pixels[i] << " does not project into the other camera.");
+  }
+
   /// This transform functor can be used along with the machinery in
   /// vw/Transform.h to warp an image from one camera's perspective
   /// into anothers.  In particular, this can be used to remove lens
@@ -73,6 +101,13 @@ namespace camera{
       return m_dst_camera.point_to_pixel(vec+m_src_camera.camera_center(p));
     }
 
+    /// Batch version of reverse(), with one call to each camera.
+    inline void reverse_points(std::vector<Vector2> const& points,
+                               std::vector<Vector2>      & results) const {
+      camera_transform_points(m_dst_camera, m_src_camera, points, results);
+    }
+    inline bool batch_reverse() const { return true; }
+
   private:
     SrcCameraT m_src_camera;
     DstCameraT m_dst_camera;
@@ -114,6 +149,13 @@ namespace camera{
       return m_dst_camera->point_to_pixel(vec+m_src_camera->camera_center(p));
     }
 
+    /// Batch version of reverse(), with one call to each camera.
+    inline void reverse_points(std::vector<Vector2> const& points,
+                               std::vector<Vector2>      & results) const {
+      camera_transform_points(*m_dst_camera, *m_src_camera, points, results);
+    }
+    inline bool batch_reverse() const { return true; }
+
   private:
     boost::shared_ptr<CameraModel> m_src_camera;
     boost::shared_ptr<CameraModel> m_dst_camera;
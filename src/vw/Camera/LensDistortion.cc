@@ -20,6 +20,9 @@
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Math/LevenbergMarquardt.h>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace vw;
 using namespace camera;
 
@@ -89,6 +92,82 @@ std::ostream& camera::operator<<(std::ostream & os,
   return os;
 }
 
+// UndistortionGrid ---------------------------------------------
+
+UndistortionGrid::UndistortionGrid(PinholeModel const& cam, LensDistortion const& distortion,
+                                   BBox2 const& bbox, double tolerance, size_t max_samples)
+  : m_bbox(bbox), m_cells(0), m_scale_x(0), m_scale_y(0), m_max_error(0) {
+
+  if (bbox.width() <= 0 || bbox.height() <= 0)
+    return;
+
+  // Start with 4x4 cells and keep the samples of each level as the
+  // even numbered nodes of the next one.  Node (i,j) is stored at
+  // (i+1,j+1) since the ring outside the box is needed for bicubic
+  // interpolation near the edges.
+  int n = 4;
+  std::vector<Vector2> table((n+3)*(n+3));
+  for (int j = -1; j <= n+1; j++)
+    for (int i = -1; i <= n+1; i++)
+      table[(j+1)*(n+3)+i+1] = distortion.undistorted_coordinates(cam,
+                                 bbox.min() + elem_prod(bbox.size(), Vector2(i,j))/n);
+
+  while (size_t(2*n+3)*size_t(2*n+3) <= max_samples) {
+    int m = 2*n;
+    std::vector<Vector2> fine((m+3)*(m+3));
+    double max_error = 0;
+    for (int j = -1; j <= m+1; j++) {
+      for (int i = -1; i <= m+1; i++) {
+        Vector2 & value = fine[(j+1)*(m+3)+i+1];
+        if (i >= 0 && j >= 0 && i % 2 == 0 && j % 2 == 0) {
+          value = table[(j/2+1)*(n+3)+i/2+1];
+          continue;
+        }
+        value = distortion.undistorted_coordinates(cam,
+                  bbox.min() + elem_prod(bbox.size(), Vector2(i,j))/m);
+        if (i >= 0 && j >= 0 && i <= m && j <= m)
+          max_error = std::max(max_error, norm_2(value - interpolate(table, n, i/2.0, j/2.0)));
+      }
+    }
+    table.swap(fine);
+    n = m;
+    if (max_error <= tolerance) {
+      m_cells     = n;
+      m_scale_x   = n / bbox.width();
+      m_scale_y   = n / bbox.height();
+      m_max_error = max_error;
+      m_table.swap(table);
+      return;
+    }
+  }
+  // The tolerance could not be met, leave the grid empty.
+}
+
+Vector2 UndistortionGrid::interpolate(std::vector<Vector2> const& table, int cells,
+                                      double x, double y) {
+  int i = std::min(std::max(int(floor(x)), 0), cells-1);
+  int j = std::min(std::max(int(floor(y)), 0), cells-1);
+  double tx = x - i, ty = y - j;
+
+  // Catmull-Rom weights for the four samples around each axis
+  double wx[4] = { ((2-tx)*tx-1)*tx/2, ((3*tx-5)*tx*tx+2)/2, ((4-3*tx)*tx+1)*tx/2, (tx-1)*tx*tx/2 };
+  double wy[4] = { ((2-ty)*ty-1)*ty/2, ((3*ty-5)*ty*ty+2)/2, ((4-3*ty)*ty+1)*ty/2, (ty-1)*ty*ty/2 };
+
+  // Sample (i-1,j-1) is stored at (i,j)
+  double rx = 0, ry = 0;
+  for (int b = 0; b < 4; b++) {
+    Vector2 const* row = &table[(j+b)*(cells+3)+i];
+    double sx = 0, sy = 0;
+    for (int a = 0; a < 4; a++) {
+      sx += wx[a]*row[a].x();
+      sy += wx[a]*row[a].y();
+    }
+    rx += wy[b]*sx;
+    ry += wy[b]*sy;
+  }
+  return Vector2(rx, ry);
+}
+
 // Specific Implementations -------------------------------------
 
 // ======== NullLensDistortion ========
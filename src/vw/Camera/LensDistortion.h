@@ -24,9 +24,11 @@
 #define __VW_CAMERA_LENSDISTORTION_H__
 
 #include <vw/Math/Vector.h>
+#include <vw/Math/BBox.h>
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 #include <boost/smart_ptr/shared_ptr.hpp>
 
@@ -83,6 +85,62 @@ namespace camera {
   std::ostream& operator<<(std::ostream& os, const LensDistortion& ld);
 
 
+  /// A lookup table of LensDistortion::undistorted_coordinates() over a
+  /// box of lens coordinates, for the models that solve for it
+  /// iteratively.  Values between the samples are found with bicubic
+  /// (Catmull-Rom) interpolation.
+  /// - The sample spacing starts coarse and is halved until the
+  ///   interpolated values at the center of every cell and of every cell
+  ///   edge are within the tolerance of the exact values.  Those test
+  ///   points are the samples of the next finer grid, so the check costs
+  ///   nothing extra and the final grid is one level finer than the one
+  ///   that passed.
+  /// - If the tolerance cannot be met with at most max_samples samples,
+  ///   the grid is left empty and callers should use the exact solution.
+  /// - All coordinates are in the same units as the focal length of the
+  ///   camera, as for undistorted_coordinates().
+  class UndistortionGrid {
+  public:
+    UndistortionGrid() : m_cells(0), m_scale_x(0), m_scale_y(0), m_max_error(0) {}
+
+    UndistortionGrid(PinholeModel const& cam, LensDistortion const& distortion,
+                     BBox2 const& bbox, double tolerance, size_t max_samples = 1000000);
+
+    /// True if building the grid failed to meet the tolerance.
+    bool empty() const { return m_table.empty(); }
+
+    /// True if the grid can be used at this location.
+    bool contains(Vector2 const& p) const {
+      return !empty() &&
+             p.x() >= m_bbox.min().x() && p.x() <= m_bbox.max().x() &&
+             p.y() >= m_bbox.min().y() && p.y() <= m_bbox.max().y();
+    }
+
+    /// The interpolated undistorted location of a point inside the grid.
+    Vector2 undistorted_coordinates(Vector2 const& p) const {
+      return interpolate(m_table, m_cells, (p.x() - m_bbox.min().x()) * m_scale_x,
+                                           (p.y() - m_bbox.min().y()) * m_scale_y);
+    }
+
+    /// The largest interpolation error measured while building the grid.
+    double max_error() const { return m_max_error; }
+
+    BBox2 const& bbox() const { return m_bbox; }
+
+  private:
+    /// Interpolate a table of (cells+3)^2 samples, which has one extra
+    /// ring of samples around the box, at (x,y) in units of cells.
+    static Vector2 interpolate(std::vector<Vector2> const& table, int cells,
+                               double x, double y);
+
+    BBox2  m_bbox;
+    int    m_cells;              ///< Number of cells along each axis
+    double m_scale_x, m_scale_y; ///< Cells per unit distance
+    double m_max_error;
+    std::vector<Vector2> m_table;
+  };
+
+
   // ------------------------------------------------------------------------------
   // -- Derived classes section
 
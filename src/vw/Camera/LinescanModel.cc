@@ -17,24 +17,178 @@
 
 #include <vw/Camera/LinescanModel.h>
 #include <vw/Camera/CameraSolve.h>
+#include <vw/Core/Thread.h>
+
+#include <algorithm>
 
 namespace vw {
 namespace camera {
 
+/// The plane swept by the sensor line at a number of evenly spaced lines.
+/// - Each plane passes through the camera center and the look directions
+///   of the first and last samples, which is exact for a straight sensor
+///   and close enough for a starting guess otherwise.
+struct LinescanModel::LineLookup {
+  Mutex mutex;
+  bool  built;
+  std::vector<double > lines;
+  std::vector<Vector3> centers, normals, first, last;
+
+  LineLookup() : built(false) {}
+
+  /// Signed distance from a point to the plane at entry k.
+  double distance(size_t k, Vector3 const& point) const {
+    return dot_prod(point - centers[k], normals[k]);
+  }
+};
+
+LinescanModel::LinescanModel(Vector2i const& image_size,
+                             bool            correct_velocity_aberration) :
+  m_image_size(image_size),
+  m_correct_velocity_aberration(correct_velocity_aberration),
+  m_line_lookup(new LineLookup) {}
+
+void LinescanModel::reset_line_lookup() {
+  // Copies of this camera may still be using the old table, so leave it to them.
+  m_line_lookup.reset(new LineLookup);
+}
+
+LinescanModel::LineLookup const& LinescanModel::line_lookup() const {
+  LineLookup & lookup = *m_line_lookup;
+  {
+    Mutex::ReadLock lock(lookup.mutex);
+    if (lookup.built)
+      return lookup;
+  }
+  Mutex::WriteLock lock(lookup.mutex);
+  if (lookup.built)
+    return lookup;
+  lookup.built = true;
+
+  // The trajectory is smooth, so a coarse table gets the solver close
+  // enough that it only needs a few iterations.
+  const int MAX_PLANES  = 129;
+  const int count       = std::min(MAX_PLANES, number_of_lines());
+  const double last_col = samples_per_line() - 1;
+  if (count < 2 || last_col < 1)
+    return lookup;
+
+  try {
+    for (int k = 0; k < count; k++) {
+      double  line  = double(number_of_lines() - 1) * k / (count - 1);
+      Vector3 first = pixel_to_vector(Vector2(0,        line));
+      Vector3 last  = pixel_to_vector(Vector2(last_col, line));
+      lookup.lines  .push_back(line);
+      lookup.centers.push_back(camera_center(Vector2(0, line)));
+      lookup.normals.push_back(normalize(cross_prod(first, last)));
+      lookup.first  .push_back(first);
+      lookup.last   .push_back(last);
+    }
+  } catch (const vw::Exception&) {
+    // Leave the table empty and fall back to the image center.
+    lookup.lines.clear();
+  }
+  return lookup;
+}
+
+Vector2 LinescanModel::point_to_pixel_guess(Vector3 const& point) const {
+  Vector2 guess = m_image_size / 2.0;
+  LineLookup const& lookup = line_lookup();
+  size_t count = lookup.lines.size();
+  if (count < 2)
+    return guess;
+
+  // The distance to the planes changes sign at the line that sees the
+  // point.  Bisect for that, or extrapolate from the end planes if the
+  // point is not in the image.
+  size_t lo  = 0, hi = count - 1;
+  double dlo = lookup.distance(lo, point);
+  double dhi = lookup.distance(hi, point);
+  if ((dlo > 0) == (dhi > 0)) {
+    if (fabs(dhi) < fabs(dlo))
+      lo = count - 2;
+    else
+      hi = 1;
+    dlo = lookup.distance(lo, point);
+    dhi = lookup.distance(hi, point);
+  } else {
+    while (hi - lo > 1) {
+      size_t mid  = (lo + hi) / 2;
+      double dmid = lookup.distance(mid, point);
+      if ((dmid > 0) == (dlo > 0)) {
+        lo  = mid;
+        dlo = dmid;
+      } else {
+        hi  = mid;
+        dhi = dmid;
+      }
+    }
+  }
+  if (dlo == dhi)
+    return guess;
+  double t = dlo / (dlo - dhi);
+  guess[1] = lookup.lines[lo] + t * (lookup.lines[hi] - lookup.lines[lo]);
+
+  // The sample is the angle to the point within the plane, as a
+  // fraction of the angle between the first and last samples.
+  t = std::min(std::max(t, 0.0), 1.0);
+  Vector3 center = lookup.centers[lo] + t * (lookup.centers[hi] - lookup.centers[lo]);
+  Vector3 first  = lookup.first  [lo] + t * (lookup.first  [hi] - lookup.first  [lo]);
+  Vector3 last   = lookup.last   [lo] + t * (lookup.last   [hi] - lookup.last   [lo]);
+  Vector3 normal = cross_prod(first, last);
+  Vector3 dir    = point - center;
+  double  span   = atan2(norm_2(normal), dot_prod(first, last));
+  double  angle  = atan2(dot_prod(cross_prod(first, dir), normalize(normal)), dot_prod(first, dir));
+  if (span > 0)
+    guess[0] = angle / span * (samples_per_line() - 1);
+  return guess;
+}
+
 Vector2 LinescanModel::point_to_pixel(Vector3 const& point) const {
   return point_to_pixel(point, -1); // Redirect to the function with no guess
 }
 
 
 Vector2 LinescanModel::point_to_pixel(Vector3 const& point, double starty) const {
+  Vector2 start = point_to_pixel_guess(point);
+  if (starty >= 0) // If the user provided a line number guess..
+    start[1] = starty;
+  return solve_point_to_pixel(point, start);
+}
+
+Vector2 LinescanModel::solve_point_to_pixel(Vector3 const& point, Vector2 const& start) const {
+
+  CameraGenericLMA model( this, point );
+
+  // From a good guess a few Gauss-Newton steps converge, where the
+  // general purpose solver below spends dozens of iterations getting
+  // down to its tolerance.
+  const double DIFF_STEP     = 1e-2; // Pixels
+  const double STEP_TOL      = 1e-8; // Pixels
+  const double RESIDUAL_TOL  = 1e-8;
+  const int    MAX_GN_ITERATIONS = 20;
+  Vector2 pix = start;
+  for (int i = 0; i < MAX_GN_ITERATIONS; i++) {
+    Vector3 r  = model(pix);
+    Vector3 dx = (model(pix + Vector2(DIFF_STEP, 0)) - r) / DIFF_STEP;
+    Vector3 dy = (model(pix + Vector2(0, DIFF_STEP)) - r) / DIFF_STEP;
+    double a = dot_prod(dx, dx), b = dot_prod(dx, dy), c = dot_prod(dy, dy);
+    double det = a*c - b*b;
+    if (!(det > 0))
+      break;
+    double gx = dot_prod(dx, r), gy = dot_prod(dy, r);
+    Vector2 step(-(c*gx - b*gy) / det, -(a*gy - b*gx) / det);
+    pix += step;
+    if (norm_2(step) < STEP_TOL) {
+      if (norm_2(model(pix)) < RESIDUAL_TOL)
+        return pix;
+      break;
+    }
+  }
 
   // Use the generic solver to find the pixel 
   // - This method will be slower but works for more complicated geometries
-  CameraGenericLMA model( this, point );
   int status;
-  Vector2 start = m_image_size / 2.0; // Use the center as the initial guess
-  if (starty >= 0) // If the user provided a line number guess..
-    start[1] = starty;
 
   // Solver constants
   const double ABS_TOL = 1e-16;
@@ -50,6 +204,30 @@ Vector2 LinescanModel::point_to_pixel(Vector3 const& point, double starty) const
   return solution;
 }
 
+void LinescanModel::points_to_pixels(std::vector<Vector3> const& points,
+                                     std::vector<Vector2>      & pixels) const {
+  pixels.resize(points.size());
+  Vector2 correction;
+  for (size_t i = 0; i < points.size(); i++) {
+    Vector2 guess = point_to_pixel_guess(points[i]);
+    try {
+      pixels[i] = solve_point_to_pixel(points[i], guess + correction);
+    } catch (const PointToPixelErr&) {
+      pixels[i] = invalid_pixel();
+      // Try again without the last point's correction
+      if (correction != Vector2()) {
+        try {
+          pixels[i] = solve_point_to_pixel(points[i], guess);
+        } catch (const PointToPixelErr&) {}
+      }
+    }
+    if (pixels[i] == invalid_pixel())
+      correction = Vector2();
+    else
+      correction = pixels[i] - guess;
+  }
+}
+
 // WARNING: This currently only works for Earth!
 Vector3 LinescanModel::get_rotation_corrected_velocity(Vector2 const& pixel,
                                                        Vector3 const& uncorrected_vector) const {
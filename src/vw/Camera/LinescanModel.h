@@ -28,6 +28,9 @@
 #include <vw/Math/LevenbergMarquardt.h>
 #include <vw/Camera/CameraModel.h>
 
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
 namespace vw {
 namespace camera {
 
@@ -51,9 +54,7 @@ namespace camera {
     // Constructors / Destructors
     //------------------------------------------------------------------
     LinescanModel(Vector2i const& image_size,
-		              bool            correct_velocity_aberration) :
-      m_image_size(image_size), 
-      m_correct_velocity_aberration(correct_velocity_aberration){}
+		              bool            correct_velocity_aberration);
 
     virtual ~LinescanModel() {}
     virtual std::string type() const { return "Linescan"; }
@@ -117,6 +118,26 @@ namespace camera {
     //   linescan cameras may be able to use more specific implementation.
     virtual Vector2 point_to_pixel(vw::Vector3 const& point, double starty) const;
 
+    /// Project many points at once.  Each solve starts from the line
+    /// lookup guess, corrected by how far off that guess was for the
+    /// point before it, so keeping nearby points next to each other in
+    /// the list (such as the points of one tile) makes this faster.
+    /// - Derived classes with their own point_to_pixel() should override
+    ///   this too, since it uses the generic solver.
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>      & pixels) const;
+
+    /// A starting guess for point_to_pixel().  This finds where the point
+    /// crosses the plane swept by the sensor line in a coarse table of
+    /// evenly spaced lines, which is built the first time it is needed
+    /// and shared by copies of the camera.
+    /// - Returns the center of the image if the table could not be built.
+    Vector2 point_to_pixel_guess(Vector3 const& point) const;
+
+    /// Discard the line lookup table.  Derived classes must call this if
+    /// their trajectory changes after any points have been projected.
+    void reset_line_lookup();
+
   protected:
 
     /// Image size in pixels: [num lines, num samples]
@@ -126,8 +147,18 @@ namespace camera {
     /// - For satellites this makes a big difference, make sure it is set!
     bool m_correct_velocity_aberration;
 
+    /// Sensor line planes at evenly spaced lines, for point_to_pixel_guess().
+    struct LineLookup;
+    boost::shared_ptr<LineLookup> m_line_lookup;
+
   protected:
 
+    /// Run the generic solver for point_to_pixel() from the given pixel.
+    Vector2 solve_point_to_pixel(Vector3 const& point, Vector2 const& start) const;
+
+    /// Fill in the line lookup table if that has not been done yet.
+    LineLookup const& line_lookup() const;
+
     /// Returns the velocity corrected to account for the planetary rotation.
     /// - For efficiency, requires the uncorrected look vector at this location.
     virtual Vector3 get_rotation_corrected_velocity(Vector2 const& pixel,
@@ -16,6 +16,7 @@
 // __END_LICENSE__
 
 #include <vw/Core/Log.h>
+#include <vw/Core/Thread.h>
 #include <vw/config.h>
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
@@ -44,6 +45,20 @@ namespace fs = boost::filesystem;
 using namespace vw;
 using namespace camera;
 
+/// The lazily built undistortion grid and the settings it was requested with.
+struct PinholeModel::UndistortionCache {
+  BBox2   image_bbox;
+  double  tolerance;
+  Vector4 intrinsics; ///< fu, fv, cu, cv when this was created
+  double  pixel_pitch;
+  bool    built;
+  boost::shared_ptr<UndistortionGrid const> grid;
+  Mutex   mutex;
+
+  UndistortionCache(BBox2 const& bbox, double tol, Vector4 const& intr, double pitch)
+    : image_bbox(bbox), tolerance(tol), intrinsics(intr), pixel_pitch(pitch), built(false) {}
+};
+
 PinholeModel::PinholeModel() : m_distortion(DistortPtr(new NullLensDistortion)),
                                m_camera_center(Vector3(0,0,0)),
                                m_fu(1), m_fv(1), m_cu(0), m_cv(0),
@@ -236,6 +251,7 @@ void PinholeModel::read(std::string const& filename) {
 
   // The lens distortion class knows how to parse the rest of the input stream.
   m_distortion->read(cam_file);
+  reset_undistortion_grid(true);
 
   cam_file.close();    
 }
@@ -335,6 +351,7 @@ void PinholeModel::read_protobuf_file(std::string const& filename) {
                IOErr() << "Pinhole::read_file: Unexpected distortion vector." );
     m_distortion.reset( new AdjustableTsaiLensDistortion(VectorProxy<double>(file.distortion_vector_size(),file.mutable_distortion_vector()->mutable_data())));
   }
+  reset_undistortion_grid(true);
 #else
   // If you hit this point, you need to install Google Protobuffers to to read this file type.
   vw_throw( IOErr() << "Pinhole::write_file: Camera IO not supported without Google Protobuffers" );
@@ -378,7 +395,7 @@ void PinholeModel::write(std::string const& filename) const {
 }
 
 
-Vector2 PinholeModel::point_to_pixel(Vector3 const& point) const {
+inline Vector2 PinholeModel::project(Vector3 const& point, bool distort) const {
 
   // Multiply the pixel location by the 3x4 camera matrix.
   // - The pixel coordinate is de-homogenized by dividing by the denominator.
@@ -392,23 +409,17 @@ Vector2 PinholeModel::point_to_pixel(Vector3 const& point) const {
   // Apply the lens distortion model
   // - Divide by pixel pitch to convert from metric units to pixels if the intrinsic
   //   values were not specified in pixel units (in that case m_pixel_pitch == 1.0)
-  return m_distortion->distorted_coordinates(*this, pixel)/m_pixel_pitch;
+  if (distort)
+    pixel = m_distortion->distorted_coordinates(*this, pixel);
+  return pixel/m_pixel_pitch;
 }
 
-Vector2 PinholeModel::point_to_pixel_no_distortion(Vector3 const& point) const {
-
-  // Multiply the pixel location by the 3x4 camera matrix.
-  // - The pixel coordinate is de-homogenized by dividing by the denominator.
-  double denominator = m_camera_matrix(2,0)*point(0) + m_camera_matrix(2,1)*point(1) +
-                       m_camera_matrix(2,2)*point(2) + m_camera_matrix(2,3);
-  Vector2 pixel = Vector2( (m_camera_matrix(0,0)*point(0) + m_camera_matrix(0,1)*point(1) +
-                            m_camera_matrix(0,2)*point(2) + m_camera_matrix(0,3)           ) / denominator,
-                           (m_camera_matrix(1,0)*point(0) + m_camera_matrix(1,1)*point(1) +
-                            m_camera_matrix(1,2)*point(2) + m_camera_matrix(1,3)           ) / denominator);
+Vector2 PinholeModel::point_to_pixel(Vector3 const& point) const {
+  return project(point, true);
+}
 
-  // Divide by pixel pitch to convert from metric units to pixels if the intrinsic
-  //   values were not specified in pixel units (in that case m_pixel_pitch == 1.0)
-  return pixel/m_pixel_pitch;
+Vector2 PinholeModel::point_to_pixel_no_distortion(Vector3 const& point) const {
+  return project(point, false);
 }
 
 bool PinholeModel::projection_valid(Vector3 const& point) const {
@@ -418,9 +429,17 @@ bool PinholeModel::projection_valid(Vector3 const& point) const {
   return z > 0;
 }
 
+Vector2 PinholeModel::undistorted_lens_coordinates(Vector2 const& lens_pix,
+                                                   UndistortionGrid const* grid) const {
+  if (grid && grid->contains(lens_pix))
+    return grid->undistorted_coordinates(lens_pix);
+  return m_distortion->undistorted_coordinates(*this, lens_pix);
+}
+
 Vector3 PinholeModel::pixel_to_vector (Vector2 const& pix) const {
   // Apply the inverse lens distortion model
-  Vector2 undistorted_pix = m_distortion->undistorted_coordinates(*this, pix*m_pixel_pitch);
+  boost::shared_ptr<UndistortionGrid const> grid = undistortion_grid();
+  Vector2 undistorted_pix = undistorted_lens_coordinates(pix*m_pixel_pitch, grid.get());
 
   // Compute the direction of the ray emanating from the camera center.
   Vector3 p(0,0,1);
@@ -432,6 +451,44 @@ Vector3 PinholeModel::camera_center(Vector2 const& /*pix*/ ) const {
   return m_camera_center;
 };
 
+void PinholeModel::points_to_pixels(std::vector<Vector3> const& points,
+                                    std::vector<Vector2>      & pixels) const {
+  pixels.resize(points.size());
+  bool distort = dynamic_cast<NullLensDistortion const*>(m_distortion.get()) == 0;
+  for (size_t i = 0; i < points.size(); i++) {
+    try {
+      pixels[i] = project(points[i], distort);
+    } catch (const PointToPixelErr& /*e*/) {
+      pixels[i] = invalid_pixel();
+    }
+  }
+}
+
+void PinholeModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                     std::vector<Vector3>      & vectors) const {
+  vectors.resize(pixels.size());
+  bool no_distortion = dynamic_cast<NullLensDistortion const*>(m_distortion.get()) != 0;
+  boost::shared_ptr<UndistortionGrid const> grid;
+  if (!no_distortion)
+    grid = undistortion_grid();
+  Vector3 p(0,0,1);
+  for (size_t i = 0; i < pixels.size(); i++) {
+    // Same as pixel_to_vector()
+    if (no_distortion)
+      subvector(p,0,2) = pixels[i]*m_pixel_pitch;
+    else
+      subvector(p,0,2) = undistorted_lens_coordinates(pixels[i]*m_pixel_pitch, grid.get());
+    vectors[i] = normalize( m_inv_camera_transform * p);
+  }
+}
+
+void PinholeModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                  std::vector<Vector3>      & centers,
+                                  std::vector<Vector3>      & directions) const {
+  pixels_to_vectors(pixels, directions);
+  centers.assign(pixels.size(), m_camera_center);
+}
+
 void PinholeModel::set_camera_center(Vector3 const& position) {
   m_camera_center = position; 
   rebuild_camera_matrix();
@@ -472,6 +529,7 @@ Vector3 PinholeModel::coordinate_frame_w_direction() const { return m_w_directio
 const LensDistortion* PinholeModel::lens_distortion() const { return m_distortion.get(); };
 void PinholeModel::set_lens_distortion(LensDistortion const& distortion) {
   m_distortion = distortion.copy();
+  reset_undistortion_grid(true);
 }
 
 void PinholeModel::intrinsic_parameters(double& f_u, double& f_v,
@@ -496,7 +554,54 @@ void PinholeModel::set_point_offset(Vector2 const& c, bool rebuild ) {
   if (rebuild) rebuild_camera_matrix();
 }
 double PinholeModel::pixel_pitch() const { return m_pixel_pitch; }
-void PinholeModel::set_pixel_pitch( double pitch ) { m_pixel_pitch = pitch; }
+void PinholeModel::set_pixel_pitch( double pitch ) {
+  m_pixel_pitch = pitch;
+  reset_undistortion_grid();
+}
+
+void PinholeModel::enable_undistortion_grid(BBox2 const& image_bbox, double tolerance) {
+  m_undistortion.reset(new UndistortionCache(image_bbox, tolerance,
+                                             Vector4(m_fu, m_fv, m_cu, m_cv), m_pixel_pitch));
+}
+
+void PinholeModel::disable_undistortion_grid() {
+  m_undistortion.reset();
+}
+
+void PinholeModel::reset_undistortion_grid(bool force) {
+  if (!m_undistortion)
+    return;
+  UndistortionCache const& cache = *m_undistortion;
+  if (!force && cache.intrinsics == Vector4(m_fu, m_fv, m_cu, m_cv) &&
+      cache.pixel_pitch == m_pixel_pitch)
+    return;
+  // Copies of this camera may still be using the old grid, so leave it to them.
+  enable_undistortion_grid(cache.image_bbox, cache.tolerance);
+}
+
+boost::shared_ptr<UndistortionGrid const> PinholeModel::undistortion_grid() const {
+  if (!m_undistortion)
+    return boost::shared_ptr<UndistortionGrid const>();
+  UndistortionCache & cache = *m_undistortion;
+  {
+    Mutex::ReadLock lock(cache.mutex);
+    if (cache.built)
+      return cache.grid;
+  }
+  Mutex::WriteLock lock(cache.mutex);
+  if (!cache.built) {
+    BBox2 lens_bbox(cache.image_bbox.min()*m_pixel_pitch, cache.image_bbox.max()*m_pixel_pitch);
+    boost::shared_ptr<UndistortionGrid> grid(
+      new UndistortionGrid(*this, *m_distortion, lens_bbox, cache.tolerance*m_pixel_pitch));
+    if (grid->empty())
+      vw_out(DebugMessage, "camera") << "PinholeModel: Could not build an undistortion grid "
+                                     << "within " << cache.tolerance << " pixels.\n";
+    else
+      cache.grid = grid;
+    cache.built = true;
+  }
+  return cache.grid;
+}
 
 
 void PinholeModel::set_camera_matrix( Matrix<double,3,4> const& p ) {
@@ -600,6 +705,8 @@ void PinholeModel::rebuild_camera_matrix() {
 
   m_camera_matrix = m_intrinsics * m_extrinsics;
   m_inv_camera_transform = inverse(uvwRotation*rotation_inverse) * inverse(m_intrinsics);
+
+  reset_undistortion_grid();
 }
 
 // Apply a given rotation + translation + scale transform to a pinhole camera
@@ -24,6 +24,7 @@
 #define __VW_CAMERAMODEL_PINHOLE_H__
 
 #include <vw/Math/Quaternion.h>
+#include <vw/Math/BBox.h>
 #include <vw/Camera/CameraModel.h>
 
 #include <iostream>
@@ -33,6 +34,7 @@ namespace vw {
 namespace camera {
 
   class LensDistortion;
+  class UndistortionGrid;
 
   /// This is a simple "generic" pinhole camera model.
   ///
@@ -114,6 +116,15 @@ namespace camera {
     /// Cached values for pixel_to_vector
     Matrix<double,3,3> m_inv_camera_transform;
 
+    /// The projection shared by point_to_pixel() and its variants,
+    /// applying lens distortion only if 'distort' is set.
+    inline Vector2 project(Vector3 const& point, bool distort) const;
+
+    /// Optional lookup table for the inverse lens distortion, shared
+    /// between copies of the camera.  Null unless it was enabled.
+    struct UndistortionCache;
+    boost::shared_ptr<UndistortionCache> m_undistortion;
+
   public:
     //------------------------------------------------------------------
     // Constructors / Destructors
@@ -228,6 +239,16 @@ namespace camera {
 
     // The pinhole camera position does not vary by pixel so the input pixel is ignored.
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const;
+
+    // Batch versions of the above. These call the lens distortion model
+    // once per point and skip it entirely when there is no distortion.
+    virtual void points_to_pixels (std::vector<Vector3> const& points,
+                                   std::vector<Vector2>      & pixels) const;
+    virtual void pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>      & vectors) const;
+    virtual void pixels_to_rays   (std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>      & centers,
+                                   std::vector<Vector3>      & directions) const;
     void set_camera_center(Vector3 const& position);
 
     // Pose is a rotation which moves a vector in camera coordinates
@@ -270,6 +291,19 @@ namespace camera {
     void set_point_offset(Vector2 const& c, bool rebuild=true );
     void set_pixel_pitch (double pitch);
 
+    /// Solve for the inverse lens distortion of the pixels in image_bbox
+    /// with an UndistortionGrid, as long as one can be built that matches
+    /// the exact solution to within 'tolerance' pixels.  Other pixels, or
+    /// all of them if no such grid exists, still use the exact solution.
+    /// - The grid is built on first use and shared by copies of this camera.
+    ///   Changing the intrinsics, pixel pitch or lens distortion starts over.
+    void enable_undistortion_grid(BBox2 const& image_bbox, double tolerance = 1e-3);
+    void disable_undistortion_grid();
+
+    /// The grid in use, building it if needed.  Null if the grid is not
+    /// enabled or could not meet the tolerance.
+    boost::shared_ptr<UndistortionGrid const> undistortion_grid() const;
+
     // Ingest camera matrix
     // This performs a camera matrix decomposition and rewrites most variables
     void set_camera_matrix( Matrix<double,3,4> const& p );
@@ -283,6 +317,14 @@ namespace camera {
   private:
     /// This must be called whenever camera parameters are modified.
     void rebuild_camera_matrix();
+
+    /// Start a new undistortion grid if the intrinsics changed since the
+    /// current one was requested, or always if 'force' is set.
+    void reset_undistortion_grid(bool force = false);
+
+    /// The inverse lens distortion, from the grid where possible.
+    Vector2 undistorted_lens_coordinates(Vector2 const& lens_pix,
+                                         UndistortionGrid const* grid) const;
     
     /// Initialize m_distortion with the correct type of lens distortion
     ///  model depending on a string from an input .tsai file.
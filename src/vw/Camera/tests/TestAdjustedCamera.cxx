@@ -100,3 +100,31 @@ TEST( AdjustedCameraModel, AdjustedConstruct ) {
     acos(dot_prod(Vector3(0,0,1),inverse(center_pose).rotate(adjcam2.pixel_to_vector(center_pixel))));
   EXPECT_LT( angle_from_z, 0.5 );
 }
+
+TEST( AdjustedCameraModel, BatchProjection ) {
+  boost::shared_ptr<CameraModel> pinhole(
+      new PinholeModel( Vector3(0,0,0), math::euler_to_rotation_matrix(1.3,2.0,-.7,"xyz"),
+                        500,500, 500,500,
+                        TsaiLensDistortion(Vector4(-0.28,0.106,-0.00014,0.00116))) );
+  AdjustedCameraModel adjcam( pinhole, Vector3(1,-2,0.5),
+                              math::euler_to_quaternion(0.1,-0.05,0.2,"xyz"),
+                              Vector2(10,-20), 2.0 );
+
+  std::vector<Vector2> pixels, batch_pixels;
+  std::vector<Vector3> points, batch_vectors, batch_centers, ray_vectors;
+  for ( int i = 0; i < 500; i += 61 )
+    for ( int j = 0; j < 500; j += 53 ) {
+      pixels.push_back( Vector2(i,j) );
+      points.push_back( adjcam.camera_center(Vector2(i,j)) + 40*adjcam.pixel_to_vector(Vector2(i,j)) );
+    }
+  adjcam.points_to_pixels ( points, batch_pixels );
+  adjcam.pixels_to_vectors( pixels, batch_vectors );
+  adjcam.pixels_to_rays   ( pixels, batch_centers, ray_vectors );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_DOUBLE_EQ( adjcam.point_to_pixel (points[i]), batch_pixels [i] );
+    EXPECT_VECTOR_DOUBLE_EQ( adjcam.pixel_to_vector(pixels[i]), batch_vectors[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( adjcam.camera_center  (pixels[i]), batch_centers[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( batch_vectors[i], ray_vectors[i] );
+    EXPECT_VECTOR_NEAR( pixels[i], batch_pixels[i], 1e-6 );
+  }
+}
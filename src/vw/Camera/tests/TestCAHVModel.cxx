@@ -189,3 +189,27 @@ TEST( CAHVModel, ForwardReverse ) {
     }
   }
 }
+
+TEST( CAHVModel, BatchProjection ) {
+  CAHVModel cahv(Vector3(0.606583,-0.036214,-0.234717),
+                 Vector3(0.708256,-0.0113108,0.705866),
+                 Vector3(365.881,275.126,361.931),
+                 Vector3(173.589,-3.95587,550.402));
+
+  std::vector<Vector2> pixels, batch_pixels;
+  std::vector<Vector3> points, batch_vectors, batch_centers, ray_vectors;
+  for ( uint32 i = 100; i < 901; i += 100 )
+    for ( uint32 j = 100; j < 901; j+= 100 ) {
+      pixels.push_back( Vector2(i,j) );
+      points.push_back( cahv.C + 30*cahv.pixel_to_vector( Vector2(i,j) ) );
+    }
+  cahv.points_to_pixels ( points, batch_pixels );
+  cahv.pixels_to_vectors( pixels, batch_vectors );
+  cahv.pixels_to_rays   ( pixels, batch_centers, ray_vectors );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_DOUBLE_EQ( cahv.point_to_pixel (points[i]), batch_pixels [i] );
+    EXPECT_VECTOR_DOUBLE_EQ( cahv.pixel_to_vector(pixels[i]), batch_vectors[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( cahv.C, batch_centers[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( batch_vectors[i], ray_vectors[i] );
+  }
+}
@@ -177,3 +177,29 @@ TEST( CAHVORModel, ForwardReverse) {
     }
   }
 }
+
+TEST( CAHVORModel, BatchProjection ) {
+  CAHVORModel cahvor(Vector3(0.491222,-0.0717236,-1.24143),
+                     Vector3(0.921657,-0.230518,0.312107),
+                     Vector3(757.076,1071.6,160.227),
+                     Vector3(91.7479,-27.7504,1319.48),
+                     Vector3(0.920759,-0.206185,0.331197),
+                     Vector3(0.00096,-0.002183,0.018547));
+
+  std::vector<Vector2> pixels, batch_pixels;
+  std::vector<Vector3> points, batch_vectors, batch_centers, ray_vectors;
+  for ( uint32 i = 100; i < 901; i += 100 )
+    for ( uint32 j = 100; j < 901; j+= 100 ) {
+      pixels.push_back( Vector2(i,j) );
+      points.push_back( cahvor.C + 30*cahvor.pixel_to_vector( Vector2(i,j) ) );
+    }
+  cahvor.points_to_pixels ( points, batch_pixels );
+  cahvor.pixels_to_vectors( pixels, batch_vectors );
+  cahvor.pixels_to_rays   ( pixels, batch_centers, ray_vectors );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_DOUBLE_EQ( cahvor.point_to_pixel (points[i]), batch_pixels [i] );
+    EXPECT_VECTOR_DOUBLE_EQ( cahvor.pixel_to_vector(pixels[i]), batch_vectors[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( cahvor.C, batch_centers[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( batch_vectors[i], ray_vectors[i] );
+  }
+}
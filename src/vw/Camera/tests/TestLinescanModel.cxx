@@ -19,15 +19,83 @@
 #include <gtest/gtest_VW.h>
 
 #include <vw/Math/Vector.h>
+#include <vw/Math/EulerAngles.h>
 #include <vw/Camera/LinescanModel.h>
+#include <vw/Camera/CameraSolve.h>
 #include <vw/Camera/Extrinsics.h>
 #include <test/Helpers.h>
 
 using namespace vw;
 using namespace camera;
 
-// TODO: Is there a good test we can do here?
-//       - Not as important since we are not using templates anymore.
+// A pushbroom camera 700km up moving along +Y at 7km/s, with a slow
+// roll so that the scan planes are not all parallel.
+class TestLinescan : public LinescanModel {
+public:
+  mutable int m_vector_calls; // For counting the solver work
+
+  TestLinescan() : LinescanModel(Vector2i(1000, 2000), false), m_vector_calls(0) {}
+
+  virtual Vector3 get_camera_center_at_time  (double time) const { return Vector3(0, 7000*time, 700000); }
+  virtual Vector3 get_camera_velocity_at_time(double /*time*/) const { return Vector3(0, 7000, 0); }
+  virtual Quat    get_camera_pose_at_time    (double time) const {
+    // Looking down, with rows along the flight direction
+    Matrix3x3 down = math::euler_to_rotation_matrix(0, M_PI, 0, "xyz");
+    return Quat(math::euler_to_rotation_matrix(0.02*time, 0, 0, "xyz") * down);
+  }
+  virtual double  get_time_at_line(double line) const { return line * 0.001; }
+  virtual Vector3 get_local_pixel_vector(Vector2 const& pix) const {
+    return normalize(Vector3((pix[0] - 500) / 10000.0, 0, 1));
+  }
+  virtual Vector3 pixel_to_vector(Vector2 const& pix) const {
+    m_vector_calls++;
+    return LinescanModel::pixel_to_vector(pix);
+  }
+
+};
+
+TEST( LinescanModel, PointToPixel ) {
+  TestLinescan cam;
+
+  // Ground points seen by a spread of pixels, some off the image
+  std::vector<Vector3> points;
+  std::vector<Vector2> expected;
+  for ( double line = -100; line < 2100; line += 173.3 )
+    for ( double sample = -50; sample < 1050; sample += 91.7 ) {
+      Vector2 pix(sample, line);
+      points.push_back( cam.camera_center(pix) + 700000*cam.pixel_to_vector(pix) );
+      expected.push_back( pix );
+    }
+
+  // The guess should be close enough that the solver barely has to move.
+  cam.point_to_pixel_guess(points[0]); // Build the lookup table
+  for ( size_t i = 0; i < points.size(); i++ )
+    EXPECT_VECTOR_NEAR( expected[i], cam.point_to_pixel_guess(points[i]), 1.0 );
+
+  // Compare the work against the generic solver starting from the
+  // center of the image, which is what point_to_pixel() used to do.
+  cam.m_vector_calls = 0;
+  std::vector<Vector2> pixels;
+  cam.points_to_pixels( points, pixels );
+  int batch_calls = cam.m_vector_calls;
+
+  cam.m_vector_calls = 0;
+  for ( size_t i = 0; i < points.size(); i++ ) {
+    CameraGenericLMA model( &cam, points[i] );
+    int status;
+    Vector2 solution = math::levenberg_marquardt( model, Vector2(500, 1000), Vector3(),
+                                                  status, 1e-16, 1e-16, 1e+5 );
+    EXPECT_VECTOR_NEAR( expected[i], solution, 1e-6 );
+  }
+  int generic_calls = cam.m_vector_calls;
+
+  ASSERT_EQ( points.size(), pixels.size() );
+  for ( size_t i = 0; i < points.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( expected[i], pixels[i], 1e-6 );
+    EXPECT_VECTOR_NEAR( expected[i], cam.point_to_pixel(points[i]), 1e-6 );
+  }
+  EXPECT_LT( 5*batch_calls, generic_calls );
+}
 
 /*
 // A very simple Linescan model for testing purposes
@@ -113,6 +113,117 @@ TEST( PinholeModel, TsaiDistortion ) {
 #endif
 }
 
+TEST( PinholeModel, BatchProjection ) {
+  PinholeModel distorted( Vector3(1,2,3), math::euler_to_rotation_matrix(0.1,-0.2,0.3,"xyz"),
+                          500,500, 500,500,
+                          TsaiLensDistortion(Vector4(-0.28,0.106,-0.00014,0.00116)) );
+  PinholeModel plain = strip_lens_distortion(distorted);
+
+  std::vector<Vector2> pixels;
+  std::vector<Vector3> points;
+  for ( int i = 0; i < 1000; i += 111 )
+    for ( int j = 0; j < 1000; j += 97 ) {
+      pixels.push_back( Vector2(i,j) );
+      points.push_back( Vector3(i/100.0 - 4, j/100.0 - 3, 20) );
+    }
+
+  PinholeModel* cameras[2] = { &distorted, &plain };
+  for ( int c = 0; c < 2; c++ ) {
+    std::vector<Vector2> batch_pixels;
+    std::vector<Vector3> batch_vectors, batch_centers, ray_vectors;
+    cameras[c]->points_to_pixels ( points, batch_pixels );
+    cameras[c]->pixels_to_vectors( pixels, batch_vectors );
+    cameras[c]->pixels_to_rays   ( pixels, batch_centers, ray_vectors );
+    ASSERT_EQ( points.size(), batch_pixels.size() );
+    ASSERT_EQ( pixels.size(), batch_vectors.size() );
+    for ( size_t i = 0; i < pixels.size(); i++ ) {
+      EXPECT_VECTOR_DOUBLE_EQ( cameras[c]->point_to_pixel (points[i]), batch_pixels [i] );
+      EXPECT_VECTOR_DOUBLE_EQ( cameras[c]->pixel_to_vector(pixels[i]), batch_vectors[i] );
+      EXPECT_VECTOR_DOUBLE_EQ( cameras[c]->camera_center  (pixels[i]), batch_centers[i] );
+      EXPECT_VECTOR_DOUBLE_EQ( batch_vectors[i], ray_vectors[i] );
+    }
+  }
+
+  // Undistorting an image goes through the batch methods a tile at a time.
+  ImageView<float> image(40,30);
+  for ( int j = 0; j < image.rows(); j++ )
+    for ( int i = 0; i < image.cols(); i++ )
+      image(i,j) = float(i*j % 17);
+  PinholeModel small_distorted( Vector3(), math::identity_matrix<3>(), 40,40, 20,15,
+                                TsaiLensDistortion(Vector4(-0.28,0.106,-0.00014,0.00116)) );
+  PinholeModel small_plain = strip_lens_distortion(small_distorted);
+  CameraTransform<PinholeModel,PinholeModel> ctx( small_distorted, small_plain );
+  EXPECT_TRUE( ctx.batch_reverse() );
+  TransformView<InterpolationView<EdgeExtensionView<ImageView<float>, ZeroEdgeExtension>, BilinearInterpolation>,
+                CameraTransform<PinholeModel,PinholeModel> > undistorted =
+    camera_transform( image, small_distorted, small_plain );
+  ImageView<float> result = undistorted;
+  for ( int j = 0; j < result.rows(); j++ )
+    for ( int i = 0; i < result.cols(); i++ )
+      EXPECT_FLOAT_EQ( undistorted(i,j), result(i,j) );
+
+  // The batch transform checks every point like reverse() does.
+  std::vector<Vector2> tile, moved;
+  tile.push_back( Vector2(3,4) );
+  tile.push_back( Vector2(10,12) );
+  ctx.reverse_points( tile, moved );
+  for ( size_t k = 0; k < tile.size(); k++ )
+    EXPECT_VECTOR_DOUBLE_EQ( ctx.reverse(tile[k]), moved[k] );
+  PinholeModel small_moved = small_plain;
+  small_moved.set_camera_center( Vector3(1,0,0) );
+  CameraTransform<PinholeModel,PinholeModel> moved_ctx( small_distorted, small_moved );
+  EXPECT_THROW( moved_ctx.reverse(tile[0]), LogicErr );
+  EXPECT_THROW( moved_ctx.reverse_points(tile, moved), LogicErr );
+}
+
+#if defined(VW_HAVE_PKG_LAPACK) && VW_HAVE_PKG_LAPACK==1
+TEST( PinholeModel, UndistortionGrid ) {
+  PinholeModel exact( Vector3(1,2,3), math::euler_to_rotation_matrix(0.1,-0.2,0.3,"xyz"),
+                      500,500, 500,500,
+                      TsaiLensDistortion(Vector4(-0.28,0.106,-0.00014,0.00116)) );
+  PinholeModel gridded = exact;
+  const double tolerance = 1e-3;
+  gridded.enable_undistortion_grid( BBox2(0,0,1000,1000), tolerance );
+
+  boost::shared_ptr<UndistortionGrid const> grid = gridded.undistortion_grid();
+  ASSERT_TRUE( grid.get() != 0 );
+  EXPECT_LE( grid->max_error(), tolerance );
+  EXPECT_FALSE( exact.undistortion_grid() );
+
+  // Copies share the grid until their intrinsics change.
+  PinholeModel copy = gridded;
+  EXPECT_EQ( grid.get(), copy.undistortion_grid().get() );
+  copy.set_camera_center( Vector3(4,5,6) );
+  EXPECT_EQ( grid.get(), copy.undistortion_grid().get() );
+  copy.set_focal_length( Vector2(510,510) );
+  EXPECT_NE( grid.get(), copy.undistortion_grid().get() );
+  EXPECT_EQ( grid.get(), gridded.undistortion_grid().get() );
+
+  // Inside the grid the results are within the tolerance (a pixel at a
+  // focal length of 500 subtends 1/500 radians), and outside they are exact.
+  std::vector<Vector2> pixels;
+  for ( double i = -50; i < 1050; i += 37.3 )
+    for ( double j = -50; j < 1050; j += 41.7 )
+      pixels.push_back( Vector2(i,j) );
+  std::vector<Vector3> batch;
+  gridded.pixels_to_vectors( pixels, batch );
+  for ( size_t k = 0; k < pixels.size(); k++ ) {
+    Vector3 expected = exact.pixel_to_vector( pixels[k] );
+    EXPECT_VECTOR_DOUBLE_EQ( gridded.pixel_to_vector(pixels[k]), batch[k] );
+    if ( grid->contains(pixels[k]) )
+      EXPECT_VECTOR_NEAR( expected, batch[k], tolerance/500 );
+    else
+      EXPECT_VECTOR_DOUBLE_EQ( expected, batch[k] );
+  }
+
+  // An unreachable tolerance leaves the exact solution in place.
+  gridded.enable_undistortion_grid( BBox2(0,0,1000,1000), 1e-14 );
+  EXPECT_FALSE( gridded.undistortion_grid() );
+  EXPECT_VECTOR_DOUBLE_EQ( exact.pixel_to_vector(Vector2(123,456)),
+                           gridded.pixel_to_vector(Vector2(123,456)) );
+}
+#endif
+
 TEST( PinholeModel, ScalePinhole ) {
   Matrix<double,3,3> rot = vw::math::euler_to_quaternion(1.15, 0.0, -1.57, "xyz").rotation_matrix();
   PinholeModel pinhole4(Vector3(-0.329, 0.065, -0.82),
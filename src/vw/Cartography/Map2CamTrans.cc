@@ -57,6 +57,21 @@ namespace vw { namespace cartography {
       else             return m_invalid_pix;
     }
 
+    Vector3 xyz;
+    if (!dem_point(p, xyz))
+      return m_invalid_pix;
+
+    Vector2 pt;
+    try{
+      pt = m_cam->point_to_pixel(xyz);
+    }catch(...){ // If a point failed to project
+      return m_invalid_pix;
+    }
+    return check_image_pixel(pt);
+  }
+
+  bool Map2CamTrans::dem_point(vw::Vector2 const& p, vw::Vector3 & xyz) const {
+
     int b = BicubicInterpolation::pixel_buffer;
     Vector2 lonlat  = m_image_georef.pixel_to_lonlat(p);
     Vector2 dem_pix = m_dem_georef.lonlat_to_pixel(lonlat);
@@ -64,7 +79,7 @@ namespace vw { namespace cartography {
         (dem_pix[1] < b - 1) || (dem_pix[1] >= m_dem.rows() - b)
         ){
       // No DEM data
-      return m_invalid_pix;
+      return false;
     }
 
     Vector2 sdem_pix = dem_pix - m_dem_cache_box.min(); // since we cropped the DEM
@@ -77,29 +92,27 @@ namespace vw { namespace cartography {
       box.min() = floor(p) - Vector2(1, 1);
       box.max() = ceil(p)  + Vector2(1, 1);
       cache_dem(box);
-      return reverse(p);
+      return dem_point(p, xyz);
     }
 
     PixelMask<float> h = m_interp_dem(sdem_pix[0], sdem_pix[1]);
     if (!is_valid(h))
-      return m_invalid_pix;
+      return false;
 
-    Vector3 xyz = m_dem_georef.datum().geodetic_to_cartesian
+    xyz = m_dem_georef.datum().geodetic_to_cartesian
       (Vector3(lonlat[0], lonlat[1], h.child()));
-    Vector2 pt;
-    try{
-      pt = m_cam->point_to_pixel(xyz);
-      if ( m_call_from_mapproject &&
-           (pt[0] < b - 1 || pt[0] >= m_image_size[0] - b ||
-            pt[1] < b - 1 || pt[1] >= m_image_size[1] - b)
-           ){
-        // Won't be able to interpolate into image in transform(...)
-        return m_invalid_pix;
-      }
-    }catch(...){ // If a point failed to project
+    return true;
+  }
+
+  vw::Vector2 Map2CamTrans::check_image_pixel(vw::Vector2 const& pt) const {
+    int b = BicubicInterpolation::pixel_buffer;
+    if ( m_call_from_mapproject &&
+         (pt[0] < b - 1 || pt[0] >= m_image_size[0] - b ||
+          pt[1] < b - 1 || pt[1] >= m_image_size[1] - b)
+         ){
+      // Won't be able to interpolate into image in transform(...)
       return m_invalid_pix;
     }
-
     return pt;
   }
 
@@ -151,9 +164,30 @@ namespace vw { namespace cartography {
     local_cache_box.expand(BicubicInterpolation::pixel_buffer); // for interpolation
     m_cache.set_size(local_cache_box.width(), local_cache_box.height());
     vw::BBox2 out_box;
+    // Project each row of DEM points into the camera with a single call.
+    std::vector<Vector3> xyz_row;
+    std::vector<Vector2> pix_row;
+    std::vector<int32>   col_row;
     for( int32 y=local_cache_box.min().y(); y<local_cache_box.max().y(); ++y ){
+      xyz_row.clear();
+      col_row.clear();
       for( int32 x=local_cache_box.min().x(); x<local_cache_box.max().x(); ++x ){
-        Vector2 p = reverse( Vector2(x,y) );
+        m_cache(x - local_cache_box.min().x(), y - local_cache_box.min().y()) = m_invalid_pix;
+        Vector3 xyz;
+        if (!dem_point(Vector2(x,y), xyz)) continue;
+        xyz_row.push_back(xyz);
+        col_row.push_back(x);
+      }
+      try {
+        m_cam->points_to_pixels(xyz_row, pix_row);
+      } catch(...) { // Be as forgiving as reverse() is.
+        pix_row.resize(xyz_row.size());
+        for (size_t i = 0; i < col_row.size(); i++)
+          pix_row[i] = reverse( Vector2(col_row[i], y) );
+      }
+      for (size_t i = 0; i < col_row.size(); i++){
+        int32 x = col_row[i];
+        Vector2 p = check_image_pixel(pix_row[i]);
         m_cache(x - local_cache_box.min().x(), y - local_cache_box.min().y()) = p;
         if (p == m_invalid_pix) continue;
         if (bbox.contains(Vector2i(x, y))) out_box.grow( p );
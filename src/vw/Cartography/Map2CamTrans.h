@@ -80,6 +80,14 @@ namespace vw { namespace cartography {
     // Not thread safe ... you must copy this object
     void       cache_dem   ( vw::BBox2i const& bbox ) const;
     vw::BBox2i reverse_bbox( vw::BBox2i const& bbox ) const;
+
+  private:
+    /// Find the DEM point under a map projected pixel, if there is one.
+    bool dem_point(vw::Vector2 const& p, vw::Vector3 & xyz) const;
+
+    /// Return the camera pixel, or the invalid pixel if it is too
+    /// close to the image edge to interpolate.
+    vw::Vector2 check_image_pixel(vw::Vector2 const& pt) const;
   };
   
   std::ostream& operator<<(std::ostream& os, const Map2CamTrans& trans);
@@ -99,7 +99,9 @@
 /// abstract method handle().  When exceptions have not been disabled,
 /// the Exception class and its children define a virtual method
 /// default_throw() which the handler may call to have the exception
-/// throw itself in a type-aware manner.
+/// throw itself in a type-aware manner.  Likewise clone() returns a
+/// heap allocated copy of the most derived type, so an exception
+/// caught in one thread can be rethrown in another.
 ///
 #ifndef __VW_CORE_EXCEPTION_H__
 #define __VW_CORE_EXCEPTION_H__
@@ -162,6 +164,7 @@ namespace vw {
     void reset() { m_desc.str(""); }
 
     VW_IF_EXCEPTIONS( virtual void default_throw() const { throw *this; } )
+    virtual Exception* clone() const { return new Exception(*this); }
 
   protected:
       virtual std::ostringstream& stream() {return m_desc;}
@@ -218,6 +221,8 @@ namespace vw {
   #define VW_EXCEPTION_API(exception_type)                                     \
     virtual std::string name() const { return #exception_type; }               \
     VW_IF_EXCEPTIONS( virtual void default_throw() const { throw *this; } )    \
+    virtual exception_type* clone() const                                      \
+      { return new exception_type(*this); }                                    \
     template <class T>                                                         \
     exception_type& operator<<( T const& t ) { stream() << t; return *this; }
 
@@ -28,9 +28,13 @@
 #include <list>
 
 #include <vw/Core/Condition.h>
+#include <vw/Core/Exception.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/Thread.h>
 
+#include <boost/exception_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
 // STL
 #include <map>
 
@@ -65,6 +69,41 @@ namespace vw {
     void signal_finished();
   };
 
+  /// Keeps an exception thrown inside a Task so that the thread which
+  /// queued the task can rethrow it after joining the queue. VW
+  /// exceptions keep their type through Exception::clone(), anything
+  /// else is carried by a boost::exception_ptr.
+  class TaskFailure {
+    boost::shared_ptr<Exception> m_vw_error;
+    boost::exception_ptr         m_other_error;
+
+  public:
+    /// Store the exception being handled. Call from a catch block.
+    void capture() {
+      try {
+        throw;
+      } catch ( const Exception& e ) {
+        m_vw_error.reset( e.clone() );
+      } catch ( ... ) {
+        m_other_error = boost::current_exception();
+      }
+    }
+
+    bool failed() const { return m_vw_error || m_other_error; }
+
+    void clear() {
+      m_vw_error.reset();
+      m_other_error = boost::exception_ptr();
+    }
+
+    /// Throw the stored exception again.
+    void rethrow() const {
+      if ( m_vw_error )
+        m_vw_error->default_throw();
+      boost::rethrow_exception( m_other_error );
+    }
+  };
+
   // ----------------------  --------------  ---------------------------
   // ----------------------  Task Generator  ---------------------------
   // ----------------------  --------------  ---------------------------
@@ -114,6 +114,104 @@ namespace vw {
     }
   };
 
+  /// A VarArray that keeps up to SmallN elements inline instead of
+  /// on the heap.  Short dynamic vectors are created and copied in
+  /// very large numbers as temporaries, and for them the allocation
+  /// costs far more than the arithmetic.  Arrays larger than SmallN
+  /// fall back to the heap.  Unlike VarArray, swap() copies the
+  /// elements of inline arrays, so it invalidates iterators.
+  template <class T, size_t SmallN>
+  class SmallVarArray {
+    T m_small[SmallN];
+    T* m_data;
+    size_t m_size;
+
+    static T* allocate( size_t size, T* small ) {
+      return ( size <= SmallN ) ? small : new T[size];
+    }
+    void release() {
+      if ( m_data != m_small ) delete [] m_data;
+    }
+  public:
+    SmallVarArray() : m_data(m_small), m_size(0) {}
+
+    SmallVarArray( SmallVarArray const& other ) : m_data(allocate(other.size(),m_small)), m_size(other.size()) {
+      std::copy( other.begin(), other.end(), begin() );
+    }
+
+    SmallVarArray( size_t size ) : m_data(allocate(size,m_small)), m_size(size) {
+      std::fill(begin(),end(),T());
+    }
+
+    template <class IterT>
+    SmallVarArray( IterT b, IterT e ) : m_data(allocate(e-b,m_small)), m_size(e-b) {
+      std::copy(b,e,begin());
+    }
+
+    ~SmallVarArray() { release(); }
+
+    SmallVarArray& operator=( SmallVarArray const& other ) {
+      if ( &other == this ) return *this;
+      if ( other.size() != m_size ) {
+        T* new_data = allocate( other.size(), m_small );
+        if ( new_data != m_data ) release();
+        m_data = new_data;
+        m_size = other.size();
+      }
+      std::copy( other.begin(), other.end(), begin() );
+      return *this;
+    }
+
+    inline T& operator[]( size_t i ) {
+      return m_data[i];
+    }
+
+    inline T const& operator[]( size_t i ) const {
+      return m_data[i];
+    }
+
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    iterator begin() { return m_data; }
+    iterator end() { return m_data + m_size; }
+
+    const_iterator begin() const { return m_data; }
+    const_iterator end() const { return m_data + m_size; }
+
+    size_t size() const { return m_size; }
+
+    void resize( size_t new_size, bool preserve = true ) {
+      if( new_size == m_size ) return;
+      size_t keep = preserve ? (std::min)( new_size, m_size ) : 0;
+      if ( new_size <= SmallN && m_data == m_small ) {
+        // Stays inline, nothing to move
+      }
+      else {
+        T* new_data = allocate( new_size, m_small );
+        if ( new_data != m_data ) {
+          std::copy( m_data, m_data+keep, new_data );
+          release();
+          m_data = new_data;
+        }
+      }
+      std::fill( m_data+keep, m_data+new_size, T() );
+      m_size = new_size;
+    }
+
+    void swap( SmallVarArray& other ) {
+      if ( m_data != m_small && other.m_data != other.m_small ) {
+        std::swap( m_data, other.m_data );
+        std::swap( m_size, other.m_size );
+      }
+      else {
+        SmallVarArray tmp( other );
+        other = *this;
+        *this = tmp;
+      }
+    }
+  };
+
 } // namespace vw
 
 #endif // __VW_CORE_VARARRAY_H__
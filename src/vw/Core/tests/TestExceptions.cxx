@@ -17,6 +17,7 @@
 
 
 #include <vw/Core/Exception.h>
+#include <boost/scoped_ptr.hpp>
 #include <test/Helpers.h>
 
 using namespace vw;
@@ -73,3 +74,13 @@ TEST(Exceptions, HAS_EXCEPTIONS(Ext)) {
     EXPECT_EQ("Code2", c.name());
   }
 }
+
+TEST(Exceptions, HAS_EXCEPTIONS(Clone)) {
+  Level2Err l2;
+  l2 << "Cloned.";
+  Exception const& base = l2;
+  boost::scoped_ptr<Exception> copy( base.clone() );
+  EXPECT_EQ("Level2Err", copy->name());
+  EXPECT_EQ("Cloned.",   copy->desc());
+  EXPECT_THROW(copy->default_throw(), Level2Err);
+}
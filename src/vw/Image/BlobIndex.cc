@@ -25,6 +25,7 @@
 #include <vw/Image/BlobIndex.h>
 
 #include <math.h>
+#include <algorithm>
 
 #include <boost/foreach.hpp>
 
@@ -581,5 +582,121 @@ BlobIndexThreaded::bbox_end() { return m_blob_bbox.end(); }
 BlobIndexThreaded::const_bbox_iterator
 BlobIndexThreaded::bbox_end() const { return m_blob_bbox.end(); }
 
-} // end namespace vw
+// TiledBlobIndex
+/////////////////////////////////////
+
+namespace blob {
+
+namespace {
+  // Give a seam id to every blob along one edge of the tile
+  void record_edge( ImageView<uint32> const& labels, int32 col, int32 row,
+                    int32 di, int32 dj, int32 length,
+                    std::vector<uint64> const& areas, std::vector<uint32>& seam_id,
+                    uint32& num_seams, std::vector<uint32>* edge, BlobSeams* seams ) {
+    if ( edge )
+      edge->resize( length );
+    for ( int32 n = 0; n < length; n++, col += di, row += dj ) {
+      uint32 label = labels(col,row);
+      if ( label && !seam_id[label-1] ) {
+        seam_id[label-1] = ++num_seams;
+        if ( seams )
+          seams->area.push_back( areas[label-1] );
+      }
+      if ( edge )
+        (*edge)[n] = label ? seam_id[label-1] : 0;
+    }
+  }
+}
+
+uint32 find_seams( ImageView<uint32>   const& labels,
+                   std::vector<uint64> const& areas,
+                   std::vector<uint32>      & seam_id,
+                   BlobSeams* seams ) {
+  seam_id.assign( areas.size(), 0 );
+  uint32 num_seams = 0;
+  const int32 cols = labels.cols(), rows = labels.rows();
+  if ( seams )
+    seams->area.clear();
+  record_edge( labels, 0, 0,      1, 0, cols, areas, seam_id, num_seams,
+               seams ? &seams->top    : 0, seams );
+  record_edge( labels, 0, rows-1, 1, 0, cols, areas, seam_id, num_seams,
+               seams ? &seams->bottom : 0, seams );
+  record_edge( labels, 0,      0, 0, 1, rows, areas, seam_id, num_seams,
+               seams ? &seams->left   : 0, seams );
+  record_edge( labels, cols-1, 0, 0, 1, rows, areas, seam_id, num_seams,
+               seams ? &seams->right  : 0, seams );
+  return num_seams;
+}
+
+namespace {
+  // Join the seam blobs on either side of a shared edge, including
+  // the diagonal neighbors.
+  void join_edges( std::vector<uint32> const& a, uint32 a_offset,
+                   std::vector<uint32> const& b, uint32 b_offset,
+                   UnionFind& sets ) {
+    const int32 length = int32(a.size());
+    for ( int32 n = 0; n < length; n++ ) {
+      if ( !a[n] )
+        continue;
+      for ( int32 m = std::max(n-1,0); m <= std::min(n+1,length-1); m++ )
+        if ( b[m] )
+          sets.unite( a_offset + a[n] - 1, b_offset + b[m] - 1 );
+    }
+  }
+}
+
+} // end namespace blob
 
+size_t TiledBlobIndex::num_tiles() const {
+  int32 tile_rows = (m_image_size.y() + m_tile_size - 1) / m_tile_size;
+  return size_t(m_tile_cols) * tile_rows;
+}
+
+BBox2i TiledBlobIndex::tile( size_t index ) const {
+  Vector2i corner( int32(index % m_tile_cols) * m_tile_size,
+                   int32(index / m_tile_cols) * m_tile_size );
+  BBox2i bbox( corner, corner + Vector2i(m_tile_size,m_tile_size) );
+  bbox.crop( BBox2i(Vector2i(), m_image_size) );
+  return bbox;
+}
+
+void TiledBlobIndex::merge_seams( std::vector<blob::BlobSeams>& seams ) {
+  blob::UnionFind sets;
+  m_seam_offset.resize( seams.size() );
+  for ( size_t t = 0; t < seams.size(); t++ ) {
+    m_seam_offset[t] = uint32(sets.size());
+    for ( size_t k = 0; k < seams[t].area.size(); k++ )
+      sets.add( seams[t].area[k] );
+  }
+
+  const size_t tile_cols = m_tile_cols, tile_rows = tile_cols ? seams.size() / tile_cols : 0;
+  for ( size_t ty = 0; ty < tile_rows; ty++ ) {
+    for ( size_t tx = 0; tx < tile_cols; tx++ ) {
+      size_t t = ty * tile_cols + tx;
+      blob::BlobSeams const& here = seams[t];
+      if ( tx + 1 < tile_cols ) { // Right
+        size_t r = t + 1;
+        blob::join_edges( here.right, m_seam_offset[t], seams[r].left, m_seam_offset[r], sets );
+      }
+      if ( ty + 1 < tile_rows ) { // Below
+        size_t b = t + tile_cols;
+        blob::join_edges( here.bottom, m_seam_offset[t], seams[b].top, m_seam_offset[b], sets );
+
+        // The corners only touch diagonally
+        if ( tx + 1 < tile_cols && here.bottom.back() && seams[b+1].top.front() )
+          sets.unite( m_seam_offset[t]   + here.bottom.back()     - 1,
+                      m_seam_offset[b+1] + seams[b+1].top.front() - 1 );
+        if ( tx > 0 && here.bottom.front() && seams[b-1].top.back() )
+          sets.unite( m_seam_offset[t]   + here.bottom.front()    - 1,
+                      m_seam_offset[b-1] + seams[b-1].top.back()  - 1 );
+      }
+    }
+  }
+
+  // Resolve the areas now so that lookups don't modify the sets
+  m_seam_area.resize( sets.size() );
+  for ( uint32 k = 0; k < sets.size(); k++ )
+    m_seam_area[k] = sets.area( sets.find(k) );
+}
+
+} // end namespace vw
@@ -29,9 +29,11 @@
 #include <vw/Core/Stopwatch.h>
 #include <vw/Image/AlgorithmFunctions.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/PixelAccessors.h>
 
 // Standard
+#include <algorithm>
 #include <vector>
 #include <deque>
 #include <list>
@@ -496,6 +498,319 @@ class BlobIndexThreaded {
   const_bbox_iterator bbox_end() const;
 };
 
+namespace blob {
+
+  // Union Find
+  ////////////////////////////////////
+  /// Disjoint set forest over blob labels that also keeps the pixel
+  /// area of every set. Sets are always linked under the root with the
+  /// lower index, so the root of a set is its oldest member.
+  class UnionFind {
+    std::vector<uint32> m_parent;
+    std::vector<uint64> m_area;
+  public:
+    /// Add a new single element set and return its index.
+    uint32 add( uint64 area = 0 ) {
+      m_parent.push_back( uint32(m_parent.size()) );
+      m_area.push_back( area );
+      return m_parent.back();
+    }
+
+    /// Return the root of the set containing index.
+    uint32 find( uint32 index ) {
+      while ( m_parent[index] != index ) {
+        m_parent[index] = m_parent[m_parent[index]]; // Path halving
+        index = m_parent[index];
+      }
+      return index;
+    }
+
+    /// Merge the sets containing a and b and return the new root.
+    uint32 unite( uint32 a, uint32 b ) {
+      a = find(a);
+      b = find(b);
+      if ( a == b )
+        return a;
+      if ( b < a )
+        std::swap( a, b );
+      m_parent[b] = a;
+      m_area  [a] += m_area[b];
+      return a;
+    }
+
+    /// Area of the set, only meaningful when called with a root.
+    uint64      & area( uint32 root )       { return m_area[root]; }
+    uint64 const& area( uint32 root ) const { return m_area[root]; }
+
+    size_t size() const { return m_parent.size(); }
+  };
+
+  /// Label the 8-connected blobs of valid pixels in an image in a
+  /// single pass using a union-find table.
+  /// - Labels start at 1 and are numbered in the raster order of the
+  ///   first pixel of each blob. Invalid pixels are labeled 0.
+  /// - The pixel count of blob k is written to areas[k-1].
+  /// - Returns the number of blobs.
+  template <class SourceT>
+  uint32 label_blobs( ImageViewBase<SourceT> const& src,
+                      ImageView<uint32>           & labels,
+                      std::vector<uint64>         & areas ) {
+    if ( src.impl().planes() > 1 )
+      vw_throw( NoImplErr()
+                << "Blob labeling currently only works with 2D images." );
+
+    // Only rasterizes if the input is not already an ImageView
+    ImageView<typename SourceT::pixel_type> image = src.impl();
+    const int32 cols = image.cols(), rows = image.rows();
+    labels.set_size( cols, rows );
+
+    // Provisional labels are one plus their index in the union-find table
+    UnionFind sets;
+    for ( int32 j = 0; j < rows; j++ ) {
+      uint32      * cur  = &labels(0,j);
+      uint32 const* prev = j > 0 ? &labels(0,j-1) : 0;
+      for ( int32 i = 0; i < cols; i++ ) {
+        if ( !is_valid(image(i,j)) ) {
+          cur[i] = 0;
+          continue;
+        }
+        uint32 neighbors[4] = { i > 0 ? cur[i-1] : 0, 0, 0, 0 };
+        if ( prev ) {
+          if ( i > 0      ) neighbors[1] = prev[i-1];
+                            neighbors[2] = prev[i  ];
+          if ( i < cols-1 ) neighbors[3] = prev[i+1];
+        }
+        uint32 label = 0;
+        for ( int32 n = 0; n < 4; n++ ) {
+          if ( !neighbors[n] || neighbors[n] == label )
+            continue;
+          if ( !label )
+            label = neighbors[n];
+          else
+            label = sets.unite( label-1, neighbors[n]-1 ) + 1;
+        }
+        if ( !label )
+          label = sets.add() + 1;
+        cur[i] = label;
+      }
+    }
+
+    // Number the roots in order. Every root has a lower index than the
+    // rest of its set, so the roots are resolved before their members.
+    std::vector<uint32> final_label( sets.size() );
+    uint32 num_blobs = 0;
+    for ( uint32 k = 0; k < sets.size(); k++ ) {
+      uint32 root = sets.find(k);
+      final_label[k] = root == k ? ++num_blobs : final_label[root];
+    }
+
+    areas.assign( num_blobs, 0 );
+    for ( int32 j = 0; j < rows; j++ ) {
+      uint32* cur = &labels(0,j);
+      for ( int32 i = 0; i < cols; i++ ) {
+        if ( cur[i] ) {
+          cur[i] = final_label[cur[i]-1];
+          areas[cur[i]-1]++;
+        }
+      }
+    }
+    return num_blobs;
+  }
+
+  // Blob Seams
+  ////////////////////////////////////
+  /// The blobs along the border of one tile of a TiledBlobIndex.
+  /// Blobs touching the border are given seam ids starting at 1, in the
+  /// order they are met walking the top row, bottom row, left column
+  /// and then the right column. The edge vectors hold the seam id of
+  /// every border pixel, or 0 for invalid pixels.
+  struct BlobSeams {
+    std::vector<uint32> top, bottom, left, right;
+    std::vector<uint64> area; ///< Area inside the tile of every seam blob
+  };
+
+  /// Find the blobs touching the border of a labeled tile.
+  /// - seam_id is filled with the seam id of every label, 0 for labels
+  ///   that are entirely inside the tile.
+  /// - If seams is not null the border and tile areas are recorded.
+  /// - Returns the number of seam blobs.
+  uint32 find_seams( ImageView<uint32>   const& labels,
+                     std::vector<uint64> const& areas,
+                     std::vector<uint32>      & seam_id,
+                     BlobSeams* seams = 0 );
+
+  /// Pass one of TiledBlobIndex: label one tile and record its seams.
+  template <class SourceT>
+  class BlobSeamTask : public Task, private boost::noncopyable {
+    SourceT const& m_view;
+    BBox2i         m_bbox;
+    BlobSeams    & m_seams;
+  public:
+    BlobSeamTask( SourceT const& view, BBox2i const& bbox, BlobSeams& seams ) :
+      m_view(view), m_bbox(bbox), m_seams(seams) {}
+
+    void operator()() {
+      ImageView<typename SourceT::pixel_type> tile = crop( m_view, m_bbox );
+      ImageView<uint32>   labels;
+      std::vector<uint64> areas;
+      std::vector<uint32> seam_id;
+      label_blobs( tile, labels, areas );
+      find_seams( labels, areas, seam_id, &m_seams );
+    }
+  };
+
+} // end namespace blob
+
+// Tiled Blob Index
+///////////////////////////////////
+/// Connected component labelling done a tile at a time.
+///
+/// The constructor labels every tile in parallel with a union-find
+/// table and keeps only the labels along the tile borders. The border
+/// labels of neighboring tiles are then merged to find the total area
+/// of every blob crossing a seam, and thrown away. Memory use is a
+/// tile per thread plus the seam blobs, never the whole image, so the
+/// input can be a large image on disk.
+///
+/// Tiles are labeled again on request by label_tile(), which gives the
+/// whole image area of every blob in the tile.
+class TiledBlobIndex {
+  Vector2i            m_image_size;
+  int32               m_tile_size, m_tile_cols;
+  std::vector<uint32> m_seam_offset; ///< Index of the first seam blob of each tile
+  std::vector<uint64> m_seam_area;   ///< Whole image area of every seam blob
+
+  // Join the seam blobs of neighboring tiles
+  void merge_seams( std::vector<blob::BlobSeams>& seams );
+
+public:
+  /// Labels the image in tiles of tile_size pixels square.
+  template <class SourceT>
+  TiledBlobIndex( ImageViewBase<SourceT> const& src,
+                  int32 tile_size   = vw_settings().default_tile_size(),
+                  int32 num_threads = vw_settings().default_num_threads() )
+    : m_image_size( src.impl().cols(), src.impl().rows() ), m_tile_size( tile_size ),
+      m_tile_cols( tile_size > 0 ? (src.impl().cols() + tile_size - 1) / tile_size : 0 ) {
+    if ( tile_size < 1 )
+      vw_throw( ArgumentErr() << "TiledBlobIndex: Tile size must be positive." );
+
+    std::vector<blob::BlobSeams> seams( num_tiles() );
+    typedef blob::BlobSeamTask<SourceT> task_type;
+    if ( num_threads > 1 && num_tiles() > 1 ) {
+      FifoWorkQueue queue( num_threads );
+      for ( size_t t = 0; t < num_tiles(); t++ ) {
+        boost::shared_ptr<task_type> task( new task_type( src.impl(), tile(t), seams[t] ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
+    } else {
+      for ( size_t t = 0; t < num_tiles(); t++ )
+        task_type( src.impl(), tile(t), seams[t] )();
+    }
+    merge_seams( seams );
+  }
+
+  /// Tiles are numbered in raster order.
+  size_t num_tiles() const;
+  int32  tile_size() const { return m_tile_size; }
+  int32  tile_cols() const { return m_tile_cols; }
+  BBox2i tile( size_t index ) const;
+
+  /// Label the pixels of one tile, which must be passed in cropped to
+  /// tile(index). Labels are as in blob::label_blobs() but areas[k-1]
+  /// is the area of blob k over the whole image.
+  template <class TileT>
+  uint32 label_tile( ImageViewBase<TileT> const& tile_image, size_t index,
+                     ImageView<uint32>& labels, std::vector<uint64>& areas ) const {
+    uint32 num_blobs = blob::label_blobs( tile_image, labels, areas );
+    std::vector<uint32> seam_id;
+    blob::find_seams( labels, areas, seam_id );
+    for ( uint32 k = 0; k < num_blobs; k++ )
+      if ( seam_id[k] )
+        areas[k] = m_seam_area[ m_seam_offset[index] + seam_id[k] - 1 ];
+    return num_blobs;
+  }
+};
+
+// Remove Small Blobs View
+///////////////////////////////////
+/// Replaces the pixels of every blob with max_area pixels or fewer by
+/// an invalid pixel, using a TiledBlobIndex of the input.
+/// - Rasterizing in blocks aligned with the index tiles labels every
+///   tile only once.
+template <class ImageT>
+class RemoveSmallBlobsView : public ImageViewBase<RemoveSmallBlobsView<ImageT> > {
+  ImageT m_image;
+  boost::shared_ptr<TiledBlobIndex> m_index;
+  uint64 m_max_area;
+public:
+  typedef typename ImageT::pixel_type pixel_type;
+  typedef pixel_type result_type;
+  typedef ProceduralPixelAccessor<RemoveSmallBlobsView> pixel_accessor;
+
+  RemoveSmallBlobsView( ImageT const& image, boost::shared_ptr<TiledBlobIndex> index,
+                        int32 max_area ) :
+    m_image(image), m_index(index), m_max_area(max_area > 0 ? max_area : 0) {}
+
+  inline int32 cols  () const { return m_image.cols(); }
+  inline int32 rows  () const { return m_image.rows(); }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+  inline result_type operator()( int32 /*i*/, int32 /*j*/, int32 /*p*/ = 0) const {
+    vw_throw( NoImplErr() << "RemoveSmallBlobsView::operator()(....) has not been implemented." );
+    return result_type();
+  }
+
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+    ImageView<pixel_type> result( bbox.width(), bbox.height() );
+    ImageView<uint32>   labels;
+    std::vector<uint64> areas;
+    const int32 size = m_index->tile_size();
+    for ( int32 ty = bbox.min().y() / size; ty * size < bbox.max().y(); ty++ ) {
+      for ( int32 tx = bbox.min().x() / size; tx * size < bbox.max().x(); tx++ ) {
+        size_t index = ty * m_index->tile_cols() + tx;
+        BBox2i tile = m_index->tile( index );
+        ImageView<pixel_type> tile_image = crop( m_image, tile );
+        m_index->label_tile( tile_image, index, labels, areas );
+
+        BBox2i section = tile;
+        section.crop( bbox );
+        for ( int32 j = section.min().y(); j < section.max().y(); j++ ) {
+          for ( int32 i = section.min().x(); i < section.max().x(); i++ ) {
+            int32 ti = i - tile.min().x(), tj = j - tile.min().y();
+            uint32 label = labels(ti,tj);
+            if ( label && areas[label-1] <= m_max_area )
+              result(i-bbox.min().x(), j-bbox.min().y()) = pixel_type();
+            else
+              result(i-bbox.min().x(), j-bbox.min().y()) = tile_image(ti,tj);
+          }
+        }
+      }
+    }
+    return prerasterize_type( result, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+  }
+
+  template <class DestT>
+  inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    vw::rasterize( prerasterize(bbox), dest, bbox );
+  }
+};
+
+/// Invalidate every 8-connected blob of valid pixels with max_area
+/// pixels or fewer. The blobs are found up front with a TiledBlobIndex
+/// using tiles of tile_size pixels and num_threads threads.
+/// - The input is read twice, once here and once when rasterizing.
+template <class ImageT>
+RemoveSmallBlobsView<ImageT>
+remove_small_blobs( ImageViewBase<ImageT> const& image, int32 max_area,
+                    int32 tile_size   = vw_settings().default_tile_size(),
+                    int32 num_threads = vw_settings().default_num_threads() ) {
+  boost::shared_ptr<TiledBlobIndex> index( new TiledBlobIndex( image, tile_size, num_threads ) );
+  return RemoveSmallBlobsView<ImageT>( image.impl(), index, max_area );
+}
+
 } // end namespace vw
 
 #endif//__BLOB_INDEX_THREADED_H__
@@ -41,6 +41,7 @@
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PixelAccessors.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/Core/Log.h>
 
@@ -385,7 +386,31 @@ namespace vw {
       VW_OUT(VerboseDebugMessage, "image") << "EdgeExtensionView: prerasterizing child view with bbox " << src_bbox << ".\n";
       return prerasterize_type(m_image.prerasterize(src_bbox), m_xoffset, m_yoffset, m_cols, m_rows, m_extension_func );
     }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    /// Only the pixels outside the child image go through the edge
+    /// extension function.  The part of the bbox that lies on the child
+    /// is rasterized by the child as a single block, and the border
+    /// strips around it are filled in one pixel at a time.
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      BBox2i frame( -m_xoffset, -m_yoffset, m_image.cols(), m_image.rows() );
+      prerasterize_type src = prerasterize( bbox );
+      if( !bbox.intersects( frame ) ) {
+        vw::rasterize( src, dest, bbox );
+        return;
+      }
+      BBox2i inner = bbox;
+      inner.crop( frame );
+      src.child().rasterize( crop( dest, inner - bbox.min() ),
+                             inner + Vector2i( m_xoffset, m_yoffset ) );
+
+      BBox2i strips[4] = {
+        BBox2i( bbox.min().x(),  bbox.min().y(),  bbox.width(),                   inner.min().y() - bbox.min().y() ), // Top
+        BBox2i( bbox.min().x(),  inner.max().y(), bbox.width(),                   bbox.max().y() - inner.max().y() ), // Bottom
+        BBox2i( bbox.min().x(),  inner.min().y(), inner.min().x() - bbox.min().x(), inner.height() ),                 // Left
+        BBox2i( inner.max().x(), inner.min().y(), bbox.max().x() - inner.max().x(), inner.height() ) };               // Right
+      for( int i = 0; i < 4; ++i )
+        if( !strips[i].empty() )
+          vw::rasterize( src, crop( dest, strips[i] - bbox.min() ), strips[i] );
+    }
   };
 
   template <class ImageT, class ExtensionT>
@@ -29,6 +29,9 @@
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageView.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace vw {
 
   // *******************************************************************
@@ -245,6 +248,49 @@ namespace vw {
   };
 
 
+  /// The blocks block_write_image() splits an image into, in the order they
+  /// are written: left to right, then top to bottom.
+  template <class ImageT>
+  std::vector<BBox2i> block_write_blocks( DstImageResource const& resource,
+                                          ImageViewBase<ImageT> const& image ) {
+    const int32 rows = boost::numeric_cast<int32>(image.impl().rows());
+    const int32 cols = boost::numeric_cast<int32>(image.impl().cols());
+
+    Vector2i block_size(cols, rows);
+    if (resource.has_block_write())
+      block_size = resource.block_write_size();
+
+    std::vector<BBox2i> blocks;
+    blocks.reserve( ((rows-1)/block_size.y()+1) * ((cols-1)/block_size.x()+1) );
+    for (int32 j = 0; j < rows; j+= block_size.y())
+      for (int32 i = 0; i < cols; i+= block_size.x())
+        blocks.push_back( BBox2i(Vector2i(i,j),
+                                 Vector2i(std::min<int32>(i+block_size.x(),cols),
+                                          std::min<int32>(j+block_size.y(),rows))) );
+    return blocks;
+  }
+
+  /// Task that stores a cost estimate for one block, used by block_write_image_by_cost().
+  template <class CostFuncT>
+  class BlockCostTask : public Task {
+    CostFuncT const& m_cost_func;
+    BBox2i           m_bbox;
+    double         & m_cost;
+  public:
+    BlockCostTask( CostFuncT const& cost_func, BBox2i const& bbox, double & cost ) :
+      m_cost_func(cost_func), m_bbox(bbox), m_cost(cost) {}
+    virtual ~BlockCostTask() {}
+    virtual void operator()() { m_cost = m_cost_func(m_bbox); }
+  };
+
+  /// Sorts block indices by decreasing cost.
+  struct BlockCostGreater {
+    std::vector<double> const& m_costs;
+    BlockCostGreater( std::vector<double> const& costs ) : m_costs(costs) {}
+    bool operator()( size_t a, size_t b ) const { return m_costs[a] > m_costs[b]; }
+  };
+
+
   /// Write an image to disk using multiple threads operating on tiles in parallel.
   template <class ImageT>
   void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
@@ -258,21 +304,14 @@ namespace vw {
     if (progress_callback.abort_requested())
       vw_throw( Aborted() << "Aborted by ProgressCallback" );
 
-    const int32 rows = boost::numeric_cast<int32>(image.impl().rows());
-    const int32 cols = boost::numeric_cast<int32>(image.impl().cols());
-
     // Write the image to disk in blocks.  We may need to revisit
     // the order in which these blocks are rasterized, but for now
     // it rasterizes blocks from left to right, then top to bottom.
-    Vector2i block_size(cols, rows);
-    if (resource.has_block_write())
-      block_size = resource.block_write_size();
-
-    size_t total_num_blocks = ((rows-1)/block_size.y()+1) * ((cols-1)/block_size.x()+1);
-    VW_OUT(DebugMessage,"image") << "block_write_image: writing " << total_num_blocks << " blocks.\n";
+    std::vector<BBox2i> blocks = block_write_blocks(resource, image);
+    VW_OUT(DebugMessage,"image") << "block_write_image: writing " << blocks.size() << " blocks.\n";
 
     // Early out for easy case
-    if (total_num_blocks == 1) {
+    if (blocks.size() == 1) {
       ImageView<typename ImageT::pixel_type> image_block = image.impl();
       resource.write( image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
     } else {
@@ -280,23 +319,9 @@ namespace vw {
       // and writing images to disk one block (and one thread) at a time.
       ThreadedBlockWriter block_writer;
 
-      for (int32 j = 0; j < rows; j+= block_size.y()) {
-        for (int32 i = 0; i < cols; i+= block_size.x()) {
-          VW_OUT(DebugMessage, "image") << "ImageIO scheduling block at [" << i << " " << j << "]/[" << rows << " " << cols << "] blocksize = " << block_size.x() << " x " <<  block_size.y() << "\n";
-
-          // Rasterize and save this image block
-          BBox2i current_bbox(Vector2i(i,j),
-                              Vector2i(std::min<int32>(i+block_size.x(),cols),
-                                       std::min<int32>(j+block_size.y(),rows)));
-
-          // Rasterize this image block by scheduling it with the block_writer.
-          int col_blocks = int( ceil(float(cols)/float(block_size.x())) );
-          int i_block_index = int(i/block_size.x());
-          int j_block_index = int(j/block_size.y());
-          int index = j_block_index*col_blocks+i_block_index;
-
-          block_writer.add_block(resource, image, current_bbox, index, total_num_blocks, progress_callback );
-        }
+      for (size_t index = 0; index < blocks.size(); ++index) {
+        VW_OUT(DebugMessage, "image") << "ImageIO scheduling block " << index << " at " << blocks[index] << "\n";
+        block_writer.add_block(resource, image, blocks[index], index, blocks.size(), progress_callback );
       }
 
       // Start the threaded block writer and wait for all tasks to finish.
@@ -305,6 +330,68 @@ namespace vw {
     progress_callback.report_finished();
   }
 
+  /// Write an image to disk using multiple threads operating on tiles
+  /// in parallel, starting the tiles that are expected to take the longest first.
+  /// - cost_func(BBox2i) must return an estimate of how long a block takes
+  ///   to rasterize. Only the relative values matter. The estimates are
+  ///   computed in parallel before any block is rasterized.
+  /// - Blocks are still written to the resource in order. Since
+  ///   rasterization may only get write_pool_size blocks ahead of the
+  ///   writes, blocks are reordered within each group of that many
+  ///   consecutive blocks. A bigger write_pool_size gives the scheduler
+  ///   more freedom at the cost of more memory.
+  template <class ImageT, class CostFuncT>
+  void block_write_image_by_cost( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                                  CostFuncT const& cost_func,
+                                  const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
+
+    VW_ASSERT( image.impl().cols() != 0 && image.impl().rows() != 0 && image.impl().planes() != 0,
+               ArgumentErr() << "write_image: cannot write an empty image to a resource" );
+
+    progress_callback.report_progress(0);
+    if (progress_callback.abort_requested())
+      vw_throw( Aborted() << "Aborted by ProgressCallback" );
+
+    std::vector<BBox2i> blocks = block_write_blocks(resource, image);
+    VW_OUT(DebugMessage,"image") << "block_write_image_by_cost: writing " << blocks.size() << " blocks.\n";
+
+    if (blocks.size() == 1) {
+      ImageView<typename ImageT::pixel_type> image_block = image.impl();
+      resource.write( image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
+      progress_callback.report_finished();
+      return;
+    }
+
+    // Get the cost estimate for every block.
+    std::vector<double> costs(blocks.size());
+    {
+      FifoWorkQueue cost_queue;
+      for (size_t index = 0; index < blocks.size(); ++index)
+        cost_queue.add_task( boost::shared_ptr<Task>
+                             ( new BlockCostTask<CostFuncT>( cost_func, blocks[index], costs[index] ) ) );
+      cost_queue.join_all();
+    }
+
+    // Most expensive first within each window of blocks the writer can work on at once.
+    std::vector<size_t> order(blocks.size());
+    for (size_t index = 0; index < order.size(); ++index)
+      order[index] = index;
+    const size_t window = std::max(vw_settings().write_pool_size(), uint32(1));
+    for (size_t start = 0; start < order.size(); start += window)
+      std::stable_sort( order.begin() + start, order.begin() + std::min(start + window, order.size()),
+                        BlockCostGreater(costs) );
+
+    ThreadedBlockWriter block_writer;
+    for (size_t i = 0; i < order.size(); ++i) {
+      const size_t index = order[i];
+      VW_OUT(DebugMessage, "image") << "ImageIO scheduling block " << index << " at " << blocks[index]
+                                    << " with cost " << costs[index] << "\n";
+      block_writer.add_block(resource, image, blocks[index], index, blocks.size(), progress_callback );
+    }
+    block_writer.process_blocks();
+    progress_callback.report_finished();
+  }
+
   template <class ImageT>
   void write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
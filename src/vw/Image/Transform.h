@@ -28,6 +28,9 @@
 // Vision Workbench
 #include <vw/Core/Features.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Cache.h>
+#include <vw/Core/System.h>
+#include <vw/Core/Thread.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/Matrix.h>
 #include <vw/Math/LevenbergMarquardt.h>
@@ -35,6 +38,13 @@
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Interpolation.h>
 
+#include <algorithm>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/shared_ptr.hpp>
+
 static const double VW_DEFAULT_MIN_TRANSFORM_IMAGE_SIZE = 1;
 static const double VW_DEFAULT_MAX_TRANSFORM_IMAGE_SIZE = 1e10; // Ten gigapixels
 
@@ -108,6 +118,19 @@ namespace vw {
       return levenberg_marquardt( ReverseLMA( this ), point, point, status );
     }
 
+    /// Applies reverse() to many points at once, replacing the contents of 'results'.
+    virtual void reverse_points( std::vector<Vector2> const& points,
+                                 std::vector<Vector2>      & results ) const {
+      results.resize( points.size() );
+      for ( size_t i = 0; i < points.size(); ++i )
+        results[i] = reverse( points[i] );
+    }
+
+    /// True if reverse_points() is much faster than calling reverse()
+    /// on each point, e.g. because it can batch up calls to a camera
+    /// model. TransformView then evaluates each tile with one call.
+    virtual bool batch_reverse() const { return false; }
+
     /// Specifies the properties of the forward mapping function.
     virtual FunctionType forward_type() const { return DiscontinuousFunction; }
 
@@ -151,6 +174,14 @@ namespace vw {
     inline ImplT      & impl()       { return static_cast<ImplT      &>(*this); }
     inline ImplT const& impl() const { return static_cast<ImplT const&>(*this); }
 
+    virtual void reverse_points( std::vector<Vector2> const& points,
+                                 std::vector<Vector2>      & results ) const {
+      ImplT const& txform = impl();
+      results.resize( points.size() );
+      for ( size_t i = 0; i < points.size(); ++i )
+        results[i] = txform.reverse( points[i] );
+    }
+
     virtual BBox2i forward_bbox( BBox2i const& bbox ) const {
       ImplT const& txform = impl();
       BBox2 transformed_bbox;
@@ -604,43 +635,68 @@ namespace vw {
     ImageView<Vector2> m_table;
   public:
     ApproximateTransform( TransformT const& transform, BBox2i const& bbox )
-      : TransformT( transform ), m_bbox( bbox ), m_table(2,2)
+      : TransformT( transform ), m_bbox( bbox )
     {
+      build_table( transform, bbox, m_table );
+    }
+
+    inline Vector2 reverse( Vector2 const& p ) const {
+      // Fall back if the function was not approximatable.
+      if( ! m_table.is_valid_image() ) return TransformT::reverse( p );
+      return interpolate( m_table, m_bbox, p );
+    }
+
+    inline void reverse_points( std::vector<Vector2> const& points,
+                                std::vector<Vector2>      & results ) const {
+      results.resize( points.size() );
+      for ( size_t i = 0; i < points.size(); ++i )
+        results[i] = reverse( points[i] );
+    }
+
+    // Never re-approximate the approximation.
+    virtual double tolerance() const { return 0; }
+
+    /// Fill in a lookup table of reverse() spanning the bounding box,
+    /// doubling its density until it is within the transform's tolerance.
+    /// The table is left empty if that never happens.
+    static void build_table( TransformT const& transform, BBox2i const& bbox,
+                             ImageView<Vector2>& table ) {
       // Initialize with a simple 2x2 lookup table
       int32 n=2;
-      m_table(0,0) = TransformT::reverse(bbox.min());
-      m_table(1,0) = TransformT::reverse(Vector2(bbox.max().x(),bbox.min().y()));
-      m_table(0,1) = TransformT::reverse(Vector2(bbox.min().x(),bbox.max().y()));
-      m_table(1,1) = TransformT::reverse(bbox.max());
+      table.set_size(2,2);
+      table(0,0) = transform.reverse(bbox.min());
+      table(1,0) = transform.reverse(Vector2(bbox.max().x(),bbox.min().y()));
+      table(0,1) = transform.reverse(Vector2(bbox.min().x(),bbox.max().y()));
+      table(1,1) = transform.reverse(bbox.max());
 
       // Double the grid density until the worst (squared) approximation error
       // is less than the allowed (squared) tolerance.
       double max_sqr_err = 0;
-      double tol_sqr = TransformT::tolerance() * TransformT::tolerance();
+      double tol_sqr = transform.tolerance() * transform.tolerance();
       Vector2 origin = bbox.min(), diag = bbox.size();
       do {
         n = 2*n-1;
         // Fall back for unapproximatably crazy transform functions.
         if( n>=bbox.width()|| n>=bbox.height() ) {
-          m_table.reset();
+          table.reset();
           return;
         }
-        ImageView<Vector2> prev = m_table;
-        m_table.set_size(n,n);
+        ImageView<Vector2> prev = table;
+        table.set_size(n,n);
         max_sqr_err = 0;
         for( int y=0; y<n; ++y ) {
           for( int x=0; x<n; ++x ) {
             if( (y%2)==0 && (x%2==0) ) {
-              m_table(x,y) = prev(x/2,y/2);
+              table(x,y) = prev(x/2,y/2);
             }
             else {
               Vector2 pos = Vector2(x,y)/(n-1);
-              m_table(x,y) = TransformT::reverse(origin+elem_prod(pos,diag));
+              table(x,y) = transform.reverse(origin+elem_prod(pos,diag));
               Vector2 interp;
               if( (y%2)==0 ) interp = (prev(x/2,y/2) + prev(x/2+1,y/2)) / 2.0;
               else if( (x%2)==0 ) interp = (prev(x/2,y/2) + prev(x/2,y/2+1)) / 2.0;
               else interp = (prev(x/2,y/2) + prev(x/2,y/2+1) + prev(x/2+1,y/2) + prev(x/2+1,y/2+1)) / 4.0;
-              double sqr_err = norm_2_sqr( m_table(x,y) - interp );
+              double sqr_err = norm_2_sqr( table(x,y) - interp );
               if( sqr_err > max_sqr_err ) max_sqr_err = sqr_err;
             }
           }
@@ -648,16 +704,15 @@ namespace vw {
       } while( max_sqr_err > tol_sqr );
     }
 
-    inline Vector2 reverse( Vector2 const& p ) const {
-      // Fall back if the function was not approximatable.
-      if( ! m_table.is_valid_image() ) return TransformT::reverse( p );
-
+    /// Bilinearly interpolate a table made by build_table().
+    static inline Vector2 interpolate( ImageView<Vector2> const& table, BBox2i const& bbox,
+                                       Vector2 const& p ) {
       // We re-implement bilinear interpolation by hand here because for
       // some reason the BilinearInterpolation object is exceptionally
       // slow for Vector data still.
-      int n = m_table.cols() - 1;
-      double px = n * (p.x() - m_bbox.min().x()) / (m_bbox.max().x() - m_bbox.min().x());
-      double py = n * (p.y() - m_bbox.min().y()) / (m_bbox.max().y() - m_bbox.min().y());
+      int n = table.cols() - 1;
+      double px = n * (p.x() - bbox.min().x()) / (bbox.max().x() - bbox.min().x());
+      double py = n * (p.y() - bbox.min().y()) / (bbox.max().y() - bbox.min().y());
       int32 ix = math::impl::_floor(px);
       if( ix < 0 ) ix = 0;
       if( ix >= n ) ix = n-1;
@@ -666,20 +721,227 @@ namespace vw {
       if( iy >= n ) iy = n-1;
       double normx = px-ix, normy = py-iy;
 
-      Vector2 const& m00 = m_table(ix,  iy);
-      Vector2 const& m10 = m_table(ix+1,iy);
-      Vector2 const& m01 = m_table(ix,  iy+1);
-      Vector2 const& m11 = m_table(ix+1,iy+1);
+      Vector2 const& m00 = table(ix,  iy);
+      Vector2 const& m10 = table(ix+1,iy);
+      Vector2 const& m01 = table(ix,  iy+1);
+      Vector2 const& m11 = table(ix+1,iy+1);
 
       return Vector2( (m00.x()*(1-normy)+m01.x()*normy)*(1-normx) +
                       (m10.x()*(1-normy)+m11.x()*normy)*normx,
                       (m00.y()*(1-normy)+m01.y()*normy)*(1-normx) +
                       (m10.y()*(1-normy)+m11.y()*normy)*normx );
     }
+  };
+
+
+  // A whole image version of ApproximateTransform that every tile of a
+  // TransformView shares, rather than each tile building its own.
+  // - The output image is split into square cells, and each cell gets
+  //   an ApproximateTransform style lookup table of its own.  So the
+  //   table is only dense in the cells where the transform bends.  The
+  //   cells on the right and bottom absorb any leftover pixels, since a
+  //   thin cell is more likely to need more samples than it has pixels.
+  // - The tables are built the first time a tile needs them and are
+  //   held in the vw system cache, the same way block_cache() holds
+  //   image blocks.  If one is evicted it is simply built again.
+  // - This object is shared between threads.  Use table() to get a
+  //   cell's lookup table, or GridApproximateTransform for a tile.
+  template <class TransformT>
+  class ApproximationGrid : private boost::noncopyable {
+
+    class CellGenerator {
+      boost::shared_ptr<TransformT> m_transform;
+      BBox2i m_bbox;
+    public:
+      typedef ImageView<Vector2> value_type;
+
+      CellGenerator( boost::shared_ptr<TransformT> const& transform, BBox2i const& bbox )
+        : m_transform( transform ), m_bbox( bbox ) {}
+
+      // The real size is not known until the table is built, so assume
+      // a sample every four pixels.
+      size_t size() const {
+        return ((m_bbox.width()+3)/4+1) * ((m_bbox.height()+3)/4+1) * sizeof(Vector2);
+      }
+
+      boost::shared_ptr<value_type> generate() const {
+        boost::shared_ptr<value_type> table( new value_type );
+        ApproximateTransform<TransformT>::build_table( *m_transform, m_bbox, *table );
+        return table;
+      }
+    };
+
+    boost::shared_ptr<TransformT> m_transform;
+    BBox2i m_bbox;
+    int32  m_cell_size, m_table_width, m_table_height;
+    mutable Mutex m_mutex;
+    mutable boost::shared_array<Cache::Handle<CellGenerator> > m_cells;
+
+  public:
+    /// Approximate the transform over the output image bbox (0,0,cols,rows).
+    ApproximationGrid( TransformT const& transform, int32 cols, int32 rows, int32 cell_size = 128 )
+      : m_transform( new TransformT( transform ) ), m_bbox( 0, 0, cols, rows ),
+        m_cell_size( cell_size ),
+        m_table_width ( std::max( cols / cell_size, 1 ) ),
+        m_table_height( std::max( rows / cell_size, 1 ) ) {}
+
+    BBox2i const& bbox     () const { return m_bbox;      }
+    int32         cell_size() const { return m_cell_size; }
+
+    /// The cell containing a point, which may be out of bounds.
+    Vector2i cell_index( Vector2 const& p ) const {
+      return Vector2i( std::min( int32(math::impl::_floor( p.x() / m_cell_size )), m_table_width -1 ),
+                       std::min( int32(math::impl::_floor( p.y() / m_cell_size )), m_table_height-1 ) );
+    }
+
+    /// The output image pixels covered by a cell.
+    BBox2i cell_bbox( int32 ix, int32 iy ) const {
+      BBox2i bbox( ix*m_cell_size, iy*m_cell_size, m_cell_size, m_cell_size );
+      if ( ix == m_table_width -1 ) bbox.max().x() = m_bbox.max().x();
+      if ( iy == m_table_height-1 ) bbox.max().y() = m_bbox.max().y();
+      return bbox;
+    }
+
+    /// The lookup table for a cell, which is empty if the transform could
+    /// not be approximated there.
+    boost::shared_ptr<ImageView<Vector2> > table( int32 ix, int32 iy ) const {
+      VW_ASSERT( ix >= 0 && iy >= 0 && ix < m_table_width && iy < m_table_height,
+                 ArgumentErr() << "ApproximationGrid: Cell (" << ix << "," << iy << ") is out of bounds." );
+      size_t index = size_t(iy) * m_table_width + ix;
+      Cache::Handle<CellGenerator> const* handle = 0;
+      {
+        Mutex::ReadLock lock( m_mutex );
+        if ( m_cells && m_cells[index].attached() )
+          handle = &m_cells[index];
+      }
+      if ( !handle ) {
+        Mutex::WriteLock lock( m_mutex );
+        if ( !m_cells )
+          m_cells.reset( new Cache::Handle<CellGenerator>[ size_t(m_table_width) * m_table_height ] );
+        if ( !m_cells[index].attached() )
+          m_cells[index] = vw_system_cache().insert( CellGenerator( m_transform, cell_bbox(ix,iy) ) );
+        handle = &m_cells[index];
+      }
+      boost::shared_ptr<ImageView<Vector2> > result = *handle;
+      handle->release();
+      return result;
+    }
+  };
+
+
+  // The transform functor for one tile of an ApproximationGrid.  It holds
+  // on to the tables of the cells that cover the tile, and falls back to
+  // the original transform outside of them.
+  template <class TransformT>
+  class GridApproximateTransform : public TransformT {
+    boost::shared_ptr<ApproximationGrid<TransformT> > m_grid;
+    double m_tolerance;
+    int32 m_ix0, m_iy0, m_cols, m_rows; // The range of cells in m_tables
+    std::vector<boost::shared_ptr<ImageView<Vector2> > > m_tables;
+    std::vector<BBox2i> m_cell_bboxes;
+  public:
+    GridApproximateTransform( TransformT const& transform,
+                              boost::shared_ptr<ApproximationGrid<TransformT> > const& grid,
+                              BBox2i const& bbox )
+      : TransformT( transform ), m_grid( grid ), m_tolerance( transform.tolerance() ) {
+      Vector2i first = grid->cell_index( bbox.min() );
+      Vector2i last  = grid->cell_index( bbox.max() - Vector2i(1,1) );
+      m_ix0  = first.x();
+      m_iy0  = first.y();
+      m_cols = last.x() - m_ix0 + 1;
+      m_rows = last.y() - m_iy0 + 1;
+      for ( int32 iy = m_iy0; iy < m_iy0 + m_rows; ++iy )
+        for ( int32 ix = m_ix0; ix < m_ix0 + m_cols; ++ix ) {
+          m_tables.push_back( grid->table(ix, iy) );
+          m_cell_bboxes.push_back( grid->cell_bbox(ix, iy) );
+        }
+    }
+
+    inline Vector2 reverse( Vector2 const& p ) const {
+      Vector2i cell = m_grid->cell_index( p );
+      int32 ix = cell.x() - m_ix0;
+      int32 iy = cell.y() - m_iy0;
+      if ( ix >= 0 && iy >= 0 && ix < m_cols && iy < m_rows ) {
+        size_t index = size_t(iy) * m_cols + ix;
+        ImageView<Vector2> const& table = *m_tables[index];
+        if ( table.is_valid_image() )
+          return ApproximateTransform<TransformT>::interpolate( table, m_cell_bboxes[index], p );
+      }
+      return TransformT::reverse( p );
+    }
+
+    // Walk the edges of the bbox through the tables as well, padding the
+    // result by the tolerance, rather than calling the original transform
+    // for every edge pixel of every tile.
+    virtual BBox2i reverse_bbox( BBox2i const& bbox ) const {
+      if ( bbox.empty() || this->reverse_type() == DiscontinuousFunction )
+        return TransformT::reverse_bbox( bbox );
+      BBox2 transformed_bbox;
+      for( int32 x=bbox.min().x(); x<bbox.max().x(); ++x ) { // Top and bottom
+        transformed_bbox.grow( reverse( Vector2(x,bbox.min().y()) ) );
+        transformed_bbox.grow( reverse( Vector2(x,bbox.max().y()-1) ) );
+      }
+      for( int32 y=bbox.min().y()+1; y<bbox.max().y()-1; ++y ) { // Left and right
+        transformed_bbox.grow( reverse( Vector2(bbox.min().x(),y) ) );
+        transformed_bbox.grow( reverse( Vector2(bbox.max().x()-1,y) ) );
+      }
+      transformed_bbox.expand( m_tolerance );
+      return grow_bbox_to_int( transformed_bbox );
+    }
+
+    inline void reverse_points( std::vector<Vector2> const& points,
+                                std::vector<Vector2>      & results ) const {
+      results.resize( points.size() );
+      for ( size_t i = 0; i < points.size(); ++i )
+        results[i] = reverse( points[i] );
+    }
 
     // Never re-approximate the approximation.
     virtual double tolerance() const { return 0; }
+  };
+
+
+  // Mimics the behavior of a given transform functor, but computes
+  // reverse() for every integer pixel in the given bounding box up
+  // front with a single call to reverse_points(). Other arguments
+  // fall back to the original transform.
+  template <class TransformT>
+  class TabulatedTransform : public TransformT {
+    BBox2i m_bbox;
+    ImageView<Vector2> m_table;
+  public:
+    TabulatedTransform( TransformT const& transform, BBox2i const& bbox )
+      : TransformT( transform ), m_bbox( bbox ), m_table( bbox.width(), bbox.height() )
+    {
+      std::vector<Vector2> points, results;
+      points.reserve( bbox.width() * bbox.height() );
+      for ( int32 y=bbox.min().y(); y<bbox.max().y(); ++y )
+        for ( int32 x=bbox.min().x(); x<bbox.max().x(); ++x )
+          points.push_back( Vector2(x,y) );
+      // Use the original, since reverse() on this object reads the table.
+      transform.reverse_points( points, results );
+      std::copy( results.begin(), results.end(), m_table.data() );
+    }
+
+    inline Vector2 reverse( Vector2 const& p ) const {
+      double px = p.x() - m_bbox.min().x(), py = p.y() - m_bbox.min().y();
+      int32  ix = int32(px), iy = int32(py);
+      if ( ix == px && iy == py && ix >= 0 && iy >= 0 &&
+           ix < m_table.cols() && iy < m_table.rows() )
+        return m_table(ix,iy);
+      return TransformT::reverse( p );
+    }
 
+    inline void reverse_points( std::vector<Vector2> const& points,
+                                std::vector<Vector2>      & results ) const {
+      results.resize( points.size() );
+      for ( size_t i = 0; i < points.size(); ++i )
+        results[i] = reverse( points[i] );
+    }
+
+    // The table is exact, so there is nothing to gain from approximating it.
+    virtual double tolerance() const { return 0; }
+    virtual bool batch_reverse() const { return false; }
   };
 
 
@@ -692,6 +954,8 @@ namespace vw {
 
     Vector2 forward( Vector2 const& point ) const { return m_transform->forward( point ); }
     Vector2 reverse( Vector2 const& point ) const { return m_transform->reverse( point ); }
+    void reverse_points( std::vector<Vector2> const& points, std::vector<Vector2>& results ) const { m_transform->reverse_points( points, results ); }
+    bool batch_reverse() const { return m_transform->batch_reverse(); }
     FunctionType forward_type() const { return m_transform->forward_type(); }
     FunctionType reverse_type() const { return m_transform->reverse_type(); }
     BBox2i forward_bbox( BBox2i const& bbox ) const { return m_transform->forward_bbox( bbox ); }
@@ -701,6 +965,18 @@ namespace vw {
   };
 
 
+  /// The shared approximation grid for a TransformView or
+  /// TransformViewNoData of the given size, or none if the transform does
+  /// not allow approximation.
+  template <class TransformT>
+  boost::shared_ptr<ApproximationGrid<TransformT> >
+  make_approximation_grid( TransformT const& mapper, int32 width, int32 height ) {
+    if ( mapper.tolerance() > 0.0 && width > 0 && height > 0 )
+      return boost::shared_ptr<ApproximationGrid<TransformT> >(
+               new ApproximationGrid<TransformT>( mapper, width, height ) );
+    return boost::shared_ptr<ApproximationGrid<TransformT> >();
+  }
+
   // ------------------------
   // class TransformView
   // ------------------------
@@ -711,9 +987,12 @@ namespace vw {
   template <class ImageT, class TransformT>
   class TransformView : public ImageViewBase<TransformView<ImageT,TransformT> > {
 
+    typedef boost::shared_ptr<ApproximationGrid<TransformT> > grid_type;
+
     ImageT     m_image;
     TransformT m_mapper;
     int32      m_width, m_height;
+    grid_type  m_grid; // Only set if the transform has a tolerance
 
   public:
     typedef typename ImageT::pixel_type pixel_type;
@@ -723,11 +1002,18 @@ namespace vw {
     // The default constructor creates a tranformed image with the
     // same dimensions as the original.
     TransformView( ImageT const& view, TransformT const& mapper ) :
-      m_image(view), m_mapper(mapper), m_width(view.cols()), m_height(view.rows()) {}
+      m_image(view), m_mapper(mapper), m_width(view.cols()), m_height(view.rows()),
+      m_grid(make_approximation_grid(mapper, m_width, m_height)) {}
 
     // This constructor allows you to specify the size of the transformed image.
     TransformView( ImageT const& view, TransformT const& mapper, int32 width, int32 height ) :
-      m_image(view), m_mapper(mapper), m_width(width), m_height(height) {}
+      m_image(view), m_mapper(mapper), m_width(width), m_height(height),
+      m_grid(make_approximation_grid(mapper, width, height)) {}
+
+    // As above, but sharing the approximation grid of another view.
+    TransformView( ImageT const& view, TransformT const& mapper, int32 width, int32 height,
+                   grid_type const& grid ) :
+      m_image(view), m_mapper(mapper), m_width(width), m_height(height), m_grid(grid) {}
 
     inline int32 cols  () const { return m_width;          }
     inline int32 rows  () const { return m_height;         }
@@ -747,14 +1033,24 @@ namespace vw {
     typedef TransformView<typename ImageT::prerasterize_type, TransformT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
       BBox2i transformed_bbox = m_mapper.reverse_bbox(bbox);
-      return prerasterize_type( m_image.prerasterize(transformed_bbox), m_mapper, m_width, m_height );
+      return prerasterize_type( m_image.prerasterize(transformed_bbox), m_mapper, m_width, m_height, m_grid );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
-      if( m_mapper.tolerance() > 0.0 ) {
+      if( m_grid && m_grid->bbox().contains(bbox) ) {
+        GridApproximateTransform<TransformT> approx_transform( m_mapper, m_grid, bbox );
+        TransformView<ImageT, GridApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height );
+        vw::rasterize( approx_view.prerasterize(bbox), dest, bbox );
+      }
+      else if( m_mapper.tolerance() > 0.0 ) {
         ApproximateTransform<TransformT> approx_transform( m_mapper, bbox );
         TransformView<ImageT, ApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height );
         vw::rasterize( approx_view.prerasterize(bbox), dest, bbox );
       }
+      else if( m_mapper.batch_reverse() ) {
+        TabulatedTransform<TransformT> table_transform( m_mapper, bbox );
+        TransformView<ImageT, TabulatedTransform<TransformT> > table_view( m_image, table_transform, m_width, m_height );
+        vw::rasterize( table_view.prerasterize(bbox), dest, bbox );
+      }
       else {
         vw::rasterize( prerasterize(bbox), dest, bbox );
       }
@@ -777,11 +1073,14 @@ namespace vw {
   template <class ImageT, class TransformT>
   class TransformViewNoData : public ImageViewBase<TransformViewNoData<ImageT,TransformT> > {
 
+    typedef boost::shared_ptr<ApproximationGrid<TransformT> > grid_type;
+
     ImageT m_image;
     TransformT m_mapper;
     int32 m_width, m_height;
     typename ImageT::pixel_type m_nodata_val;
     int m_pixel_buffer;
+    grid_type m_grid; // Only set if the transform has a tolerance
   public:
     typedef typename ImageT::pixel_type pixel_type;
     typedef pixel_type result_type;
@@ -794,7 +1093,16 @@ namespace vw {
                          typename ImageT::pixel_type nodata_val,
                          int pixel_buffer) :
       m_image(view), m_mapper(mapper), m_width(width), m_height(height),
-      m_nodata_val(nodata_val), m_pixel_buffer(pixel_buffer) {}
+      m_nodata_val(nodata_val), m_pixel_buffer(pixel_buffer),
+      m_grid(make_approximation_grid(mapper, width, height)) {}
+
+    // As above, but sharing the approximation grid of another view.
+    TransformViewNoData( ImageT const& view, TransformT const& mapper,
+                         int32 width, int32 height,
+                         typename ImageT::pixel_type nodata_val,
+                         int pixel_buffer, grid_type const& grid) :
+      m_image(view), m_mapper(mapper), m_width(width), m_height(height),
+      m_nodata_val(nodata_val), m_pixel_buffer(pixel_buffer), m_grid(grid) {}
 
     inline int32 cols() const { return m_width; }
     inline int32 rows() const { return m_height; }
@@ -820,15 +1128,25 @@ namespace vw {
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
       BBox2i transformed_bbox = m_mapper.reverse_bbox(bbox);
       return prerasterize_type( m_image.prerasterize(transformed_bbox), m_mapper,
-                                m_width, m_height, m_nodata_val, m_pixel_buffer);
+                                m_width, m_height, m_nodata_val, m_pixel_buffer, m_grid);
     }
     template <class DestT> inline void rasterize( DestT const& dest,
                                                   BBox2i const& bbox ) const {
-      if( m_mapper.tolerance() > 0.0 ) {
+      if( m_grid && m_grid->bbox().contains(bbox) ) {
+        GridApproximateTransform<TransformT> approx_transform( m_mapper, m_grid, bbox );
+        TransformViewNoData<ImageT, GridApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height, m_nodata_val, m_pixel_buffer );
+        vw::rasterize( approx_view.prerasterize(bbox), dest, bbox );
+      }
+      else if( m_mapper.tolerance() > 0.0 ) {
         ApproximateTransform<TransformT> approx_transform( m_mapper, bbox );
         TransformViewNoData<ImageT, ApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height, m_nodata_val, m_pixel_buffer );
         vw::rasterize( approx_view.prerasterize(bbox), dest, bbox );
       }
+      else if( m_mapper.batch_reverse() ) {
+        TabulatedTransform<TransformT> table_transform( m_mapper, bbox );
+        TransformViewNoData<ImageT, TabulatedTransform<TransformT> > table_view( m_image, table_transform, m_width, m_height, m_nodata_val, m_pixel_buffer );
+        vw::rasterize( table_view.prerasterize(bbox), dest, bbox );
+      }
       else {
         vw::rasterize( prerasterize(bbox), dest, bbox );
       }
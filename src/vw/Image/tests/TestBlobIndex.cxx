@@ -20,6 +20,7 @@
 #include <vw/Math/BBox.h>
 #include <vw/Math/Vector.h>
 #include <vw/Image/BlobIndex.h>
+#include <vw/Image/ErodeView.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/MaskViews.h>
 #include <vw/Image/PerPixelViews.h>
@@ -34,6 +35,7 @@
 
 #include <boost/assign/std/vector.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/random/linear_congruential.hpp>
 
 using namespace vw;
 using namespace boost::assign;
@@ -57,6 +59,67 @@ TEST( BlobIndex, BlobIndex ) {
   EXPECT_EQ( idx(5,1), idx(6,2) ); // Verify blob 3
   EXPECT_NE( idx(6,2), idx(1,1) );
 }
+TEST( BlobIndex, LabelBlobs ) {
+  typedef PixelMask<uint8> MPx;
+  ImageView<MPx> im(7,5);
+  fill( crop(im,1,1,3,1), MPx(255) ); // Blob 1
+  fill( crop(im,2,3,2,1), MPx(255) ); // Blob 2
+  fill( crop(im,5,1,1,3), MPx(255) );
+  im(6,4) = MPx(5);                   // Blob 3, only touching diagonally
+
+  ImageView<uint32> labels;
+  std::vector<uint64> areas;
+  ASSERT_EQ( 3u, blob::label_blobs( im, labels, areas ) );
+  EXPECT_EQ( 0u, labels(0,0) );
+  EXPECT_EQ( 1u, labels(3,1) );
+  EXPECT_EQ( 2u, labels(5,1) );
+  EXPECT_EQ( 2u, labels(6,4) );
+  EXPECT_EQ( 3u, labels(2,3) );
+  EXPECT_EQ( 3u, areas[0] );
+  EXPECT_EQ( 4u, areas[1] );
+  EXPECT_EQ( 2u, areas[2] );
+}
+
+TEST( BlobIndex, RemoveSmallBlobs ) {
+  // Random speckle, just under the percolation threshold so there are
+  // blobs of every size and shape crossing the tile seams.
+  typedef PixelMask<uint8> MPx;
+  ImageView<MPx> im(61,47);
+  boost::rand48 gen(11);
+  for ( int32 j = 0; j < im.rows(); j++ )
+    for ( int32 i = 0; i < im.cols(); i++ )
+      if ( gen() % 100 < 38 )
+        im(i,j) = MPx( 1 + (i+j) % 200 );
+
+  const int32 area = 6;
+  BlobIndexThreaded bindex( im, area, 61 );
+  ImageView<MPx> expected = applyErodeView( im, bindex );
+  int32 removed = 0;
+  for ( int32 j = 0; j < im.rows(); j++ )
+    for ( int32 i = 0; i < im.cols(); i++ )
+      if ( is_valid(im(i,j)) && !is_valid(expected(i,j)) )
+        removed++;
+  EXPECT_LT( 100, removed );
+
+  int32 tile_sizes[] = { 1, 5, 16, 61, 100 };
+  for ( int32 t = 0; t < 5; t++ ) {
+    for ( int32 threads = 1; threads <= 4; threads += 3 ) {
+      ImageView<MPx> result = remove_small_blobs( im, area, tile_sizes[t], threads );
+      ImageView<MPx> section = crop( remove_small_blobs( im, area, tile_sizes[t], threads ),
+                                     7, 9, 30, 20 );
+      for ( int32 j = 0; j < im.rows(); j++ ) {
+        for ( int32 i = 0; i < im.cols(); i++ ) {
+          ASSERT_EQ( is_valid(expected(i,j)), is_valid(result(i,j)) )
+            << "tile size " << tile_sizes[t] << " at " << i << "," << j;
+          EXPECT_EQ( expected(i,j).child(), result(i,j).child() );
+          if ( BBox2i(7,9,30,20).contains( Vector2i(i,j) ) )
+            EXPECT_EQ( result(i,j), section(i-7,j-9) );
+        }
+      }
+    }
+  }
+}
+
 /*
 TEST(BlobIndexThreaded, TestImage1) {
   DiskImageView<PixelGray<uint8> > input("ThreadTest1.tif");
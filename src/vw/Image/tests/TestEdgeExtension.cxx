@@ -426,6 +426,38 @@ TEST( EdgeExtension, Linear ) {
   EXPECT_BBOX( ee.source_bbox(im,BBox2i(2,3,2,2)), 0,1,2,2 );
 }
 
+// Rasterizing has to agree with indexing the view, whether the bbox is
+// inside the image, straddles its edges, covers it, or misses it.
+template <class ViewT>
+static void check_rasterize( ViewT const& view ) {
+  BBox2i boxes[] = { BBox2i(1,1,3,2), BBox2i(-3,-2,5,4), BBox2i(2,3,6,5),
+                     BBox2i(-4,-3,13,11), BBox2i(-9,1,4,3), BBox2i(7,9,3,3) };
+  for( int k = 0; k < 6; ++k ) {
+    BBox2i const& bbox = boxes[k];
+    ImageView<double> result( bbox.width(), bbox.height() );
+    view.rasterize( result, bbox );
+    for( int j = 0; j < bbox.height(); ++j )
+      for( int i = 0; i < bbox.width(); ++i )
+        EXPECT_EQ( view(i + bbox.min().x(), j + bbox.min().y()), result(i,j) );
+  }
+}
+
+TEST( EdgeExtension, RasterizeBorders ) {
+  ImageView<double> im(5,4);
+  for( int j = 0; j < im.rows(); ++j )
+    for( int i = 0; i < im.cols(); ++i )
+      im(i,j) = 1 + i + 10*j;
+  check_rasterize( edge_extend(im, ZeroEdgeExtension()) );
+  check_rasterize( edge_extend(im, ValueEdgeExtension<double>(-1)) );
+  check_rasterize( edge_extend(im, ConstantEdgeExtension()) );
+  check_rasterize( edge_extend(im, PeriodicEdgeExtension()) );
+  check_rasterize( edge_extend(im, CylindricalEdgeExtension()) );
+  check_rasterize( edge_extend(im, ReflectEdgeExtension()) );
+  check_rasterize( edge_extend(im, LinearEdgeExtension()) );
+  check_rasterize( edge_extend(im, -2, 1, 9, 6, ConstantEdgeExtension()) );
+  check_rasterize( edge_extend(im, 3, -1, 4, 7, ReflectEdgeExtension()) );
+}
+
 template <class PixelT>
 class FloatingView : public ImageViewBase<FloatingView<PixelT> > {
   int32 m_cols, m_rows, m_planes;
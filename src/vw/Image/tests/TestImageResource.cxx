@@ -21,6 +21,8 @@
 #include <vw/Core/Functors.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Math/BBox.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageResourceStream.h>
 #include <vw/Image/PixelTypeInfo.h>
@@ -125,6 +127,56 @@ TEST( ImageResource, NativePtr ) {
   EXPECT_RANGE_EQ(src, src+4, &d2[0], &d2[4]);
 }
 
+// Memory resource that records the order blocks were written in.
+class BlockRecordingResource : public DstImageResource {
+  Mutex m_mutex;
+public:
+  ImageView<uint8>    image;
+  std::vector<BBox2i> written;
+  BlockRecordingResource(int32 cols, int32 rows) : image(cols, rows) {}
+
+  virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+    ImageView<uint8> block(bbox.width(), bbox.height());
+    convert(block.buffer(), buf);
+    Mutex::Lock lock(m_mutex);
+    crop(image, bbox) = block;
+    written.push_back(bbox);
+  }
+  virtual bool has_block_write() const { return true; }
+  virtual Vector2i block_write_size() const { return Vector2i(4,3); }
+  virtual bool has_nodata_write() const { return false; }
+  virtual void flush() {}
+};
+
+// Claims the blocks on the right are the expensive ones.
+struct ColumnCost {
+  double operator()(BBox2i const& bbox) const { return bbox.min().x(); }
+};
+
+TEST( ImageResource, BlockWriteByCost ) {
+  ImageView<uint8> src(14,10);
+  for (int32 j = 0; j < src.rows(); ++j)
+    for (int32 i = 0; i < src.cols(); ++i)
+      src(i,j) = uint8(j*src.cols() + i);
+
+  // Try with a write window both larger and smaller than the number of blocks.
+  const uint32 pool_size = vw_settings().write_pool_size();
+  for (uint32 window = 3; window <= 24; window += 21) {
+    vw_settings().set_write_pool_size(window);
+    BlockRecordingResource resource(src.cols(), src.rows());
+    block_write_image_by_cost(resource, src, ColumnCost());
+
+    EXPECT_RANGE_EQ(src.begin(), src.end(), resource.image.begin(), resource.image.end());
+
+    // The blocks are still written in order, exactly once each.
+    std::vector<BBox2i> expected = block_write_blocks(resource, src);
+    ASSERT_EQ(expected.size(), resource.written.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+      EXPECT_EQ(expected[i], resource.written[i]);
+  }
+  vw_settings().set_write_pool_size(pool_size);
+}
+
 struct TestStream : public ::testing::Test {
   protected:
     static const size_t WIDTH = 2;
@@ -202,3 +202,93 @@ TEST( Transform, FreeForward ) {
                         tx.forward(tx.reverse(Vector2(i*i,i))), 1e-3 );
   }
 }
+
+// Counts how many times the batch interface was used.
+class BatchOnlyTransform : public TransformBase<BatchOnlyTransform> {
+  boost::shared_ptr<int> m_batches;
+public:
+  BatchOnlyTransform() : m_batches(new int(0)) {}
+  inline Vector2 reverse( const Vector2& p ) const {
+    return Vector2( 0.9*p.x() + 0.01*p.y()*p.y(), 1.1*p.y() - 0.3 );
+  }
+  void reverse_points( std::vector<Vector2> const& points, std::vector<Vector2>& results ) const {
+    ++*m_batches;
+    TransformBase<BatchOnlyTransform>::reverse_points( points, results );
+  }
+  bool batch_reverse() const { return true; }
+  int batches() const { return *m_batches; }
+};
+
+TEST( Transform, TabulatedReverse ) {
+  ImageView<float> im(12,9);
+  for ( int j = 0; j < im.rows(); j++ )
+    for ( int i = 0; i < im.cols(); i++ )
+      im(i,j) = float(i + 3*j);
+
+  BatchOnlyTransform tx;
+  TabulatedTransform<BatchOnlyTransform> table( tx, BBox2i(2,3,5,4) );
+  EXPECT_EQ( 1, tx.batches() );
+  EXPECT_VECTOR_DOUBLE_EQ( tx.reverse(Vector2(4,5)),     table.reverse(Vector2(4,5)) );
+  EXPECT_VECTOR_DOUBLE_EQ( tx.reverse(Vector2(4.5,5)),   table.reverse(Vector2(4.5,5)) );
+  EXPECT_VECTOR_DOUBLE_EQ( tx.reverse(Vector2(20,20)),   table.reverse(Vector2(20,20)) );
+
+  // Rasterizing the whole image is one tile, so one batch.
+  TransformView<InterpolationView<EdgeExtensionView<ImageView<float>, ZeroEdgeExtension>, BilinearInterpolation>, BatchOnlyTransform> view = transform(im, tx);
+  ImageView<float> result = view;
+  EXPECT_EQ( 2, tx.batches() );
+  for ( int j = 0; j < result.rows(); j++ )
+    for ( int i = 0; i < result.cols(); i++ )
+      EXPECT_FLOAT_EQ( view(i,j), result(i,j) );
+}
+
+// Counts calls to reverse(), and bends enough to need a few table levels.
+class CountingTransform : public TransformHelper<CountingTransform,ContinuousFunction,ContinuousFunction> {
+  boost::shared_ptr<int> m_calls;
+public:
+  CountingTransform() : m_calls(new int(0)) { set_tolerance(0.01); }
+  inline Vector2 reverse( const Vector2& p ) const {
+    ++*m_calls;
+    return Vector2( p.x() + 0.001*p.y()*p.y(), 0.5*p.y() + 0.0001*p.x()*p.x() );
+  }
+  int calls() const { return *m_calls; }
+};
+
+TEST( Transform, ApproximationGrid ) {
+  CountingTransform tx;
+  boost::shared_ptr<ApproximationGrid<CountingTransform> > grid( new ApproximationGrid<CountingTransform>( tx, 300, 200 ) );
+  GridApproximateTransform<CountingTransform> approx( tx, grid, BBox2i(0,0,300,200) );
+  for ( int j = 0; j < 200; j += 7 )
+    for ( int i = 0; i < 300; i += 5 )
+      EXPECT_VECTOR_NEAR( tx.reverse(Vector2(i,j)), approx.reverse(Vector2(i,j)), 0.01 );
+  EXPECT_VECTOR_DOUBLE_EQ( tx.reverse(Vector2(-5,310)), approx.reverse(Vector2(-5,310)) );
+
+  // Neighbouring tiles share the cells between them, so rasterizing the
+  // whole image after its two halves costs nothing more.
+  ImageView<float> im(300,200);
+  for ( int j = 0; j < im.rows(); j++ )
+    for ( int i = 0; i < im.cols(); i++ )
+      im(i,j) = float(i + 3*j);
+  TransformView<InterpolationView<EdgeExtensionView<ImageView<float>, ZeroEdgeExtension>, BilinearInterpolation>, CountingTransform> view = transform(im, tx);
+  ImageView<float> result(300,200);
+  int start = tx.calls();
+  view.rasterize( crop(result, BBox2i(0,0,150,200)), BBox2i(0,0,150,200) );
+  int first_half = tx.calls() - start;
+  view.rasterize( crop(result, BBox2i(150,0,150,200)), BBox2i(150,0,150,200) );
+  int second_half = tx.calls() - start - first_half;
+  EXPECT_LT( second_half, first_half );
+  int before = tx.calls();
+  view.rasterize( result, BBox2i(0,0,300,200) );
+  EXPECT_EQ( before, tx.calls() );
+
+  ImageView<float> exact(300,200);
+  for ( int j = 0; j < exact.rows(); j++ )
+    for ( int i = 0; i < exact.cols(); i++ )
+      exact(i,j) = view(i,j);
+  // Away from the edge of the source image, where the zero edge
+  // extension makes the error in the position matter a lot more.
+  BBox2 inside( 1, 1, im.cols()-3, im.rows()-3 );
+  for ( int j = 0; j < exact.rows(); j++ )
+    for ( int i = 0; i < exact.cols(); i++ )
+      if ( inside.contains( tx.reverse(Vector2(i,j)) ) )
+        EXPECT_NEAR( exact(i,j), result(i,j), 0.1 );
+}
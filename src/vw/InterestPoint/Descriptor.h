@@ -61,6 +61,12 @@ namespace ip {
     void operator() ( ImageViewBase<ViewT> const& image,
 		      IterT start, IterT end );
 
+    /// Overload for an InterestPointSet. The descriptors are written
+    /// straight into the set's descriptor pool.
+    template <class ViewT>
+    void operator() ( ImageViewBase<ViewT> const& image,
+		      InterestPointSet          & points );
+
     int support_size   () { return 41;  } ///< Default suport size ( i.e. descriptor window)
     int descriptor_size() { return 128; } ///< Default descriptor(vector) length
 
@@ -322,6 +328,25 @@ void DescriptorGeneratorBase<ImplT>::operator() ( ImageViewBase<ViewT> const& im
   }
 }
 
+template <class ImplT>
+template <class ViewT>
+void DescriptorGeneratorBase<ImplT>::operator() ( ImageViewBase<ViewT> const& image,
+		  InterestPointSet          & points ) {
+  // Timing
+  Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
+
+  points.set_descriptor_length( impl().descriptor_size() );
+  const size_t length = points.descriptor_length();
+  for (size_t i = 0; i < points.size(); ++i) {
+    // Only the geometry of the point is needed to find its support
+    ImageView<PixelGray<float> > support =
+      get_support(points.point(i, false), pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl())));
+
+    float* descriptor = points.descriptor(i);
+    impl().compute_descriptor( support, descriptor, descriptor + length );
+  }
+}
+
 /// Get the size x size support region around an interest point,
 /// rescaled by the scale factor and rotated by the specified
 /// angle. Also, delay raster until assigment.
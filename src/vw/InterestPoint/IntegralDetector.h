@@ -28,7 +28,11 @@
 #include <vw/InterestPoint/Detector.h>
 #include <vw/InterestPoint/IntegralImage.h>
 #include <vw/InterestPoint/IntegralInterestOperator.h>
+#include <algorithm>
 #include <deque>
+#include <queue>
+
+#include <boost/type_traits/integral_constant.hpp>
 
 namespace vw {
 namespace ip {
@@ -105,29 +109,124 @@ namespace ip {
   }; // End class AssignOrientation
 
 
+  /// Ranks interest points the way IntegralInterestPointDetector
+  /// orders its output: by decreasing interest when culling, then in
+  /// the order the untiled scan finds them (by scale, row, column).
+  struct IntegralPointOrder {
+    bool m_by_interest;
+    IntegralPointOrder( bool by_interest = true ) : m_by_interest(by_interest) {}
+
+    bool operator()( InterestPoint const& a, InterestPoint const& b ) const {
+      if ( m_by_interest && a.interest != b.interest ) return b.interest < a.interest;
+      if ( a.scale != b.scale ) return a.scale < b.scale;
+      if ( a.iy    != b.iy    ) return a.iy    < b.iy;
+      return a.ix < b.ix;
+    }
+  };
+
+  /// Gathers the points of the tiles of a tiled detection as they
+  /// finish, keeping only the best max_points of them (all of them if
+  /// max_points is zero).
+  class IntegralTileCollector : private boost::noncopyable {
+    typedef std::priority_queue<InterestPoint, std::vector<InterestPoint>, IntegralPointOrder> queue_type;
+    Mutex      m_mutex;
+    size_t     m_max_points;
+    queue_type m_best; // The worst kept point is on top
+
+  public:
+    IntegralTileCollector( size_t max_points )
+      : m_max_points(max_points), m_best( IntegralPointOrder(max_points > 0) ) {}
+
+    void add( InterestPointList const& points ) {
+      Mutex::Lock lock(m_mutex);
+      for ( InterestPointList::const_iterator i = points.begin(); i != points.end(); ++i ) {
+        m_best.push( *i );
+        if ( m_max_points > 0 && m_best.size() > m_max_points )
+          m_best.pop();
+      }
+    }
+
+    /// The kept points, best first.
+    InterestPointList points() {
+      Mutex::Lock lock(m_mutex);
+      InterestPointList result;
+      while ( !m_best.empty() ) {
+        result.push_front( m_best.top() );
+        m_best.pop();
+      }
+      return result;
+    }
+  };
+
+  /// Task detecting the interest points of one tile of a tiled detection.
+  template <class DetectorT, class ViewT>
+  class IntegralDetectorTileTask : public Task, private boost::noncopyable {
+    DetectorT             const& m_detector;
+    ViewT                        m_view;
+    BBox2i                       m_tile;
+    IntegralTileCollector      & m_collector;
+
+  public:
+    IntegralDetectorTileTask( DetectorT const& detector, ViewT const& view,
+                              BBox2i const& tile, IntegralTileCollector& collector )
+      : m_detector(detector), m_view(view), m_tile(tile), m_collector(collector) {}
+
+    virtual void operator()() {
+      m_collector.add( m_detector.process_tile( m_view, m_tile ) );
+    }
+  };
+
+
   /// InterestDetector implementation for all detectors with operate off of an integral image.
+  ///
+  /// By default the whole image is processed at once. After
+  /// set_tile_size() the image is instead cut into tiles that are
+  /// processed in parallel on the thread pool. Each tile gets its own
+  /// integral image over the tile plus a margin covering the largest
+  /// filter, so memory use is bounded by the tile size. The tiled
+  /// result has the same points as the untiled one, except that
+  /// rounding in the (much smaller) integral images can change the
+  /// last bits of the orientations. Tiling needs the interest operator
+  /// to provide int support(int const& scale) const, the pixel radius
+  /// it reads at a scale (see HasInterestSupport); with operators that
+  /// don't, set_tile_size() has no effect and images are processed
+  /// whole.
   template <class InterestT>
   class IntegralInterestPointDetector : public InterestDetectorBase<IntegralInterestPointDetector<InterestT> >,
                                         private boost::noncopyable {
 
+    template <class DetectorT, class ViewT> friend class IntegralDetectorTileTask;
+
   public:
     static const int IP_DEFAULT_SCALES = 8;
 
     /// Setting max_points = 0 will disable interest point culling.
     IntegralInterestPointDetector( int max_points = 1000 )
-      : m_interest(InterestT()), m_scales(IP_DEFAULT_SCALES), m_max_points(max_points) {}
+      : m_interest(InterestT()), m_scales(IP_DEFAULT_SCALES), m_max_points(max_points), m_tile_size(0) {}
 
     IntegralInterestPointDetector( InterestT const& interest, int max_points = 1000 )
-      : m_interest(interest), m_scales(IP_DEFAULT_SCALES), m_max_points(max_points) {}
+      : m_interest(interest), m_scales(IP_DEFAULT_SCALES), m_max_points(max_points), m_tile_size(0) {}
 
     IntegralInterestPointDetector( InterestT const& interest, int scales, int max_points )
-      : m_interest(interest), m_scales(scales), m_max_points(max_points) {}
+      : m_interest(interest), m_scales(scales), m_max_points(max_points), m_tile_size(0) {}
+
+    /// Process images larger than tile_size x tile_size in tiles of that
+    /// size. A tile size of zero (the default) disables tiling.
+    void set_tile_size( int tile_size ) { m_tile_size = tile_size; }
+    int  tile_size() const { return m_tile_size; }
 
     /// Detect Interest Points in the source image.
     template <class ViewT>
     InterestPointList process_image(ImageViewBase<ViewT> const& image ) const {
       typedef ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type> ImageT;
-      typedef ImageInterestData<ImageT,InterestT> DataT;
+
+      if ( m_tile_size > 0 && ( image.impl().cols() > m_tile_size ||
+                                image.impl().rows() > m_tile_size ) ) {
+        InterestPointList tiled_points;
+        if ( process_image_tiled( image.impl(), tiled_points,
+                                  boost::integral_constant<bool, HasInterestSupport<InterestT>::value>() ) )
+          return tiled_points;
+      }
 
       Timer total("\t\tTotal elapsed time", DebugMessage, "interest_point");
 
@@ -142,10 +241,48 @@ namespace ip {
         integral_image= IntegralImage( original_image );
       }
 
+      // Detecting interest points away from the one pixel border
+      InterestPointList new_points =
+        detect_scales( original_image, integral_image,
+                       BBox2i( Vector2i(1,1), Vector2i(original_image.cols()-1, original_image.rows()-1) ) );
+
+      if ( m_max_points > 0 ) { // Cull
+        vw_out(DebugMessage, "interest_point") << "\tCulling ...";
+        Timer t("elapsed time", DebugMessage, "interest_point");
+        int original_num_points = new_points.size();
+        new_points.sort();
+        if (m_max_points < original_num_points)
+          new_points.resize( m_max_points );
+        vw_out(DebugMessage, "interest_point") << "     (removed " << original_num_points - new_points.size() << " interest points, " << new_points.size() << " remaining.)\n";
+      }
+
+      { // Assign orientations
+        vw_out(DebugMessage, "interest_point") << "\tAssigning Orientations... ";
+        Timer t("elapsed time", DebugMessage, "interest_point");
+        std::for_each( new_points.begin(), new_points.end(),
+                       AssignOrientation<ImageT >( integral_image ) );
+      }
+
+      return new_points;
+    } // End function process_image
+
+  protected:
+
+    InterestT m_interest;
+    int m_scales, m_max_points, m_tile_size;
+
+    /// Run the scale stack over an image and its integral image,
+    /// returning the thresholded extrema at positions inside 'scan' in
+    /// the order they were found (by scale, then row, then column).
+    template <class ImageT>
+    InterestPointList detect_scales( ImageT const& image, ImageT const& integral_image,
+                                     BBox2i const& scan ) const {
+      typedef ImageInterestData<ImageT,InterestT> DataT;
+
       // Creating Scales
       std::deque<DataT> interest_data;
-      interest_data.push_back( DataT(original_image, integral_image) );
-      interest_data.push_back( DataT(original_image, integral_image) );
+      interest_data.push_back( DataT(image, integral_image) );
+      interest_data.push_back( DataT(image, integral_image) );
 
       // Priming scales
       InterestPointList new_points;
@@ -162,7 +299,7 @@ namespace ip {
       // Finally processing scales
       for ( int scale = 2; scale < m_scales; scale++ ) {
 
-        interest_data.push_back( DataT(original_image, integral_image) );
+        interest_data.push_back( DataT(image, integral_image) );
         {
           vw_out(DebugMessage, "interest_point") << "\tScale " << scale << " ... ";
           Timer t("done, elapsed time", DebugMessage, "interest_point");
@@ -172,21 +309,21 @@ namespace ip {
         InterestPointList scale_points;
 
         // Detecting interest points in middle
-        int32 cols = original_image.cols() - 2;
-        int32 rows = original_image.rows() - 2;
         typedef typename DataT::interest_type::pixel_accessor AccessT;
 
         AccessT l_row = interest_data[0].interest().origin();
         AccessT m_row = interest_data[1].interest().origin();
         AccessT h_row = interest_data[2].interest().origin();
-        l_row.advance(1,1); m_row.advance(1,1); h_row.advance(1,1);
-        for ( int32 r=0; r < rows; r++ ) {
+        l_row.advance(scan.min().x(),scan.min().y());
+        m_row.advance(scan.min().x(),scan.min().y());
+        h_row.advance(scan.min().x(),scan.min().y());
+        for ( int32 r=scan.min().y(); r < scan.max().y(); r++ ) {
           AccessT l_col = l_row;
           AccessT m_col = m_row;
           AccessT h_col = h_row;
-          for ( int32 c=0; c < cols; c++ ) {
+          for ( int32 c=scan.min().x(); c < scan.max().x(); c++ ) {
             if ( is_extrema( l_col, m_col, h_col ) )
-              scale_points.push_back(InterestPoint(c+2,r+2,
+              scale_points.push_back(InterestPoint(c+1,r+1,
                                                    m_interest.float_scale(scale-1),
                                                    *m_col) );
             l_col.next_col();
@@ -210,30 +347,92 @@ namespace ip {
         interest_data.pop_front();
       } // End scale loop
 
-      if ( m_max_points > 0 ) { // Cull
-        vw_out(DebugMessage, "interest_point") << "\tCulling ...";
-        Timer t("elapsed time", DebugMessage, "interest_point");
-        int original_num_points = new_points.size();
-        new_points.sort();
-        if (m_max_points < original_num_points)
-          new_points.resize( m_max_points );
-        vw_out(DebugMessage, "interest_point") << "     (removed " << original_num_points - new_points.size() << " interest points, " << new_points.size() << " remaining.)\n";
+      return new_points;
+    }
+
+    /// Pixels of context a tile needs on each side so that its filter
+    /// responses, thresholding and orientations match the untiled run.
+    int tile_margin() const {
+      int margin = 0;
+      for ( int scale = 0; scale < m_scales; scale++ )
+        margin = std::max( margin, m_interest.support(scale) );
+      // Orientations sample Haar wavelets out to 8 times the point scale
+      float max_scale = m_interest.float_scale( std::max(m_scales-2, 0) );
+      margin = std::max( margin, int(ceil(8*max_scale)) + 2 );
+      // One more pixel for the extrema neighborhood and one for the
+      // offset of the reported location.
+      return margin + 2;
+    }
+
+    /// Detect the points whose scan position lies in 'tile', using a
+    /// rasterized copy of the tile plus margin. Returns the tile's best
+    /// m_max_points with orientations, in image coordinates.
+    template <class ViewT>
+    InterestPointList process_tile( ViewT const& image, BBox2i const& tile ) const {
+      typedef ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type> ImageT;
+
+      BBox2i region = tile;
+      region.expand( tile_margin() );
+      region.crop( bounding_box(image) );
+
+      ImageT tile_image = crop( image, region );
+      ImageT integral_image = IntegralImage( tile_image );
+
+      // Same scan positions as the untiled run, in tile coordinates
+      BBox2i scan = tile;
+      scan.crop( BBox2i( Vector2i(1,1), Vector2i(image.cols()-1, image.rows()-1) ) );
+      InterestPointList points;
+      if ( !scan.empty() )
+        points = detect_scales( tile_image, integral_image, scan - region.min() );
+
+      // Only the tile's best points can make the global cut
+      if ( m_max_points > 0 && int(points.size()) > m_max_points ) {
+        points.sort( IntegralPointOrder() );
+        points.resize( m_max_points );
       }
 
-      { // Assign orientations
-        vw_out(DebugMessage, "interest_point") << "\tAssigning Orientations... ";
-        Timer t("elapsed time", DebugMessage, "interest_point");
-        std::for_each( new_points.begin(), new_points.end(),
-                       AssignOrientation<ImageT >( integral_image ) );
+      std::for_each( points.begin(), points.end(),
+                     AssignOrientation<ImageT >( integral_image ) );
+
+      for ( InterestPointList::iterator pt = points.begin(); pt != points.end(); ++pt ) {
+        pt->x  += region.min().x();
+        pt->ix += region.min().x();
+        pt->y  += region.min().y();
+        pt->iy += region.min().y();
       }
+      return points;
+    }
 
-      return new_points;
-    } // End function process_image
+    /// Without support() the tile margins are unknown, so fall back to
+    /// processing the whole image.
+    template <class ViewT>
+    bool process_image_tiled( ViewT const& /*image*/, InterestPointList& /*points*/,
+                              boost::false_type ) const {
+      vw_out(DebugMessage, "interest_point") << "\tInterest operator has no support(), not tiling.\n";
+      return false;
+    }
 
-  protected:
+    /// Tiled version of process_image().
+    template <class ViewT>
+    bool process_image_tiled( ViewT const& image, InterestPointList& points,
+                              boost::true_type ) const {
+      Timer total("\t\tTotal elapsed time", DebugMessage, "interest_point");
 
-    InterestT m_interest;
-    int m_scales, m_max_points;
+      std::vector<BBox2i> tiles = image_blocks( image, m_tile_size, m_tile_size );
+      vw_out(DebugMessage, "interest_point") << "\tDetecting in " << tiles.size()
+                                             << " tiles with a margin of " << tile_margin() << "\n";
+
+      IntegralTileCollector collector( m_max_points > 0 ? m_max_points : 0 );
+      {
+        typedef IntegralDetectorTileTask<IntegralInterestPointDetector<InterestT>, ViewT> task_type;
+        FifoWorkQueue queue;
+        for ( size_t i = 0; i < tiles.size(); ++i )
+          queue.add_task( boost::shared_ptr<Task>( new task_type( *this, image, tiles[i], collector ) ) );
+        queue.join_all();
+      }
+      points = collector.points();
+      return true;
+    }
 
     template <class AccessT>
     bool inline is_extrema( AccessT const& low,
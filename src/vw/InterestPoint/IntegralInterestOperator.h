@@ -24,6 +24,7 @@
 #define __VW_INTEGRAL_INTEREST_OPERATOR_H__
 
 // STL
+#include <algorithm>
 #include <vector>
 
 #include <vw/Image/ImageViewRef.h>
@@ -156,6 +157,16 @@ namespace ip {
       return SCALE_LOG_SIGMA[scale];
     }
 
+    /// Pixel radius around a location that operator() and threshold()
+    /// read at this scale: half the largest box plus the Harris window.
+    inline int support( int const& scale ) const {
+      int box_size = 0;
+      for ( uint8 b = 0; b < 6; b++ )
+        box_size = std::max( box_size, std::max( SCALE_BOX_WIDTH [scale][b],
+                                                 SCALE_BOX_HEIGHT[scale][b] ) );
+      return box_size/2 + 1 + 4*int(SCALE_LOG_SIGMA[scale]) + 1;
+    }
+
   };
 
   // Type traits for OBALoG Interest
@@ -21,7 +21,15 @@
 /// Basic classes and structures for storing image interest points.
 ///
 #include <fstream>
+#include <cstring>
+#include <vw/config.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <boost/filesystem/operations.hpp>
+namespace fs = boost::filesystem;
+
+#if VW_HAVE_PKG_BOOST_IOSTREAMS
+#include <boost/iostreams/device/mapped_file.hpp>
+#endif
 
 namespace vw {
 namespace ip {
@@ -89,10 +97,160 @@ namespace ip {
     return ip;
   }
 
-  void write_binary_ip_file(std::string ip_file, InterestPointList ip) {
+  //------------------------------------------------------------------
+  // VWIP version 2 layout
+
+  namespace {
+
+    // Version 2 files start with a magic string instead of the point
+    // count of the original format. Read as a count it would be
+    // billions of times too large to be a real file.
+    const char   VWIP_MAGIC [8] = { 'V','W','I','P','D','A','T','A' };
+    const char   MATCH_MAGIC[8] = { 'V','W','M','A','T','C','H','S' };
+    const uint32 VWIP_VERSION   = 2;
+    const uint64 VWIP_ALIGNMENT = 64;
+
+    enum VwipField { VWIP_X, VWIP_Y, VWIP_SCALE, VWIP_ORIENTATION, VWIP_INTEREST,
+                     VWIP_IX, VWIP_IY, VWIP_POLARITY, VWIP_OCTAVE, VWIP_SCALE_LVL,
+                     VWIP_DESCRIPTORS, VWIP_NUM_FIELDS };
+
+    // All values are stored in native byte order, like the original format.
+    struct VwipHeader {
+      char   magic[8];
+      uint32 version;
+      uint32 header_size;
+      uint64 num_points;
+      uint64 descriptor_length;
+      uint64 offset[VWIP_NUM_FIELDS]; // Byte offset of each array in the file
+      uint64 file_size;
+    };
+
+    // Index match files: the header is followed by the two IP file names
+    // and then the two index arrays.
+    struct MatchHeader {
+      char   magic[8];
+      uint32 version;
+      uint32 header_size;
+      uint64 num_matches;
+      uint64 name_length[2];
+      uint64 index_offset[2];
+    };
+
+    uint64 vwip_align( uint64 pos ) {
+      return (pos + VWIP_ALIGNMENT - 1) / VWIP_ALIGNMENT * VWIP_ALIGNMENT;
+    }
+
+    VwipHeader vwip_header( uint64 num_points, uint64 descriptor_length ) {
+      VwipHeader header;
+      std::memset( &header, 0, sizeof(header) );
+      std::memcpy( header.magic, VWIP_MAGIC, sizeof(VWIP_MAGIC) );
+      header.version           = VWIP_VERSION;
+      header.header_size       = sizeof(VwipHeader);
+      header.num_points        = num_points;
+      header.descriptor_length = descriptor_length;
+
+      const uint64 element_size[VWIP_NUM_FIELDS] =
+        { sizeof(float), sizeof(float), sizeof(float), sizeof(float), sizeof(float),
+          sizeof(int32), sizeof(int32), sizeof(uint8), sizeof(uint32), sizeof(uint32),
+          sizeof(float)*descriptor_length };
+      uint64 pos = vwip_align( sizeof(VwipHeader) );
+      for ( int i = 0; i < VWIP_NUM_FIELDS; ++i ) {
+        header.offset[i] = pos;
+        pos = vwip_align( pos + num_points * element_size[i] );
+      }
+      header.file_size = pos;
+      return header;
+    }
+
+    // Zero pad the stream up to an absolute position.
+    void pad_to( std::ostream& f, uint64 pos, uint64 start ) {
+      static const char zeros[VWIP_ALIGNMENT] = {0};
+      uint64 current = uint64(f.tellp()) - start;
+      while ( current < pos ) {
+        uint64 count = std::min( pos - current, VWIP_ALIGNMENT );
+        f.write( zeros, count );
+        current += count;
+      }
+    }
+
+    template <class T>
+    void write_block( std::ostream& f, uint64 offset, uint64 start,
+                      T const* data, size_t count ) {
+      pad_to( f, offset, start );
+      if ( count )
+        f.write( (char const*)data, count * sizeof(T) );
+    }
+
+    template <class T>
+    void write_block( std::ostream& f, uint64 offset, uint64 start,
+                      std::vector<T> const& data ) {
+      write_block( f, offset, start, data.empty() ? (T const*)0 : &data[0], data.size() );
+    }
+
+    void write_vwip_v2( std::ostream& f, InterestPointSet const& ip ) {
+      const uint64 start = f.tellp();
+      VwipHeader header = vwip_header( ip.size(), ip.descriptor_length() );
+      f.write( (char const*)&header, sizeof(header) );
+      write_block( f, header.offset[VWIP_X          ], start, ip.x           );
+      write_block( f, header.offset[VWIP_Y          ], start, ip.y           );
+      write_block( f, header.offset[VWIP_SCALE      ], start, ip.scale       );
+      write_block( f, header.offset[VWIP_ORIENTATION], start, ip.orientation );
+      write_block( f, header.offset[VWIP_INTEREST   ], start, ip.interest    );
+      write_block( f, header.offset[VWIP_IX         ], start, ip.ix          );
+      write_block( f, header.offset[VWIP_IY         ], start, ip.iy          );
+      write_block( f, header.offset[VWIP_POLARITY   ], start, ip.polarity    );
+      write_block( f, header.offset[VWIP_OCTAVE     ], start, ip.octave      );
+      write_block( f, header.offset[VWIP_SCALE_LVL  ], start, ip.scale_lvl   );
+      write_block( f, header.offset[VWIP_DESCRIPTORS], start,
+                   ip.size() && ip.descriptor_length() ? ip.descriptor(0) : (float const*)0,
+                   ip.size() * ip.descriptor_length() );
+      pad_to( f, header.file_size, start );
+    }
+
+    // Check the header of a version 2 file occupying 'size' bytes.
+    void check_vwip_header( VwipHeader const& header, uint64 size, std::string const& ip_file ) {
+      if ( header.version != VWIP_VERSION || header.header_size != sizeof(VwipHeader) )
+        vw_throw( IOErr() << "Unsupported VWIP version in \"" << ip_file << "\"." );
+      VwipHeader expected = vwip_header( header.num_points, header.descriptor_length );
+      if ( std::memcmp( expected.offset, header.offset, sizeof(header.offset) ) != 0 ||
+           header.file_size != expected.file_size || size < header.file_size )
+        vw_throw( IOErr() << "VWIP file \"" << ip_file << "\" is truncated or corrupt." );
+    }
+
+    bool has_magic( char const* data, uint64 size, char const* magic ) {
+      return size >= 8 && std::memcmp( data, magic, 8 ) == 0;
+    }
+
+    // Read the records of the original format, after its point count.
+    void read_vwip_v1( std::ifstream& f, uint64 size, InterestPointSet& ip ) {
+      ip.reserve( size );
+      for (size_t i = 0; i < size; ++i) {
+        InterestPoint point = read_ip_record(f);
+        if ( !f )
+          vw_throw( IOErr() << "VWIP file is truncated." );
+        ip.push_back( point );
+      }
+    }
+
+  } // anonymous namespace
+
+  void write_binary_ip_file(std::string ip_file, InterestPointList const& ip) {
+    // Points with descriptors of differing lengths can't share a
+    // descriptor block, so they still go in the original format.
+    bool uniform = true;
+    for ( InterestPointList::const_iterator iter = ip.begin(); iter != ip.end(); ++iter )
+      if ( iter->size() != ip.front().size() ) {
+        uniform = false;
+        break;
+      }
+    if ( uniform ) {
+      write_binary_ip_file( ip_file, InterestPointSet( ip ) );
+      return;
+    }
+
     std::ofstream f;
     f.open(ip_file.c_str(), std::ios::binary | std::ios::out);
-    InterestPointList::iterator iter = ip.begin();
+    InterestPointList::const_iterator iter = ip.begin();
     uint64 size = ip.size();
     f.write((char*)&size, sizeof(uint64));
     for ( ; iter != ip.end(); ++iter)
@@ -100,6 +258,15 @@ namespace ip {
     f.close();
   }
 
+  void write_binary_ip_file( std::string ip_file, InterestPointSet const& ip ) {
+    std::ofstream f;
+    f.open(ip_file.c_str(), std::ios::binary | std::ios::out);
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << ip_file << "\" for writing." );
+    write_vwip_v2( f, ip );
+    f.close();
+  }
+
   std::vector<InterestPoint> read_binary_ip_file(std::string ip_file) {
     std::vector<InterestPoint> result;
 
@@ -110,6 +277,20 @@ namespace ip {
     if ( !f.is_open() )
       vw_throw( IOErr() << "Failed to open \"" << ip_file << "\" as VWIP file." );
 
+    char magic[8];
+    f.read( magic, sizeof(magic) );
+    if ( f.gcount() == sizeof(magic) && has_magic( magic, 8, VWIP_MAGIC ) ) {
+      f.close();
+      InterestPointFileView view( ip_file );
+      result.reserve( view.size() );
+      for (size_t i = 0; i < view.size(); ++i)
+        result.push_back( view.point(i) );
+      return result;
+    }
+    f.clear();
+    f.seekg( 0 );
+
+    // The original format allows descriptors of differing lengths
     uint64 size;
     f.read((char*)&size, sizeof(uint64));
     for (size_t i = 0; i < size; ++i)
@@ -118,6 +299,127 @@ namespace ip {
     return result;
   }
 
+  void read_binary_ip_file( std::string ip_file, InterestPointSet& ip ) {
+    ip.clear();
+    InterestPointFileView( ip_file ).get_points( ip );
+  }
+
+  //------------------------------------------------------------------
+  // InterestPointFileView
+
+  struct InterestPointFileView::Storage {
+#if VW_HAVE_PKG_BOOST_IOSTREAMS
+    boost::iostreams::mapped_file_source file;
+#endif
+    std::string buffer; // Used when the file can't be mapped as is
+  };
+
+  InterestPointFileView::InterestPointFileView( std::string const& ip_file )
+    : m_storage( new Storage ) {
+
+    std::ifstream f;
+    f.open(ip_file.c_str(), std::ios::binary | std::ios::in);
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << ip_file << "\" as VWIP file." );
+    char magic[8];
+    f.read( magic, sizeof(magic) );
+    const bool version2 = f.gcount() == sizeof(magic) && has_magic( magic, 8, VWIP_MAGIC );
+
+    char const* data;
+    uint64      data_size;
+    if ( version2 ) {
+      f.close();
+#if VW_HAVE_PKG_BOOST_IOSTREAMS
+      m_storage->file.open( ip_file );
+      data      = m_storage->file.data();
+      data_size = m_storage->file.size();
+#else
+      std::ifstream in( ip_file.c_str(), std::ios::binary | std::ios::in );
+      std::ostringstream contents;
+      contents << in.rdbuf();
+      m_storage->buffer = contents.str();
+      data      = m_storage->buffer.data();
+      data_size = m_storage->buffer.size();
+#endif
+    } else {
+      // Original format: convert to the version 2 layout in memory
+      if ( f.gcount() != sizeof(magic) )
+        vw_throw( IOErr() << "VWIP file \"" << ip_file << "\" is truncated." );
+      uint64 size;
+      std::memcpy( &size, magic, sizeof(size) );
+      InterestPointSet points;
+      read_vwip_v1( f, size, points );
+      f.close();
+
+      std::ostringstream contents( std::ios::binary | std::ios::out );
+      write_vwip_v2( contents, points );
+      m_storage->buffer = contents.str();
+      data      = m_storage->buffer.data();
+      data_size = m_storage->buffer.size();
+    }
+
+    if ( data_size < sizeof(VwipHeader) )
+      vw_throw( IOErr() << "VWIP file \"" << ip_file << "\" is truncated or corrupt." );
+    VwipHeader header;
+    std::memcpy( &header, data, sizeof(header) );
+    check_vwip_header( header, data_size, ip_file );
+
+    m_size              = header.num_points;
+    m_descriptor_length = header.descriptor_length;
+    m_x           = (float  const*)( data + header.offset[VWIP_X          ] );
+    m_y           = (float  const*)( data + header.offset[VWIP_Y          ] );
+    m_scale       = (float  const*)( data + header.offset[VWIP_SCALE      ] );
+    m_orientation = (float  const*)( data + header.offset[VWIP_ORIENTATION] );
+    m_interest    = (float  const*)( data + header.offset[VWIP_INTEREST   ] );
+    m_ix          = (int32  const*)( data + header.offset[VWIP_IX         ] );
+    m_iy          = (int32  const*)( data + header.offset[VWIP_IY         ] );
+    m_polarity    = (uint8  const*)( data + header.offset[VWIP_POLARITY   ] );
+    m_octave      = (uint32 const*)( data + header.offset[VWIP_OCTAVE     ] );
+    m_scale_lvl   = (uint32 const*)( data + header.offset[VWIP_SCALE_LVL  ] );
+    m_descriptors = (float  const*)( data + header.offset[VWIP_DESCRIPTORS] );
+  }
+
+  InterestPoint InterestPointFileView::point( size_t i, bool with_descriptor ) const {
+    InterestPoint ip( m_x[i], m_y[i], m_scale[i], m_interest[i], m_orientation[i],
+                      m_polarity[i], m_octave[i], m_scale_lvl[i] );
+    ip.ix = m_ix[i];
+    ip.iy = m_iy[i];
+    if ( with_descriptor && m_descriptor_length ) {
+      ip.descriptor.set_size( m_descriptor_length );
+      std::copy( descriptor(i), descriptor(i) + m_descriptor_length, ip.descriptor.begin() );
+    }
+    return ip;
+  }
+
+  void InterestPointFileView::get_points( InterestPointSet& points, size_t begin, size_t end ) const {
+    VW_ASSERT( begin <= end && end <= m_size,
+               ArgumentErr() << "InterestPointFileView: invalid range [" << begin << ", "
+               << end << ") for " << m_size << " points." );
+    if ( points.empty() )
+      points.set_descriptor_length( m_descriptor_length );
+    VW_ASSERT( points.descriptor_length() == m_descriptor_length,
+               ArgumentErr() << "InterestPointFileView: descriptor length " << m_descriptor_length
+               << " does not match the set's " << points.descriptor_length() << "." );
+
+    const size_t first = points.size();
+    points.resize( first + end - begin );
+    std::copy( m_x           + begin, m_x           + end, points.x          .begin() + first );
+    std::copy( m_y           + begin, m_y           + end, points.y          .begin() + first );
+    std::copy( m_scale       + begin, m_scale       + end, points.scale      .begin() + first );
+    std::copy( m_orientation + begin, m_orientation + end, points.orientation.begin() + first );
+    std::copy( m_interest    + begin, m_interest    + end, points.interest   .begin() + first );
+    std::copy( m_ix          + begin, m_ix          + end, points.ix         .begin() + first );
+    std::copy( m_iy          + begin, m_iy          + end, points.iy         .begin() + first );
+    std::copy( m_polarity    + begin, m_polarity    + end, points.polarity   .begin() + first );
+    std::copy( m_octave      + begin, m_octave      + end, points.octave     .begin() + first );
+    std::copy( m_scale_lvl   + begin, m_scale_lvl   + end, points.scale_lvl  .begin() + first );
+    if ( end > begin && m_descriptor_length )
+      std::copy( descriptor(begin), descriptor(end), points.descriptor(first) );
+  }
+
+  //------------------------------------------------------------------
+  // Match files
+
   // Routines for reading & writing interest point match files
   void write_binary_match_file(std::string match_file, std::vector<InterestPoint> const& ip1, std::vector<InterestPoint> const& ip2) {
     std::ofstream f;
@@ -135,6 +437,93 @@ namespace ip {
     f.close();
   }
 
+  void write_binary_match_file(std::string match_file,
+                               std::string ip_file1, std::string ip_file2,
+                               std::vector<uint32> const& index1,
+                               std::vector<uint32> const& index2) {
+    VW_ASSERT( index1.size() == index2.size(),
+               ArgumentErr() << "write_binary_match_file: index lists differ in length." );
+
+    MatchHeader header;
+    std::memset( &header, 0, sizeof(header) );
+    std::memcpy( header.magic, MATCH_MAGIC, sizeof(MATCH_MAGIC) );
+    header.version         = VWIP_VERSION;
+    header.header_size     = sizeof(MatchHeader);
+    header.num_matches     = index1.size();
+    header.name_length[0]  = ip_file1.size();
+    header.name_length[1]  = ip_file2.size();
+    header.index_offset[0] = vwip_align( sizeof(MatchHeader) + ip_file1.size() + ip_file2.size() );
+    header.index_offset[1] = vwip_align( header.index_offset[0] + index1.size() * sizeof(uint32) );
+
+    std::ofstream f;
+    f.open(match_file.c_str(), std::ios::binary | std::ios::out);
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << match_file << "\" for writing." );
+    f.write( (char const*)&header, sizeof(header) );
+    f.write( ip_file1.data(), ip_file1.size() );
+    f.write( ip_file2.data(), ip_file2.size() );
+    write_block( f, header.index_offset[0], 0, index1 );
+    write_block( f, header.index_offset[1], 0, index2 );
+    f.close();
+  }
+
+  void read_binary_match_file(std::string match_file,
+                              std::string& ip_file1, std::string& ip_file2,
+                              std::vector<uint32>& index1,
+                              std::vector<uint32>& index2) {
+    std::ifstream f;
+    f.open(match_file.c_str(), std::ios::binary | std::ios::in);
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << match_file << "\" as Match file." );
+
+    MatchHeader header;
+    f.read( (char*)&header, sizeof(header) );
+    if ( f.gcount() != sizeof(header) || !has_magic( header.magic, 8, MATCH_MAGIC ) )
+      vw_throw( IOErr() << "\"" << match_file << "\" is not an index match file." );
+    if ( header.version != VWIP_VERSION || header.header_size != sizeof(MatchHeader) )
+      vw_throw( IOErr() << "Unsupported match file version in \"" << match_file << "\"." );
+
+    ip_file1.resize( header.name_length[0] );
+    ip_file2.resize( header.name_length[1] );
+    if ( header.name_length[0] ) f.read( &ip_file1[0], header.name_length[0] );
+    if ( header.name_length[1] ) f.read( &ip_file2[0], header.name_length[1] );
+    index1.resize( header.num_matches );
+    index2.resize( header.num_matches );
+    if ( header.num_matches ) {
+      f.seekg( header.index_offset[0] );
+      f.read( (char*)&index1[0], header.num_matches * sizeof(uint32) );
+      f.seekg( header.index_offset[1] );
+      f.read( (char*)&index2[0], header.num_matches * sizeof(uint32) );
+    }
+    if ( !f )
+      vw_throw( IOErr() << "Match file \"" << match_file << "\" is truncated." );
+    f.close();
+  }
+
+  namespace {
+    // Index match files name their IP files as given to the writer;
+    // if that path doesn't exist, look next to the match file.
+    std::string resolve_ip_file( std::string const& match_file, std::string const& ip_file ) {
+      if ( fs::exists( ip_file ) )
+        return ip_file;
+      fs::path sibling = fs::path(match_file).parent_path() / fs::path(ip_file).filename();
+      if ( fs::exists( sibling ) )
+        return sibling.string();
+      return ip_file;
+    }
+
+    void select_points( std::string const& match_file, InterestPointFileView const& view,
+                        std::vector<uint32> const& index, std::vector<InterestPoint>& ip ) {
+      ip.reserve( index.size() );
+      for ( size_t i = 0; i < index.size(); ++i ) {
+        if ( index[i] >= view.size() )
+          vw_throw( IOErr() << "Match file \"" << match_file << "\" refers to point "
+                    << index[i] << " of a file with " << view.size() << " points." );
+        ip.push_back( view.point( index[i] ) );
+      }
+    }
+  }
+
   void read_binary_match_file(std::string match_file, std::vector<InterestPoint> &ip1, std::vector<InterestPoint> &ip2) {
     ip1.clear();
     ip2.clear();
@@ -146,6 +535,22 @@ namespace ip {
     if ( !f.is_open() )
       vw_throw( IOErr() << "Failed to open \"" << match_file << "\" as Match file." );
 
+    char magic[8];
+    f.read( magic, sizeof(magic) );
+    if ( f.gcount() == sizeof(magic) && has_magic( magic, 8, MATCH_MAGIC ) ) {
+      f.close();
+      std::string ip_file1, ip_file2;
+      std::vector<uint32> index1, index2;
+      read_binary_match_file( match_file, ip_file1, ip_file2, index1, index2 );
+      select_points( match_file, InterestPointFileView( resolve_ip_file( match_file, ip_file1 ) ),
+                     index1, ip1 );
+      select_points( match_file, InterestPointFileView( resolve_ip_file( match_file, ip_file2 ) ),
+                     index2, ip2 );
+      return;
+    }
+    f.clear();
+    f.seekg( 0 );
+
     uint64 size1, size2;
     f.read((char*)&size1, sizeof(uint64));
     f.read((char*)&size2, sizeof(uint64));
@@ -179,4 +584,69 @@ namespace ip {
   /// Helpful functors
   void remove_descriptor( InterestPoint & ip ) { ip.descriptor.set_size(0); }
 
+  //------------------------------------------------------------------
+  // InterestPointSet
+
+  void InterestPointSet::reserve( size_t num_points ) {
+    x.reserve( num_points ); y.reserve( num_points );
+    scale.reserve( num_points ); orientation.reserve( num_points ); interest.reserve( num_points );
+    ix.reserve( num_points ); iy.reserve( num_points );
+    polarity.reserve( num_points );
+    octave.reserve( num_points ); scale_lvl.reserve( num_points );
+    m_descriptors.reserve( num_points * m_descriptor_length );
+  }
+
+  void InterestPointSet::resize( size_t num_points ) {
+    x.resize( num_points ); y.resize( num_points );
+    scale.resize( num_points ); orientation.resize( num_points ); interest.resize( num_points );
+    ix.resize( num_points ); iy.resize( num_points );
+    polarity.resize( num_points );
+    octave.resize( num_points ); scale_lvl.resize( num_points );
+    m_descriptors.resize( num_points * m_descriptor_length, 0 );
+  }
+
+  void InterestPointSet::clear() {
+    x.clear(); y.clear();
+    scale.clear(); orientation.clear(); interest.clear();
+    ix.clear(); iy.clear();
+    polarity.clear();
+    octave.clear(); scale_lvl.clear();
+    m_descriptors.clear();
+  }
+
+  void InterestPointSet::push_back( InterestPoint const& ip ) {
+    if ( empty() && m_descriptors.empty() && ip.size() != 0 )
+      m_descriptor_length = ip.size();
+    VW_ASSERT( ip.size() == 0 || ip.size() == m_descriptor_length,
+               ArgumentErr() << "InterestPointSet: descriptor has length " << ip.size()
+               << " instead of " << m_descriptor_length << "." );
+    x.push_back( ip.x ); y.push_back( ip.y );
+    scale.push_back( ip.scale ); orientation.push_back( ip.orientation ); interest.push_back( ip.interest );
+    ix.push_back( ip.ix ); iy.push_back( ip.iy );
+    polarity.push_back( ip.polarity );
+    octave.push_back( ip.octave ); scale_lvl.push_back( ip.scale_lvl );
+    if ( ip.size() )
+      m_descriptors.insert( m_descriptors.end(), ip.begin(), ip.end() );
+    else
+      m_descriptors.resize( m_descriptors.size() + m_descriptor_length, 0 );
+  }
+
+  void InterestPointSet::set_descriptor_length( size_t length ) {
+    m_descriptor_length = length;
+    m_descriptors.assign( size() * length, 0 );
+  }
+
+  InterestPoint InterestPointSet::point( size_t i, bool with_descriptor ) const {
+    InterestPoint ip( x[i], y[i], scale[i], interest[i], orientation[i],
+                      polarity[i], octave[i], scale_lvl[i] );
+    ip.ix = ix[i];
+    ip.iy = iy[i];
+    if ( with_descriptor && m_descriptor_length ) {
+      ip.descriptor.set_size( m_descriptor_length );
+      float const* row = descriptor(i);
+      std::copy( row, row + m_descriptor_length, ip.descriptor.begin() );
+    }
+    return ip;
+  }
+
 }} // namespace vw::ip
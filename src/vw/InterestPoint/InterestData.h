@@ -34,6 +34,8 @@
 #include <algorithm>
 #include <sstream>
 
+#include <boost/shared_ptr.hpp>
+
 #if defined(VW_HAVE_PKG_OPENCV) && VW_HAVE_PKG_OPENCV == 1
 #include "opencv2/core/core.hpp"
 #include "opencv2/features2d/features2d.hpp"
@@ -171,16 +173,35 @@ namespace ip {
   //std::vector<InterestPoint> vectorlist_to_iplist(std::vector<Vector3      > const& veclist); // Avoid using, info is lost!
 
   // Routines for reading & writing interest point data files
+  // - VWIP files are written in the version 2 layout (see
+  //   InterestPointFileView) unless the descriptors differ in length.
+  // - The readers accept both version 2 and the original format.
   void write_lowe_ascii_ip_file(std::string ip_file, InterestPointList ip);
-  void write_binary_ip_file    (std::string ip_file, InterestPointList ip);
+  void write_binary_ip_file    (std::string ip_file, InterestPointList const& ip);
   std::vector<InterestPoint> read_binary_ip_file(std::string ip_file);
 
   // Routines for reading & writing interest point match files
+  // - These store full copies of the matched points. The readers also
+  //   accept index match files, loading the points from the IP files.
   void write_binary_match_file(std::string match_file, std::vector<InterestPoint> const& ip1,
                                std::vector<InterestPoint> const& ip2);
   void read_binary_match_file(std::string match_file, std::vector<InterestPoint> &ip1,
                               std::vector<InterestPoint> &ip2);
 
+  /// Write an index match file. Match k pairs point index1[k] of
+  /// ip_file1 with point index2[k] of ip_file2; only the indices and
+  /// the two file names are stored.
+  void write_binary_match_file(std::string match_file,
+                               std::string ip_file1, std::string ip_file2,
+                               std::vector<uint32> const& index1,
+                               std::vector<uint32> const& index2);
+  /// Read an index match file. Throws IOErr for match files that store
+  /// points rather than indices.
+  void read_binary_match_file(std::string match_file,
+                              std::string& ip_file1, std::string& ip_file2,
+                              std::vector<uint32>& index1,
+                              std::vector<uint32>& index2);
+
   /// Select only the interest points that fall within the specified bounding box.
   template <class RealT>
   InterestPointList crop(InterestPointList const& interest_points, BBox<RealT,2> const& bbox) {
@@ -214,6 +235,136 @@ namespace ip {
   }
 
 
+  /// A collection of interest points stored as contiguous arrays: one
+  /// array per geometry field and a single row-major pool holding all
+  /// the descriptors, one row per point. Describing, matching and
+  /// writing a set work on the pool directly instead of allocating and
+  /// chasing one descriptor vector per point.
+  ///
+  /// The field arrays are public, like the fields of InterestPoint, but
+  /// should only be resized through the member functions.
+  class InterestPointSet {
+    size_t             m_descriptor_length;
+    std::vector<float> m_descriptors;
+
+    float      * descriptor_data()       { return m_descriptors.empty() ? 0 : &m_descriptors[0]; }
+    float const* descriptor_data() const { return m_descriptors.empty() ? 0 : &m_descriptors[0]; }
+
+  public:
+    std::vector<float > x, y, scale, orientation, interest;
+    std::vector<int32 > ix, iy;
+    std::vector<uint8 > polarity;
+    std::vector<uint32> octave, scale_lvl;
+
+    InterestPointSet() : m_descriptor_length(0) {}
+
+    /// Copy a container of InterestPoints (list, vector, ...).
+    /// All of their descriptors must have the same length.
+    template <class ListT>
+    explicit InterestPointSet( ListT const& points ) : m_descriptor_length(0) {
+      if ( !points.empty() )
+        m_descriptor_length = points.begin()->size();
+      reserve( points.size() );
+      for ( typename ListT::const_iterator i = points.begin(); i != points.end(); ++i )
+        push_back( *i );
+    }
+
+    size_t size             () const { return x.size(); }
+    bool   empty            () const { return x.empty(); }
+    size_t descriptor_length() const { return m_descriptor_length; }
+
+    void reserve( size_t num_points );
+    void resize ( size_t num_points );
+    void clear();
+
+    /// Append a point. Its descriptor must have descriptor_length()
+    /// elements, or none, in which case the row is zero filled.
+    void push_back( InterestPoint const& ip );
+
+    /// Change the descriptor length, zeroing every descriptor.
+    void set_descriptor_length( size_t length );
+
+    /// The descriptor of point i, descriptor_length() contiguous floats.
+    float      * descriptor( size_t i )       { return descriptor_data() + i*m_descriptor_length; }
+    float const* descriptor( size_t i ) const { return descriptor_data() + i*m_descriptor_length; }
+
+    /// All the descriptors as a size() x descriptor_length() matrix
+    /// sharing the set's memory. It is invalidated by push_back().
+    MatrixProxy<float> descriptors() {
+      return MatrixProxy<float>( descriptor_data(), size(), m_descriptor_length );
+    }
+    MatrixProxy<const float> descriptors() const {
+      return MatrixProxy<const float>( descriptor_data(), size(), m_descriptor_length );
+    }
+
+    /// Point i as an InterestPoint. The descriptor is only copied if
+    /// requested, so geometry-only access does not allocate.
+    InterestPoint point( size_t i, bool with_descriptor = true ) const;
+
+    /// Append every point of the set to a container of InterestPoints.
+    template <class ListT>
+    void get_points( ListT& points ) const {
+      for ( size_t i = 0; i < size(); ++i )
+        points.push_back( point(i) );
+    }
+  };
+
+  // VWIP version 2 routines for interest point sets
+  void write_binary_ip_file( std::string ip_file, InterestPointSet const& ip );
+  void read_binary_ip_file ( std::string ip_file, InterestPointSet& ip );
+
+  /// Read-only access to a VWIP file without parsing it.
+  ///
+  /// A version 2 file is a fixed size header followed by one array per
+  /// InterestPointSet field and a row-major block with all the
+  /// descriptors, each starting on a 64 byte boundary. The file is
+  /// memory mapped and the accessors point straight into the mapping,
+  /// so a slice of the points can be used without touching the rest of
+  /// the file. Files in the original format are converted in memory.
+  ///
+  /// Copies of a view share the same mapping.
+  class InterestPointFileView {
+    struct Storage;
+    boost::shared_ptr<Storage> m_storage;
+
+    size_t         m_size, m_descriptor_length;
+    float  const * m_x, * m_y, * m_scale, * m_orientation, * m_interest;
+    int32  const * m_ix, * m_iy;
+    uint8  const * m_polarity;
+    uint32 const * m_octave, * m_scale_lvl;
+    float  const * m_descriptors;
+
+  public:
+    explicit InterestPointFileView( std::string const& ip_file );
+
+    size_t size             () const { return m_size; }
+    size_t descriptor_length() const { return m_descriptor_length; }
+
+    float  const* x          () const { return m_x;           }
+    float  const* y          () const { return m_y;           }
+    float  const* scale      () const { return m_scale;       }
+    float  const* orientation() const { return m_orientation; }
+    float  const* interest   () const { return m_interest;    }
+    int32  const* ix         () const { return m_ix;          }
+    int32  const* iy         () const { return m_iy;          }
+    uint8  const* polarity   () const { return m_polarity;    }
+    uint32 const* octave     () const { return m_octave;      }
+    uint32 const* scale_lvl  () const { return m_scale_lvl;   }
+
+    float const* descriptor( size_t i ) const { return m_descriptors + i*m_descriptor_length; }
+
+    /// All the descriptors as a size() x descriptor_length() matrix.
+    MatrixProxy<const float> descriptors() const {
+      return MatrixProxy<const float>( m_descriptors, m_size, m_descriptor_length );
+    }
+
+    InterestPoint point( size_t i, bool with_descriptor = true ) const;
+
+    /// Append points [begin, end) of the file to a set.
+    void get_points( InterestPointSet& points, size_t begin, size_t end ) const;
+    void get_points( InterestPointSet& points ) const { get_points( points, 0, m_size ); }
+  };
+
   /// ImageInterestData
   ///
   /// This struct encapsulates some basic and widely useful processed
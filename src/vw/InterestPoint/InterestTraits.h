@@ -53,6 +53,28 @@ namespace ip {
   template <class InterestT>
   struct InterestPeakType { static const int peak_type = IP_MAX; };
 
+  /// Whether an integral interest operator provides
+  ///   int support( int const& scale ) const;
+  /// the pixel radius it reads around a location at a scale. Tiled
+  /// detection needs it to size the tile margins; operators without
+  /// it are always processed untiled. This only looks for a member
+  /// named support, inherited ones included.
+  template <class InterestT>
+  struct HasInterestSupport {
+  private:
+    typedef char yes_type;
+    typedef char (&no_type)[2];
+    // &Probe::support is ambiguous, and the first test() drops out,
+    // exactly when InterestT has a support member of its own.
+    struct Fallback { int support; };
+    struct Probe : InterestT, Fallback {};
+    template <class T, T> struct Check;
+    template <class T> static no_type  test( Check<int Fallback::*, &T::support>* );
+    template <class T> static yes_type test( ... );
+  public:
+    static const bool value = sizeof(test<Probe>(0)) == sizeof(yes_type);
+  };
+
 } } //namespace vw::ip
 
 #endif
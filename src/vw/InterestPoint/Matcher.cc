@@ -33,9 +33,15 @@ namespace ip {
   float
   L2NormMetric::operator()( InterestPoint const& ip1, InterestPoint const& ip2,
                             float maxdist ) const {
+    return (*this)( ip1.begin(), ip2.begin(), ip1.size(), maxdist );
+  }
+
+  float
+  L2NormMetric::operator()( float const* desc1, float const* desc2, size_t length,
+                            float maxdist ) const {
     float dist = 0.0;
-    for (size_t i = 0; i < ip1.descriptor.size(); i++) {
-      dist += (ip1.descriptor[i] - ip2.descriptor[i])*(ip1.descriptor[i] - ip2.descriptor[i]);
+    for (size_t i = 0; i < length; i++) {
+      dist += (desc1[i] - desc2[i])*(desc1[i] - desc2[i]);
       if (dist > maxdist) break;  // abort calculation if distance exceeds upper bound
     }
     return dist;
@@ -60,14 +66,19 @@ namespace ip {
   float HammingMetric::operator()( InterestPoint const& ip1, 
                                    InterestPoint const& ip2,
                                    float maxdist ) const {
+    return (*this)( ip1.begin(), ip2.begin(), ip1.size(), maxdist );
+  }
+
+  float HammingMetric::operator()( float const* desc1, float const* desc2, size_t length,
+                                   float maxdist ) const {
     float dist = 0.0;
-    for (size_t i = 0; i < ip1.descriptor.size(); i++) {
+    for (size_t i = 0; i < length; i++) {
       // Cast the two elements to bytes which they should have originally been
-      unsigned char desc1 = static_cast<unsigned char>(ip1.descriptor[i]);
-      unsigned char desc2 = static_cast<unsigned char>(ip2.descriptor[i]);
+      unsigned char byte1 = static_cast<unsigned char>(desc1[i]);
+      unsigned char byte2 = static_cast<unsigned char>(desc2[i]);
 
       // Compute the hamming distance between just these two bytes
-      size_t dist_int = hamming_helper(desc1, desc2);
+      size_t dist_int = hamming_helper(byte1, byte2);
 
       // Accumulate the floating point distance
       dist += static_cast<float>(dist_int);
@@ -81,9 +92,15 @@ namespace ip {
   RelativeEntropyMetric::operator()( InterestPoint const& ip1,
                                      InterestPoint const& ip2,
                                      float maxdist ) const {
+    return (*this)( ip1.begin(), ip2.begin(), ip1.size(), maxdist );
+  }
+
+  float
+  RelativeEntropyMetric::operator()( float const* desc1, float const* desc2, size_t length,
+                                     float maxdist ) const {
     float dist = 0.0;
-    for (size_t i = 0; i < ip1.descriptor.size(); i++) {
-      dist += ip1.descriptor[i] * logf(ip1.descriptor[i]/(ip2.descriptor[i]+1e-16)+1e-16)/logf(2.) ;
+    for (size_t i = 0; i < length; i++) {
+      dist += desc1[i] * logf(desc1[i]/(desc2[i]+1e-16)+1e-16)/logf(2.) ;
       if (dist > maxdist) break;  // abort calculation if distance exceeds upper bound
     }
     return dist;
@@ -28,8 +28,10 @@
 #include <vw/Core/Log.h>
 #include <vw/InterestPoint/Descriptor.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/Math/BruteForceKNN.h>
 #include <vector>
 #include <boost/foreach.hpp>
+#include <boost/type_traits/integral_constant.hpp>
 
 #if VW_HAVE_PKG_FLANN
 #include <vw/Math/FLANNTree.h>
@@ -48,6 +50,11 @@ namespace ip {
   ///
   /// float operator() (const InterestPoint& ip1, const InterestPoint &ip2, float maxdist = DBL_MAX)
   ///
+  /// --> The same distance between two raw descriptors, used when matching InterestPointSets.
+  /// float operator() (float const* desc1, float const* desc2, size_t length, float maxdist = DBL_MAX)
+  ///     This overload is optional. Without it, InterestPointSets are matched
+  ///     by rebuilding the two InterestPoints and calling the first form.
+  ///
   /// --> This one is for interoperability with our FLANNTRee class which does all our heavy-duty matching.
   /// static const math::FLANN_DistType flann_type=FLANN_DistType;
 
@@ -57,6 +64,8 @@ namespace ip {
   struct L2NormMetric {
     float operator() (InterestPoint const& ip1, InterestPoint const& ip2,
 		      float maxdist = std::numeric_limits<float>::max()) const;
+    float operator() (float const* desc1, float const* desc2, size_t length,
+		      float maxdist = std::numeric_limits<float>::max()) const;
     static const math::FLANN_DistType flann_type = math::FLANN_DistType_L2;
   };
 
@@ -64,6 +73,8 @@ namespace ip {
   struct HammingMetric {
     float operator() (InterestPoint const& ip1, InterestPoint const& ip2,
 		      float maxdist = std::numeric_limits<float>::max()) const;
+    float operator() (float const* desc1, float const* desc2, size_t length,
+		      float maxdist = std::numeric_limits<float>::max()) const;
     static const math::FLANN_DistType flann_type = math::FLANN_DistType_Hamming;
   };
 
@@ -73,9 +84,49 @@ namespace ip {
   struct RelativeEntropyMetric {
     float operator() (InterestPoint const& ip1, InterestPoint const& ip2,
 		      float maxdist = std::numeric_limits<float>::max()) const;
+    float operator() (float const* desc1, float const* desc2, size_t length,
+		      float maxdist = std::numeric_limits<float>::max()) const;
     static const math::FLANN_DistType flann_type = math::FLANN_DistType_Unsupported;
   };
 
+  /// True if MetricT can be called on two raw descriptors and a length.
+  template <class MetricT>
+  struct HasRawDescriptorMetric {
+  private:
+    typedef char yes_type;
+    typedef char (&no_type)[2];
+    template <class T>
+    static yes_type test( char (*)[sizeof( (*(T const*)0)( (float const*)0, (float const*)0, size_t(0) ) )] );
+    template <class T>
+    static no_type  test( ... );
+  public:
+    static const bool value = sizeof(test<MetricT>(0)) == sizeof(yes_type);
+  };
+
+  /// Distance between point i1 of set1 and point i2 of set2, using the
+  /// raw descriptor form of the metric when it has one.
+  template <class MetricT>
+  inline float set_metric_distance( MetricT const& metric,
+                                    InterestPointSet const& set1, size_t i1,
+                                    InterestPointSet const& set2, size_t i2,
+                                    boost::true_type ) {
+    return metric( set1.descriptor(i1), set2.descriptor(i2), set1.descriptor_length() );
+  }
+  template <class MetricT>
+  inline float set_metric_distance( MetricT const& metric,
+                                    InterestPointSet const& set1, size_t i1,
+                                    InterestPointSet const& set2, size_t i2,
+                                    boost::false_type ) {
+    return metric( set1.point(i1), set2.point(i2) );
+  }
+  template <class MetricT>
+  inline float set_metric_distance( MetricT const& metric,
+                                    InterestPointSet const& set1, size_t i1,
+                                    InterestPointSet const& set2, size_t i2 ) {
+    return set_metric_distance( metric, set1, i1, set2, i2,
+                                boost::integral_constant<bool, HasRawDescriptorMetric<MetricT>::value>() );
+  }
+
 
   //======================================================================
 
@@ -153,6 +204,13 @@ namespace ip {
   //                         Interest Point Matcher
   // ---------------------------------------------------------------------------
 
+  /// The ratio test shared by the matchers: the nearest candidate is
+  /// accepted only if it is closer than threshold times the distance
+  /// to the second nearest one.
+  inline bool ratio_test( double nearest_dist, double second_dist, double threshold ) {
+    return nearest_dist < threshold * second_dist;
+  }
+
   /// Interest point matcher class
   template < class MetricT, class ConstraintT >
   class InterestPointMatcher {
@@ -187,6 +245,13 @@ namespace ip {
 		     IndexListT& index_list,
 		     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
 
+    /// The same for two InterestPointSets, whose descriptors are
+    /// searched in place rather than repacked.
+    template <class IndexListT >
+    void operator()( InterestPointSet const& ip1, InterestPointSet const& ip2,
+		     IndexListT& index_list,
+		     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
     /// Given two lists of interest points, this routine returns the two lists
     /// of matching interest points based on the Metric and Constraints provided by the user.
     template <class ListT, class MatchListT>
@@ -297,6 +362,18 @@ template <class ListT, class IndexListT >
 void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, ListT const& ip2,
 		 IndexListT& index_list,
 		 const ProgressCallback &progress_callback) const {
+  // Pack both lists into contiguous storage and match that
+  InterestPointSet set1( ip1 ), set2( ip2 );
+  this->operator()( set1, set2, index_list, progress_callback );
+}
+
+// The InterestPointSet version of the above, which does the work.
+template <class MetricT, class ConstraintT>
+template <class IndexListT >
+void InterestPointMatcher<MetricT, ConstraintT>::operator()( InterestPointSet const& ip1,
+		 InterestPointSet const& ip2,
+		 IndexListT& index_list,
+		 const ProgressCallback &progress_callback) const {
 
   Timer total_time("Total elapsed time", DebugMessage, "interest_point");
   size_t ip1_size = ip1.size(), ip2_size = ip2.size();
@@ -307,80 +384,94 @@ void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, L
     progress_callback.report_finished();
     return;
   }
+  VW_ASSERT( ip1.descriptor_length() == ip2.descriptor_length(),
+             ArgumentErr() << "All descriptors must have the same length." );
+  const size_t descriptor_length = ip1.descriptor_length();
 
   float inc_amt = 1.0f/float(ip1_size);
 
-
   // Set up FLANNTree objects of all the different types we may need.
   math::FLANNTree<float        > kd_float;
   math::FLANNTree<unsigned char> kd_uchar;
 
-  Matrix<float        > ip2_matrix_float;
-  Matrix<unsigned char> ip2_matrix_uchar;
+  // Below this many descriptor comparisons an exact exhaustive search
+  // is cheaper than building and searching a FLANN index.
+  const double BRUTE_FORCE_MAX_PAIRS = 1e7;
+  const bool use_brute_force = (MetricT::flann_type != math::FLANN_DistType_Unsupported) &&
+                               (double(ip1_size)*double(ip2_size) <= BRUTE_FORCE_MAX_PAIRS);
 
-  // Pack the IP descriptors into a matrix and feed it to the chosen FLANNTree object
+  // Float descriptors are searched in place. Binary descriptors are
+  // converted to bytes first.
   const bool use_uchar_FLANN = (MetricT::flann_type == math::FLANN_DistType_Hamming);
-  if (use_uchar_FLANN) {
-    ip_list_to_matrix(ip2, ip2_matrix_uchar);
-    kd_uchar.load_match_data( ip2_matrix_uchar, MetricT::flann_type );
-  }else {
-    ip_list_to_matrix(ip2, ip2_matrix_float);
-    kd_float.load_match_data( ip2_matrix_float,  MetricT::flann_type );
-  }
+  Matrix<unsigned char> ip2_matrix_uchar;
+  if (use_uchar_FLANN)
+    ip2_matrix_uchar = ip2.descriptors();
 
-  vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
+  if (use_brute_force) {
+    vw_out(InfoMessage,"interest_point") << "Matching by exhaustive search...\n";
+  } else {
+    if (use_uchar_FLANN)
+      kd_uchar.load_match_data( ip2_matrix_uchar,   MetricT::flann_type );
+    else
+      kd_float.load_match_data( ip2.descriptors(), MetricT::flann_type );
+    vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
+  }
 
-  const size_t KNN = 2; // Find this many matches
-  Vector<int   > indices(KNN);
-  Vector<double> distances(KNN);
+  // The ip1 descriptors are searched a block at a time; each call
+  // splits its block between the default number of VW threads.
+  // Blocking bounds the memory used and leaves room to report
+  // progress and honor aborts.
+  const size_t KNN        = 2; // Find this many matches
+  const size_t BLOCK_SIZE = 10000;
+  Matrix<unsigned char> query_uchar;
+  Matrix<int   > indices;
+  Matrix<double> distances;
   progress_callback.report_progress(0);
 
-  BOOST_FOREACH( InterestPoint ip, ip1 ) {
+  for (size_t block_start = 0; block_start < ip1_size; block_start += BLOCK_SIZE) {
     if (progress_callback.abort_requested())
       vw_throw( Aborted() << "Aborted by ProgressCallback" );
-    progress_callback.report_incremental_progress(inc_amt);
+    const size_t block_size = std::min(BLOCK_SIZE, ip1_size - block_start);
 
-    size_t num_matches_found = 0;
+    MatrixProxy<const float> query( ip1.descriptor(block_start), block_size, descriptor_length );
     if (use_uchar_FLANN) {
-      // Convert the descriptor to unsigned chars, then call FLANN
-      vw::Vector<unsigned char> uchar_descriptor(ip.descriptor.size());
-      for (size_t i=0; i<ip.descriptor.size(); ++i)
-	uchar_descriptor[i] = static_cast<unsigned char>(ip.descriptor[i]);
-      num_matches_found = kd_uchar.knn_search( uchar_descriptor, indices, distances, KNN );
+      query_uchar = query;
+      if (use_brute_force)
+        math::brute_force_knn_hamming( ip2_matrix_uchar, query_uchar, indices, distances, KNN );
+      else
+        kd_uchar.knn_search( query_uchar, indices, distances, KNN );
+    } else {
+      if (use_brute_force)
+        math::brute_force_knn_l2( ip2.descriptors(), query, indices, distances, KNN );
+      else
+        kd_float.knn_search( query, indices, distances, KNN );
     }
-    else // Use float
-      num_matches_found = kd_float.knn_search( ip.descriptor, indices, distances, KNN );
 
-    //vw_out() << "KNN matches "<< num_matches_found <<": indices = " << indices << ",    distances = " << distances << std::endl;
+    for (size_t i = 0; i < block_size; ++i) {
+      const size_t i1 = block_start + i;
 
-    if (num_matches_found < KNN) {
-      // If we did not get two nearest neighbors, return no match for this point.
-      vw_out() << "Bad descriptor = " << ip.descriptor << std::endl;
-      index_list.push_back( (size_t)(-1) ); // Last value of size_t
-    } else {
-
-      // Copy the two nearest matches
-      std::vector<InterestPoint> nearest_records(KNN);
-      typename ListT::const_iterator iterator = ip2.begin();
-      std::advance( iterator, indices[0] );
-      nearest_records[0] = *iterator;
-      iterator = ip2.begin();
-      std::advance( iterator, indices[1] );
-      nearest_records[1] = *iterator;
-
-      // Check the user constraint on the record
-      if ( check_constraint<ConstraintT>( nearest_records[0], ip ) ) {
-	double dist0 = m_distance_metric(nearest_records[0], ip);
-	double dist1 = m_distance_metric(nearest_records[1], ip);
-
-	// As a final check, make sure the nearest record is significantly closer than the next one.
-	if (dist0 < m_threshold * dist1) {
-	  index_list.push_back( indices[0] );
-	} else {
-	  index_list.push_back( (size_t)(-1) ); // Last value of size_t
-	}
-      } // End check constraint
-    } // End both valid case
+      if (indices.cols() < KNN || indices(i,0) < 0 || indices(i,1) < 0) {
+        // If we did not get two nearest neighbors, return no match for this point.
+        vw_out() << "Bad descriptor = " << ip1.point(i1).descriptor << std::endl;
+        index_list.push_back( (size_t)(-1) ); // Last value of size_t
+        continue;
+      }
+      const size_t nearest0 = indices(i,0), nearest1 = indices(i,1);
+
+      // Check the user constraint on the record, and as a final check, make
+      // sure the nearest record is significantly closer than the next one.
+      bool matched = false;
+      if ( check_constraint<ConstraintT>( ip2.point(nearest0, false), ip1.point(i1, false) ) ) {
+        double dist0 = set_metric_distance(m_distance_metric, ip2, nearest0, ip1, i1);
+        double dist1 = set_metric_distance(m_distance_metric, ip2, nearest1, ip1, i1);
+        matched = ratio_test(dist0, dist1, m_threshold);
+      }
+      if (matched)
+        index_list.push_back( nearest0 );
+      else
+        index_list.push_back( (size_t)(-1) ); // Last value of size_t
+    }
+    progress_callback.report_incremental_progress( inc_amt * block_size );
   }
 } // End InterestPointMatcher::operator()
 
@@ -398,25 +489,25 @@ void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, L
   matched_ip2.clear();
 
   // Redirect to the other version of this function, getting the results in an index list.
-  std::list<size_t> index_list;
+  std::vector<size_t> index_list;
   this->operator()(ip1, ip2, index_list, progress_callback);
 
-  // Now convert from the index output to the pairs output
+  // Now convert from the index output to the pairs output, using random
+  // access into ip2 since ListT may be a std::list.
+  std::vector<InterestPoint const*> ip2_ptrs;
+  ip2_ptrs.reserve( ip2.size() );
+  BOOST_FOREACH( InterestPoint const& ip, ip2 )
+    ip2_ptrs.push_back( &ip );
 
   // Loop through ip1 and index_list
-  std::list<size_t>::const_iterator index_list_iter = index_list.begin();
-  BOOST_FOREACH( InterestPoint ip, ip1 ) {
-
-    // Get and check the match index
-    typename ListT::const_iterator ip2_iter = ip2.begin();
+  std::vector<size_t>::const_iterator index_list_iter = index_list.begin();
+  BOOST_FOREACH( InterestPoint const& ip, ip1 ) {
+    // Skip points without a match
     size_t list_position = *index_list_iter;
-    if (list_position < ip2.size()) {
-      // Skip points without a match
-
-      // Get the ip2 that corresponds to the current ip1 and store the point pair
-      std::advance( ip2_iter, list_position);
+    if (list_position < ip2_ptrs.size()) {
+      // Store the ip2 that corresponds to the current ip1
       matched_ip1.push_back(ip);
-      matched_ip2.push_back(*ip2_iter);
+      matched_ip2.push_back(*ip2_ptrs[list_position]);
     }
     ++index_list_iter;
   } // End loop through ip1
@@ -479,8 +570,9 @@ void InterestPointMatcherSimple<MetricT, ConstraintT>::operator()( ListT const&
 
     //vw_out() << "Best 2 distances: " << first_pick <<", " << second_pick <<"\n";
 
-    // Checking to see if the match is strong enough
-    if ( first_pick > m_threshold * second_pick )
+    // Checking to see if the match is strong enough. Like the FLANN
+    // matcher, a point with fewer than two candidates is not matched.
+    if ( second_pick == 1e100 || !ratio_test( first_pick, second_pick, m_threshold ) )
       match_index[i] = -1;
   } // End double loop through IPs
 
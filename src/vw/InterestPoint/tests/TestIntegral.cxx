@@ -20,6 +20,7 @@
 #include <gtest/gtest_VW.h>
 
 #include <vw/InterestPoint/IntegralImage.h>
+#include <vw/InterestPoint/IntegralDetector.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Interpolation.h>
 #include <vw/FileIO/DiskImageResource.h>
@@ -247,3 +248,67 @@ TEST( Integral, InterpolationProof ) {
                              10.5, 10.0, 10 ),
                1e-4 );
 }
+
+TEST( Integral, TiledDetection ) {
+  // Integer valued pixels keep every integral image sum exact, so the
+  // tiled and untiled filter responses agree to the bit.
+  ImageView<float> graffiti;
+  read_image( graffiti, TEST_SRCDIR"/sub.png" );
+  float min_val, max_val;
+  min_max_channel_values( graffiti, min_val, max_val );
+  ImageView<float> image = round( graffiti * (255 / max_val) );
+
+  for ( int max_points = 0; max_points <= 40; max_points += 40 ) {
+    IntegralInterestPointDetector<OBALoGInterestOperator>
+      detector( OBALoGInterestOperator(1.0), max_points );
+    InterestPointList untiled = detector.process_image( image );
+    detector.set_tile_size( 32 );
+    InterestPointList tiled   = detector.process_image( image );
+
+    ASSERT_LT( 10u, untiled.size() );
+    ASSERT_EQ( untiled.size(), tiled.size() );
+    InterestPointList::const_iterator u = untiled.begin(), t = tiled.begin();
+    for ( ; u != untiled.end(); ++u, ++t ) {
+      EXPECT_EQ( u->x,        t->x        );
+      EXPECT_EQ( u->y,        t->y        );
+      EXPECT_EQ( u->ix,       t->ix       );
+      EXPECT_EQ( u->iy,       t->iy       );
+      EXPECT_EQ( u->scale,    t->scale    );
+      EXPECT_EQ( u->interest, t->interest );
+      EXPECT_NEAR( u->orientation, t->orientation, 1e-3 );
+    }
+  }
+}
+
+// An operator without support(), which can't be tiled
+class NoSupportInterestOperator {
+  OBALoGInterestOperator m_operator;
+public:
+  template <class ViewT> struct ViewType {
+    typedef typename OBALoGInterestOperator::ViewType<ViewT>::type type;
+  };
+  NoSupportInterestOperator( double threshold ) : m_operator(threshold) {}
+  template <class DataT>
+  void operator()( DataT& data, int scale = 0 ) const { m_operator( data, scale ); }
+  template <class DataT>
+  bool threshold( InterestPoint const& ip, DataT const& data, int scale ) const {
+    return m_operator.threshold( ip, data, scale );
+  }
+  float float_scale( int const& scale ) const { return m_operator.float_scale( scale ); }
+};
+
+TEST( Integral, TiledDetectionNeedsSupport ) {
+  EXPECT_TRUE ( HasInterestSupport<OBALoGInterestOperator>::value );
+  EXPECT_FALSE( HasInterestSupport<NoSupportInterestOperator>::value );
+
+  ImageView<float> graffiti;
+  read_image( graffiti, TEST_SRCDIR"/sub.png" );
+
+  // Asking for tiles is harmless, the image is processed whole
+  IntegralInterestPointDetector<NoSupportInterestOperator>
+    detector( NoSupportInterestOperator(0.01), 40 );
+  InterestPointList untiled = detector.process_image( graffiti );
+  detector.set_tile_size( 32 );
+  InterestPointList tiled   = detector.process_image( graffiti );
+  EXPECT_EQ( untiled.size(), tiled.size() );
+}
@@ -20,6 +20,8 @@
 #include <test/Helpers.h>
 #include <vw/InterestPoint/InterestData.h>
 
+#include <fstream>
+
 using namespace vw;
 using namespace vw::ip;
 using namespace vw::test;
@@ -108,3 +110,197 @@ TEST( InterestData, MATCH_IO_Loop ) {
     ip1iter++; ip2iter++;
   }
 }
+
+TEST( InterestData, InterestPointSet ) {
+  std::vector<InterestPoint> ip;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ip.push_back( InterestPoint( 2*i+0.5, 2*i+5, 1.0+i, -float(i), i, i%2, 5, i ) );
+    ip.back().descriptor = Vector3(5,6,i);
+  }
+
+  InterestPointSet set( ip );
+  ASSERT_EQ( 5u, set.size() );
+  ASSERT_EQ( 3u, set.descriptor_length() );
+
+  // The descriptors are packed into one row per point
+  MatrixProxy<float> descriptors = set.descriptors();
+  ASSERT_EQ( 5u, descriptors.rows() );
+  ASSERT_EQ( 3u, descriptors.cols() );
+  for ( uint32 i = 0; i < 5; i++ ) {
+    EXPECT_EQ( 5, descriptors(i,0) );
+    EXPECT_EQ( 6, descriptors(i,1) );
+    EXPECT_EQ( float(i), descriptors(i,2) );
+    EXPECT_EQ( set.descriptor(i), &descriptors(i,0) );
+  }
+
+  std::list<InterestPoint> result;
+  set.get_points( result );
+  ASSERT_EQ( 5u, result.size() );
+  std::list<InterestPoint>::iterator riter = result.begin();
+  for ( uint32 i = 0; i < 5; i++ ) {
+    EXPECT_EQ( ip[i].x, riter->x );
+    EXPECT_EQ( ip[i].y, riter->y );
+    EXPECT_EQ( ip[i].scale, riter->scale );
+    EXPECT_EQ( ip[i].ix, riter->ix );
+    EXPECT_EQ( ip[i].iy, riter->iy );
+    EXPECT_EQ( ip[i].orientation, riter->orientation );
+    EXPECT_EQ( ip[i].interest, riter->interest );
+    EXPECT_EQ( ip[i].polarity, riter->polarity );
+    EXPECT_EQ( ip[i].octave, riter->octave );
+    EXPECT_EQ( ip[i].scale_lvl, riter->scale_lvl );
+    EXPECT_VECTOR_FLOAT_EQ( ip[i].descriptor, riter->descriptor );
+    riter++;
+  }
+
+  // Geometry only access doesn't copy the descriptor
+  EXPECT_EQ( 0u, set.point( 2, false ).size() );
+
+  // Descriptors must all have the same length
+  InterestPoint bad( 1, 1 );
+  bad.descriptor = Vector2(1,2);
+  EXPECT_THROW( set.push_back( bad ), ArgumentErr );
+
+  // A point without a descriptor gets a zeroed row
+  set.push_back( InterestPoint( 3, 4 ) );
+  ASSERT_EQ( 6u, set.size() );
+  EXPECT_VECTOR_FLOAT_EQ( Vector3(), set.point(5).descriptor );
+}
+
+TEST( InterestData, VWIP_V2_View ) {
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 7; i++ ) {
+    ip.push_back( InterestPoint( 2*i+0.25, 3*i, 1.5, -float(i), 0.1*i, i%2, i, 2 ) );
+    ip.back().descriptor = Vector4(i,1,2,3);
+  }
+
+  UnlinkName vwip_file( "monkey2.vwip" );
+  write_binary_ip_file( vwip_file, ip );
+
+  InterestPointFileView view( vwip_file );
+  ASSERT_EQ( 7u, view.size() );
+  ASSERT_EQ( 4u, view.descriptor_length() );
+  // The descriptor block is aligned for in place use
+  EXPECT_EQ( 0u, size_t(view.descriptor(0)) % 64 );
+
+  InterestPointList::iterator ipiter = ip.begin();
+  for ( uint32 i = 0; i < 7; i++ ) {
+    EXPECT_EQ( ipiter->x, view.x()[i] );
+    EXPECT_EQ( ipiter->iy, view.iy()[i] );
+    EXPECT_EQ( ipiter->polarity, bool(view.polarity()[i]) );
+    EXPECT_EQ( ipiter->octave, view.octave()[i] );
+    EXPECT_EQ( float(i), view.descriptors()(i,0) );
+    EXPECT_EQ( 3, view.descriptors()(i,3) );
+    ipiter++;
+  }
+
+  // Slicing copies only the requested points
+  InterestPointSet slice;
+  view.get_points( slice, 2, 5 );
+  ASSERT_EQ( 3u, slice.size() );
+  EXPECT_EQ( view.x()[2], slice.x[0] );
+  EXPECT_EQ( view.scale_lvl()[4], slice.scale_lvl[2] );
+  EXPECT_VECTOR_FLOAT_EQ( Vector4(3,1,2,3), slice.point(1).descriptor );
+
+  // Sets go through the same layout
+  UnlinkName set_file( "monkey3.vwip" );
+  write_binary_ip_file( set_file, slice );
+  InterestPointSet result;
+  read_binary_ip_file( set_file, result );
+  ASSERT_EQ( 3u, result.size() );
+  EXPECT_EQ( slice.y, result.y );
+  EXPECT_VECTOR_FLOAT_EQ( slice.point(2).descriptor, result.point(2).descriptor );
+}
+
+TEST( InterestData, VWIP_V1_Compatibility ) {
+  // Write a file in the original record-per-point format
+  UnlinkName vwip_file( "monkey_v1.vwip" );
+  {
+    std::ofstream f( vwip_file.c_str(), std::ios::binary | std::ios::out );
+    uint64 size = 3;
+    f.write( (char*)&size, sizeof(uint64) );
+    for ( uint32 i = 0; i < 3; i++ ) {
+      InterestPoint p( i+0.5, 2*i, 1.0, i, -float(i), true, 1, i );
+      f.write( (char*)&p.x, sizeof(p.x) );
+      f.write( (char*)&p.y, sizeof(p.y) );
+      f.write( (char*)&p.ix, sizeof(p.ix) );
+      f.write( (char*)&p.iy, sizeof(p.iy) );
+      f.write( (char*)&p.orientation, sizeof(p.orientation) );
+      f.write( (char*)&p.scale, sizeof(p.scale) );
+      f.write( (char*)&p.interest, sizeof(p.interest) );
+      f.write( (char*)&p.polarity, sizeof(p.polarity) );
+      f.write( (char*)&p.octave, sizeof(p.octave) );
+      f.write( (char*)&p.scale_lvl, sizeof(p.scale_lvl) );
+      uint64 length = 2;
+      f.write( (char*)&length, sizeof(uint64) );
+      float descriptor[2] = { float(i), 7 };
+      f.write( (char*)descriptor, sizeof(descriptor) );
+    }
+  }
+
+  std::vector<InterestPoint> result = read_binary_ip_file( vwip_file );
+  ASSERT_EQ( 3u, result.size() );
+  InterestPointFileView view( vwip_file );
+  ASSERT_EQ( 3u, view.size() );
+  for ( uint32 i = 0; i < 3; i++ ) {
+    EXPECT_EQ( i+0.5, result[i].x );
+    EXPECT_EQ( -float(i), result[i].orientation );
+    EXPECT_EQ( i, result[i].scale_lvl );
+    EXPECT_VECTOR_FLOAT_EQ( Vector2(i,7), result[i].descriptor );
+    EXPECT_EQ( result[i].y, view.y()[i] );
+    EXPECT_VECTOR_FLOAT_EQ( result[i].descriptor, view.point(i).descriptor );
+  }
+
+  // Lists with differing descriptor lengths still use the original format
+  InterestPointList mixed;
+  mixed.push_back( InterestPoint( 1, 2 ) );
+  mixed.push_back( InterestPoint( 3, 4 ) );
+  mixed.back().descriptor = Vector3(1,2,3);
+  UnlinkName mixed_file( "monkey_mixed.vwip" );
+  write_binary_ip_file( mixed_file, mixed );
+  result = read_binary_ip_file( mixed_file );
+  ASSERT_EQ( 2u, result.size() );
+  EXPECT_EQ( 0u, result[0].size() );
+  EXPECT_EQ( 3u, result[1].size() );
+}
+
+TEST( InterestData, MATCH_Index_Loop ) {
+  InterestPointList ip1, ip2;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ip1.push_back( InterestPoint( i, 2*i ) );
+    ip1.back().descriptor = Vector2(i,1);
+    ip2.push_back( InterestPoint( 10+i, 20-i ) );
+    ip2.back().descriptor = Vector2(1,i);
+  }
+  UnlinkName vwip_file1( "monkey_a.vwip" ), vwip_file2( "monkey_b.vwip" );
+  write_binary_ip_file( vwip_file1, ip1 );
+  write_binary_ip_file( vwip_file2, ip2 );
+
+  std::vector<uint32> index1, index2;
+  index1.push_back( 0 ); index2.push_back( 4 );
+  index1.push_back( 3 ); index2.push_back( 1 );
+  UnlinkName match_file( "monkey_ab.match" );
+  write_binary_match_file( match_file, vwip_file1, vwip_file2, index1, index2 );
+
+  std::string name1, name2;
+  std::vector<uint32> result_index1, result_index2;
+  read_binary_match_file( match_file, name1, name2, result_index1, result_index2 );
+  EXPECT_EQ( vwip_file1, name1 );
+  EXPECT_EQ( vwip_file2, name2 );
+  EXPECT_EQ( index1, result_index1 );
+  EXPECT_EQ( index2, result_index2 );
+
+  // The point reader resolves the indices through the IP files
+  std::vector<InterestPoint> result1, result2;
+  read_binary_match_file( match_file, result1, result2 );
+  ASSERT_EQ( 2u, result1.size() );
+  ASSERT_EQ( 2u, result2.size() );
+  EXPECT_EQ( 3, result1[1].x );
+  EXPECT_EQ( 14, result2[0].x );
+  EXPECT_VECTOR_FLOAT_EQ( Vector2(1,1), result2[1].descriptor );
+
+  // Point match files aren't index match files
+  UnlinkName point_match_file( "monkey_points.match" );
+  write_binary_match_file( point_match_file, result1, result2 );
+  EXPECT_THROW( read_binary_match_file( point_match_file, name1, name2,
+                                        result_index1, result_index2 ), IOErr );
+}
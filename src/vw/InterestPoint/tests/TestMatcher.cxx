@@ -24,6 +24,7 @@
 #include <test/Helpers.h>
 
 #include <algorithm>
+#include <cstdlib>
 
 using namespace vw;
 using namespace vw::ip;
@@ -122,4 +123,88 @@ TEST( Matcher, Matcher ) {
   EXPECT_EQ( matched_indexes[0], 3 );
 }
 
+// A metric written before the raw descriptor form was added
+struct PointOnlyL2Metric {
+  float operator() (InterestPoint const& ip1, InterestPoint const& ip2,
+                    float maxdist = std::numeric_limits<float>::max()) const {
+    return L2NormMetric()(ip1, ip2, maxdist);
+  }
+  static const math::FLANN_DistType flann_type = math::FLANN_DistType_L2;
+};
 
+TEST( Matcher, PointOnlyMetric ) {
+  EXPECT_TRUE ( HasRawDescriptorMetric<L2NormMetric     >::value );
+  EXPECT_FALSE( HasRawDescriptorMetric<PointOnlyL2Metric>::value );
+
+  std::vector<InterestPoint> ip1_list, ip2_list;
+  ip1_list.push_back( InterestPoint(0,0) );
+  ip1_list.back().descriptor = Vector3(0,7.7,0);
+  for (int i = 5; i < 10; ++i) {
+    ip2_list.push_back( InterestPoint(20,0) );
+    ip2_list.back().descriptor = Vector3(0,i,0);
+  }
+
+  std::vector<size_t> point_index, raw_index;
+  InterestPointMatcher<PointOnlyL2Metric,NullConstraint>().operator()( ip1_list, ip2_list, point_index );
+  InterestPointMatcher<L2NormMetric,     NullConstraint>().operator()( ip1_list, ip2_list, raw_index   );
+  ASSERT_EQ( 1u, point_index.size() );
+  EXPECT_EQ( raw_index[0], point_index[0] );
+  EXPECT_EQ( 3u, point_index[0] );
+}
+
+
+
+// Small sets are matched by exhaustive search, which should pick the
+// same pairs as the simple matcher, binary descriptors included.
+TEST( Matcher, ExhaustiveMatchesSimple ) {
+  std::vector<InterestPoint> ip1_list, ip2_list;
+  srand(3);
+  for (int i = 0; i < 60; ++i) {
+    InterestPoint ip2(i, 2*i, 1.0, 1.0, 0.0);
+    ip2.descriptor.set_size(16);
+    for (int k = 0; k < 16; ++k)
+      ip2.descriptor[k] = rand() % 256;
+    ip2_list.push_back(ip2);
+
+    // Every other point gets a perturbed copy to match against
+    if (i % 2 == 0) {
+      InterestPoint ip1 = ip2;
+      ip1.descriptor[i % 16] = 255 - ip1.descriptor[i % 16];
+      ip1_list.push_back(ip1);
+    }
+  }
+
+  std::vector<InterestPoint> matched_ip1, matched_ip2, simple_ip1, simple_ip2;
+  InterestPointMatcher      <L2NormMetric,NullConstraint> matcher(0.8);
+  InterestPointMatcherSimple<L2NormMetric,NullConstraint> simple (0.8);
+  matcher(ip1_list, ip2_list, matched_ip1, matched_ip2);
+  simple (ip1_list, ip2_list, simple_ip1,  simple_ip2 );
+  ASSERT_EQ( simple_ip1.size(), matched_ip1.size() );
+  EXPECT_LT( 0u, matched_ip1.size() );
+  for (size_t i = 0; i < matched_ip1.size(); ++i) {
+    EXPECT_EQ( simple_ip2[i].x, matched_ip2[i].x );
+    EXPECT_EQ( matched_ip1[i].x, matched_ip2[i].x );
+  }
+
+  InterestPointMatcher      <HammingMetric,NullConstraint> hamming(0.8);
+  InterestPointMatcherSimple<HammingMetric,NullConstraint> simple_hamming(0.8);
+  hamming       (ip1_list, ip2_list, matched_ip1, matched_ip2);
+  simple_hamming(ip1_list, ip2_list, simple_ip1,  simple_ip2 );
+  ASSERT_EQ( simple_ip1.size(), matched_ip1.size() );
+  EXPECT_LT( 0u, matched_ip1.size() );
+  for (size_t i = 0; i < matched_ip1.size(); ++i)
+    EXPECT_EQ( simple_ip2[i].x, matched_ip2[i].x );
+
+  // Matching the contiguous sets directly gives the same indices
+  std::vector<size_t> list_index, set_index;
+  InterestPointSet ip1_set(ip1_list), ip2_set(ip2_list);
+  matcher(ip1_list, ip2_list, list_index);
+  matcher(ip1_set,  ip2_set,  set_index );
+  ASSERT_EQ( ip1_list.size(), set_index.size() );
+  for (size_t i = 0; i < set_index.size(); ++i) {
+    EXPECT_EQ( list_index[i], set_index[i] );
+    if (set_index[i] != size_t(-1)) {
+      EXPECT_EQ( 2*i, set_index[i] );
+    }
+  }
+}
@@ -0,0 +1,191 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Math/BruteForceKNN.h>
+
+#include <vw/Core/FundamentalTypes.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+  using vw::math::Matrix;
+
+  // Each pass compares this many queries against one feature, so the
+  // feature is loaded once for all of them.
+  const size_t QUERY_GROUP = 4;
+  // Features are visited in tiles of this many rows, small enough to
+  // stay in cache while every query group is run over them.
+  const size_t FEATURE_TILE = 128;
+
+  // Insert a candidate into a list of the k best neighbors so far,
+  // which is kept sorted by increasing distance.  A candidate that ties
+  // an existing entry goes after it, so ties favor the lower index.
+  template <class DistT>
+  inline void insert_neighbor( DistT* best_dists, int* best_indices, size_t knn,
+                               DistT dist, int index ) {
+    if ( !(dist < best_dists[knn-1]) )
+      return;
+    size_t pos = knn-1;
+    while ( pos > 0 && dist < best_dists[pos-1] ) {
+      best_dists  [pos] = best_dists  [pos-1];
+      best_indices[pos] = best_indices[pos-1];
+      --pos;
+    }
+    best_dists  [pos] = dist;
+    best_indices[pos] = index;
+  }
+
+  /// Squared Euclidean distances from a group of queries to one feature.
+  template <class T>
+  struct L2Kernel {
+    typedef T dist_type;
+    size_t dim;
+    explicit L2Kernel( size_t d ) : dim(d) {}
+
+    inline void operator()( T const* const* q, T const* f, T* out ) const {
+      T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      for ( size_t k = 0; k < dim; ++k ) {
+        const T v = f[k];
+        const T d0 = q[0][k] - v, d1 = q[1][k] - v, d2 = q[2][k] - v, d3 = q[3][k] - v;
+        s0 += d0*d0; s1 += d1*d1; s2 += d2*d2; s3 += d3*d3;
+      }
+      out[0] = s0; out[1] = s1; out[2] = s2; out[3] = s3;
+    }
+  };
+
+  inline int popcount64( vw::uint64 x ) {
+#if defined(__GNUC__)
+    return __builtin_popcountll( x );
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return int((x * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+  /// Hamming distances from a group of queries to one feature, on rows
+  /// packed into 64 bit words.
+  struct HammingKernel {
+    typedef int dist_type;
+    size_t words;
+    explicit HammingKernel( size_t w ) : words(w) {}
+
+    inline void operator()( vw::uint64 const* const* q, vw::uint64 const* f, int* out ) const {
+      int s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      for ( size_t k = 0; k < words; ++k ) {
+        const vw::uint64 v = f[k];
+        s0 += popcount64( q[0][k] ^ v ); s1 += popcount64( q[1][k] ^ v );
+        s2 += popcount64( q[2][k] ^ v ); s3 += popcount64( q[3][k] ^ v );
+      }
+      out[0] = s0; out[1] = s1; out[2] = s2; out[3] = s3;
+    }
+  };
+
+  /// Compare every query row against every feature row, both stored
+  /// contiguously with 'stride' elements per row, keeping the knn best.
+  template <class ElemT, class KernelT>
+  void exhaustive_knn( ElemT const* data, size_t num_data,
+                       ElemT const* queries, size_t num_queries, size_t stride,
+                       KernelT const& kernel, size_t knn,
+                       Matrix<int>& indices, Matrix<double>& dists ) {
+    typedef typename KernelT::dist_type DistT;
+
+    knn = std::min( knn, num_data );
+    indices.set_size( num_queries, knn );
+    dists.set_size  ( num_queries, knn );
+    if ( knn == 0 || num_queries == 0 )
+      return;
+
+    std::vector<DistT> best_dists  ( num_queries*knn, std::numeric_limits<DistT>::max() );
+    std::vector<int  > best_indices( num_queries*knn, -1 );
+
+    ElemT const* q[QUERY_GROUP];
+    DistT        d[QUERY_GROUP];
+    for ( size_t tile = 0; tile < num_data; tile += FEATURE_TILE ) {
+      const size_t tile_end = std::min( tile + FEATURE_TILE, num_data );
+      for ( size_t i = 0; i < num_queries; i += QUERY_GROUP ) {
+        // A short last group repeats its final query in the unused slots
+        const size_t group = std::min( QUERY_GROUP, num_queries - i );
+        for ( size_t m = 0; m < QUERY_GROUP; ++m )
+          q[m] = queries + (i + std::min( m, group-1 )) * stride;
+
+        for ( size_t j = tile; j < tile_end; ++j ) {
+          kernel( q, data + j*stride, d );
+          for ( size_t m = 0; m < group; ++m )
+            insert_neighbor( &best_dists[(i+m)*knn], &best_indices[(i+m)*knn],
+                             knn, d[m], int(j) );
+        }
+      }
+    }
+
+    for ( size_t i = 0; i < num_queries; ++i ) {
+      for ( size_t k = 0; k < knn; ++k ) {
+        indices(i,k) = best_indices[i*knn+k];
+        dists  (i,k) = double( best_dists[i*knn+k] );
+      }
+    }
+  }
+
+  // Copy rows of bytes into zero padded 64 bit words.
+  void pack_words( unsigned char const* rows, size_t num_rows, size_t cols, size_t words,
+                   std::vector<vw::uint64>& packed ) {
+    packed.assign( num_rows*words, 0 );
+    if ( cols == 0 )
+      return;
+    for ( size_t r = 0; r < num_rows; ++r )
+      std::memcpy( &packed[r*words], rows + r*cols, cols );
+  }
+
+} // namespace
+
+
+namespace vw {
+namespace math {
+
+  void brute_force_knn_l2( float const* data, size_t num_data,
+                           float const* queries, size_t num_queries, size_t cols,
+                           Matrix<int>& indices, Matrix<double>& dists, size_t knn ) {
+    exhaustive_knn( data, num_data, queries, num_queries, cols,
+                    L2Kernel<float>( cols ), knn, indices, dists );
+  }
+
+  void brute_force_knn_l2( double const* data, size_t num_data,
+                           double const* queries, size_t num_queries, size_t cols,
+                           Matrix<int>& indices, Matrix<double>& dists, size_t knn ) {
+    exhaustive_knn( data, num_data, queries, num_queries, cols,
+                    L2Kernel<double>( cols ), knn, indices, dists );
+  }
+
+  void brute_force_knn_hamming( unsigned char const* data, size_t num_data,
+                                unsigned char const* queries, size_t num_queries, size_t cols,
+                                Matrix<int>& indices, Matrix<double>& dists, size_t knn ) {
+    const size_t words = (cols + 7) / 8;
+    std::vector<vw::uint64> packed_data, packed_queries;
+    pack_words( data,    num_data,    cols, words, packed_data    );
+    pack_words( queries, num_queries, cols, words, packed_queries );
+    exhaustive_knn( packed_data.empty()    ? (vw::uint64 const*)0 : &packed_data[0],    num_data,
+                    packed_queries.empty() ? (vw::uint64 const*)0 : &packed_queries[0], num_queries,
+                    words, HammingKernel( words ), knn, indices, dists );
+  }
+
+}} // namespace vw::math
@@ -0,0 +1,86 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BruteForceKNN.h
+///
+/// Exact k-nearest-neighbor search by exhaustive comparison.
+///
+/// For a few thousand features building a FLANN index costs more than
+/// it saves, so these functions simply compare every query against
+/// every feature in cache-sized blocks. The results have the same
+/// layout as the batched FLANNTree::knn_search(): one row per query,
+/// holding min(knn, data.rows()) neighbors sorted by increasing
+/// distance, with ties going to the lower feature index.
+#ifndef __VW_MATH_BRUTE_FORCE_KNN_H__
+#define __VW_MATH_BRUTE_FORCE_KNN_H__
+
+#include <vw/Math/Matrix.h>
+
+namespace vw {
+namespace math {
+
+  /// Nearest neighbors in squared Euclidean distance, the same
+  /// distance FLANN reports for its L2 indices. Both inputs are packed
+  /// row-major arrays with 'cols' elements per row.
+  void brute_force_knn_l2( float  const* data, size_t num_data,
+                           float  const* queries, size_t num_queries, size_t cols,
+                           Matrix<int>& indices, Matrix<double>& dists, size_t knn );
+  void brute_force_knn_l2( double const* data, size_t num_data,
+                           double const* queries, size_t num_queries, size_t cols,
+                           Matrix<int>& indices, Matrix<double>& dists, size_t knn );
+
+  /// Nearest neighbors in Hamming distance, counting the differing
+  /// bits of the raw bytes of each row.
+  void brute_force_knn_hamming( unsigned char const* data, size_t num_data,
+                                unsigned char const* queries, size_t num_queries, size_t cols,
+                                Matrix<int>& indices, Matrix<double>& dists, size_t knn );
+
+  /// Pointer to the packed elements of a Matrix or MatrixProxy, or
+  /// null if it is empty.
+  template <class MatrixT>
+  inline typename MatrixT::value_type const* packed_data( MatrixT const& m ) {
+    return ( m.rows() && m.cols() ) ? &m(0,0) : 0;
+  }
+
+  /// Matrix versions of the above, for a Matrix or MatrixProxy of
+  /// features and of queries with the same element type.
+  template <class MatrixT1, class MatrixT2>
+  void brute_force_knn_l2( MatrixBase<MatrixT1> const& data, MatrixBase<MatrixT2> const& queries,
+                           Matrix<int>& indices, Matrix<double>& dists, size_t knn ) {
+    VW_ASSERT( queries.impl().rows() == 0 || data.impl().rows() == 0 ||
+               data.impl().cols() == queries.impl().cols(),
+               ArgumentErr() << "brute_force_knn: query and feature lengths differ." );
+    brute_force_knn_l2( packed_data(data.impl()), data.impl().rows(),
+                        packed_data(queries.impl()), queries.impl().rows(), data.impl().cols(),
+                        indices, dists, knn );
+  }
+
+  template <class MatrixT1, class MatrixT2>
+  void brute_force_knn_hamming( MatrixBase<MatrixT1> const& data, MatrixBase<MatrixT2> const& queries,
+                                Matrix<int>& indices, Matrix<double>& dists, size_t knn ) {
+    VW_ASSERT( queries.impl().rows() == 0 || data.impl().rows() == 0 ||
+               data.impl().cols() == queries.impl().cols(),
+               ArgumentErr() << "brute_force_knn: query and feature lengths differ." );
+    brute_force_knn_hamming( packed_data(data.impl()), data.impl().rows(),
+                             packed_data(queries.impl()), queries.impl().rows(), data.impl().cols(),
+                             indices, dists, knn );
+  }
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_BRUTE_FORCE_KNN_H__
@@ -69,11 +69,20 @@
 /// which may be buggy and certainly is underperforming Armijo
 /// for me at the moment.  I also provide a steepest_descent()
 /// method for comparison to conjugate_gradient().
+///
+/// For symmetric positive definite linear systems there is also
+/// preconditioned_conjugate_gradient(), which only needs the
+/// products A*x and inverse(M)*r, and an Eisenstat-Walker forcing
+/// term for choosing its tolerance when the linear system is one
+/// step of an inexact Newton method.
 
 #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
 #define __VW_MATH_CONJUGATEGRADIENT_H__
 
+#include <algorithm>
+
 #include <vw/Core/Log.h>
+#include <vw/Math/Vector.h>
 
 #define VW_CONJGRAD_MAX_ITERS_BETWEEN_SPACER_STEPS 20
 
@@ -240,6 +249,97 @@ namespace math{
     return pos;
   }
 
+
+  /// A preconditioner that does nothing.
+  struct IdentityPreconditioner {
+    void operator()( Vector<double> const& r, Vector<double>& z ) const { z = r; }
+  };
+
+  /// Solves A*x = b for symmetric positive definite A with the
+  /// preconditioned conjugate gradient method. A and M are functors
+  /// with a method
+  ///   void operator()( Vector<double> const& x, Vector<double>& y ) const;
+  /// that computes y = A*x and y = inverse(M)*x respectively, so
+  /// neither matrix has to be formed. x holds the initial guess.
+  ///
+  /// Iteration stops once |b - A*x| <= tolerance * |b|, or after
+  /// max_iterations. Returns the number of iterations taken.
+  template <class LinearOpT, class PrecondT>
+  int preconditioned_conjugate_gradient( LinearOpT const& A, PrecondT const& M,
+                                         Vector<double> const& b, Vector<double>& x,
+                                         double tolerance, int max_iterations ) {
+    if ( x.size() != b.size() )
+      x = Vector<double>( b.size() );
+    Vector<double> r( b.size() ), z( b.size() ), p, q( b.size() );
+    A( x, q );
+    r = b - q;
+
+    double threshold = tolerance * norm_2( b );
+    double residual = norm_2( r );
+    if ( residual <= threshold )
+      return 0;
+
+    M( r, z );
+    p = z;
+    double rz = dot_prod( r, z );
+    int iteration = 0;
+    while ( iteration < max_iterations ) {
+      A( p, q );
+      double pq = dot_prod( p, q );
+      if ( pq <= 0 ) {
+        VW_OUT(DebugMessage, "math") << "preconditioned_conjugate_gradient: matrix is not positive definite." << std::endl;
+        break;
+      }
+      double alpha = rz / pq;
+      x += alpha * p;
+      r -= alpha * q;
+      ++iteration;
+
+      residual = norm_2( r );
+      if ( residual <= threshold )
+        break;
+
+      M( r, z );
+      double rz_next = dot_prod( r, z );
+      p = z + ( rz_next / rz ) * p;
+      rz = rz_next;
+    }
+    VW_OUT(DebugMessage, "math") << "preconditioned_conjugate_gradient: " << iteration
+                                 << " iterations, relative residual "
+                                 << residual / norm_2( b ) << std::endl;
+    return iteration;
+  }
+
+  /// Forcing term for an inexact Newton method, choice 2 of Eisenstat
+  /// and Walker, "Choosing the forcing terms in an inexact Newton
+  /// method" (1996). Call it once per outer iteration with the norm of
+  /// that iteration's gradient; the result is the relative tolerance
+  /// to solve its linear system to. The tolerance tightens as the
+  /// gradient shrinks, so early steps are cheap and later ones
+  /// converge quickly.
+  class EisenstatWalkerForcing {
+    double m_eta, m_eta_max, m_gamma, m_alpha;
+    double m_last_norm;
+  public:
+    EisenstatWalkerForcing( double eta_max = 0.1, double gamma = 0.9, double alpha = 2 )
+      : m_eta(eta_max), m_eta_max(eta_max), m_gamma(gamma), m_alpha(alpha), m_last_norm(-1) {}
+
+    double operator()( double gradient_norm ) {
+      if ( m_last_norm > 0 ) {
+        double eta = m_gamma * pow( gradient_norm / m_last_norm, m_alpha );
+        // Safeguard against the tolerance dropping too quickly
+        double safeguard = m_gamma * pow( m_eta, m_alpha );
+        if ( safeguard > 0.1 && safeguard > eta )
+          eta = safeguard;
+        m_eta = std::min( eta, m_eta_max );
+      }
+      m_last_norm = gradient_norm;
+      return m_eta;
+    }
+
+    double eta() const { return m_eta; }
+  };
+
 } } // namespace vw::math
 
 #endif // #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
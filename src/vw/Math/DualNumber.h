@@ -0,0 +1,207 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Math/DualNumber.h
+///
+/// Dual numbers for forward mode automatic differentiation.
+///
+/// A DualNumber<N> carries a value together with its partial
+/// derivatives with respect to N variables. Code written as a
+/// template over its scalar type can be evaluated once with dual
+/// numbers to get the function value and its full gradient, exact to
+/// round off, instead of evaluating it N+1 times for finite
+/// differences:
+///
+///   DualNumber<2> x( 3.0, 0 ), y( 4.0, 1 );   // seed variables 0 and 1
+///   DualNumber<2> r = sqrt( x*x + y*y );
+///   r.value();          // 5
+///   r.derivative(0);    // 0.6 = x/r
+///   r.derivative(1);    // 0.8 = y/r
+///
+/// Comparisons only look at the value, so branches in the templated
+/// code follow the same path as they would for doubles.
+
+#ifndef __VW_MATH_DUALNUMBER_H__
+#define __VW_MATH_DUALNUMBER_H__
+
+#include <cmath>
+#include <ostream>
+
+#include <vw/Math/Vector.h>
+
+namespace vw {
+namespace math {
+
+  template <size_t N>
+  class DualNumber {
+    double m_value;
+    double m_derivative[N];
+
+  public:
+    /// A constant: all derivatives are zero.
+    DualNumber( double value = 0 ) : m_value(value) {
+      for ( size_t i = 0; i < N; ++i ) m_derivative[i] = 0;
+    }
+
+    /// The variable with the given index: its derivative with respect
+    /// to itself is one.
+    DualNumber( double value, size_t index ) : m_value(value) {
+      for ( size_t i = 0; i < N; ++i ) m_derivative[i] = 0;
+      m_derivative[index] = 1;
+    }
+
+    double  value() const { return m_value; }
+    double& value()       { return m_value; }
+    double  derivative( size_t i ) const { return m_derivative[i]; }
+    double& derivative( size_t i )       { return m_derivative[i]; }
+
+    Vector<double,N> gradient() const {
+      Vector<double,N> result;
+      for ( size_t i = 0; i < N; ++i ) result[i] = m_derivative[i];
+      return result;
+    }
+
+    // Chain rule for a function f applied to this number, given
+    // f(value) and f'(value).
+    DualNumber chain( double f, double df ) const {
+      DualNumber result( f );
+      for ( size_t i = 0; i < N; ++i ) result.m_derivative[i] = df * m_derivative[i];
+      return result;
+    }
+
+    DualNumber& operator+=( DualNumber const& x ) {
+      m_value += x.m_value;
+      for ( size_t i = 0; i < N; ++i ) m_derivative[i] += x.m_derivative[i];
+      return *this;
+    }
+    DualNumber& operator-=( DualNumber const& x ) {
+      m_value -= x.m_value;
+      for ( size_t i = 0; i < N; ++i ) m_derivative[i] -= x.m_derivative[i];
+      return *this;
+    }
+    DualNumber& operator*=( DualNumber const& x ) {
+      for ( size_t i = 0; i < N; ++i )
+        m_derivative[i] = m_derivative[i] * x.m_value + m_value * x.m_derivative[i];
+      m_value *= x.m_value;
+      return *this;
+    }
+    DualNumber& operator/=( DualNumber const& x ) {
+      double inverse = 1.0 / x.m_value;
+      m_value *= inverse;
+      for ( size_t i = 0; i < N; ++i )
+        m_derivative[i] = ( m_derivative[i] - m_value * x.m_derivative[i] ) * inverse;
+      return *this;
+    }
+
+    DualNumber& operator+=( double x ) { m_value += x; return *this; }
+    DualNumber& operator-=( double x ) { m_value -= x; return *this; }
+    DualNumber& operator*=( double x ) {
+      m_value *= x;
+      for ( size_t i = 0; i < N; ++i ) m_derivative[i] *= x;
+      return *this;
+    }
+    DualNumber& operator/=( double x ) { return *this *= 1.0 / x; }
+
+    DualNumber operator-() const { return chain( -m_value, -1 ); }
+    DualNumber operator+() const { return *this; }
+  };
+
+  // Arithmetic
+  template <size_t N> inline DualNumber<N> operator+( DualNumber<N> a, DualNumber<N> const& b ) { return a += b; }
+  template <size_t N> inline DualNumber<N> operator-( DualNumber<N> a, DualNumber<N> const& b ) { return a -= b; }
+  template <size_t N> inline DualNumber<N> operator*( DualNumber<N> a, DualNumber<N> const& b ) { return a *= b; }
+  template <size_t N> inline DualNumber<N> operator/( DualNumber<N> a, DualNumber<N> const& b ) { return a /= b; }
+
+  template <size_t N> inline DualNumber<N> operator+( DualNumber<N> a, double b ) { return a += b; }
+  template <size_t N> inline DualNumber<N> operator-( DualNumber<N> a, double b ) { return a -= b; }
+  template <size_t N> inline DualNumber<N> operator*( DualNumber<N> a, double b ) { return a *= b; }
+  template <size_t N> inline DualNumber<N> operator/( DualNumber<N> a, double b ) { return a /= b; }
+
+  template <size_t N> inline DualNumber<N> operator+( double a, DualNumber<N> b ) { return b += a; }
+  template <size_t N> inline DualNumber<N> operator-( double a, DualNumber<N> const& b ) { return (-b) += a; }
+  template <size_t N> inline DualNumber<N> operator*( double a, DualNumber<N> b ) { return b *= a; }
+  template <size_t N> inline DualNumber<N> operator/( double a, DualNumber<N> const& b ) {
+    return b.chain( a / b.value(), -a / ( b.value() * b.value() ) );
+  }
+
+  // Comparisons only look at the value
+  template <size_t N> inline bool operator< ( DualNumber<N> const& a, DualNumber<N> const& b ) { return a.value() <  b.value(); }
+  template <size_t N> inline bool operator> ( DualNumber<N> const& a, DualNumber<N> const& b ) { return a.value() >  b.value(); }
+  template <size_t N> inline bool operator<=( DualNumber<N> const& a, DualNumber<N> const& b ) { return a.value() <= b.value(); }
+  template <size_t N> inline bool operator>=( DualNumber<N> const& a, DualNumber<N> const& b ) { return a.value() >= b.value(); }
+  template <size_t N> inline bool operator< ( DualNumber<N> const& a, double b ) { return a.value() <  b; }
+  template <size_t N> inline bool operator> ( DualNumber<N> const& a, double b ) { return a.value() >  b; }
+  template <size_t N> inline bool operator<=( DualNumber<N> const& a, double b ) { return a.value() <= b; }
+  template <size_t N> inline bool operator>=( DualNumber<N> const& a, double b ) { return a.value() >= b; }
+
+  // Elementary functions
+  template <size_t N> inline DualNumber<N> sqrt( DualNumber<N> const& x ) {
+    double s = std::sqrt( x.value() );
+    return x.chain( s, 0.5 / s );
+  }
+  template <size_t N> inline DualNumber<N> sin( DualNumber<N> const& x ) {
+    return x.chain( std::sin( x.value() ), std::cos( x.value() ) );
+  }
+  template <size_t N> inline DualNumber<N> cos( DualNumber<N> const& x ) {
+    return x.chain( std::cos( x.value() ), -std::sin( x.value() ) );
+  }
+  template <size_t N> inline DualNumber<N> tan( DualNumber<N> const& x ) {
+    double t = std::tan( x.value() );
+    return x.chain( t, 1 + t*t );
+  }
+  template <size_t N> inline DualNumber<N> asin( DualNumber<N> const& x ) {
+    return x.chain( std::asin( x.value() ), 1 / std::sqrt( 1 - x.value()*x.value() ) );
+  }
+  template <size_t N> inline DualNumber<N> acos( DualNumber<N> const& x ) {
+    return x.chain( std::acos( x.value() ), -1 / std::sqrt( 1 - x.value()*x.value() ) );
+  }
+  template <size_t N> inline DualNumber<N> atan( DualNumber<N> const& x ) {
+    return x.chain( std::atan( x.value() ), 1 / ( 1 + x.value()*x.value() ) );
+  }
+  template <size_t N> inline DualNumber<N> atan2( DualNumber<N> const& y, DualNumber<N> const& x ) {
+    double d = x.value()*x.value() + y.value()*y.value();
+    DualNumber<N> result( std::atan2( y.value(), x.value() ) );
+    for ( size_t i = 0; i < N; ++i )
+      result.derivative(i) = ( x.value()*y.derivative(i) - y.value()*x.derivative(i) ) / d;
+    return result;
+  }
+  template <size_t N> inline DualNumber<N> exp( DualNumber<N> const& x ) {
+    double e = std::exp( x.value() );
+    return x.chain( e, e );
+  }
+  template <size_t N> inline DualNumber<N> log( DualNumber<N> const& x ) {
+    return x.chain( std::log( x.value() ), 1 / x.value() );
+  }
+  template <size_t N> inline DualNumber<N> pow( DualNumber<N> const& x, double p ) {
+    return x.chain( std::pow( x.value(), p ), p * std::pow( x.value(), p - 1 ) );
+  }
+  template <size_t N> inline DualNumber<N> fabs( DualNumber<N> const& x ) {
+    return x.value() < 0 ? -x : x;
+  }
+
+  template <size_t N>
+  inline std::ostream& operator<<( std::ostream& os, DualNumber<N> const& x ) {
+    os << x.value() << " [";
+    for ( size_t i = 0; i < N; ++i )
+      os << ( i ? "," : "" ) << x.derivative(i);
+    return os << "]";
+  }
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_DUALNUMBER_H__
@@ -16,9 +16,14 @@
 // __END_LICENSE__
 
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/FLANNTree.h>
 #include <flann/flann.hpp>
 
+#include <algorithm>
+#include <vector>
+
 namespace vw {
 namespace math {
 
@@ -55,6 +60,97 @@ namespace math {
 
 
 
+  // Searches one contiguous block of query rows.  FLANN only spreads a
+  // search over params.cores threads when it is built with OpenMP,
+  // which VW is not, so the blocks are run on the VW thread pool
+  // instead.  knnSearch() is const and each block writes its own rows.
+  template <class IndexT, class ElemT, class DistT>
+  class FLANNSearchTask : public Task {
+    IndexT const*        m_index;
+    flann::Matrix<ElemT> m_queries;
+    flann::Matrix<int  > m_indices;
+    flann::Matrix<DistT> m_dists;
+    size_t               m_knn;
+    flann::SearchParams  m_params;
+    TaskFailure&         m_failure;
+  public:
+    FLANNSearchTask( IndexT const* index, flann::Matrix<ElemT> const& queries,
+                     flann::Matrix<int> const& indices, flann::Matrix<DistT> const& dists,
+                     size_t knn, flann::SearchParams const& params, TaskFailure& failure ) :
+      m_index(index), m_queries(queries), m_indices(indices), m_dists(dists),
+      m_knn(knn), m_params(params), m_failure(failure) {}
+
+    void operator()() {
+      try {
+        m_index->knnSearch( m_queries, m_indices, m_dists, m_knn, m_params );
+      } catch ( ... ) {
+        m_failure.capture();
+      }
+    }
+  };
+
+  // Shared body of the batched searches.  Each query's results are
+  // written to its own row, so the output matrices are filled in place.
+  template <class IndexT, class ElemT, class DistT>
+  void batch_knn_search( IndexT const* index, size_t num_loaded,
+                         void* data_ptr, size_t rows, size_t cols,
+                         Matrix<int>& indices, Matrix<double>& dists,
+                         size_t knn, flann::SearchParams params, int num_threads ) {
+    // Constrain the number of results that we can return to the number of loaded objects
+    knn = std::min( knn, num_loaded );
+    indices.set_size( rows, knn );
+    dists.set_size  ( rows, knn );
+    if ( rows == 0 || knn == 0 )
+      return;
+
+    std::fill( indices.begin(), indices.end(), -1 );
+    std::vector<DistT> dist_buffer( rows * knn );
+    ElemT* query_ptr = (ElemT*)data_ptr;
+
+    // Don't start a thread for fewer than this many queries.
+    const size_t MIN_BLOCK_ROWS = 64;
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+    size_t num_blocks = std::max( size_t(1), std::min( size_t(num_threads), rows / MIN_BLOCK_ROWS ) );
+    params.cores = 1;
+
+    if ( num_blocks == 1 ) {
+      flann::Matrix<ElemT> query_mat ( query_ptr,       rows, cols );
+      flann::Matrix<int  > indice_mat( &indices(0,0),   rows, knn  );
+      flann::Matrix<DistT> dists_mat ( &dist_buffer[0], rows, knn  );
+      index->knnSearch( query_mat, indice_mat, dists_mat, knn, params );
+    } else {
+      std::vector<TaskFailure> failures( num_blocks );
+      {
+        FifoWorkQueue queue( num_blocks );
+        for ( size_t b = 0; b < num_blocks; ++b ) {
+          size_t begin = b * rows / num_blocks, end = (b + 1) * rows / num_blocks;
+          typedef FLANNSearchTask<IndexT, ElemT, DistT> task_type;
+          boost::shared_ptr<task_type>
+            task( new task_type( index,
+                                 flann::Matrix<ElemT>( query_ptr + begin * cols,  end - begin, cols ),
+                                 flann::Matrix<int  >( &indices(begin,0),         end - begin, knn  ),
+                                 flann::Matrix<DistT>( &dist_buffer[begin * knn], end - begin, knn  ),
+                                 knn, params, failures[b] ) );
+          queue.add_task( task );
+        }
+        queue.join_all();
+      }
+      for ( size_t b = 0; b < num_blocks; ++b )
+        if ( failures[b].failed() )
+          failures[b].rethrow();
+    }
+
+    for ( size_t r = 0; r < rows; ++r ) {
+      for ( size_t k = 0; k < knn; ++k ) {
+        if ( indices(r,k) < 0 || indices(r,k) >= static_cast<int>(num_loaded) )
+          indices(r,k) = -1;
+        dists(r,k) = static_cast<double>( dist_buffer[r * knn + k] );
+      }
+    }
+  }
+
+
 //============================================================================
 
 
@@ -96,6 +192,19 @@ namespace math {
   }
 
 
+  template <>
+  void FLANNTree<float>::knn_search_batch_help( void* data_ptr, size_t rows, size_t cols,
+                                                Matrix<int>& indices,
+                                                Matrix<double>& dists,
+                                                size_t knn, int num_threads ) {
+    if (m_dist_type != FLANN_DistType_L2)
+      vw_throw( IOErr() << "FLANNTree: Illegal distance type passed in." );
+    batch_knn_search<flann::Index<flann::L2<float> >, float, float>
+      ( cast_index_ptr_L2_f(this->m_index_ptr), m_num_features_loaded, data_ptr, rows, cols,
+        indices, dists, knn, flann::SearchParams(128), num_threads );
+  }
+
+
   template <>
   void FLANNTree<float>::construct_index( void* data_ptr, size_t rows, size_t cols ) {
     if ( m_index_ptr != NULL )
@@ -175,6 +284,19 @@ template <>
   }
 
 
+  template <>
+  void FLANNTree<double>::knn_search_batch_help( void* data_ptr, size_t rows, size_t cols,
+                                                 Matrix<int>& indices,
+                                                 Matrix<double>& dists,
+                                                 size_t knn, int num_threads ) {
+    if (m_dist_type != FLANN_DistType_L2)
+      vw_throw( IOErr() << "FLANNTree: Illegal distance type passed in." );
+    batch_knn_search<flann::Index<flann::L2<double> >, double, double>
+      ( cast_index_ptr_L2_d(this->m_index_ptr), m_num_features_loaded, data_ptr, rows, cols,
+        indices, dists, knn, flann::SearchParams(128), num_threads );
+  }
+
+
   template <>
   void FLANNTree<double>::construct_index( void* data_ptr, size_t rows, size_t cols ) {
     if ( m_index_ptr != NULL )
@@ -262,6 +384,21 @@ template <>
   }
 
 
+  template <>
+  void FLANNTree<unsigned char>::knn_search_batch_help( void* data_ptr, size_t rows, size_t cols,
+                                                        Matrix<int>& indices,
+                                                        Matrix<double>& dists,
+                                                        size_t knn, int num_threads ) {
+    if (m_dist_type != FLANN_DistType_Hamming)
+      vw_throw( IOErr() << "FLANNTree: Illegal distance type passed in." );
+    flann::SearchParams params;
+    params.checks = 256; // Search more leaves
+    batch_knn_search<flann::Index<flann::Hamming<unsigned char> >, unsigned char, unsigned int>
+      ( cast_index_ptr_HAMM_u(this->m_index_ptr), m_num_features_loaded, data_ptr, rows, cols,
+        indices, dists, knn, params, num_threads );
+  }
+
+
   template <>
   void FLANNTree<unsigned char>::construct_index( void* data_ptr, size_t rows, size_t cols ) {
     if ( m_index_ptr != NULL )
@@ -56,9 +56,33 @@ namespace math {
                             Vector<double>& dists,    // Distance of each result
                             size_t knn );             // Number of results to return
 
+    /// Batched version of knn_search_help() with one row of results per query row.
+    void knn_search_batch_help( void* data_ptr, size_t rows, size_t cols,
+                                Matrix<int   >& indices,
+                                Matrix<double>& dists,
+                                size_t knn, int num_threads );
+
     /// Make a FLANN index wrapping a matrix of feature data
     void construct_index( void* data_ptr, size_t rows, size_t cols );
 
+    /// Returns the packed elements of the queries, or NULL if there
+    /// are none, copying them into buffer only if they are not already
+    /// packed elements of type T.
+    static T const* query_data( Matrix<T> const& queries, Matrix<T>& /*buffer*/ ) {
+      return queries.rows() ? queries.data() : NULL;
+    }
+    static T const* query_data( MatrixProxy<T> const& queries, Matrix<T>& /*buffer*/ ) {
+      return queries.rows() ? queries.data() : NULL;
+    }
+    static T const* query_data( MatrixProxy<const T> const& queries, Matrix<T>& /*buffer*/ ) {
+      return queries.rows() ? queries.data() : NULL;
+    }
+    template <class MatrixT>
+    static T const* query_data( MatrixT const& queries, Matrix<T>& buffer ) {
+      buffer = queries;
+      return buffer.rows() ? buffer.data() : NULL;
+    }
+
   public: // Functions
 
     /// Simple constructor.  Call load_match_data() before calling knn_search()!
@@ -122,6 +146,24 @@ namespace math {
       return num_found;
     }
 
+    /// Batched query access, one query per row of the input matrix.
+    /// - Row i of indices and dists holds the results for query row i.
+    /// - Results that do not point at a loaded feature are set to -1.
+    /// - The queries are split between num_threads threads, or between
+    ///   the default number of VW threads if num_threads is zero.
+    /// - A Matrix<T> or MatrixProxy<T> of queries is searched in place rather than copied.
+    template <class MatrixT>
+    void knn_search( MatrixBase<MatrixT> const& queries, // Values we are looking for
+                     Matrix<int   >& indices,            // Indices of each query's results
+                     Matrix<double>& dists,              // Distances of each query's results
+                     size_t knn,                         // Number of results per query
+                     int num_threads = 0 ) {
+      Matrix<T> query_cast;
+      T const* query = query_data( queries.impl(), query_cast );
+      knn_search_batch_help( (void*)query, queries.impl().rows(), queries.impl().cols(),
+                             indices, dists, knn, num_threads );
+    }
+
     size_t size1() const;
     size_t size2() const;
 
@@ -162,6 +162,15 @@ namespace math {
     return MatrixNoTmp<MatrixT>( val.impl() );
   }
 
+  /// This helper class allows overriding the basic matrix assignment
+  /// operations in specific cases for efficiency, using template specialization.
+  template <class DstMatT, class SrcMatT>
+  struct MatrixAssignImpl {
+    static void assign( DstMatT& dst, SrcMatT const& src ) {
+      std::copy( src.begin(), src.end(), dst.begin() );
+    }
+  };
+
 
   // *******************************************************************
   // class IndexingMatrixIterator<MatrixT>
@@ -345,7 +354,7 @@ namespace math {
     template <class T>
     Matrix( MatrixBase<T> const& m ) {
       VW_ASSERT( m.impl().rows()==RowsN && m.impl().cols()==ColsN, ArgumentErr() << "Matrix must have dimensions " << RowsN << "x" << ColsN << "." );
-      std::copy( m.impl().begin(), m.impl().end(), begin() );
+      MatrixAssignImpl<Matrix,T>::assign(*this,m.impl());
     }
 
     /// Standard copy assignment operator.
@@ -369,7 +378,7 @@ namespace math {
     template <class T>
     Matrix& operator=( MatrixNoTmp<T> const& m ) {
       VW_ASSERT( m.impl().rows()==RowsN && m.impl().cols()==ColsN, ArgumentErr() << "Matrix must have dimensions " << RowsN << "x" << ColsN << "." );
-      std::copy( m.impl().begin(), m.impl().end(), begin() );
+      MatrixAssignImpl<Matrix,T>::assign(*this,m.impl());
       return *this;
     }
 
@@ -462,7 +471,9 @@ namespace math {
     /// Generalized copy constructor, from arbitrary VW matrix expressions.
     template <class T>
     Matrix( MatrixBase<T> const& m )
-      : core_(m.impl().begin(),m.impl().end()), m_rows(m.impl().rows()), m_cols(m.impl().cols()) {}
+      : core_(m.impl().rows()*m.impl().cols()), m_rows(m.impl().rows()), m_cols(m.impl().cols()) {
+      MatrixAssignImpl<Matrix,T>::assign(*this,m.impl());
+    }
 
     /// Standard copy assignment operator.
     Matrix& operator=( Matrix const& m ) {
@@ -488,7 +499,7 @@ namespace math {
     template <class T>
     Matrix& operator=( MatrixNoTmp<T> const& m ) {
       if( m.impl().rows()==rows() && m.impl().cols()==cols() ) {
-        std::copy( m.impl().begin(), m.impl().end(), begin() );
+        MatrixAssignImpl<Matrix,T>::assign(*this,m.impl());
         return *this;
       }
       else return *this = m.impl();
@@ -1872,9 +1883,18 @@ namespace math {
       return (TransposeN)?(m_matrix.cols()):(m_matrix.rows());
     }
 
+    // The matrix is always held as a packed row-major matrix, so the
+    // dot product runs straight over its memory with a constant
+    // stride rather than through a row or column view.
     reference_type operator()( size_t i ) const {
-      if( TransposeN ) return dot_prod( select_col(m_matrix,i), m_vector );
-      else return dot_prod( select_row(m_matrix,i), m_vector );
+      const size_t n = m_vector.size();
+      value_type result = value_type();
+      if ( n == 0 ) return result;
+      const size_t stride = (TransposeN)?(m_matrix.cols()):(1);
+      typename MatrixT::value_type const* a = m_matrix.data() + ((TransposeN)?(i):(i*m_matrix.cols()));
+      for ( size_t k = 0; k < n; ++k )
+        result += a[k*stride] * m_vector(k);
+      return result;
     }
 
     class iterator : public boost::iterator_facade<iterator, value_type, boost::random_access_traversal_tag, value_type> {
@@ -1965,6 +1985,41 @@ namespace math {
 
     iterator begin() const { return iterator(*this,0,     0); }
     iterator end  () const { return iterator(*this,rows(),0); }
+
+    /// Writes the whole product into a dense matrix. Both operands
+    /// are held as packed row-major matrices, so this runs directly
+    /// over their memory instead of going through the row and column
+    /// views element by element. For fixed-size operands all the
+    /// loop bounds and strides are compile-time constants, which lets
+    /// the compiler unroll the small cases completely.
+    template <class DstMatT>
+    void evaluate( DstMatT& dst ) const {
+      const size_t n_rows = rows(), n_cols = cols();
+      const size_t n_inner = (Transpose1N)?(m_matrix1.rows()):(m_matrix1.cols());
+      const size_t stride1 = m_matrix1.cols(), stride2 = m_matrix2.cols();
+      if ( n_inner == 0 ) {
+        std::fill( dst.begin(), dst.end(), value_type() );
+        return;
+      }
+      typename Matrix1T::value_type const* a = m_matrix1.data();
+      typename Matrix2T::value_type const* b = m_matrix2.data();
+      for ( size_t i = 0; i < n_rows; ++i ) {
+        for ( size_t j = 0; j < n_cols; ++j ) {
+          value_type result = value_type();
+          for ( size_t k = 0; k < n_inner; ++k )
+            result += a[ (Transpose1N)?(k*stride1+i):(i*stride1+k) ] *
+                      b[ (Transpose2N)?(j*stride2+k):(k*stride2+j) ];
+          dst(i,j) = result;
+        }
+      }
+    }
+  };
+
+  template <class DstMatT, class Matrix1T, class Matrix2T, bool Transpose1N, bool Transpose2N>
+  struct MatrixAssignImpl<DstMatT, MatrixMatrixProduct<Matrix1T,Matrix2T,Transpose1N,Transpose2N> > {
+    static void assign( DstMatT& dst, MatrixMatrixProduct<Matrix1T,Matrix2T,Transpose1N,Transpose2N> const& src ) {
+      src.evaluate( dst );
+    }
   };
 
   /// Product of two matrices.
@@ -1974,6 +2029,28 @@ namespace math {
     return MatrixMatrixProduct<Matrix1T,Matrix2T,false,false>( m1.impl(), m2.impl() );
   }
 
+  /// Product of a transposed matrix and a matrix.  The transpose is
+  /// folded into the product rather than evaluated into a temporary.
+  template <class Matrix1T, class Matrix2T>
+  MatrixMatrixProduct<Matrix1T,Matrix2T,true,false>
+  inline operator*( MatrixTranspose<Matrix1T> const& m1, MatrixBase<Matrix2T> const& m2 ) {
+    return MatrixMatrixProduct<Matrix1T,Matrix2T,true,false>( m1.child(), m2.impl() );
+  }
+
+  /// Product of a matrix and a transposed matrix.
+  template <class Matrix1T, class Matrix2T>
+  MatrixMatrixProduct<Matrix1T,Matrix2T,false,true>
+  inline operator*( MatrixBase<Matrix1T> const& m1, MatrixTranspose<Matrix2T> const& m2 ) {
+    return MatrixMatrixProduct<Matrix1T,Matrix2T,false,true>( m1.impl(), m2.child() );
+  }
+
+  /// Product of two transposed matrices.
+  template <class Matrix1T, class Matrix2T>
+  MatrixMatrixProduct<Matrix1T,Matrix2T,true,true>
+  inline operator*( MatrixTranspose<Matrix1T> const& m1, MatrixTranspose<Matrix2T> const& m2 ) {
+    return MatrixMatrixProduct<Matrix1T,Matrix2T,true,true>( m1.child(), m2.child() );
+  }
+
 
   // *******************************************************************
   // Convenience functions for returning a pre-made identity matrix in
@@ -2144,6 +2221,115 @@ namespace math {
     return inverse;
   }
 
+  /// \cond INTERNAL
+  // Inverse of a fixed-size square matrix, entirely on the stack. The
+  // general case is the same LU decomposition with partial pivoting
+  // as inverse() above; 2x2 and 3x3 matrices use the closed form.
+  template <class ElemT, size_t DimN>
+  struct MatrixInverseImpl {
+    static Matrix<ElemT,DimN,DimN> inverse( Matrix<ElemT,DimN,DimN> const& m ) {
+      ElemT zero = ElemT();
+      Matrix<ElemT,DimN,DimN> buf = m;
+
+      // Initialize the permutation
+      size_t pm[DimN];
+      for ( size_t i=0; i<DimN; ++i ) pm[i] = i;
+
+      // Perform LU decomposition with partial pivoting
+      for ( size_t i=0; i<DimN; ++i ) {
+        size_t i_norm_inf = i;
+        for ( size_t k=i+1; k<DimN; ++k )
+          if ( std::abs(buf(k,i)) > std::abs(buf(i_norm_inf,i)) ) i_norm_inf = k;
+        if ( buf(i_norm_inf,i) == zero )
+          vw_throw( MathErr() << "Matrix is singular in inverse()" );
+        if ( i_norm_inf != i ) {
+          std::swap( pm[i], pm[i_norm_inf] );
+          for ( size_t c=0; c<DimN; ++c ) std::swap( buf(i,c), buf(i_norm_inf,c) );
+        }
+        for ( size_t k=i+1; k<DimN; ++k ) {
+          buf(k,i) /= buf(i,i);
+          for ( size_t c=i+1; c<DimN; ++c )
+            buf(k,c) -= buf(k,i) * buf(i,c);
+        }
+      }
+
+      // Build up a permuted identity matrix
+      Matrix<ElemT,DimN,DimN> inverse;
+      for ( size_t i=0; i<DimN; ++i )
+        inverse(i,pm[i]) = ElemT(1);
+
+      // Divide by the lower-triangular term
+      for ( size_t i=0; i<DimN; ++i ) {
+        for ( size_t j=0; j<DimN; ++j ) {
+          ElemT t = inverse(i,j);
+          if ( t != zero ) {
+            for ( size_t k=i+1; k<DimN; ++k )
+              inverse(k,j) -= buf(k,i) * t;
+          }
+        }
+      }
+
+      // Divide by the upper-triangular term
+      for ( ssize_t i=DimN-1; i>=0; --i ) {
+        for ( ssize_t j=DimN-1; j>=0; --j ) {
+          ElemT t = inverse(i,j) /= buf(i,i);
+          if ( t != zero ) {
+            for ( ssize_t k=i-1; k>=0; --k )
+              inverse(k,j) -= buf(k,i) * t;
+          }
+        }
+      }
+
+      return inverse;
+    }
+  };
+
+  template <class ElemT>
+  struct MatrixInverseImpl<ElemT,1> {
+    static Matrix<ElemT,1,1> inverse( Matrix<ElemT,1,1> const& m ) {
+      if ( m(0,0) == ElemT() )
+        vw_throw( MathErr() << "Matrix is singular in inverse()" );
+      return Matrix<ElemT,1,1>( ElemT(1) / m(0,0) );
+    }
+  };
+
+  template <class ElemT>
+  struct MatrixInverseImpl<ElemT,2> {
+    static Matrix<ElemT,2,2> inverse( Matrix<ElemT,2,2> const& m ) {
+      ElemT det = m(0,0)*m(1,1) - m(0,1)*m(1,0);
+      if ( det == ElemT() )
+        vw_throw( MathErr() << "Matrix is singular in inverse()" );
+      return Matrix<ElemT,2,2>(  m(1,1)/det, -m(0,1)/det,
+                                -m(1,0)/det,  m(0,0)/det );
+    }
+  };
+
+  template <class ElemT>
+  struct MatrixInverseImpl<ElemT,3> {
+    static Matrix<ElemT,3,3> inverse( Matrix<ElemT,3,3> const& m ) {
+      // Cofactors of the first row give the determinant
+      ElemT c00 = m(1,1)*m(2,2) - m(1,2)*m(2,1);
+      ElemT c01 = m(1,2)*m(2,0) - m(1,0)*m(2,2);
+      ElemT c02 = m(1,0)*m(2,1) - m(1,1)*m(2,0);
+      ElemT det = m(0,0)*c00 + m(0,1)*c01 + m(0,2)*c02;
+      if ( det == ElemT() )
+        vw_throw( MathErr() << "Matrix is singular in inverse()" );
+      return Matrix<ElemT,3,3>( c00/det, (m(0,2)*m(2,1) - m(0,1)*m(2,2))/det, (m(0,1)*m(1,2) - m(0,2)*m(1,1))/det,
+                                c01/det, (m(0,0)*m(2,2) - m(0,2)*m(2,0))/det, (m(0,2)*m(1,0) - m(0,0)*m(1,2))/det,
+                                c02/det, (m(0,1)*m(2,0) - m(0,0)*m(2,1))/det, (m(0,0)*m(1,1) - m(0,1)*m(1,0))/det );
+    }
+  };
+  /// \endcond
+
+  /// Matrix inversion for fixed-size square matrices. Unlike the
+  /// general inverse() this returns a fixed-size matrix and never
+  /// touches the heap.
+  template <class ElemT, size_t DimN>
+  inline typename boost::disable_if_c< DimN==0, Matrix<ElemT,DimN,DimN> >::type
+  inverse( Matrix<ElemT,DimN,DimN> const& m ) {
+    return MatrixInverseImpl<ElemT,DimN>::inverse( m );
+  }
+
 
 } // namespace math
 
@@ -50,12 +50,28 @@
 ///    set of points, this routine could compute the 2-norm of the
 ///    error: || p2 - H * p1 ||
 ///
+/// Hypotheses are evaluated in parallel batches, and by default the
+/// search stops once enough hypotheses have been drawn to find an
+/// outlier free sample with 99% confidence. Progressive sampling, as
+/// in PROSAC, can be enabled when the data is sorted by match quality:
+///
+/// Chum, Ondrej and Matas, Jiri. "Matching with PROSAC - Progressive
+/// Sample Consensus" (2005)
+///
 
 #ifndef __VW_MATH_RANSAC_H__
 #define __VW_MATH_RANSAC_H__
 
 #include <vw/Math/Vector.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
 
 namespace vw {
 namespace math {
@@ -104,7 +120,36 @@ namespace math {
   /// points using RANSAC.
   typedef HomogeneousL2NormErrorMetric<2> InterestPointErrorMetric;
 
+  /// \cond INTERNAL
+  /// Counter based random number generator (SplitMix64). Each RANSAC
+  /// hypothesis seeds its own generator from the run seed and its
+  /// index, so samples don't depend on which thread draws them.
+  class RANSACRandom {
+    uint64 m_state;
+  public:
+    RANSACRandom(uint64 seed, uint64 stream)
+      : m_state(seed ^ (stream * 0xD1B54A32D192ED03ULL)) {}
+
+    uint64 operator()() {
+      uint64 z = (m_state += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+    }
+
+    /// Uniform integer in [0, size)
+    int operator()(int size) {
+      return int( (*this)() % uint64(size) );
+    }
+  };
+  /// \endcond
+
   /// RANSAC Driver class
+  ///
+  /// With more than one thread the fitting and error functors are
+  /// called concurrently, so their const operator() must be thread
+  /// safe. Hypotheses are drawn and ranked in the same order whatever
+  /// the number of threads, so the result only depends on the seed.
   template <class FittingFuncT, class ErrorFuncT>
   class RandomSampleConsensus {
     const FittingFuncT& m_fitting_func;
@@ -113,26 +158,36 @@ namespace math {
           double        m_inlier_threshold;
           int           m_min_num_output_inliers;
           bool          m_reduce_min_num_output_inliers_if_no_fit;
-    
+          int           m_num_threads;
+          double        m_confidence;
+          bool          m_progressive_sampling;
+          bool          m_have_seed;
+          uint64        m_seed;
+
+    typedef typename FittingFuncT::result_type result_type;
+
+    /// Number of hypotheses evaluated between termination checks.
+    static const int BATCH_SIZE = 64;
+
     /// \cond INTERNAL
-    // Utility Function: Pick N UNIQUE, random integers in the range [0, size]
-    inline void get_n_unique_integers(int size, std::vector<int> & samples) const {
-
-      // Note: We do not modify the initial random seed. As such, if
-      // a program uses RANSAC, repeatedly running this program will
-      // always return the same results. However, if that program
-      // calls RANSAC twice while within the same instance of the
-      // program, the second time the result of RANSAC will be
-      // different, since we keep on pulling new random numbers.
-        
+    struct Hypothesis {
+      bool        valid;
+      result_type H;
+      int         num_inliers;
+      double      error;
+      TaskFailure failure; // Exception thrown by a functor
+    };
+
+    // Pick samples.size() unique random integers in the range [0, size)
+    inline void get_n_unique_integers(int size, std::vector<int> & samples,
+                                      RANSACRandom & random) const {
       int n = samples.size();
       VW_ASSERT(size >= n, ArgumentErr() << "Not enough samples (" << n << " / " << size << ")\n");
 
-      const double divisor = static_cast<double>(RAND_MAX) + 1.0;
       for (int i = 0; i < n; ++i) {
         bool done = false;
         while (!done) {
-          samples[i] = static_cast<int>( (static_cast<double>(std::rand()) / divisor) * size );
+          samples[i] = random(size);
           done = true;
           for (int j = 0; j < i; j++)
             if (samples[i] == samples[j])
@@ -140,6 +195,151 @@ namespace math {
         }
       }
     }
+
+    // PROSAC growth function: hypothesis t is drawn from the best
+    // pool_size[t] points. The pool grows from the minimal sample to
+    // all the data over the course of m_num_iterations hypotheses.
+    std::vector<int> progressive_pool_sizes(int num_data, int sample_size) const {
+      std::vector<int> pool_size(m_num_iterations, num_data);
+      if (!m_progressive_sampling || num_data == sample_size)
+        return pool_size;
+
+      // Expected number of samples, out of m_num_iterations, drawn
+      // only from the top n points.
+      double t_n = m_num_iterations;
+      for (int i = 0; i < sample_size; ++i)
+        t_n *= double(sample_size - i) / double(num_data - i);
+
+      int n = sample_size;
+      double t_prime = 1;
+      for (int t = 0; t < m_num_iterations; ++t) {
+        while (t + 1 > t_prime && n < num_data) {
+          double t_next = t_n * (n + 1) / double(n + 1 - sample_size);
+          t_prime += std::ceil(t_next - t_n);
+          t_n = t_next;
+          ++n;
+        }
+        pool_size[t] = n;
+      }
+      return pool_size;
+    }
+
+    // Draw, fit and score hypothesis number 'index'.
+    template <class ContainerT1, class ContainerT2>
+    void evaluate_hypothesis(std::vector<ContainerT1> const& p1,
+                             std::vector<ContainerT2> const& p2,
+                             std::vector<int>         const& order,
+                             int sample_size, int pool_size,
+                             uint64 seed, int index,
+                             Hypothesis & result) const {
+      result.valid = false;
+      result.failure.clear();
+      try {
+        // 0. Get sample_size points at random, taking care not to
+        //    select the same point twice. A progressive sample always
+        //    contains the newest point of its pool.
+        RANSACRandom random(seed, index);
+        std::vector<int> random_indices(sample_size);
+        if (pool_size < int(p1.size())) {
+          random_indices.resize(sample_size - 1);
+          get_n_unique_integers(pool_size - 1, random_indices, random);
+          random_indices.push_back(pool_size - 1);
+        } else {
+          get_n_unique_integers(pool_size, random_indices, random);
+        }
+
+        std::vector<ContainerT1> try1(sample_size);
+        std::vector<ContainerT2> try2(sample_size);
+        for (int i = 0; i < sample_size; ++i) {
+          try1[i] = p1[random_indices[i]];
+          try2[i] = p2[random_indices[i]];
+        }
+
+        // 1. Compute the fit using these samples.
+        result_type H = m_fitting_func(try1, try2);
+
+        // 2. Find all the inliers for this fit. The points are scored
+        //    in a random order, so that a hypothesis which can no
+        //    longer reach m_min_num_output_inliers is dropped after
+        //    seeing only a subset of the data.
+        const int max_outliers = int(p1.size()) - m_min_num_output_inliers;
+        int num_outliers = 0;
+        std::vector<int> inlier_index;
+        for (size_t k = 0; k < order.size(); ++k) {
+          const int i = order[k];
+          if (m_error_func(H, p1[i], p2[i]) < m_inlier_threshold) {
+            inlier_index.push_back(i);
+          } else if (++num_outliers > max_outliers) {
+            // 3. Skip this model if too few inliers.
+            return;
+          }
+        }
+        std::sort(inlier_index.begin(), inlier_index.end());
+        try1.resize(inlier_index.size());
+        try2.resize(inlier_index.size());
+        for (size_t i = 0; i < inlier_index.size(); ++i) {
+          try1[i] = p1[inlier_index[i]];
+          try2[i] = p2[inlier_index[i]];
+        }
+
+        // 4. Re-estimate the model using the inliers.
+        H = m_fitting_func(try1, try2, H);
+
+        // 5. Find the mean error for the inliers.
+        double err_val = 0.0;
+        for (size_t i = 0; i < try1.size(); i++)
+          err_val += m_error_func(H, try1[i], try2[i]);
+        err_val /= try1.size();
+
+        result.valid       = true;
+        result.H           = H;
+        result.num_inliers = try1.size();
+        result.error       = err_val;
+      } catch ( ... ) {
+        result.failure.capture();
+      }
+    }
+
+    // Evaluates a contiguous range of the hypotheses of a batch.
+    template <class ContainerT1, class ContainerT2>
+    class HypothesisTask : public Task {
+      RandomSampleConsensus    const& m_ransac;
+      std::vector<ContainerT1> const& m_p1;
+      std::vector<ContainerT2> const& m_p2;
+      std::vector<int>         const& m_order;
+      std::vector<int>         const& m_pool_size;
+      int m_sample_size, m_first, m_begin, m_end;
+      uint64 m_seed;
+      std::vector<Hypothesis>& m_results;
+    public:
+      HypothesisTask(RandomSampleConsensus const& ransac,
+                     std::vector<ContainerT1> const& p1, std::vector<ContainerT2> const& p2,
+                     std::vector<int> const& order, std::vector<int> const& pool_size,
+                     int sample_size, int first, int begin, int end, uint64 seed,
+                     std::vector<Hypothesis>& results)
+        : m_ransac(ransac), m_p1(p1), m_p2(p2), m_order(order), m_pool_size(pool_size),
+          m_sample_size(sample_size), m_first(first), m_begin(begin), m_end(end),
+          m_seed(seed), m_results(results) {}
+
+      void operator()() {
+        for (int k = m_begin; k < m_end; ++k)
+          m_ransac.evaluate_hypothesis(m_p1, m_p2, m_order, m_sample_size,
+                                       m_pool_size[m_first + k], m_seed,
+                                       m_first + k, m_results[k]);
+      }
+    };
+
+    // Total number of hypotheses needed to draw an outlier free sample
+    // with probability m_confidence, given the inlier ratio.
+    int adaptive_num_iterations(double inlier_ratio, int sample_size) const {
+      const double p_good = std::pow(inlier_ratio, sample_size);
+      if (p_good >= 1.0)
+        return 1;
+      if (p_good <= 0.0)
+        return m_num_iterations;
+      const double n = std::log(1.0 - m_confidence) / std::log(1.0 - p_good);
+      return n < m_num_iterations ? int(std::ceil(n)) : m_num_iterations;
+    }
     /// \endcond
 
   public:
@@ -191,7 +391,30 @@ namespace math {
       m_num_iterations(num_iterations), 
       m_inlier_threshold(inlier_threshold),
       m_min_num_output_inliers(min_num_output_inliers),
-      m_reduce_min_num_output_inliers_if_no_fit(reduce_min_num_output_inliers_if_no_fit){}
+      m_reduce_min_num_output_inliers_if_no_fit(reduce_min_num_output_inliers_if_no_fit),
+      m_num_threads(1), m_confidence(0.99), m_progressive_sampling(false),
+      m_have_seed(false), m_seed(0) {}
+
+    /// Number of threads evaluating hypotheses. The default is 1. Zero
+    /// uses the VW default number of threads. Only raise this when the
+    /// fitting and error functors are thread safe.
+    void set_num_threads(int num_threads) { m_num_threads = num_threads; }
+
+    /// Stop drawing hypotheses once an outlier free sample has been
+    /// drawn with this probability, judging by the best inlier ratio
+    /// found so far. num_iterations stays the upper bound. Zero always
+    /// runs all num_iterations hypotheses.
+    void set_confidence(double confidence) { m_confidence = confidence; }
+
+    /// Seed the sampler. Without a seed each run takes one from
+    /// std::rand(), so a program that does not seed std::rand() gets
+    /// the same results every time it is run.
+    void set_seed(uint64 seed) { m_have_seed = true; m_seed = seed; }
+
+    /// Draw samples progressively (PROSAC). The data must be sorted
+    /// by decreasing match quality: early hypotheses are drawn from
+    /// the best matches only and later ones from all of the data.
+    void set_progressive_sampling(bool progressive) { m_progressive_sampling = progressive; }
 
     /// As attempt_ransac but keep trying with smaller numbers of required inliers.
     template <class ContainerT1, class ContainerT2>
@@ -246,53 +469,65 @@ namespace math {
       VW_ASSERT( m_min_num_output_inliers >= min_elems_for_fit,
                  RANSACErr() << "RANSAC Error.  Number of requested inliers is less than min number of elements needed for fit. (" << m_min_num_output_inliers << "/" << min_elems_for_fit << ")\n");
 
-      typename FittingFuncT::result_type best_H;
-
-      std::vector<ContainerT1> try1;
-      std::vector<ContainerT2> try2;
-      std::vector<int> random_indices(min_elems_for_fit);
+      const int    num_data = p1.size();
+      const uint64 seed     = m_have_seed ? m_seed : uint64(std::rand());
+      const int    num_threads = m_num_threads > 0 ? m_num_threads
+                                                   : int(vw_settings().default_num_threads());
+
+      // Random order in which every hypothesis scores the data
+      std::vector<int> order(num_data);
+      RANSACRandom shuffle(seed, std::numeric_limits<uint64>::max());
+      for (int i = 0; i < num_data; ++i) {
+        int j = shuffle(i + 1);
+        order[i] = order[j];
+        order[j] = i;
+      }
+      const std::vector<int> pool_size = progressive_pool_sizes(num_data, min_elems_for_fit);
 
-      int num_inliers = 0;
+      typename FittingFuncT::result_type best_H;
+      int num_inliers = 0, max_inliers = 0;
       double min_err = std::numeric_limits<double>::max();
-      for (int iteration = 0; iteration < m_num_iterations; ++iteration) {
-
-        // 0. Get min_elems_for_fit points at random, taking care not
-        //    to select the same point twice.
-        get_n_unique_integers(p1.size(), random_indices);
-        // Resizing below is essential, as by now their size may have changed
-        try1.resize(min_elems_for_fit);
-        try2.resize(min_elems_for_fit);
-        for (int i = 0; i < min_elems_for_fit; ++i) {
-          try1[i] = p1[random_indices[i]];
-          try2[i] = p2[random_indices[i]];
-        }
-
-        // 1. Compute the fit using these samples.
-        typename FittingFuncT::result_type H = m_fitting_func(try1, try2);
-
-        // 2. Find all the inliers for this fit.
-        inliers(H, p1, p2, try1, try2);
-
-        // 3. Skip this model if too few inliers.
-        if ((int)try1.size() < m_min_num_output_inliers) 
-          continue;
 
-        // 4. Re-estimate the model using the inliers.
-        H = m_fitting_func(try1, try2, H);
-        
-        // 5. Find the mean error for the inliers.
-        double err_val = 0.0;
-        for (size_t i = 0; i < try1.size(); i++) 
-          err_val += m_error_func(H, try1[i], try2[i]);
-        err_val /= try1.size();
+      std::vector<Hypothesis> batch(BATCH_SIZE);
+      int num_hypotheses = m_num_iterations, evaluated = 0;
+      while (evaluated < num_hypotheses) {
+        const int count = std::min(int(BATCH_SIZE), num_hypotheses - evaluated);
+        const int num_tasks = std::min(num_threads, count);
+        if (num_tasks <= 1) {
+          for (int k = 0; k < count; ++k)
+            evaluate_hypothesis(p1, p2, order, min_elems_for_fit, pool_size[evaluated + k],
+                                seed, evaluated + k, batch[k]);
+        } else {
+          FifoWorkQueue queue(num_tasks);
+          for (int t = 0; t < num_tasks; ++t) {
+            typedef HypothesisTask<ContainerT1, ContainerT2> task_type;
+            boost::shared_ptr<task_type>
+              task(new task_type(*this, p1, p2, order, pool_size, min_elems_for_fit, evaluated,
+                                 t * count / num_tasks, (t + 1) * count / num_tasks, seed, batch));
+            queue.add_task(task);
+          }
+          queue.join_all();
+        }
 
-        // 6. Save this model if its error is lowest so far.
-        if (err_val < min_err){
-          min_err     = err_val;
-          best_H      = H;
-          num_inliers = try1.size();
+        // 6. Save the model with the lowest error, in hypothesis order.
+        for (int k = 0; k < count; ++k) {
+          Hypothesis const& h = batch[k];
+          if (h.failure.failed())
+            h.failure.rethrow();
+          if (!h.valid)
+            continue;
+          max_inliers = std::max(max_inliers, h.num_inliers);
+          if (h.error < min_err) {
+            min_err     = h.error;
+            best_H      = h.H;
+            num_inliers = h.num_inliers;
+          }
         }
+        evaluated += count;
 
+        if (m_confidence > 0 && max_inliers > 0)
+          num_hypotheses = adaptive_num_iterations(double(max_inliers) / num_data,
+                                                   min_elems_for_fit);
       }
 
       if (num_inliers < m_min_num_output_inliers) {
@@ -302,7 +537,8 @@ namespace math {
       // For debugging
       VW_OUT(InfoMessage, "interest_point") << "\nRANSAC Summary:"     << std::endl;
       VW_OUT(InfoMessage, "interest_point") << "\tFit = "              << best_H      << std::endl;
-      VW_OUT(InfoMessage, "interest_point") << "\tInliers / Total  = " << num_inliers << " / " << p1.size() << "\n\n";
+      VW_OUT(InfoMessage, "interest_point") << "\tInliers / Total  = " << num_inliers << " / " << p1.size() << "\n";
+      VW_OUT(InfoMessage, "interest_point") << "\tHypotheses       = " << evaluated   << " / " << m_num_iterations << "\n\n";
       
       return best_H;
     }
@@ -396,11 +396,20 @@ namespace math {
     }
   };
 
+  /// Plain old data is zeroed with memset. Other element types (dual
+  /// numbers, pixels, ...) are assigned a default constructed value.
   template <class ElemT, size_t N>
   struct VectorClearImpl<Vector<ElemT,N> > {
     static void clear( Vector<ElemT,N>& v ) {
+      clear( v, boost::is_pod<ElemT>() );
+    }
+  private:
+    static void clear( Vector<ElemT,N>& v, boost::true_type ) {
       std::memset( &v(0), 0, N*sizeof(ElemT) );
     }
+    static void clear( Vector<ElemT,N>& v, boost::false_type ) {
+      std::fill( v.begin(), v.end(), ElemT() );
+    }
   };
 
 
@@ -409,10 +418,23 @@ namespace math {
   // A dynamically-allocated arbitrary-dimension vector class.
   // *******************************************************************
 
+  /// Storage for dynamically-sized vectors.  Vectors of arithmetic
+  /// type keep up to six elements inline, so the many short vectors
+  /// (camera parameters, jacobian rows, ...) don't allocate.
+  template <class ElemT, bool InlineN = boost::is_arithmetic<ElemT>::value>
+  struct VectorStorage {
+    typedef VarArray<ElemT> type;
+  };
+
+  template <class ElemT>
+  struct VectorStorage<ElemT,true> {
+    typedef SmallVarArray<ElemT,6> type;
+  };
+
   /// An arbitrary-dimension mathematical vector class.
   template <class ElemT>
   class Vector<ElemT,0> : public VectorBase<Vector<ElemT> > {
-    typedef VarArray<ElemT> core_type;
+    typedef typename VectorStorage<ElemT>::type core_type;
     core_type core_;
   public:
     typedef ElemT value_type;
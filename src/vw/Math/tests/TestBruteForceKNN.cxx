@@ -0,0 +1,150 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <vw/Math/BruteForceKNN.h>
+
+#include <cstdlib>
+
+using namespace vw;
+using namespace vw::math;
+
+// Index of the nearest feature to query row i, found the slow way
+template <class T>
+int naive_nearest_l2( Matrix<T> const& data, Matrix<T> const& queries, size_t i ) {
+  int best = -1;
+  double best_dist = 0;
+  for (size_t j = 0; j < data.rows(); ++j) {
+    double dist = 0;
+    for (size_t k = 0; k < data.cols(); ++k)
+      dist += (double(queries(i,k)) - data(j,k)) * (double(queries(i,k)) - data(j,k));
+    if (best < 0 || dist < best_dist) {
+      best      = j;
+      best_dist = dist;
+    }
+  }
+  return best;
+}
+
+TEST(BruteForceKNN, L2) {
+  // More rows than one feature tile and a query count that leaves a partial group
+  const size_t num_data = 300, num_queries = 37, dim = 13;
+  Matrix<float> data(num_data, dim), queries(num_queries, dim);
+  srand(42);
+  for (size_t i = 0; i < num_data; ++i)
+    for (size_t k = 0; k < dim; ++k)
+      data(i,k) = float(rand() % 1000) / 10.0f;
+  for (size_t i = 0; i < num_queries; ++i)
+    for (size_t k = 0; k < dim; ++k)
+      queries(i,k) = float(rand() % 1000) / 10.0f;
+
+  Matrix<int   > indices;
+  Matrix<double> dists;
+  brute_force_knn_l2( data, queries, indices, dists, 3 );
+  ASSERT_EQ( num_queries, indices.rows() );
+  ASSERT_EQ( 3u,          indices.cols() );
+  ASSERT_EQ( num_queries, dists.rows()   );
+  for (size_t i = 0; i < num_queries; ++i) {
+    EXPECT_EQ( naive_nearest_l2( data, queries, i ), indices(i,0) );
+    EXPECT_LE( dists(i,0), dists(i,1) );
+    EXPECT_LE( dists(i,1), dists(i,2) );
+    double d = 0;
+    for (size_t k = 0; k < dim; ++k)
+      d += (queries(i,k) - data(indices(i,1),k)) * (queries(i,k) - data(indices(i,1),k));
+    EXPECT_NEAR( d, dists(i,1), 1e-2 );
+  }
+
+  // Every point is its own nearest neighbor
+  Matrix<double> data_d = data;
+  brute_force_knn_l2( data_d, data_d, indices, dists, 1 );
+  for (size_t i = 0; i < num_data; ++i) {
+    EXPECT_EQ( int(i), indices(i,0) );
+    EXPECT_EQ( 0.0,    dists(i,0)   );
+  }
+}
+
+TEST(BruteForceKNN, TiesAndBounds) {
+  // Four identical features tie, so the lower indices must win
+  Matrix<float> data(4, 2), query(1, 2);
+  for (size_t i = 0; i < 4; ++i) {
+    data(i,0) = 1; data(i,1) = 2;
+  }
+  Matrix<int   > indices;
+  Matrix<double> dists;
+  brute_force_knn_l2( data, query, indices, dists, 2 );
+  ASSERT_EQ( 2u, indices.cols() );
+  EXPECT_EQ( 0, indices(0,0) );
+  EXPECT_EQ( 1, indices(0,1) );
+  EXPECT_EQ( 5.0, dists(0,0) );
+
+  // Asking for more neighbors than there are features
+  brute_force_knn_l2( data, query, indices, dists, 10 );
+  EXPECT_EQ( 4u, indices.cols() );
+  EXPECT_EQ( 3,  indices(0,3) );
+
+  // No queries
+  brute_force_knn_l2( data, Matrix<float>(0, 2), indices, dists, 2 );
+  EXPECT_EQ( 0u, indices.rows() );
+
+  EXPECT_THROW( brute_force_knn_l2( data, Matrix<float>(1, 3), indices, dists, 2 ),
+                ArgumentErr );
+}
+
+TEST(BruteForceKNN, Hamming) {
+  // Descriptor length that is not a multiple of the 8 byte packing
+  const size_t num_data = 150, dim = 11;
+  Matrix<unsigned char> data(num_data, dim);
+  srand(7);
+  for (size_t i = 0; i < num_data; ++i)
+    for (size_t k = 0; k < dim; ++k)
+      data(i,k) = (unsigned char)(rand() % 256);
+
+  // Queries are features with a few bits flipped
+  Matrix<unsigned char> queries(3, dim);
+  for (size_t k = 0; k < dim; ++k) {
+    queries(0,k) = data(5,  k);
+    queries(1,k) = data(77, k);
+    queries(2,k) = data(149,k);
+  }
+  queries(0,0)  ^= 0x01;
+  queries(1,3)  ^= 0x81;
+  queries(2,10) ^= 0xF0;
+
+  Matrix<int   > indices;
+  Matrix<double> dists;
+  brute_force_knn_hamming( data, queries, indices, dists, 2 );
+  ASSERT_EQ( 3u, indices.rows() );
+  EXPECT_EQ( 5,   indices(0,0) );
+  EXPECT_EQ( 1.0, dists(0,0)   );
+  EXPECT_EQ( 77,  indices(1,0) );
+  EXPECT_EQ( 2.0, dists(1,0)   );
+  EXPECT_EQ( 149, indices(2,0) );
+  EXPECT_EQ( 4.0, dists(2,0)   );
+
+  // Check the second neighbor distance against a direct bit count
+  for (size_t i = 0; i < 3; ++i) {
+    int count = 0;
+    for (size_t k = 0; k < dim; ++k) {
+      unsigned char v = queries(i,k) ^ data(indices(i,1),k);
+      for (; v; v &= v-1)
+        ++count;
+    }
+    EXPECT_EQ( double(count), dists(i,1) );
+    EXPECT_LE( dists(i,0), dists(i,1) );
+  }
+}
@@ -18,7 +18,9 @@
 
 // TestConjugateGradient.h
 #include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
 #include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
 #include <vw/Math/ConjugateGradient.h>
 
 using namespace vw;
@@ -62,3 +64,64 @@ TEST( ConjugateGradient, ConjugateGradient ) {
   EXPECT_NEAR(result[0], 0.1962, 1e-3);
   EXPECT_NEAR(result[1], 0.4846, 1e-3);
 }
+
+struct MatrixOperator {
+  Matrix<double> const& m_A;
+  MatrixOperator( Matrix<double> const& A ) : m_A(A) {}
+  void operator()( Vector<double> const& x, Vector<double>& y ) const { y = m_A * x; }
+};
+
+struct JacobiPreconditioner {
+  Vector<double> m_inv_diagonal;
+  JacobiPreconditioner( Matrix<double> const& A ) : m_inv_diagonal(A.rows()) {
+    for ( size_t i = 0; i < A.rows(); i++ )
+      m_inv_diagonal[i] = 1.0 / A(i,i);
+  }
+  void operator()( Vector<double> const& r, Vector<double>& z ) const {
+    z = elem_prod( m_inv_diagonal, r );
+  }
+};
+
+TEST( ConjugateGradient, Preconditioned ) {
+  // A badly scaled symmetric positive definite matrix
+  const size_t n = 20;
+  Matrix<double> A(n,n);
+  Vector<double> x_true(n);
+  for ( size_t i = 0; i < n; i++ ) {
+    A(i,i) = 4.0 * (i+1) * (i+1);
+    if ( i > 0 ) {
+      A(i,i-1) = A(i-1,i) = double(i);
+    }
+    x_true[i] = sin( double(i) );
+  }
+  Vector<double> b = A * x_true;
+
+  Vector<double> x;
+  int iterations =
+    preconditioned_conjugate_gradient( MatrixOperator(A), IdentityPreconditioner(),
+                                       b, x, 1e-12, 100 );
+  EXPECT_LE( iterations, 2*int(n) );
+  EXPECT_VECTOR_NEAR( x, x_true, 1e-8 );
+
+  Vector<double> y;
+  int preconditioned_iterations =
+    preconditioned_conjugate_gradient( MatrixOperator(A), JacobiPreconditioner(A),
+                                       b, y, 1e-12, 100 );
+  EXPECT_VECTOR_NEAR( y, x_true, 1e-8 );
+  EXPECT_LT( preconditioned_iterations, iterations );
+
+  // A loose tolerance stops early
+  Vector<double> z;
+  preconditioned_conjugate_gradient( MatrixOperator(A), JacobiPreconditioner(A),
+                                     b, z, 1e-2, 100 );
+  EXPECT_LE( norm_2( b - A*z ), 1e-2 * norm_2(b) );
+}
+
+TEST( ConjugateGradient, EisenstatWalkerForcing ) {
+  EisenstatWalkerForcing forcing( 0.1 );
+  EXPECT_EQ( 0.1, forcing( 100 ) );
+  // A large reduction in the gradient tightens the tolerance
+  EXPECT_NEAR( 0.9 * 0.01 * 0.01, forcing( 1 ), 1e-12 );
+  // ... and it never loosens past eta_max
+  EXPECT_EQ( 0.1, forcing( 10 ) );
+}
@@ -0,0 +1,85 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+#include <vw/Math/DualNumber.h>
+
+using namespace vw;
+using namespace vw::math;
+
+typedef DualNumber<2> Dual2;
+
+// f(x,y) written once for both doubles and dual numbers
+template <class T>
+T test_function( T const& x, T const& y ) {
+  return sin( x*y ) + sqrt( x ) / ( 1 + y*y ) - 3.0*exp( x - y ) + atan2( y, x ) + log( x ) * pow( y, 3 );
+}
+
+TEST( DualNumber, Arithmetic ) {
+  Dual2 x( 3.0, 0 ), y( 4.0, 1 );
+  Dual2 r = sqrt( x*x + y*y );
+  EXPECT_DOUBLE_EQ( 5, r.value() );
+  EXPECT_DOUBLE_EQ( 0.6, r.derivative(0) );
+  EXPECT_DOUBLE_EQ( 0.8, r.derivative(1) );
+
+  Dual2 q = x / y;
+  EXPECT_DOUBLE_EQ( 0.75, q.value() );
+  EXPECT_DOUBLE_EQ( 0.25, q.derivative(0) );
+  EXPECT_DOUBLE_EQ( -3.0/16.0, q.derivative(1) );
+
+  Dual2 c = 2.0 / x - 1.0 + y * 2.0 - x;
+  EXPECT_DOUBLE_EQ( 2.0/3.0 - 1 + 8 - 3, c.value() );
+  EXPECT_DOUBLE_EQ( -2.0/9.0 - 1, c.derivative(0) );
+  EXPECT_DOUBLE_EQ( 2, c.derivative(1) );
+
+  // Constants have no derivatives
+  Dual2 k( 7.0 );
+  EXPECT_EQ( 0, k.derivative(0) );
+  EXPECT_EQ( 0, (k*k).derivative(1) );
+
+  // Comparisons use the value
+  EXPECT_TRUE( x < y );
+  EXPECT_TRUE( x > 2.0 );
+  EXPECT_DOUBLE_EQ( 3, fabs( -x ).value() );
+  EXPECT_DOUBLE_EQ( 1, fabs( -x ).derivative(0) );
+}
+
+TEST( DualNumber, MatchesFiniteDifferences ) {
+  double x0 = 1.3, y0 = 0.7;
+  Dual2 f = test_function( Dual2( x0, 0 ), Dual2( y0, 1 ) );
+  EXPECT_DOUBLE_EQ( test_function( x0, y0 ), f.value() );
+
+  // Central differences
+  double h = 1e-6;
+  double dfdx = ( test_function( x0 + h, y0 ) - test_function( x0 - h, y0 ) ) / ( 2*h );
+  double dfdy = ( test_function( x0, y0 + h ) - test_function( x0, y0 - h ) ) / ( 2*h );
+  EXPECT_NEAR( dfdx, f.derivative(0), 1e-7 );
+  EXPECT_NEAR( dfdy, f.derivative(1), 1e-7 );
+  EXPECT_VECTOR_NEAR( Vector2( dfdx, dfdy ), f.gradient(), 1e-7 );
+}
+
+TEST( DualNumber, Vector ) {
+  // Dual numbers can be stored and combined in VW vectors
+  Vector<Dual2,3> v( Dual2( 1.0, 0 ), Dual2( 2.0, 1 ), Dual2( 3.0 ) );
+  Vector<Dual2,3> w = v + v;
+  Dual2 d = dot_prod( v, w );
+  EXPECT_DOUBLE_EQ( 28, d.value() );
+  EXPECT_DOUBLE_EQ( 4, d.derivative(0) );
+  EXPECT_DOUBLE_EQ( 8, d.derivative(1) );
+}
@@ -57,3 +57,39 @@ TEST(FLANNTree, boundsLimiting) {
   }
 
 }
+
+// A batched search over several threads gives the same answers as
+// searching for one point at a time.
+TEST(FLANNTree, batchSearch) {
+
+  const int numPts = 200;
+  Matrix<float> locations(numPts, 2);
+  for (int i=0; i<numPts; ++i) {
+    locations(i, 0) = (i*37) % 101;
+    locations(i, 1) = 0.5*i;
+  }
+
+  math::FLANNTree<float> tree;
+  tree.load_match_data(locations, FLANN_DistType_L2);
+
+  Matrix<int>    batch_indices;
+  Matrix<double> batch_distance;
+  tree.knn_search(locations, batch_indices, batch_distance, 3, 2);
+  ASSERT_EQ(batch_indices.rows(), numPts);
+  ASSERT_EQ(batch_indices.cols(), 3);
+  ASSERT_EQ(batch_distance.rows(), numPts);
+
+  Vector<int>    indices;
+  Vector<double> distance;
+  for (int i=0; i<numPts; ++i) {
+    tree.knn_search(select_row(locations, i), indices, distance, 3);
+    EXPECT_EQ(batch_indices(i,0), i); // Every point is its own nearest neighbor
+    for (size_t k=0; k<3; ++k)
+      EXPECT_NEAR(batch_distance(i,k), distance[k], 1e-6);
+  }
+
+  // More neighbors than points are clamped just like the single search
+  tree.knn_search(submatrix(locations, 0, 0, 4, 2), batch_indices, batch_distance, 500);
+  EXPECT_EQ(batch_indices.rows(), 4);
+  EXPECT_EQ(batch_indices.cols(), numPts);
+}
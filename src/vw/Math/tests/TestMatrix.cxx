@@ -18,7 +18,9 @@
 
 // TestMatrix.h
 #include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
 #include <vw/Math/Matrix.h>
+#include <vw/Core/Stopwatch.h>
 
 using namespace vw;
 
@@ -468,6 +470,150 @@ TEST(Matrix, Inverse) {
   EXPECT_FLOAT_EQ(  -3.0f / -15.0f , i2(2,2) );
 }
 
+// A well conditioned test matrix with a pivot swap in its first column
+template <size_t DimN>
+Matrix<double,DimN,DimN> small_test_matrix() {
+  Matrix<double,DimN,DimN> m;
+  for ( size_t i = 0; i < DimN; ++i )
+    for ( size_t j = 0; j < DimN; ++j )
+      m(i,j) = ( i == j ) ? 4.0 + i : 1.0 / ( 1 + i + 2*j );
+  m(DimN-1,0) = 8;
+  return m;
+}
+
+template <size_t DimN>
+void check_fixed_inverse() {
+  Matrix<double,DimN,DimN> m = small_test_matrix<DimN>();
+  Matrix<double,DimN,DimN> fixed = inverse( m );
+  Matrix<double> generic = inverse( Matrix<double>( m ) );
+  EXPECT_MATRIX_NEAR( generic, fixed, 1e-12 );
+  EXPECT_MATRIX_NEAR( identity_matrix<DimN>(), Matrix<double>(m*fixed), 1e-12 );
+}
+
+TEST(Matrix, FixedInverse) {
+  check_fixed_inverse<1>();
+  check_fixed_inverse<2>();
+  check_fixed_inverse<3>();
+  check_fixed_inverse<4>();
+  check_fixed_inverse<5>();
+  check_fixed_inverse<6>();
+
+  EXPECT_THROW( inverse( Matrix2x2(1,2,2,4) ), MathErr );
+  EXPECT_THROW( inverse( Matrix3x3() ), MathErr );
+  EXPECT_THROW( inverse( Matrix4x4() ), MathErr );
+}
+
+TEST(Matrix, TransposedProducts) {
+  const double a_data[6] = { 1, 2, 3, 4, 5, 6 };
+  const double b_data[6] = { 2, -1, 0, 3, 1, -2 };
+  Matrix<double,2,3> a( a_data ), b( b_data );
+  Matrix<double,3,2> at = transpose(a), bt = transpose(b);
+
+  Matrix<double,3,3> r1 = transpose(a)*b;
+  EXPECT_MATRIX_NEAR( Matrix<double>(at*b), r1, 1e-15 );
+  Matrix<double,2,2> r2 = a*transpose(b);
+  EXPECT_MATRIX_NEAR( Matrix<double>(a*bt), r2, 1e-15 );
+  Matrix<double,3,3> r3 = transpose(a)*transpose(bt);
+  EXPECT_MATRIX_NEAR( Matrix<double>(at*b), r3, 1e-15 );
+
+  // Mixed fixed and dynamic operands, and a transposed vector product
+  Matrix<double> r4 = transpose(Matrix<double>(a))*b;
+  EXPECT_MATRIX_NEAR( r1, r4, 1e-15 );
+  Vector<double> r5 = transpose(a)*Vector2(1,-1);
+  EXPECT_VECTOR_NEAR( Vector3(-3,-3,-3), r5, 1e-15 );
+}
+
+// Compares the fixed-size kernels against the generic expression
+// evaluation. Run with --gtest_also_run_disabled_tests.
+TEST(Matrix, DISABLED_SmallMatrixBenchmark) {
+  const int iterations = 2000000;
+  Matrix<double,2,6> J;
+  for ( size_t i = 0; i < 12; ++i ) J.begin()[i] = 0.1 * (i+1);
+  Matrix<double,6,6> JtJ;
+  Matrix3x3 R = small_test_matrix<3>();
+  Matrix<double,6,6> M = small_test_matrix<6>();
+  double check = 0;
+  Stopwatch sw;
+
+  sw = Stopwatch(); sw.start();
+  for ( int i = 0; i < iterations; ++i ) {
+    J(0,0) += 1e-9;
+    JtJ = transpose(J)*J;
+    check += JtJ(0,0);
+  }
+  sw.stop();
+  vw_out() << "J^T*J (2x6) kernel:     " << sw.elapsed_seconds() << " s\n";
+
+  sw = Stopwatch(); sw.start();
+  for ( int i = 0; i < iterations; ++i ) {
+    J(0,0) += 1e-9;
+    Matrix<double> Jt = transpose(J);
+    math::MatrixMatrixProduct<Matrix<double>,Matrix<double,2,6>,false,false> product( Jt, J );
+    std::copy( product.begin(), product.end(), JtJ.begin() );
+    check += JtJ(0,0);
+  }
+  sw.stop();
+  vw_out() << "J^T*J (2x6) generic:    " << sw.elapsed_seconds() << " s\n";
+
+  sw = Stopwatch(); sw.start();
+  for ( int i = 0; i < iterations; ++i ) {
+    R(0,0) += 1e-9;
+    Matrix3x3 Ri = inverse(R);
+    check += Ri(0,0);
+  }
+  sw.stop();
+  vw_out() << "3x3 inverse fixed:      " << sw.elapsed_seconds() << " s\n";
+
+  sw = Stopwatch(); sw.start();
+  for ( int i = 0; i < iterations; ++i ) {
+    R(0,0) += 1e-9;
+    Matrix3x3 Ri = math::inverse( static_cast<MatrixBase<Matrix3x3> const&>(R) );
+    check += Ri(0,0);
+  }
+  sw.stop();
+  vw_out() << "3x3 inverse generic:    " << sw.elapsed_seconds() << " s\n";
+
+  sw = Stopwatch(); sw.start();
+  for ( int i = 0; i < iterations / 10; ++i ) {
+    M(0,0) += 1e-9;
+    Matrix<double,6,6> Mi = inverse(M);
+    check += Mi(0,0);
+  }
+  sw.stop();
+  vw_out() << "6x6 inverse fixed:      " << sw.elapsed_seconds() << " s\n";
+
+  sw = Stopwatch(); sw.start();
+  for ( int i = 0; i < iterations / 10; ++i ) {
+    M(0,0) += 1e-9;
+    Matrix<double,6,6> Mi = math::inverse( static_cast<MatrixBase<Matrix<double,6,6> > const&>(M) );
+    check += Mi(0,0);
+  }
+  sw.stop();
+  vw_out() << "6x6 inverse generic:    " << sw.elapsed_seconds() << " s\n";
+
+  sw = Stopwatch(); sw.start();
+  for ( int i = 0; i < iterations; ++i ) {
+    Vector<double> v(6);
+    v[0] = i;
+    Vector<double> w = v;
+    check += w[0];
+  }
+  sw.stop();
+  vw_out() << "Vector<double>(6) inline: " << sw.elapsed_seconds() << " s\n";
+
+  sw = Stopwatch(); sw.start();
+  for ( int i = 0; i < iterations; ++i ) {
+    VarArray<double> v(6);
+    v[0] = i;
+    VarArray<double> w = v;
+    check += w[0];
+  }
+  sw.stop();
+  vw_out() << "Vector<double>(6) heap:   " << sw.elapsed_seconds() << " s\n";
+
+  EXPECT_TRUE( check == check );
+}
+
 TEST(Matrix, IndexingIterator) {
   typedef Matrix2x2 Mat;
   typedef math::IndexingMatrixIterator<Mat> Iter;
@@ -0,0 +1,162 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/RANSAC.h>
+
+using namespace vw;
+using namespace vw::math;
+
+// Fits a translation between two point sets, counting the fits made.
+struct TranslationFittingFunctor {
+  typedef Vector2 result_type;
+  int* m_num_fits;
+
+  TranslationFittingFunctor(int* num_fits = 0) : m_num_fits(num_fits) {}
+
+  template <class ContainerT>
+  size_t min_elements_needed_for_fit(ContainerT const& /*example*/) const { return 2; }
+
+  template <class ContainerT>
+  Vector2 operator()(std::vector<ContainerT> const& p1,
+                     std::vector<ContainerT> const& p2,
+                     Vector2 const& /*seed_input*/ = Vector2()) const {
+    if (m_num_fits)
+      ++*m_num_fits;
+    Vector2 sum;
+    for (size_t i = 0; i < p1.size(); ++i)
+      sum += p2[i] - p1[i];
+    return sum / double(p1.size());
+  }
+};
+
+struct TranslationErrorMetric {
+  template <class ContainerT>
+  double operator()(Vector2 const& t, ContainerT const& p1, ContainerT const& p2) const {
+    return norm_2(p2 - (p1 + t));
+  }
+};
+
+// num_inliers points moved by (5,-3) with a little noise, followed by
+// outliers moved at random.
+void make_data(int num_inliers, int num_outliers,
+               std::vector<Vector2>& p1, std::vector<Vector2>& p2) {
+  RANSACRandom random(7, 0);
+  p1.clear();
+  p2.clear();
+  for (int i = 0; i < num_inliers + num_outliers; ++i) {
+    Vector2 p(random(1000), random(1000));
+    p1.push_back(p);
+    if (i < num_inliers)
+      p2.push_back(p + Vector2(5, -3) + Vector2(random(100), random(100)) / 1000.0);
+    else
+      p2.push_back(p + Vector2(random(200), random(200)) - Vector2(100, 100));
+  }
+}
+
+TEST(RANSAC, FitsTranslation) {
+  std::vector<Vector2> p1, p2;
+  make_data(60, 40, p1, p2);
+
+  TranslationFittingFunctor fit;
+  TranslationErrorMetric    error;
+  RandomSampleConsensus<TranslationFittingFunctor, TranslationErrorMetric>
+    ransac(fit, error, 200, 1.0, 50);
+  ransac.set_seed(12);
+  Vector2 t = ransac(p1, p2);
+  EXPECT_VECTOR_NEAR(Vector2(5.05, -2.95), t, 0.05);
+  EXPECT_EQ(60u, ransac.inlier_indices(t, p1, p2).size());
+}
+
+TEST(RANSAC, ThreadsAreDeterministic) {
+  std::vector<Vector2> p1, p2;
+  make_data(30, 70, p1, p2);
+
+  TranslationFittingFunctor fit;
+  TranslationErrorMetric    error;
+  RandomSampleConsensus<TranslationFittingFunctor, TranslationErrorMetric>
+    serial(fit, error, 300, 1.0, 20), parallel(fit, error, 300, 1.0, 20);
+  serial.set_seed(99);
+  serial.set_num_threads(1);
+  parallel.set_seed(99);
+  parallel.set_num_threads(4);
+  Vector2 t1 = serial(p1, p2), t2 = parallel(p1, p2);
+  EXPECT_EQ(t1[0], t2[0]);
+  EXPECT_EQ(t1[1], t2[1]);
+}
+
+// A fit that always fails with a specific error type
+struct FailingFittingFunctor : public TranslationFittingFunctor {
+  template <class ContainerT>
+  Vector2 operator()(std::vector<ContainerT> const& /*p1*/,
+                     std::vector<ContainerT> const& /*p2*/,
+                     Vector2 const& /*seed_input*/ = Vector2()) const {
+    vw_throw(MathErr() << "Degenerate sample.");
+    return Vector2();
+  }
+};
+
+TEST(RANSAC, FunctorExceptionsPropagate) {
+  std::vector<Vector2> p1, p2;
+  make_data(30, 70, p1, p2);
+
+  FailingFittingFunctor  fit;
+  TranslationErrorMetric error;
+  RandomSampleConsensus<FailingFittingFunctor, TranslationErrorMetric>
+    ransac(fit, error, 100, 1.0, 20);
+  ransac.set_seed(5);
+  EXPECT_THROW(ransac.attempt_ransac(p1, p2), MathErr);
+  ransac.set_num_threads(4);
+  EXPECT_THROW(ransac.attempt_ransac(p1, p2), MathErr);
+}
+
+TEST(RANSAC, AdaptiveTermination) {
+  std::vector<Vector2> p1, p2;
+  make_data(80, 20, p1, p2);
+
+  int fixed_fits = 0, adaptive_fits = 0;
+  TranslationFittingFunctor fixed_fit(&fixed_fits), adaptive_fit(&adaptive_fits);
+  TranslationErrorMetric    error;
+  RandomSampleConsensus<TranslationFittingFunctor, TranslationErrorMetric>
+    fixed(fixed_fit, error, 1000, 1.0, 50), adaptive(adaptive_fit, error, 1000, 1.0, 50);
+  fixed.set_num_threads(1);
+  fixed.set_confidence(0);
+  adaptive.set_num_threads(1);
+  Vector2 t1 = fixed(p1, p2), t2 = adaptive(p1, p2);
+
+  // Each hypothesis makes one or two fits
+  EXPECT_LE(1000, fixed_fits);
+  EXPECT_GT(200, adaptive_fits);
+  EXPECT_VECTOR_NEAR(t1, t2, 0.01);
+}
+
+TEST(RANSAC, ProgressiveSampling) {
+  // Mostly outliers, but the data is sorted with the inliers first
+  std::vector<Vector2> p1, p2;
+  make_data(15, 85, p1, p2);
+
+  TranslationFittingFunctor fit;
+  TranslationErrorMetric    error;
+  RandomSampleConsensus<TranslationFittingFunctor, TranslationErrorMetric>
+    ransac(fit, error, 50, 1.0, 15);
+  ransac.set_progressive_sampling(true);
+  Vector2 t = ransac(p1, p2);
+  EXPECT_VECTOR_NEAR(Vector2(5.05, -2.95), t, 0.05);
+}
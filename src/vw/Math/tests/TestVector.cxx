@@ -77,6 +77,14 @@ TEST(Vector, Static_Construction) {
   Vector3 v(value, value, value); // Should not compile
   Vector2 v2(0, 0);
   //Vector3 v3(v2); // Should not compile
+
+  // Elements that are not plain old data are default constructed
+  Vector<std::complex<double>,6> c;
+  for (size_t i = 0; i < c.size(); ++i)
+    EXPECT_EQ( std::complex<double>(), c[i] );
+  Vector<std::string,5> s;
+  for (size_t i = 0; i < s.size(); ++i)
+    EXPECT_TRUE( s[i].empty() );
 }
 
 TEST(Vector, Dynamic) {
@@ -114,6 +122,38 @@ TEST(Vector, Dynamic) {
   EXPECT_EQ(&(*(v.end()-1)),&(v(2)));
 }
 
+TEST(Vector, DynamicInlineStorage) {
+  // Growing from inline storage onto the heap and back preserves the
+  // leading elements and zeroes the new ones
+  Vector<double> v(3);
+  v = Vector3(1,2,3);
+  v.set_size(8,true);
+  ASSERT_EQ( 8u, v.size() );
+  EXPECT_VECTOR_NEAR( Vector3(1,2,3), subvector(v,0,3), 0 );
+  for ( size_t i = 3; i < 8; ++i )
+    EXPECT_EQ( 0, v(i) );
+  v(7) = 5;
+  Vector<double> w = v;
+  EXPECT_EQ( 5, w(7) );
+  v.set_size(2,true);
+  ASSERT_EQ( 2u, v.size() );
+  EXPECT_EQ( 1, v(0) );
+  EXPECT_EQ( 2, v(1) );
+  v.set_size(4);
+  EXPECT_VECTOR_NEAR( Vector4(), v, 0 );
+
+  // Copies are independent, whichever storage they use
+  Vector<double> small = Vector3(4,5,6), copy = small;
+  copy(0) = 0;
+  EXPECT_EQ( 4, small(0) );
+  w = small;
+  ASSERT_EQ( 3u, w.size() );
+  EXPECT_EQ( 6, w(2) );
+  small = Vector<double>(10);
+  EXPECT_EQ( 10u, small.size() );
+  EXPECT_EQ( 0, small(9) );
+}
+
 TEST(Vector, Proxy) {
   float data[] = {1,2,3,4};
 
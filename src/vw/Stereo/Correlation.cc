@@ -16,6 +16,7 @@
 // __END_LICENSE__
 
 #include <vw/Math/BBox.h>
+#include <vw/Math/Matrix.h>
 #include <vw/Image/Statistics.h>
 #include <vw/Stereo/Correlation.h>
 
@@ -231,4 +232,56 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
   }
 
 
+PixelMask<Vector2f> fit_cost_patch( PixelMask<Vector2i> const& disparity,
+                                    CostPatch const& patch ) {
+  if ( !is_valid(disparity) )
+    return PixelMask<Vector2f>();
+
+  const float MAX_SUBPIXEL_SHIFT = 5.0;
+  Vector2f result = remove_mask(disparity);
+
+  // A flat patch has no extremum
+  if ( std::equal( patch.begin()+1, patch.end(), patch.begin() ) )
+    return PixelMask<Vector2f>( result );
+
+  bool complete = true;
+  for ( int32 k = 0; k < 9; ++k )
+    if ( patch[k] != patch[k] ) // NaN
+      complete = false;
+
+  if ( complete ) {
+    // Pseudoinverse of the A matrix, where each row in A is
+    // [ x^2 y^2 xy x y 1] (our 2d parabolic surface) for the range
+    // of x = [-1:1] and y = [-1:1].
+    static const float pinvA_data[] =
+      {  1.0/6, -1.0/3,  1.0/6,  1.0/6, -1.0/3,  1.0/6,   1.0/6, -1.0/3,  1.0/6,  // = a
+         1.0/6,  1.0/6,  1.0/6, -1.0/3, -1.0/3, -1.0/3,   1.0/6,  1.0/6,  1.0/6,  // = b
+         1.0/4,    0.0, -1.0/4,    0.0,    0.0,    0.0,  -1.0/4,    0.0,  1.0/4,  // = c
+        -1.0/6,    0.0,  1.0/6, -1.0/6,    0.0,  1.0/6,  -1.0/6,    0.0,  1.0/6,  // = d
+        -1.0/6, -1.0/6, -1.0/6,    0.0,    0.0,    0.0,   1.0/6,  1.0/6,  1.0/6,  // = e
+        -1.0/9,  2.0/9, -1.0/9,  2.0/9,   5.0/9, 2.0/9,  -1.0/9,  2.0/9, -1.0/9 };// = f
+    static const Matrix<float,6,9> pinvA( pinvA_data );
+
+    // With the surface parameters the extremum is at [x,y] where:
+    //   dz/dx = 2ax + cy + d = 0
+    //   dz/dy = 2by + cx + e = 0
+    Vector<float,6> x( pinvA * patch );
+    float denom = 4 * x[0] * x[1] - ( x[2] * x[2] ); // = 4ab - c^2
+    Vector2f offset( ( x[2] * x[4] - 2 * x[1] * x[3] ) / denom,
+                     ( x[2] * x[3] - 2 * x[0] * x[4] ) / denom );
+    if ( norm_2(offset) < MAX_SUBPIXEL_SHIFT )
+      result += offset;
+    return PixelMask<Vector2f>( result );
+  }
+
+  // Fit each axis on its own. A NaN neighbor makes the denominator NaN.
+  float denom_x = patch[3] - 2 * patch[4] + patch[5];
+  if ( denom_x != 0 && denom_x == denom_x )
+    result[0] += 0.5 * ( patch[3] - patch[5] ) / denom_x;
+  float denom_y = patch[1] - 2 * patch[4] + patch[7];
+  if ( denom_y != 0 && denom_y == denom_y )
+    result[1] += 0.5 * ( patch[1] - patch[7] ) / denom_y;
+  return PixelMask<Vector2f>( result );
+}
+
 }} // end namespace vw::stereo
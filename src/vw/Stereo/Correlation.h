@@ -29,6 +29,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <limits>
 #include <utility>
 
 #include <boost/type_traits/is_integral.hpp>
@@ -36,115 +37,200 @@
 namespace vw {
 namespace stereo {
 
+  /// The costs of the 3x3 disparities centered on the chosen disparity of
+  /// a pixel, in row major order: index 0 is disparity offset (-1,-1),
+  /// index 4 is the chosen disparity and index 8 is offset (1,1).
+  /// Disparities outside of the searched range have a NaN cost.
+  typedef Vector<float,9> CostPatch;
+
+  /// Refine an integer disparity by finding the extremum of a parabolic
+  /// surface fit to its cost patch.
+  /// - Falls back to a parabola fit along each axis that has both
+  ///   neighbors when the patch is incomplete.
+  /// - Returns the integer disparity if no fit is possible.
+  PixelMask<Vector2f> fit_cost_patch( PixelMask<Vector2i> const& disparity,
+                                      CostPatch const& patch );
+
   /// Lower level implementation function for calc_disparity.
   /// - The inputs must already be rasterized to safe sizes!
   /// - Since the inputs are rasterized, the input images must not be too big.
+  ///
+  /// For every disparity this makes a single pass down the image
+  /// computing per pixel costs, the running box sum, and the
+  /// best/worst update together. Only kernel_size[1]+1 rows of costs
+  /// are kept around so that the working set stays in cache. The
+  /// summation order matches fast_box_sum so results are identical.
+  ///
+  /// If cost_patches is not null it is filled with the CostPatch of
+  /// every pixel as a side product of the search. This needs a buffer
+  /// of one cost per pixel for every column of the search volume when
+  /// searching in two dimensions.
   template <template<class,bool> class CostFuncT, class PixelT>
   ImageView<PixelMask<Vector2i> >
   best_of_search_convolution(ImageView<PixelT> const& left_raster,
                              ImageView<PixelT> const& right_raster,
                              BBox2i            const& left_region,
                              Vector2i          const& search_volume,
-                             Vector2i          const& kernel_size) {
+                             Vector2i          const& kernel_size,
+                             ImageView<CostPatch>   * cost_patches = 0) {
 
     typedef ImageView<PixelT> ImageType;
-    typedef typename CostFuncT<ImageType,
-      boost::is_integral<typename PixelChannelType<PixelT>::type>::value>::accumulator_type AccumChannelT;
+    typedef CostFuncT<ImageType,
+      boost::is_integral<typename PixelChannelType<PixelT>::type>::value> CostT;
+    typedef typename CostT::accumulator_type AccumChannelT;
     typedef typename PixelChannelCast<PixelT,AccumChannelT>::type AccumT;
-    typedef typename std::pair<AccumT,AccumT> QualT;
-
+    typedef typename CostT::pixel_functor_type PixelFuncT;
 
     // Build cost function which sometimes has side car data
-    CostFuncT<ImageType,boost::is_integral<typename PixelChannelType<PixelT>::type>::value> 
-          cost_function( left_raster, right_raster, kernel_size);
+    CostT cost_function( left_raster, right_raster, kernel_size);
+    PixelFuncT pixel_cost;
 
-    // Result buffers
+    // Result buffers. These are kept as flat arrays of scalars rather
+    // than the result pixel type so the update loop can be vectorized.
+    // The best disparity is stored as an index into the search volume.
     Vector2i result_size = bounding_box(left_raster).size() - kernel_size + Vector2i(1,1);
-    ImageView<PixelMask<Vector2i> > disparity_map(result_size[0], result_size[1]);
-    std::fill( disparity_map.data(), disparity_map.data() + prod(result_size),
-               PixelMask<Vector2i>(Vector2i()) );
-    // First channel is best, second is worst.
-    ImageView<QualT > quality_map( result_size[0], result_size[1] );
-    
-    // Storage buffers
-    ImageView<AccumT> cost_metric      ( result_size[0], result_size[1] );
-    ImageView<AccumT> cost_applied     ( left_raster.cols(), left_raster.rows() );
-    ImageView<PixelT> right_raster_crop( left_raster.cols(), left_raster.rows() );
+    std::vector<AccumChannelT> best_cost ( prod(result_size) );
+    std::vector<AccumChannelT> worst_cost( prod(result_size) );
+    std::vector<int32>         best_index( prod(result_size), 0 );
+
+    // Storage buffers. These are all just a few rows big.
+    const int32 input_cols = left_raster.cols();
+    const int32 ring_rows  = kernel_size[1] + 1;
+    std::vector<AccumT> cost_ring( ring_rows * input_cols ); // Per pixel costs
+    std::vector<AccumT> col_sum  ( input_cols );             // Vertical sums
+    std::vector<AccumT> cost_row ( result_size[0] );         // Box sums of one row
+
+    // Cost patch buffers. Patches are started when a pixel finds a new
+    // best disparity from the costs already seen, which are the previous
+    // disparity and the previous row of the search volume, and then
+    // completed as the following disparities come in.
+    const int32 num_pixels = prod(result_size);
+    std::vector<float> prev_cost, prev_search_row, search_row;
+    CostPatch empty_patch;
+    if ( cost_patches ) {
+      std::fill( empty_patch.begin(), empty_patch.end(), std::numeric_limits<float>::quiet_NaN() );
+      cost_patches->set_size( result_size[0], result_size[1] );
+      std::fill( cost_patches->data(), cost_patches->data() + num_pixels, empty_patch );
+      prev_cost.resize( num_pixels );
+      if ( search_volume[1] > 1 ) {
+        prev_search_row.resize( search_volume[0] * num_pixels );
+        search_row     .resize( search_volume[0] * num_pixels );
+      }
+    }
 
     // Loop across the disparity range we are searching over.
     Vector2i disparity(0,0);
     for ( ; disparity.y() != search_volume[1]; ++disparity.y() ) {
       for ( disparity.x() = 0; disparity.x() != search_volume[0]; ++disparity.x() ) {
-      
-        // Compute correlations quickly by shifting the right image by the
-        //  current disparity, computing the pixel difference at each location,
-        //  and using fast_box_sum/cost_function to get the final convolution
-        //  value at each location in "cost_metric"
-      
-        // There's only one raster here. Fast box sum calls each pixel
-        // individually by pixel accessor. It only calls each pixel
-        // once so there's no reason to copy/rasterize the cost result before hand.
-        //
-        // The cost function should also not be applying an edge
-        // extension as we've already over cropped the input.
-        
-        right_raster_crop = crop(right_raster, bounding_box(left_raster)+disparity);
-        cost_applied      = cost_function( left_raster, right_raster_crop);
-        cost_metric       = fast_box_sum<AccumChannelT>(cost_applied, kernel_size );
-        cost_function.cost_modification( cost_metric, disparity );
-
-        // Loop across the region we want to compute disparities for.
-        // - The correlation score for each pixel is located in "cost_metric"
-        // - We update the best and worst disparity for each pixel in "quality_map"
-
-        // These conditionals might be served outside of the iteration
-        // of dx and dy. It would make the code slightly longer but
-        // would avoid a conditional inside a double loop.
-        const AccumT* cost_ptr     = cost_metric.data();
-        const AccumT* cost_ptr_end = cost_metric.data() + prod(result_size);
-        QualT* quality_ptr         = quality_map.data();
-        PixelMask<Vector2i>* disparity_ptr = disparity_map.data();
-        if ( disparity != Vector2i(0,0) ) {
-          // Normal comparison operations
-          while ( cost_ptr != cost_ptr_end ) {
-            if ( cost_function.quality_comparison( *cost_ptr, quality_ptr->first ) ) {
-              // Better than best?
-              quality_ptr->first = *cost_ptr;
-              disparity_ptr->child() = disparity;
-            } else if ( !cost_function.quality_comparison( *cost_ptr, quality_ptr->second ) ) {
-              // Worse than worse
-              quality_ptr->second = *cost_ptr;
+
+        // Seed the column sums with the first kernel_size[1] rows
+        std::fill( col_sum.begin(), col_sum.end(), AccumT() );
+        for ( int32 ky = 0; ky < kernel_size[1]; ++ky ) {
+          const PixelT* left_ptr  = &left_raster (0, ky);
+          const PixelT* right_ptr = &right_raster(disparity.x(), ky + disparity.y());
+          AccumT* ring_ptr = &cost_ring[ky * input_cols];
+          for ( int32 i = 0; i < input_cols; ++i )
+            ring_ptr[i] = pixel_cost( left_ptr[i], right_ptr[i] );
+          for ( int32 i = 0; i < input_cols; ++i )
+            col_sum[i] += ring_ptr[i];
+        }
+
+        const int32 disparity_index = disparity.y() * search_volume[0] + disparity.x();
+        for ( int32 row = 0; row < result_size[1]; ++row ) {
+
+          // Slide the kernel across the row of column sums
+          AccumT row_sum(0);
+          row_sum = std::accumulate(&col_sum[0], &col_sum[kernel_size[0]], row_sum);
+          const AccumT *cback = &col_sum[0], *cfront = &col_sum[kernel_size[0]];
+          for ( int32 col = 0; col < result_size[0] - 1; ++col ) {
+            cost_row[col] = row_sum;
+            row_sum += *cfront++ - *cback++;
+          }
+          cost_row[result_size[0]-1] = row_sum;
+          cost_function.cost_modification_row( &cost_row[0], result_size[0], row, disparity );
+
+          // Update the best and worst disparity for this row
+          AccumChannelT* best_ptr  = &best_cost [row * result_size[0]];
+          AccumChannelT* worst_ptr = &worst_cost[row * result_size[0]];
+          int32*         index_ptr = &best_index[row * result_size[0]];
+          if ( disparity_index != 0 ) {
+            // Normal comparison operations. Written without branches
+            // so that the compiler can turn this into vector selects.
+            for ( int32 i = 0; i < result_size[0]; ++i ) {
+              const AccumChannelT cost = cost_row[i];
+              const bool better = cost_function.quality_comparison( cost, best_ptr[i] );
+              const bool worse  = !better & !cost_function.quality_comparison( cost, worst_ptr[i] );
+              best_ptr [i] = better ? cost : best_ptr[i];
+              index_ptr[i] = better ? disparity_index : index_ptr[i];
+              worst_ptr[i] = worse  ? cost : worst_ptr[i];
+            }
+          } else {
+            // Initializing best and worst with first result
+            for ( int32 i = 0; i < result_size[0]; ++i )
+              best_ptr[i] = worst_ptr[i] = cost_row[i];
+          }
+
+          if ( cost_patches ) {
+            const int32 row_offset = row * result_size[0];
+            CostPatch* patch_ptr = cost_patches->data() + row_offset;
+            for ( int32 i = 0; i < result_size[0]; ++i ) {
+              const float cost = float(cost_row[i]);
+              const int32 p    = row_offset + i;
+              CostPatch& patch = patch_ptr[i];
+              if ( index_ptr[i] == disparity_index ) { // New best disparity
+                patch = empty_patch;
+                patch[4] = cost;
+                if ( disparity.x() > 0 )
+                  patch[3] = prev_cost[p];
+                if ( disparity.y() > 0 )
+                  for ( int32 k = -1; k <= 1; ++k )
+                    if ( disparity.x()+k >= 0 && disparity.x()+k < search_volume[0] )
+                      patch[1+k] = prev_search_row[(disparity.x()+k)*num_pixels + p];
+              } else { // Fill in the neighbors after the best disparity
+                const int32 dx = disparity.x() - index_ptr[i] % search_volume[0];
+                const int32 dy = disparity.y() - index_ptr[i] / search_volume[0];
+                if ( dy == 0 && dx == 1 )
+                  patch[5] = cost;
+                else if ( dy == 1 && dx >= -1 && dx <= 1 )
+                  patch[7+dx] = cost;
+              }
+              prev_cost[p] = cost;
+              if ( !search_row.empty() )
+                search_row[disparity.x()*num_pixels + p] = cost;
             }
-            ++cost_ptr;
-            ++quality_ptr;
-            ++disparity_ptr;
           }
-        } else {
-          // Initializing quality_map and disparity_map with first result
-          while ( cost_ptr != cost_ptr_end ) {
-            quality_ptr->first = quality_ptr->second = *cost_ptr;
-            ++cost_ptr;
-            ++quality_ptr;
+
+          // Move the column sums down a row. The new row of costs goes
+          // into the ring slot after the one for the row leaving the kernel.
+          if ( row + 1 == result_size[1] )
+            break;
+          const int32 front_row = row + kernel_size[1];
+          const PixelT* left_ptr  = &left_raster (0, front_row);
+          const PixelT* right_ptr = &right_raster(disparity.x(), front_row + disparity.y());
+          AccumT* front_ptr      = &cost_ring[( front_row % ring_rows ) * input_cols];
+          const AccumT* back_ptr = &cost_ring[( row       % ring_rows ) * input_cols];
+          for ( int32 i = 0; i < input_cols; ++i )
+            front_ptr[i] = pixel_cost( left_ptr[i], right_ptr[i] );
+          for ( int32 i = 0; i < input_cols; ++i ) {
+            col_sum[i] += front_ptr[i]; // We do this in 2 lines to match fast_box_sum.
+            col_sum[i] -= back_ptr[i];
           }
-        }
+        } // End row loop
       } // End x loop
+      prev_search_row.swap( search_row );
     } // End y loop
 
 
-    // Determine validity of result (detects rare invalid cases)
-    size_t invalid_count = 0;
-    const QualT* quality_ptr      = quality_map.data();
-    const QualT* quality_ptr_end  = quality_map.data() + prod(result_size);
+    // Convert to disparity and determine validity of result (detects
+    // rare invalid cases)
+    ImageView<PixelMask<Vector2i> > disparity_map(result_size[0], result_size[1]);
     PixelMask<Vector2i>* disp_ptr = disparity_map.data();
-    while ( quality_ptr != quality_ptr_end ) {
-      if ( quality_ptr->first == quality_ptr->second ) {
+    for ( int32 i = 0; i < prod(result_size); ++i, ++disp_ptr ) {
+      *disp_ptr = PixelMask<Vector2i>( Vector2i( best_index[i] % search_volume[0],
+                                                 best_index[i] / search_volume[0] ) );
+      if ( best_cost[i] == worst_cost[i] )
         invalidate( *disp_ptr );
-        ++invalid_count;
-      }
-      ++quality_ptr;
-      ++disp_ptr;
     }
-    //std::cout << "Invalidated " << invalid_count << " pixels in best_of_search_convolution2\n";
 
     return disparity_map;
   } // End function best_of_search_convolution
@@ -175,7 +261,8 @@ namespace stereo {
                  ImageViewBase<ImageT2> const& right_in,
                  BBox2i                 const& left_region,   // Valid region in the left image
                  Vector2i               const& search_volume, // Max disparity to search in right image
-                 Vector2i               const& kernel_size){
+                 Vector2i               const& kernel_size,
+                 ImageView<CostPatch>        * cost_patches = 0){ // Optional CostPatch output
 
     
     // Sanity check the input:
@@ -200,11 +287,11 @@ namespace stereo {
     // Call the lower level function with the appropriate cost function type
     switch ( cost_type ) {
     case CROSS_CORRELATION:
-      return best_of_search_convolution<NCCCost>(left, right, left_region, search_volume, kernel_size);
+      return best_of_search_convolution<NCCCost>(left, right, left_region, search_volume, kernel_size, cost_patches);
     case SQUARED_DIFFERENCE:
-      return best_of_search_convolution<SquaredCost>(left, right, left_region, search_volume, kernel_size);
+      return best_of_search_convolution<SquaredCost>(left, right, left_region, search_volume, kernel_size, cost_patches);
     default: // case ABSOLUTE_DIFFERENCE:
-      return best_of_search_convolution<AbsoluteCost>(left, right, left_region, search_volume, kernel_size);
+      return best_of_search_convolution<AbsoluteCost>(left, right, left_region, search_volume, kernel_size, cost_patches);
     }
     
   } // End function calc_disparity
@@ -0,0 +1,234 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#ifndef __VW_STEREO_CORRELATION_PYRAMID_H__
+#define __VW_STEREO_CORRELATION_PYRAMID_H__
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/MaskViews.h>
+#include <vw/Image/PerPixelAccessorViews.h>
+#include <vw/Image/Statistics.h>
+#include <vw/Stereo/PreFilter.h>
+
+#include <vector>
+
+namespace vw {
+namespace stereo {
+
+  /// Downsample a mask by two.
+  /// - If at least two mask pixels in a 2x2 region are on, the output pixel is on.
+  struct SubsampleMaskByTwoFunc : public ReturnFixedType<uint8> {
+    BBox2i work_area() const { return BBox2i(0,0,2,2); }
+
+    template <class PixelAccessorT>
+    typename boost::remove_reference<typename PixelAccessorT::pixel_type>::type
+    operator()( PixelAccessorT acc ) const {
+
+      typedef typename PixelAccessorT::pixel_type PixelT;
+
+      uint8 count = 0;
+      if ( *acc ) count++;
+      acc.next_col();
+      if ( *acc ) count++;
+      acc.advance(-1,1);
+      if ( *acc ) count++;
+      acc.next_col();
+      if ( *acc ) count++;
+      if ( count > 1 )
+        return PixelT(ScalarTypeLimits<PixelT>::highest());
+      return PixelT();
+    }
+  }; // End struct SubsampleMaskByTwoFunc
+
+  template <class ViewT>
+  SubsampleView<UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>, SubsampleMaskByTwoFunc> >
+  subsample_mask_by_two( ImageViewBase<ViewT> const& input ) {
+    return subsample(per_pixel_accessor_filter(input.impl(), SubsampleMaskByTwoFunc()),2);
+  }
+
+  /// The smoothing kernel applied before downsampling each pyramid level.
+  /// - Szeliski's book recommended this simple kernel.
+  template <class PixelT>
+  std::vector<typename DefaultKernelT<PixelT>::type > pyramid_smoothing_kernel() {
+    std::vector<typename DefaultKernelT<PixelT>::type > kernel(5);
+    kernel[0] = kernel[4] = 1.0/16.0;
+    kernel[1] = kernel[3] = 4.0/16.0;
+    kernel[2] = 6.0/16.0;
+    return kernel;
+  }
+
+
+  /// Replaces the masked out pixels of an image with the mean of the
+  /// valid pixels in the region being rasterized.
+  /// - The fill value depends on the requested region, so this view
+  ///   should be wrapped in block_cache() to get repeatable results.
+  template <class ImageT, class MaskT>
+  class MeanFillView : public ImageViewBase<MeanFillView<ImageT, MaskT> > {
+    ImageT m_image;
+    MaskT  m_mask;
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<MeanFillView> pixel_accessor;
+
+    MeanFillView( ImageT const& image, MaskT const& mask ) :
+      m_image(image), m_mask(mask) {}
+
+    inline int32 cols  () const { return m_image.cols(); }
+    inline int32 rows  () const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+    inline result_type operator()( int32 /*i*/, int32 /*j*/, int32 /*p*/ = 0) const {
+      vw_throw( NoImplErr() << "MeanFillView::operator()(....) has not been implemented." );
+      return result_type();
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      ImageView<pixel_type> image = crop(m_image, bbox);
+      ImageView<typename MaskT::pixel_type> mask = crop(m_mask, bbox);
+      try {
+        pixel_type mean = mean_pixel_value(subsample(copy_mask(image, create_mask(mask,0)),2));
+        image = apply_mask(copy_mask(image, create_mask(mask,0)), mean);
+      } catch ( const ArgumentErr& err ) {
+        // No valid pixels in this region, there is nothing to fill.
+      }
+      return prerasterize_type( image, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+
+    template <class DestT>
+    inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+  }; // End class MeanFillView
+
+
+  /// Whole image pyramids of the left and right images and their masks
+  /// that are shared between all the tiles of a PyramidCorrelationView.
+  /// - Every level is block cached through the vw system cache, so the
+  ///   mean fill, blurring, downsampling and prefiltering are done once
+  ///   per pixel per level rather than once per tile touching the pixel.
+  /// - The right image and mask are shifted by the start of the search
+  ///   region so that they line up with the left image. With that, pixel
+  ///   (x,y) on level i of any of the pyramids corresponds to pixel
+  ///   (x,y)*2^i of level 0.
+  /// - Highest resolution image is stored at index zero.
+  ///
+  /// The levels are close to, but not the same as, the ones that
+  /// PyramidCorrelationView::build_image_pyramids() makes for a tile:
+  /// - Nodata is filled with the mean of each cache block rather than
+  ///   the mean of the tile's padded region. Both are means of valid
+  ///   pixels, they only differ in which ones.
+  /// - Each level is blurred from the whole previous level and edge
+  ///   extended afterwards. A tile edge extends its padded region at
+  ///   level zero instead and blurs only that, so on every level its
+  ///   outer two pixels, and those next to the image edge, differ.
+  /// The disparities can therefore only change within two coarsest
+  /// level pixels, plus the kernel radius, of a tile edge, the image
+  /// edge or nodata. TestPyramidCorrelationView checks this bound.
+  template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+  class CorrelationPyramid {
+  public:
+    typedef typename Image1T::pixel_type left_pixel_type;
+    typedef typename Image2T::pixel_type right_pixel_type;
+    typedef typename Mask1T::pixel_type  left_mask_pixel_type;
+    typedef typename Mask2T::pixel_type  right_mask_pixel_type;
+
+    CorrelationPyramid( Image1T const& left_image, Image2T const& right_image,
+                        Mask1T  const& left_mask,  Mask2T  const& right_mask,
+                        BBox2i const& search_region, int32 max_level,
+                        PrefilterModeType prefilter_mode, float prefilter_width ) {
+
+      Vector2i block_size( vw_settings().default_tile_size(),
+                           vw_settings().default_tile_size() );
+
+      // The right side only ever needs to cover the left image plus the search range.
+      BBox2i right_shift( search_region.min(),
+                          search_region.min() + Vector2i(left_image.cols(), left_image.rows())
+                                              + search_region.size() + Vector2i(1,1) );
+
+      // Level zero, with the nodata filled in by a mean pixel value.
+      // This helps with the edge quality of a DEM.
+      ImageViewRef<left_pixel_type > left_base =
+        block_cache(MeanFillView<Image1T,Mask1T>(left_image, left_mask), block_size, 0);
+      ImageViewRef<right_pixel_type> right_base =
+        crop(edge_extend(block_cache(MeanFillView<Image2T,Mask2T>(right_image, right_mask),
+                                     block_size, 0),
+                         ConstantEdgeExtension()), right_shift);
+
+      m_left      .resize(max_level + 1);
+      m_right     .resize(max_level + 1);
+      m_left_mask .resize(max_level + 1);
+      m_right_mask.resize(max_level + 1);
+      m_left_mask [0] = left_mask;
+      m_right_mask[0] = crop(edge_extend(right_mask, ZeroEdgeExtension()), right_shift);
+
+      // Smooth and downsample to build the pyramid (don't smooth the masks).
+      // The prefiltered levels are cached separately since the unfiltered
+      // ones are what the next level is built from.
+      std::vector<typename DefaultKernelT<left_pixel_type >::type> left_kernel
+        = pyramid_smoothing_kernel<left_pixel_type >();
+      std::vector<typename DefaultKernelT<right_pixel_type>::type> right_kernel
+        = pyramid_smoothing_kernel<right_pixel_type>();
+      for ( int32 i = 0; i <= max_level; ++i ) {
+        if ( i > 0 ) {
+          left_base  = block_cache(pixel_cast<left_pixel_type >(subsample(separable_convolution_filter(left_base, left_kernel, left_kernel),2)),
+                                   block_size, 0);
+          right_base = block_cache(pixel_cast<right_pixel_type>(subsample(separable_convolution_filter(right_base, right_kernel, right_kernel),2)),
+                                   block_size, 0);
+          m_left_mask [i] = block_cache(subsample_mask_by_two(m_left_mask [i-1]), block_size, 0);
+          m_right_mask[i] = block_cache(subsample_mask_by_two(m_right_mask[i-1]), block_size, 0);
+        }
+        if ( prefilter_mode == PREFILTER_NONE ) {
+          m_left [i] = left_base;
+          m_right[i] = right_base;
+        } else {
+          m_left [i] = block_cache(prefilter_view(left_base,  prefilter_mode, prefilter_width), block_size, 0);
+          m_right[i] = block_cache(prefilter_view(right_base, prefilter_mode, prefilter_width), block_size, 0);
+        }
+      }
+    }
+
+    /// The number of levels not including the original resolution level.
+    int32 max_level() const { return int32(m_left.size()) - 1; }
+
+    /// Prefiltered pyramid levels, in the pixel coordinates of that level.
+    /// - The right levels are shifted by the start of the search region.
+    ImageViewRef<left_pixel_type      > const& left      (int32 level) const { return m_left      [level]; }
+    ImageViewRef<right_pixel_type     > const& right     (int32 level) const { return m_right     [level]; }
+    ImageViewRef<left_mask_pixel_type > const& left_mask (int32 level) const { return m_left_mask [level]; }
+    ImageViewRef<right_mask_pixel_type> const& right_mask(int32 level) const { return m_right_mask[level]; }
+
+  private:
+    std::vector<ImageViewRef<left_pixel_type      > > m_left;
+    std::vector<ImageViewRef<right_pixel_type     > > m_right;
+    std::vector<ImageViewRef<left_mask_pixel_type > > m_left_mask;
+    std::vector<ImageViewRef<right_mask_pixel_type> > m_right_mask;
+  }; // End class CorrelationPyramid
+
+}} // namespace vw::stereo
+
+#endif//__VW_STEREO_CORRELATION_PYRAMID_H__
@@ -23,11 +23,12 @@
 #include <vw/Core/Stopwatch.h>
 #include <vw/Core/Thread.h>
 #include <vw/Image/Algorithms.h>
-#include <vw/Image/ErodeView.h>
+#include <vw/Image/BlobIndex.h>
 #include <vw/Image/PerPixelAccessorViews.h>
 #include <vw/FileIO.h>
 #include <vw/Stereo/Correlation.h>
 #include <vw/Stereo/Correlate.h>
+#include <vw/Stereo/CorrelationPyramid.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Stereo/PreFilter.h>
 #include <boost/foreach.hpp>
@@ -126,6 +127,15 @@ namespace stereo {
 
     /// Initialize the view
     /// - Set blob_filter_area > 0 to filter out disparity blobs.
+    /// - Set use_pyramid_cache to build the image pyramids once for the
+    ///   whole image and share them between tiles, instead of building
+    ///   them again for every tile. Tiles still build their own pyramids
+    ///   when their corner is not aligned with the coarsest level. The
+    ///   result can differ slightly near tile edges, image edges and
+    ///   nodata, see CorrelationPyramid.
+    /// - Set subpixel_from_costs to have the window correlator keep the
+    ///   costs around each final disparity and refine the result with
+    ///   fit_cost_patch(), instead of returning integer disparities.
     PyramidCorrelationView( ImageViewBase<Image1T> const& left,
                             ImageViewBase<Image2T> const& right,
                             ImageViewBase<Mask1T > const& left_mask,
@@ -139,7 +149,9 @@ namespace stereo {
                             CorrelationAlgorithm  algorithm = CORRELATION_WINDOW,
                             int   collar_size        = 0,
                             int   blob_filter_area   = 0,
-                            bool  write_debug_images = false) :
+                            bool  write_debug_images = false,
+                            bool  use_pyramid_cache  = false,
+                            bool  subpixel_from_costs = false) :
       m_left_image(left.impl()),     m_right_image(right.impl()),
       m_left_mask(left_mask.impl()), m_right_mask(right_mask.impl()),
       m_prefilter_mode(prefilter_mode), m_prefilter_width(prefilter_width),
@@ -150,7 +162,8 @@ namespace stereo {
       m_blob_filter_area(blob_filter_area),
       m_algorithm(algorithm),
       m_collar_size(collar_size),
-      m_write_debug_images(write_debug_images){
+      m_write_debug_images(write_debug_images),
+      m_subpixel_from_costs(subpixel_from_costs){
       
       if (algorithm != CORRELATION_WINDOW)
         m_prefilter_mode = PREFILTER_NONE; // SGM/MGM works best with no prefilter
@@ -162,6 +175,12 @@ namespace stereo {
         m_max_level_by_search = max_pyramid_levels;
       if ( m_max_level_by_search < 0 )
         m_max_level_by_search = 0;
+
+      if (use_pyramid_cache)
+        m_pyramid_cache.reset(new CorrelationPyramid<Image1T,Image2T,Mask1T,Mask2T>
+                                (m_left_image, m_right_image, m_left_mask, m_right_mask,
+                                 m_search_region, m_max_level_by_search,
+                                 m_prefilter_mode, m_prefilter_width));
     } // End constructor
 
     // Standard required ImageView interfaces
@@ -179,6 +198,14 @@ namespace stereo {
     typedef CropView<ImageView<result_type> > prerasterize_type;
     inline prerasterize_type prerasterize(BBox2i const& bbox) const;
 
+    /// Cheap estimate of how much work prerasterize(bbox) will be, in
+    /// correlation operations, for scheduling the most expensive tiles first.
+    /// - This correlates the lowest resolution level of the tile and measures
+    ///   the spread of the disparities found there.
+    /// - Best used together with use_pyramid_cache, so the pyramids built
+    ///   for the estimate are reused when the tile is rasterized.
+    double tile_cost_estimate(BBox2i const& bbox) const;
+
     template <class DestT>
     inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
     
@@ -222,39 +249,16 @@ namespace stereo {
     int m_sgm_filter_size; ///< Filter SGM subpixel results with a filter of this size
 
     bool m_write_debug_images; ///< If true, write out a bunch of intermediate images.
+    bool m_subpixel_from_costs; ///< If true, window correlation results get parabola subpixel.
+
+    /// Image pyramids shared between tiles, null if not in use.
+    boost::shared_ptr<CorrelationPyramid<Image1T,Image2T,Mask1T,Mask2T> > m_pyramid_cache;
 
   private: // Functions
 
-    /// Downsample a mask by two.
-    /// - If at least two mask pixels in a 2x2 region are on, the output pixel is on.
-    struct SubsampleMaskByTwoFunc : public ReturnFixedType<uint8> {
-      BBox2i work_area() const { return BBox2i(0,0,2,2); }
-
-      template <class PixelAccessorT>
-      typename boost::remove_reference<typename PixelAccessorT::pixel_type>::type
-      operator()( PixelAccessorT acc ) const {
-
-        typedef typename PixelAccessorT::pixel_type PixelT;
-
-        uint8 count = 0;
-        if ( *acc ) count++;
-        acc.next_col();
-        if ( *acc ) count++;
-        acc.advance(-1,1);
-        if ( *acc ) count++;
-        acc.next_col();
-        if ( *acc ) count++;
-        if ( count > 1 )
-          return PixelT(ScalarTypeLimits<PixelT>::highest());
-        return PixelT();
-      }
-    }; // End struct SubsampleMaskByTwoFunc
-
-    template <class ViewT>
-    SubsampleView<UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>, SubsampleMaskByTwoFunc> >
-    subsample_mask_by_two( ImageViewBase<ViewT> const& input ) const {
-      return subsample(per_pixel_accessor_filter(input.impl(), SubsampleMaskByTwoFunc()),2);
-    }
+    /// The number of pyramid levels, not including the original
+    /// resolution level, that will be used for a tile.
+    int32 tile_pyramid_levels(BBox2i const& bbox) const;
 
     /// Create the image pyramids needed by the prerasterize function.
     /// - Most of this function is spent figuring out the correct ROIs to use.
@@ -264,6 +268,17 @@ namespace stereo {
                               std::vector<ImageView<typename Mask1T::pixel_type > > & left_mask_pyramid,
                               std::vector<ImageView<typename Mask2T::pixel_type > > & right_mask_pyramid) const;
 
+    /// Fill in the image pyramids needed by the prerasterize function by
+    /// cropping them out of the shared pyramid cache.
+    /// - Returns false if the cache can't be used for this tile, which
+    ///   happens when bbox.min() is not a multiple of 2^max_pyramid_levels.
+    bool crop_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
+                             std::vector<ImageView<typename Image1T::pixel_type> > & left_pyramid,
+                             std::vector<ImageView<typename Image2T::pixel_type> > & right_pyramid,
+                             std::vector<ImageView<typename Mask1T::pixel_type > > & left_mask_pyramid,
+                             std::vector<ImageView<typename Mask2T::pixel_type > > & right_mask_pyramid,
+                             bool & has_data) const;
+
     /// Filter out isolated blobs of valid disparity regions which are usually wrong.
     /// - Using this can decrease run time in images with lots of little disparity islands.
     void disparity_blob_filter(ImageView<pixel_typeI > &disparity, int level,
@@ -273,6 +288,23 @@ namespace stereo {
 
   }; // End class PyramidCorrelationView
 
+  /// Cost functor for block_write_image_by_cost() that asks a
+  /// PyramidCorrelationView for its tile cost estimates.
+  /// - The view being written may be any view built on top of the
+  ///   correlation view, as long as the tiles line up.
+  template <class ViewT>
+  class TileCostEstimator {
+    ViewT const& m_view;
+  public:
+    TileCostEstimator(ViewT const& view) : m_view(view) {}
+    double operator()(BBox2i const& bbox) const { return m_view.tile_cost_estimate(bbox); }
+  };
+
+  template <class ViewT>
+  TileCostEstimator<ViewT> tile_cost_estimator(ViewT const& view) {
+    return TileCostEstimator<ViewT>(view);
+  }
+
   template <class Image1T, class Image2T, class Mask1T, class Mask2T>
   PyramidCorrelationView<Image1T,Image2T,Mask1T,Mask2T>
   pyramid_correlate( ImageViewBase<Image1T> const& left,
@@ -288,7 +320,9 @@ namespace stereo {
                      CorrelationAlgorithm  algorithm = CORRELATION_WINDOW,
                      int   collar_size        = 0,
                      int   blob_filter_area   = 0,
-                     bool  write_debug_images =false) {
+                     bool  write_debug_images = false,
+                     bool  use_pyramid_cache  = false,
+                     bool  subpixel_from_costs = false) {
     typedef PyramidCorrelationView<Image1T,Image2T,Mask1T,Mask2T> result_type;
     return result_type( left.impl(),      right.impl(), 
                         left_mask.impl(), right_mask.impl(),
@@ -298,7 +332,7 @@ namespace stereo {
                         corr_timeout, seconds_per_op,
                         consistency_threshold, max_pyramid_levels,
                         algorithm, collar_size, blob_filter_area,
-                        write_debug_images);
+                        write_debug_images, use_pyramid_cache, subpixel_from_costs);
   }
 
 }} // namespace vw::stereo
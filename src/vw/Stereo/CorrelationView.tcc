@@ -152,13 +152,10 @@ build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
   right_mask_pyramid[0] = crop(edge_extend(m_right_mask,ZeroEdgeExtension()), right_mask);
 
   // Build a smoothing kernel to use before downsampling.
-  // Szeliski's book recommended this simple kernel. This
-  // operation is quickly becoming a time sink, we might
+  // This operation is quickly becoming a time sink, we might
   // possibly want to write an integer optimized version.
-  std::vector<typename DefaultKernelT<typename Image1T::pixel_type>::type > kernel(5);
-  kernel[0] = kernel[4] = 1.0/16.0;
-  kernel[1] = kernel[3] = 4.0/16.0;
-  kernel[2] = 6.0/16.0;
+  std::vector<typename DefaultKernelT<typename Image1T::pixel_type>::type > kernel
+    = pyramid_smoothing_kernel<typename Image1T::pixel_type>();
   std::vector<uint8> mask_kern(max(m_kernel_size));
   std::fill(mask_kern.begin(), mask_kern.end(), 1 );
 
@@ -184,6 +181,66 @@ build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
 }
 
 
+template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+bool PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
+crop_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
+                    std::vector<ImageView<typename Image1T::pixel_type> > & left_pyramid,
+                    std::vector<ImageView<typename Image2T::pixel_type> > & right_pyramid,
+                    std::vector<ImageView<typename Mask1T::pixel_type > > & left_mask_pyramid,
+                    std::vector<ImageView<typename Mask2T::pixel_type > > & right_mask_pyramid,
+                    bool & has_data) const {
+
+  // The tile must start on a pixel of the coarsest level so that
+  // every level can be cropped out of the cache without resampling.
+  int32 max_upscaling = 1 << max_pyramid_levels;
+  if ( !m_pyramid_cache || max_pyramid_levels > m_pyramid_cache->max_level() ||
+       (bbox.min().x() & (max_upscaling-1)) != 0 ||
+       (bbox.min().y() & (max_upscaling-1)) != 0 )
+    return false;
+
+  // These are the same regions used by build_image_pyramids(), except
+  // that the right side of the cache has already been shifted by
+  // m_search_region.min().
+  Vector2i half_kernel = m_kernel_size/2;
+  BBox2i left_region = bbox;
+  left_region.expand(half_kernel * max_upscaling);
+  BBox2i right_region = left_region;
+  right_region.max() += m_search_region.size() + Vector2i(max_upscaling,max_upscaling);
+  BBox2i left_mask_region  = bbox;
+  BBox2i right_mask_region = bbox;
+  right_mask_region.max() += m_search_region.size();
+
+  left_pyramid.resize      (max_pyramid_levels + 1);
+  right_pyramid.resize     (max_pyramid_levels + 1);
+  left_mask_pyramid.resize (max_pyramid_levels + 1);
+  right_mask_pyramid.resize(max_pyramid_levels + 1);
+
+  for ( int32 i = 0; i <= max_pyramid_levels; ++i ) {
+    left_mask_pyramid [i] = crop(edge_extend(m_pyramid_cache->left_mask (i), ZeroEdgeExtension()), left_mask_region );
+    right_mask_pyramid[i] = crop(edge_extend(m_pyramid_cache->right_mask(i), ZeroEdgeExtension()), right_mask_region);
+
+    // Skip the tile if either side is fully masked, like build_image_pyramids() does.
+    if ( i == 0 && ( max_pixel_value(left_mask_pyramid [0]) == 0 ||
+                     max_pixel_value(right_mask_pyramid[0]) == 0 ) ) {
+      has_data = false;
+      return true;
+    }
+
+    left_pyramid [i] = crop(edge_extend(m_pyramid_cache->left (i), ConstantEdgeExtension()), left_region );
+    right_pyramid[i] = crop(edge_extend(m_pyramid_cache->right(i), ConstantEdgeExtension()), right_region);
+
+    // Shrink the regions the same way subsample() shrinks an image.
+    left_region       = BBox2i(left_region.min()/2,       left_region.min()/2       + (left_region.size()      +Vector2i(1,1))/2);
+    right_region      = BBox2i(right_region.min()/2,      right_region.min()/2      + (right_region.size()     +Vector2i(1,1))/2);
+    left_mask_region  = BBox2i(left_mask_region.min()/2,  left_mask_region.min()/2  + (left_mask_region.size() +Vector2i(1,1))/2);
+    right_mask_region = BBox2i(right_mask_region.min()/2, right_mask_region.min()/2 + (right_mask_region.size()+Vector2i(1,1))/2);
+  }
+
+  has_data = true;
+  return true;
+}
+
+
 /// Filter out small blobs of valid pixels (they are usually bad)
 template <class Image1T, class Image2T, class Mask1T, class Mask2T>
 void PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
@@ -206,20 +263,94 @@ disparity_blob_filter(ImageView<pixel_typeI> &disparity, int level,
     vw_out() << "Finished writing DEBUG data...\n";
   } // End DEBUG
 
-  // Do the entire image at once!
-  BBox2i tile_size = bounding_box(disparity);
-  int big_size = tile_size.width();
-  if (tile_size.height() > big_size) 
-    big_size = tile_size.height();
-    
-  BlobIndexThreaded smallBlobIndex(disparity, area, big_size);
-  ImageView<pixel_typeI> filtered_image = applyErodeView(disparity, smallBlobIndex);
+  // Blobs are measured over the entire tile, labelling it in smaller
+  // pieces whose seams are merged. The other tiles are already keeping
+  // the threads busy so this runs in the calling thread.
+  ImageView<pixel_typeI> filtered_image =
+    remove_small_blobs(disparity, area, vw_settings().default_tile_size(), 1);
 
   disparity = filtered_image;
 }
 
 
 
+template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+int32 PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
+tile_pyramid_levels(BBox2i const& bbox) const {
+  int32 smallest_bbox      = math::min(bbox.size()); // Get smallest/largest of height/width
+  int32 largest_kernel     = math::max(m_kernel_size);
+  int32 max_pyramid_levels = std::floor(log(smallest_bbox)/log(2.0f) - log(largest_kernel)/log(2.0f));
+  if ( m_max_level_by_search < max_pyramid_levels )
+    max_pyramid_levels = m_max_level_by_search;
+  if ( max_pyramid_levels < 1 )
+    max_pyramid_levels = 0;
+  return max_pyramid_levels;
+}
+
+template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+double PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
+tile_cost_estimate(BBox2i const& bbox) const {
+
+  int32    max_pyramid_levels = tile_pyramid_levels(bbox);
+  Vector2i half_kernel        = m_kernel_size/2;
+  int32    max_upscaling      = 1 << max_pyramid_levels;
+
+  std::vector<ImageView<typename Image1T::pixel_type> > left_pyramid;
+  std::vector<ImageView<typename Image2T::pixel_type> > right_pyramid;
+  std::vector<ImageView<typename Mask1T::pixel_type > > left_mask_pyramid;
+  std::vector<ImageView<typename Mask2T::pixel_type > > right_mask_pyramid;
+  bool has_data = true;
+  if (!crop_image_pyramids(bbox, max_pyramid_levels, left_pyramid, right_pyramid,
+                           left_mask_pyramid, right_mask_pyramid, has_data))
+    has_data = build_image_pyramids(bbox, max_pyramid_levels, left_pyramid, right_pyramid,
+                                    left_mask_pyramid, right_mask_pyramid);
+  if (!has_data)
+    return 0;
+
+  // Correlate the lowest resolution level over the full search range,
+  // the same way prerasterize() starts off.
+  SearchParam zone(bounding_box(left_mask_pyramid[max_pyramid_levels]),
+                   BBox2i(0,0,m_search_region.width ()/max_upscaling+1,
+                              m_search_region.height()/max_upscaling+1));
+  BBox2i left_region = zone.image_region() + half_kernel;
+  left_region.expand(half_kernel);
+  BBox2i right_region = left_region;
+  right_region.max() += zone.disparity_range().size();
+  ImageView<pixel_typeI> disparity =
+    calc_disparity(m_cost_type,
+                   crop(left_pyramid [max_pyramid_levels], left_region),
+                   crop(right_pyramid[max_pyramid_levels], right_region),
+                   left_region - left_region.min(),
+                   zone.disparity_range().size(), m_kernel_size);
+  double cost = zone.search_volume();
+
+  // The lower levels search around the disparities found here, so the
+  // work left scales with the spread of the disparities in each part of
+  // the tile. Blocks with no valid disparity are assumed to stay invalid.
+  const int32 block_size = 8;
+  const double scaled_area = double(max_upscaling) * double(max_upscaling);
+  for (int32 j = 0; j < disparity.rows(); j += block_size) {
+    for (int32 i = 0; i < disparity.cols(); i += block_size) {
+      BBox2i block = BBox2i(i, j, block_size, block_size);
+      block.crop(bounding_box(disparity));
+      BBox2i range; // Inclusive, so a single disparity has zero width.
+      bool   found = false;
+      for (int32 y = block.min().y(); y < block.max().y(); ++y)
+        for (int32 x = block.min().x(); x < block.max().x(); ++x)
+          if (is_valid(disparity(x,y)) && left_mask_pyramid[max_pyramid_levels](x,y)) {
+            range.grow(disparity(x,y).child());
+            found = true;
+          }
+      if (!found)
+        continue;
+      cost += double(block.area()) * scaled_area
+            * double(range.width ()*max_upscaling + 1)
+            * double(range.height()*max_upscaling + 1);
+    }
+  }
+  return cost;
+}
+
 template <class Image1T, class Image2T, class Mask1T, class Mask2T>
 typename PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::prerasterize_type
 PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
@@ -241,13 +372,7 @@ prerasterize(BBox2i const& bbox) const {
     //      the maximum based on kernel size and current bbox.
     // - max_pyramid_levels is the number of levels not including the original resolution level.
     // - Each pyramid level is shrunk by the (reduced size) kernel size on that level.
-    int32 smallest_bbox      = math::min(bbox.size()); // Get smallest/largest of height/width
-    int32 largest_kernel     = math::max(m_kernel_size);
-    int32 max_pyramid_levels = std::floor(log(smallest_bbox)/log(2.0f) - log(largest_kernel)/log(2.0f));
-    if ( m_max_level_by_search < max_pyramid_levels )
-      max_pyramid_levels = m_max_level_by_search;
-    if ( max_pyramid_levels < 1 )
-      max_pyramid_levels = 0;
+    int32 max_pyramid_levels = tile_pyramid_levels(bbox);
     Vector2i half_kernel = m_kernel_size/2;
     int32 max_upscaling = 1 << max_pyramid_levels;
 
@@ -260,8 +385,13 @@ prerasterize(BBox2i const& bbox) const {
     std::vector<ImageView<typename Mask1T::pixel_type > > left_mask_pyramid;
     std::vector<ImageView<typename Mask2T::pixel_type > > right_mask_pyramid;
 
-    if (!build_image_pyramids(bbox, max_pyramid_levels, left_pyramid, right_pyramid, 
-                              left_mask_pyramid, right_mask_pyramid)){
+    // - Use the shared pyramid cache if possible, otherwise build them just for this tile.
+    bool has_data = true;
+    if (!crop_image_pyramids(bbox, max_pyramid_levels, left_pyramid, right_pyramid,
+                             left_mask_pyramid, right_mask_pyramid, has_data))
+      has_data = build_image_pyramids(bbox, max_pyramid_levels, left_pyramid, right_pyramid, 
+                                      left_mask_pyramid, right_mask_pyramid);
+    if (!has_data){
 #if VW_DEBUG_LEVEL > 0
       watch.stop();
       double elapsed = watch.elapsed_seconds();
@@ -301,6 +431,10 @@ prerasterize(BBox2i const& bbox) const {
     boost::shared_ptr<SemiGlobalMatcher> sgm_matcher_ptr;
     const bool use_mgm = (m_algorithm == CORRELATION_MGM);
 
+    // Costs around the final disparities for subpixel refinement
+    const bool record_cost_patches = m_subpixel_from_costs && (m_algorithm == CORRELATION_WINDOW);
+    ImageView<CostPatch> cost_patches;
+
     // Loop down through all of the pyramid levels, low res to high res.
     for ( int32 level = max_pyramid_levels; level >= 0; --level) {
 
@@ -412,6 +546,13 @@ prerasterize(BBox2i const& bbox) const {
         // - Prioritize the zones which take less time so we don't miss
         //   a bunch of tiles because we spent all our time on a slow one.
         std::sort(zones.begin(), zones.end(), SearchParamLessThan()); // Sort the zones, smallest to largest.
+        const bool record_level_patches = record_cost_patches && on_last_level;
+        if ( record_level_patches ) {
+          CostPatch empty_patch;
+          std::fill(empty_patch.begin(), empty_patch.end(), std::numeric_limits<float>::quiet_NaN());
+          cost_patches.set_size( disparity.cols(), disparity.rows() );
+          fill( cost_patches, empty_patch );
+        }
         BOOST_FOREACH( SearchParam const& zone, zones ) {
 
           // The input zone is in the normal pixel coordinates for this  level.
@@ -442,13 +583,17 @@ prerasterize(BBox2i const& bbox) const {
 
           // Compute left to right disparity vectors in this zone.
           // - The cropped regions we pass in have padding for the kernel.
+          ImageView<CostPatch> zone_patches;
           crop(disparity, zone.image_region())
             = calc_disparity(m_cost_type,
                              crop(left_pyramid [level], left_region), 
                              crop(right_pyramid[level], right_region),
                              left_region - left_region.min(), // Specify that the whole cropped region is valid
                              zone.disparity_range().size(), 
-                             m_kernel_size);
+                             m_kernel_size,
+                             record_level_patches ? &zone_patches : 0);
+          if ( record_level_patches )
+            crop(cost_patches, zone.image_region()) = zone_patches;
 
 
           // If at the last level and the user requested a left<->right consistency check,
@@ -619,6 +764,19 @@ prerasterize(BBox2i const& bbox) const {
                                  + result_type(m_search_region.min()),
                                -bbox.min().x(), -bbox.min().y(),
                                cols(), rows() );      
+    } else if (record_cost_patches) {
+      // The filtering above only invalidates pixels, so the patches still
+      // match the remaining disparities.
+      ImageView<result_type> float_type(disparity.cols(), disparity.rows());
+      for ( int32 j = 0; j < disparity.rows(); ++j ) {
+        for ( int32 i = 0; i < disparity.cols(); ++i ) {
+          float_type(i,j) = fit_cost_patch(disparity(i,j), cost_patches(i,j));
+          float_type(i,j).child() += Vector2f(m_search_region.min());
+        }
+      }
+      return prerasterize_type(float_type,
+                               -bbox.min().x(), -bbox.min().y(),
+                               cols(), rows() );
     } else {
       // TODO CLEANUP
       ImageView<pixel_typeI> temp = disparity + pixel_typeI(m_search_region.min());
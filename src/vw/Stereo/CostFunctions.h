@@ -188,6 +188,7 @@ namespace stereo {
 
   template <class ImageT, bool IsInteger>
   struct AbsoluteCost {
+    typedef AbsDifferenceFunctor pixel_functor_type;
     typedef typename AbsAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
 
@@ -209,6 +210,10 @@ namespace stereo {
     inline void cost_modification( ImageView<pixel_accumulator_type>& /*cost_metric*/,
                                    Vector2i const& /*disparity*/ ) const {}
 
+    // Row version of the above for the fused correlator. Does nothing.
+    inline void cost_modification_row( pixel_accumulator_type* /*cost_row*/, int32 /*length*/,
+                                       int32 /*row*/, Vector2i const& /*disparity*/ ) const {}
+
     inline bool quality_comparison( accumulator_type cost,
                                     accumulator_type quality ) const {
       return cost < quality;
@@ -217,6 +222,7 @@ namespace stereo {
 
   template <class ImageT, bool IsInteger>
   struct SquaredCost {
+    typedef SquaredDifferenceFunctor pixel_functor_type;
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
 
@@ -238,6 +244,10 @@ namespace stereo {
     inline void cost_modification( ImageView<pixel_accumulator_type>& /*cost_metric*/,
                                    Vector2i const& /*disparity*/ ) const {}
 
+    // Row version of the above for the fused correlator. Does nothing.
+    inline void cost_modification_row( pixel_accumulator_type* /*cost_row*/, int32 /*length*/,
+                                       int32 /*row*/, Vector2i const& /*disparity*/ ) const {}
+
     inline bool quality_comparison( accumulator_type cost,
                                     accumulator_type quality ) const {
       return cost < quality;
@@ -247,6 +257,7 @@ namespace stereo {
   // The float version of Cross Correlation
   template <class ImageT, bool IsInteger>
   struct NCCCost {
+    typedef CrossCorrelationFunctor pixel_functor_type;
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
     ImageView<pixel_accumulator_type> left_precision, right_precision;
@@ -275,6 +286,16 @@ namespace stereo {
                                                  bounding_box(left_precision)+disparity) );
     }
 
+    // Applies the same normalization to a single row of box sums.
+    // "row" is the row index into the result and "length" its width.
+    inline void cost_modification_row( pixel_accumulator_type* cost_row, int32 length,
+                                       int32 row, Vector2i const& disparity ) const {
+      const pixel_accumulator_type* left_ptr  = &left_precision(0, row);
+      const pixel_accumulator_type* right_ptr = &right_precision(disparity[0], row+disparity[1]);
+      for ( int32 i = 0; i < length; ++i )
+        cost_row[i] *= math::ArgSqrtFunctor()( left_ptr[i] * right_ptr[i] );
+    }
+
     inline bool quality_comparison( accumulator_type cost,
                                     accumulator_type quality ) const {
       return cost > quality;
@@ -285,6 +306,7 @@ namespace stereo {
   // avoids integer overflow.
   template <class ImageT>
   struct NCCCost<ImageT, true> {
+    typedef CrossCorrelationFunctor pixel_functor_type;
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
     ImageView<pixel_accumulator_type> left_variance, right_variance;
@@ -314,6 +336,16 @@ namespace stereo {
                                                           bounding_box(left_variance)+disparity) ) / 64 );
     }
 
+    // Applies the same normalization to a single row of box sums.
+    // "row" is the row index into the result and "length" its width.
+    inline void cost_modification_row( pixel_accumulator_type* cost_row, int32 length,
+                                       int32 row, Vector2i const& disparity ) const {
+      const pixel_accumulator_type* left_ptr  = &left_variance(0, row);
+      const pixel_accumulator_type* right_ptr = &right_variance(disparity[0], row+disparity[1]);
+      for ( int32 i = 0; i < length; ++i )
+        cost_row[i] = (64 * cost_row[i]) / ( math::ArgSqrtFunctor()( left_ptr[i] * right_ptr[i] ) / 64 );
+    }
+
     inline bool quality_comparison( accumulator_type cost,
                                     accumulator_type quality ) const {
       return cost > quality;
@@ -34,6 +34,11 @@
 #include <vw/Image/Statistics.h>
 
 #include <ostream>
+#include <limits>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <vector>
 
 // For the PixelDisparity math.
 #include <boost/smart_ptr/shared_ptr.hpp>
@@ -47,6 +52,8 @@ namespace vw {
   template<> struct PixelFormatID<Vector2             > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_2_CHANNEL; };
   template<> struct PixelFormatID<PixelMask<Vector2i> > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_3_CHANNEL; };
   template<> struct PixelFormatID<Vector2i            > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_2_CHANNEL; };
+  template<> struct PixelFormatID<PixelMask<Vector<int16,2> > > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_3_CHANNEL; };
+  template<> struct PixelFormatID<Vector<int16,2>            > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_2_CHANNEL; };
 
 namespace stereo {
 
@@ -66,6 +73,52 @@ namespace stereo {
                   accumulator.maximum());
   }
 
+  /// Compact integer disparity pixel with 16 bit components and a 16 bit
+  /// valid channel, 6 bytes per pixel instead of the 12 of PixelMask<Vector2i>.
+  /// - Widening to PixelMask<Vector2i> or PixelMask<Vector2f> with
+  ///   pixel_cast() or plain assignment is lossless.
+  /// - Use compact_disparity() to narrow, it checks the range.
+  typedef PixelMask<Vector<int16,2> > CompactDisparity;
+
+  /// Returns true if every disparity in the search range can be stored
+  /// in a CompactDisparity.
+  inline bool fits_compact_disparity( BBox2i const& search_range ) {
+    return search_range.min().x() >= std::numeric_limits<int16>::min() &&
+           search_range.min().y() >= std::numeric_limits<int16>::min() &&
+           search_range.max().x() <= std::numeric_limits<int16>::max() &&
+           search_range.max().y() <= std::numeric_limits<int16>::max();
+  }
+
+  /// Converts a disparity pixel to a CompactDisparity.
+  /// - Subpixel disparities are rounded to the nearest integer.
+  /// - Disparities that don't fit in 16 bits come out invalid.
+  template <class PixelT>
+  struct CompactDisparityFunc : public ReturnFixedType<CompactDisparity> {
+    CompactDisparity operator()( PixelT const& pix ) const {
+      typedef typename UnmaskedPixelType<PixelT>::type vector_type;
+      vector_type const& disp = remove_mask(pix);
+      CompactDisparity result;
+      for ( size_t i = 0; i < 2; i++ ) {
+        double value = std::floor( double(disp[i]) + 0.5 );
+        if ( !( value >= std::numeric_limits<int16>::min() &&
+                value <= std::numeric_limits<int16>::max() ) )
+          return result; // Invalid
+        result.child()[i] = int16(value);
+      }
+      if ( is_valid(pix) )
+        result.validate();
+      return result;
+    }
+  };
+
+  /// Convert a disparity image to CompactDisparity pixels.
+  template <class ViewT>
+  UnaryPerPixelView<ViewT, CompactDisparityFunc<typename ViewT::pixel_type> >
+  compact_disparity( ImageViewBase<ViewT> const& disparity_map ) {
+    typedef UnaryPerPixelView<ViewT, CompactDisparityFunc<typename ViewT::pixel_type> > result_type;
+    return result_type(disparity_map.impl(), CompactDisparityFunc<typename ViewT::pixel_type>());
+  }
+
   //  missing_pixel_image()
   //
   /// Produce a colorized image depicting which pixels in the disparity
@@ -654,7 +707,7 @@ namespace stereo {
         return *acc;
 
       // Allocate storage for recording pixel values
-      const size_t numPixels = (2*m_half_v_kernel + 1) * (2*m_half_v_kernel + 1);
+      const size_t numPixels = (2*m_half_h_kernel + 1) * (2*m_half_v_kernel + 1);
       std::vector<double> xVals(numPixels), yVals(numPixels);
 
       size_t matched = 0, total = 0;
@@ -711,9 +764,9 @@ namespace stereo {
       // Compute difference of this pixel from the mean disparity
       double thisX = (*acc)[0];
       double thisY = (*acc)[1];
-      double errorX = abs(thisX - meanX);
-      double errorY = abs(thisY - meanY);
-            
+      double errorX = std::abs(thisX - meanX);
+      double errorY = std::abs(thisY - meanY);
+
       if ((errorX > m_pixel_threshold*stdDevX) || 
           (errorY > m_pixel_threshold*stdDevY)   ){
         m_state->rejected_points++;
@@ -767,6 +820,242 @@ namespace stereo {
                       func_type_thresh( 1, 1, 3.0, 0.2 ) ); // Constants set to find only very isolated pixels
   }
 
+  // Constant time per pixel versions of methods 2 and 3.
+
+  /// Sums of the valid pixels of a disparity image over any rectangular
+  /// window, looked up in constant time from integral images.
+  class DisparityWindowSums {
+    int32 m_cols;
+    std::vector<double> m_count, m_x, m_y, m_xx, m_yy;
+
+    size_t index(int32 i, int32 j) const { return size_t(j)*(m_cols+1) + i; }
+    double lookup(std::vector<double> const& table,
+                  int32 i0, int32 j0, int32 i1, int32 j1) const {
+      return table[index(i1,j1)] - table[index(i0,j1)] - table[index(i1,j0)] + table[index(i0,j0)];
+    }
+
+  public:
+    template <class PixelT>
+    DisparityWindowSums(ImageView<PixelT> const& disparity) : m_cols(disparity.cols()) {
+      const size_t size = size_t(disparity.cols()+1)*size_t(disparity.rows()+1);
+      m_count.resize(size, 0.0);
+      m_x .resize(size, 0.0);  m_y .resize(size, 0.0);
+      m_xx.resize(size, 0.0);  m_yy.resize(size, 0.0);
+      for (int32 j = 0; j < disparity.rows(); ++j) {
+        double count = 0, x = 0, y = 0, xx = 0, yy = 0; // Sums along this row
+        for (int32 i = 0; i < disparity.cols(); ++i) {
+          if (is_valid(disparity(i,j))) {
+            double dx = disparity(i,j)[0], dy = disparity(i,j)[1];
+            count += 1;
+            x  += dx;     y  += dy;
+            xx += dx*dx;  yy += dy*dy;
+          }
+          size_t above = index(i+1,j), here = index(i+1,j+1);
+          m_count[here] = m_count[above] + count;
+          m_x [here] = m_x [above] + x;   m_y [here] = m_y [above] + y;
+          m_xx[here] = m_xx[above] + xx;  m_yy[here] = m_yy[above] + yy;
+        }
+      }
+    }
+
+    /// Sums over the pixels [i0,i1) x [j0,j1).
+    void window(int32 i0, int32 j0, int32 i1, int32 j1,
+                double& count, double& x, double& y, double& xx, double& yy) const {
+      count = lookup(m_count, i0, j0, i1, j1);
+      x  = lookup(m_x,  i0, j0, i1, j1);
+      y  = lookup(m_y,  i0, j0, i1, j1);
+      xx = lookup(m_xx, i0, j0, i1, j1);
+      yy = lookup(m_yy, i0, j0, i1, j1);
+    }
+  };
+
+  enum RmOutliersIntegralMethod {
+    RM_OUTLIERS_USING_MEAN   = 0, ///< Same result as rm_outliers_using_mean()
+    RM_OUTLIERS_USING_STDDEV = 1  ///< Same result as rm_outliers_using_stddev()
+  };
+
+  /// Tiled version of rm_outliers_using_mean() and rm_outliers_using_stddev()
+  /// whose cost per pixel does not grow with the kernel size.
+  /// - Each tile builds integral images of the valid pixel count, sum and
+  ///   sum of squares over the tile plus the kernel border, so the window
+  ///   statistics are a few lookups per pixel.
+  /// - The mean method drops disparities larger than a percentile based
+  ///   cutoff before averaging, which can't be done from sums. Windows
+  ///   where no disparity can reach the cutoff (max <= 2*min of |dx|+|dy|)
+  ///   use the sums, the others fall back to the per-window search.
+  /// - Results match the originals, up to floating point rounding of the
+  ///   sums for non-integer disparities.
+  template <class ViewT>
+  class RmOutliersIntegralView : public ImageViewBase<RmOutliersIntegralView<ViewT> > {
+    ViewT  m_view;
+    RmOutliersIntegralMethod m_method;
+    int32  m_half_h_kernel, m_half_v_kernel;
+    double m_pixel_threshold, m_rejection_threshold; // Mean method only uses the first one.
+
+    /// Min or max over every window of a row major buffer, in place.
+    /// - Uses a monotonic queue so the cost doesn't depend on the half size.
+    template <class CompareT>
+    static void sliding_extreme(std::vector<double>& values, int32 cols, int32 rows,
+                                int32 half_h, int32 half_v, CompareT compare) {
+      std::vector<double> line, result;
+      std::deque<int32>   queue;
+      // First along the rows, then along the columns.
+      for (int32 pass = 0; pass < 2; ++pass) {
+        int32 length = pass == 0 ? cols : rows, count = pass == 0 ? rows : cols;
+        int32 half   = pass == 0 ? half_h : half_v;
+        int32 step   = pass == 0 ? 1 : cols, stride = pass == 0 ? cols : 1;
+        line.resize(length);
+        result.resize(length);
+        for (int32 k = 0; k < count; ++k) {
+          double* data = &values[0] + size_t(k)*stride;
+          for (int32 i = 0; i < length; ++i)
+            line[i] = data[size_t(i)*step];
+          queue.clear();
+          for (int32 i = 0; i < length; ++i) {
+            while (!queue.empty() && !compare(line[queue.back()], line[i]))
+              queue.pop_back();
+            queue.push_back(i);
+            if (queue.front() <= i - 2*half - 1)
+              queue.pop_front();
+            if (i >= 2*half)
+              result[i-half] = line[queue.front()];
+          }
+          for (int32 i = half; i < length-half; ++i)
+            data[size_t(i)*step] = result[i];
+        }
+      }
+    }
+
+  public:
+    typedef typename ViewT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<RmOutliersIntegralView> pixel_accessor;
+
+    RmOutliersIntegralView(ImageViewBase<ViewT> const& disparity_map,
+                           RmOutliersIntegralMethod method,
+                           int32 half_h_kernel, int32 half_v_kernel,
+                           double pixel_threshold, double rejection_threshold = 0) :
+      m_view(disparity_map.impl()), m_method(method),
+      m_half_h_kernel(half_h_kernel), m_half_v_kernel(half_v_kernel),
+      m_pixel_threshold(pixel_threshold), m_rejection_threshold(rejection_threshold) {
+      VW_ASSERT(half_h_kernel > 0 && half_v_kernel > 0,
+                ArgumentErr() << "RmOutliersIntegralView: half kernel sizes must be non-zero.");
+    }
+
+    inline int32 cols  () const { return m_view.cols  (); }
+    inline int32 rows  () const { return m_view.rows  (); }
+    inline int32 planes() const { return m_view.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+    inline result_type operator()( int32 i, int32 j, int32 p = 0 ) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      // The input with the same edge handling as the original filters.
+      BBox2i support = bbox;
+      support.expand(Vector2i(m_half_h_kernel, m_half_v_kernel));
+      ImageView<pixel_type> input = crop(edge_extend(m_view, ConstantEdgeExtension()), support);
+      DisparityWindowSums sums(input);
+
+      // For the mean method, the smallest and largest |dx|+|dy| of the
+      // valid pixels in the window centered at each pixel.
+      std::vector<double> min_len, max_len;
+      if (m_method == RM_OUTLIERS_USING_MEAN) {
+        min_len.resize(size_t(input.cols())*input.rows());
+        max_len.resize(min_len.size());
+        for (int32 j = 0; j < input.rows(); ++j)
+          for (int32 i = 0; i < input.cols(); ++i) {
+            size_t k = size_t(j)*input.cols() + i;
+            if (is_valid(input(i,j))) {
+              min_len[k] = max_len[k] = std::abs(double(input(i,j)[0])) + std::abs(double(input(i,j)[1]));
+            } else {
+              min_len[k] =  std::numeric_limits<double>::max();
+              max_len[k] = -std::numeric_limits<double>::max();
+            }
+          }
+        sliding_extreme(min_len, input.cols(), input.rows(), m_half_h_kernel, m_half_v_kernel,
+                        std::less<double>());
+        sliding_extreme(max_len, input.cols(), input.rows(), m_half_h_kernel, m_half_v_kernel,
+                        std::greater<double>());
+      }
+      RmOutliersUsingMeanFunc<pixel_type> mean_func(m_half_h_kernel, m_half_v_kernel,
+                                                    m_pixel_threshold);
+      const double max_mean_diffSq = m_pixel_threshold*m_pixel_threshold;
+
+      ImageView<pixel_type> output(bbox.width(), bbox.height());
+      for (int32 j = 0; j < output.rows(); ++j) {
+        for (int32 i = 0; i < output.cols(); ++i) {
+          // Center pixel in the input
+          const int32 ci = i + m_half_h_kernel, cj = j + m_half_v_kernel;
+          pixel_type const& center = input(ci, cj);
+          output(i,j) = center;
+          if (!is_valid(center))
+            continue;
+
+          double count, sx, sy, sxx, syy;
+          sums.window(i, j, ci + m_half_h_kernel + 1, cj + m_half_v_kernel + 1,
+                      count, sx, sy, sxx, syy);
+          const double thisX = center[0], thisY = center[1];
+
+          if (m_method == RM_OUTLIERS_USING_MEAN) {
+            const size_t k = size_t(cj)*input.cols() + ci;
+            if (max_len[k] > 2.0*min_len[k]) {
+              // Some disparities may be over the cutoff, do the full search.
+              typename ImageView<pixel_type>::pixel_accessor acc = input.origin();
+              acc.advance(ci, cj);
+              output(i,j) = mean_func(acc);
+              continue;
+            }
+            double meanX = sx / count, meanY = sy / count;
+            double errorSq = (thisX - meanX)*(thisX - meanX) + (thisY - meanY)*(thisY - meanY);
+            if (errorSq > max_mean_diffSq)
+              output(i,j) = pixel_type();
+          } else {
+            double meanX = sx / count, meanY = sy / count;
+            // Variance from the sums, clamped against rounding below zero.
+            double stdDevX = sqrt(std::max(sxx / count - meanX*meanX, 0.0));
+            double stdDevY = sqrt(std::max(syy / count - meanY*meanY, 0.0));
+            if (stdDevX < m_rejection_threshold)
+              stdDevX = m_rejection_threshold;
+            if (stdDevY < m_rejection_threshold)
+              stdDevY = m_rejection_threshold;
+            if ((std::abs(thisX - meanX) > m_pixel_threshold*stdDevX) ||
+                (std::abs(thisY - meanY) > m_pixel_threshold*stdDevY))
+              output(i,j) = pixel_type();
+          }
+        }
+      }
+      return prerasterize_type(output, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox ); }
+  };
+
+  /// Constant time per pixel equivalent of rm_outliers_using_mean().
+  template <class ViewT>
+  RmOutliersIntegralView<ViewT>
+  rm_outliers_using_mean_integral(ImageViewBase<ViewT> const& disparity_map,
+                                  int32 half_h_kernel, int32 half_v_kernel,
+                                  double max_mean_diff) {
+    return RmOutliersIntegralView<ViewT>(disparity_map, RM_OUTLIERS_USING_MEAN,
+                                         half_h_kernel, half_v_kernel, max_mean_diff);
+  }
+
+  /// Constant time per pixel equivalent of rm_outliers_using_stddev().
+  template <class ViewT>
+  RmOutliersIntegralView<ViewT>
+  rm_outliers_using_stddev_integral(ImageViewBase<ViewT> const& disparity_map,
+                                    int32 half_h_kernel, int32 half_v_kernel,
+                                    double pixel_threshold,
+                                    double rejection_threshold) {
+    return RmOutliersIntegralView<ViewT>(disparity_map, RM_OUTLIERS_USING_STDDEV,
+                                         half_h_kernel, half_v_kernel,
+                                         pixel_threshold, rejection_threshold);
+  }
+
   // Method 4: Fit a plane to the other pixels and see how well the
   // test pixel fits the plane.
     
@@ -827,7 +1116,7 @@ namespace stereo {
         return *acc;
 
       // Allocate storage for recording pixel values
-      const size_t numPixels = (2*m_half_v_kernel + 1) * (2*m_half_v_kernel + 1);
+      const size_t numPixels = (2*m_half_h_kernel + 1) * (2*m_half_v_kernel + 1);
       std::vector<double> xVals(numPixels), yVals(numPixels);
 
       // Record all valid points as x/y/z pairs (one set for dX, one set for dY)
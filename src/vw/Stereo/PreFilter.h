@@ -20,6 +20,7 @@
 #define __VW_STEREO_PREFILTER_H__
 
 #include <vw/Image/Filter.h>
+#include <vw/Image/ImageViewRef.h>
 
 namespace vw {
 namespace stereo {
@@ -91,6 +92,27 @@ prefilter_image(ImageViewBase<ImageT> const& image,
   return prefilter.filter(image);
 }
 
+/// Same as prefilter_image but the result is not rasterized.
+/// - Use this when the result is going to be block cached.
+template <class ImageT>
+ImageViewRef<typename ImageT::pixel_type>
+prefilter_view(ImageViewBase<ImageT> const& image,
+               PrefilterModeType prefilter_mode,
+               float             prefilter_width) {
+  typedef typename ImageT::pixel_type PixelT;
+
+  if (prefilter_mode == PREFILTER_LOG){  // LOG
+    stereo::LaplacianOfGaussian prefilter(prefilter_width);
+    return pixel_cast<PixelT>(prefilter.filter(image));
+  }
+  if (prefilter_mode == PREFILTER_MEANSUB){  // Subtracted mean
+    stereo::SubtractedMean prefilter(prefilter_width);
+    return pixel_cast<PixelT>(prefilter.filter(image));
+  }
+  //Default: PREFILTER_NONE
+  return image.impl();
+}
+
 
 }} // end namespace vw::stereo
 
@@ -1081,6 +1081,41 @@ create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
 }
 
 
+ImageView<CostPatch> SemiGlobalMatcher::
+create_cost_patches(DisparityImage const& integer_disparity) {
+
+  CostPatch empty_patch;
+  std::fill(empty_patch.begin(), empty_patch.end(), std::numeric_limits<float>::quiet_NaN());
+  ImageView<CostPatch> patches(m_num_output_cols, m_num_output_rows);
+  for ( int j = 0; j < m_num_output_rows; j++ ) {
+    for ( int i = 0; i < m_num_output_cols; i++ ) {
+      patches(i,j) = empty_patch;
+      PixelMask<Vector2i> integer_pixel = integer_disparity(i, j);
+      if (!is_valid(integer_pixel))
+        continue;
+
+      const Vector4i bounds = m_disp_bound_image(i,j);
+      const int width = (bounds[2] - bounds[0] + 1);
+      const int dx    = integer_pixel[0];
+      const int dy    = integer_pixel[1];
+      AccumCostType const* accum_vec = get_accum_vector(i, j);
+
+      // Neighbors outside of the searched disparities are left as NaN
+      for ( int y = -1; y <= 1; y++ ) {
+        if ( dy+y < bounds[1] || dy+y > bounds[3] )
+          continue;
+        for ( int x = -1; x <= 1; x++ ) {
+          if ( dx+x < bounds[0] || dx+x > bounds[2] )
+            continue;
+          patches(i,j)[4 + 3*y + x] = accum_vec[(dy+y-bounds[1])*width + (dx+x-bounds[0])];
+        }
+      }
+    }
+  }
+  return patches;
+}
+
+
 // TODO: Replace with ASP implementation?
 SemiGlobalMatcher::CostType SemiGlobalMatcher::get_cost_block(ImageView<uint8> const& left_image,
                ImageView<uint8> const& right_image,
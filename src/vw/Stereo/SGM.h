@@ -114,6 +114,11 @@ public: // Functions
   /// Create a subpixel leves disparity image using parabola interpolation
   ImageView<PixelMask<Vector2f> > create_disparity_view_subpixel(DisparityImage const& integer_disparity);
 
+  /// Return the accumulated costs around each disparity in integer_disparity
+  /// in the CostPatch layout, for use with fit_cost_patch() or parabola_subpixel().
+  /// - Must be called before the matcher is reused.
+  ImageView<CostPatch> create_cost_patches(DisparityImage const& integer_disparity);
+
 private: // Variables
 
     // The core parameters
@@ -67,9 +67,7 @@ StereoModel::StereoModel(camera::CameraModel const* camera_model1,
   m_angle_tol = angle_tol;
 }
   
-bool StereoModel::are_nearly_parallel(bool least_squares,
-                                      double angle_tol,
-                                      std::vector<Vector3> const& camDirs){
+double StereoModel::parallel_tolerance(bool least_squares, double angle_tol){
 
   // If the camera directions are nearly parallel, there will be very
   // large numerical uncertainty about where to place the point.  We
@@ -86,7 +84,14 @@ bool StereoModel::are_nearly_parallel(bool least_squares,
   else               tol = 1e-4;
 
   if (angle_tol > 0) tol = angle_tol; // can be over-ridden from the outside
-  
+  return tol;
+}
+
+bool StereoModel::are_nearly_parallel(bool least_squares,
+                                      double angle_tol,
+                                      std::vector<Vector3> const& camDirs){
+
+  double tol = parallel_tolerance(least_squares, angle_tol);
   bool are_par = true;
   for (int p = 0; p < int(camDirs.size()) - 1; p++){
     if ( 1 - dot_prod(camDirs[p], camDirs[p+1]) >= tol )
@@ -192,24 +197,8 @@ Vector3 StereoModel::triangulate_point(vector<Vector3> const& camDirs,
   
 
   int num_cams = camDirs.size();
-  if ( num_cams == 2 ){
-
-    // Two-ray triangulation. Triangulate the point by finding the
-    // midpoint of the segment joining the closest points on the two
-    // rays emanating from the camera.
-    
-    Vector3 v12 = cross_prod(camDirs[0], camDirs[1]);
-    Vector3 v1 = cross_prod(v12, camDirs[0]);
-    Vector3 v2 = cross_prod(v12, camDirs[1]);
-    
-    Vector3 closestPoint1 = camCtrs[0] + dot_prod(v2, camCtrs[1]-camCtrs[0])/dot_prod(v2, camDirs[0])*camDirs[0];
-    Vector3 closestPoint2 = camCtrs[1] + dot_prod(v1, camCtrs[0]-camCtrs[1])/dot_prod(v1, camDirs[1])*camDirs[1];
-    
-    errorVec = closestPoint1 - closestPoint2;
-
-    return 0.5 * (closestPoint1 + closestPoint2);
-    
-  }
+  if ( num_cams == 2 )
+    return triangulate_pair(camDirs[0], camCtrs[0], camDirs[1], camCtrs[1], errorVec);
 
   // Multi-ray triangulation. Find the intersection of the rays in
   // least squares sense (the point from which the sum of square
@@ -267,6 +256,94 @@ Vector3 StereoModel::triangulate_point(vector<Vector3> const& camDirs,
   return P;
 }
 
+Vector3 StereoModel::triangulate_pair(Vector3 const& dir1, Vector3 const& ctr1,
+                                      Vector3 const& dir2, Vector3 const& ctr2,
+                                      Vector3& errorVec){
+
+  // Two-ray triangulation. Triangulate the point by finding the
+  // midpoint of the segment joining the closest points on the two
+  // rays emanating from the camera.
+
+  Vector3 v12 = cross_prod(dir1, dir2);
+  Vector3 v1 = cross_prod(v12, dir1);
+  Vector3 v2 = cross_prod(v12, dir2);
+
+  Vector3 closestPoint1 = ctr1 + dot_prod(v2, ctr2-ctr1)/dot_prod(v2, dir1)*dir1;
+  Vector3 closestPoint2 = ctr2 + dot_prod(v1, ctr1-ctr2)/dot_prod(v1, dir2)*dir2;
+
+  errorVec = closestPoint1 - closestPoint2;
+
+  return 0.5 * (closestPoint1 + closestPoint2);
+}
+
+void StereoModel::triangulate(vector<Vector2> const& pixels1,
+                              vector<Vector2> const& pixels2,
+                              vector<Vector3>      & points,
+                              vector<Vector3>      & errors,
+                              BatchBuffers         & buffers) const {
+
+  VW_ASSERT(pixels1.size() == pixels2.size(),
+            vw::ArgumentErr() << "StereoModel: both pixel lists must be the same size.\n");
+
+  const size_t num_pairs = pixels1.size();
+  points.assign(num_pairs, Vector3());
+  errors.assign(num_pairs, Vector3());
+
+  if (m_cameras.size() != 2) {
+    vector<Vector2> pixVec(2);
+    for (size_t i = 0; i < num_pairs; i++) {
+      pixVec[0] = pixels1[i];
+      pixVec[1] = pixels2[i];
+      points[i] = operator()(pixVec, errors[i]);
+    }
+    return;
+  }
+
+  // Only send the valid pixels to the cameras
+  buffers.index.clear();
+  buffers.pixels1.clear();
+  buffers.pixels2.clear();
+  const Vector2 invalid_pix = camera::CameraModel::invalid_pixel();
+  for (size_t i = 0; i < num_pairs; i++) {
+    Vector2 const& pix1 = pixels1[i];
+    Vector2 const& pix2 = pixels2[i];
+    if (pix1 != pix1 || pix1 == invalid_pix || // i.e., NaN
+        pix2 != pix2 || pix2 == invalid_pix)
+      continue;
+    buffers.index  .push_back(i);
+    buffers.pixels1.push_back(pix1);
+    buffers.pixels2.push_back(pix2);
+  }
+  if (buffers.index.empty())
+    return;
+
+  m_cameras[0]->pixels_to_rays(buffers.pixels1, buffers.centers1, buffers.directions1);
+  m_cameras[1]->pixels_to_rays(buffers.pixels2, buffers.centers2, buffers.directions2);
+
+  const double tol = parallel_tolerance(m_least_squares, m_angle_tol);
+  const Vector3 no_ray;
+  for (size_t k = 0; k < buffers.index.size(); k++) {
+    Vector3 const& dir1 = buffers.directions1[k];
+    Vector3 const& dir2 = buffers.directions2[k];
+    Vector3 const& ctr1 = buffers.centers1[k];
+    Vector3 const& ctr2 = buffers.centers2[k];
+
+    // Pixels that did not project, or rays too close to parallel
+    if (dir1 == no_ray || dir2 == no_ray || 1 - dot_prod(dir1, dir2) < tol)
+      continue;
+
+    const size_t i = buffers.index[k];
+    Vector3 result = triangulate_pair(dir1, ctr1, dir2, ctr2, errors[i]);
+    if (m_least_squares)
+      refine_point(buffers.pixels1[k], buffers.pixels2[k], result);
+
+    // Reflect points that fall behind one of the two cameras
+    if (dot_prod(result - ctr1, dir1) < 0 || dot_prod(result - ctr2, dir2) < 0)
+      result = -result + 2*ctr1;
+    points[i] = result;
+  }
+}
+
 void StereoModel::refine_point(Vector2 const& pix1,
                                Vector2 const& pix2,
                                Vector3& point) const {
@@ -296,8 +373,11 @@ StereoModel::operator()(ImageView<PixelMask<Vector2f> > const& disparity_map,
   ImageView<Vector3> xyz(disparity_map.cols(), disparity_map.rows());
   error.set_size(disparity_map.cols(), disparity_map.rows());
 
-  // Compute 3D position for each pixel in the disparity map
+  // Compute 3D position for each pixel in the disparity map, a row at a time
   vw_out() << "StereoModel: Applying camera models\n";
+  BatchBuffers buffers;
+  vector<Vector2> pixels1(disparity_map.cols()), pixels2(disparity_map.cols());
+  vector<Vector3> points, errors;
   for (int32 y = 0; y < disparity_map.rows(); y++) {
     if (y % 100 == 0) {
       printf("\tStereoModel computing points: %0.2f%% complete.\r", 100.0f*float(y)/disparity_map.rows());
@@ -305,10 +385,19 @@ StereoModel::operator()(ImageView<PixelMask<Vector2f> > const& disparity_map,
     }
     for (int32 x = 0; x < disparity_map.cols(); x++) {
       if ( is_valid(disparity_map(x,y)) ) {
-        xyz(x,y) = (*this)(Vector2( x, y),
-                           Vector2( x+disparity_map(x,y)[0],
-                                    y+disparity_map(x,y)[1]),
-                           error(x,y) );
+        pixels1[x] = Vector2( x, y);
+        pixels2[x] = Vector2( x+disparity_map(x,y)[0],
+                              y+disparity_map(x,y)[1]);
+      } else {
+        pixels1[x] = pixels2[x] = camera::CameraModel::invalid_pixel();
+      }
+    }
+    triangulate(pixels1, pixels2, points, errors, buffers);
+
+    for (int32 x = 0; x < disparity_map.cols(); x++) {
+      if ( is_valid(disparity_map(x,y)) ) {
+        xyz(x,y)   = points[x];
+        error(x,y) = norm_2(errors[x]);
 
         if (error(x,y) >= 0) {
           // Keep track of error statistics
@@ -325,7 +414,7 @@ StereoModel::operator()(ImageView<PixelMask<Vector2f> > const& disparity_map,
         xyz(x,y) = Vector3();
         error(x,y) = 0;
       }
-      }
+    }
   }
 
   if (divergent != 0)
@@ -21,6 +21,8 @@
 
 #include <vw/Math/Vector.h>
 
+#include <vector>
+
 namespace vw {
 
   template <class PixelT> class ImageView;
@@ -75,6 +77,26 @@ namespace stereo {
     virtual Vector3 operator()(Vector2              const& pix1,   Vector2 const& pix2, Vector3& errorVec ) const;
     virtual Vector3 operator()(Vector2              const& pix1,   Vector2 const& pix2, double & error    ) const;
 
+    /// Scratch space for triangulate(). Keep one around while
+    /// processing many batches so the buffers are only allocated once.
+    struct BatchBuffers {
+      std::vector<size_t>  index;            ///< Position in the batch of each valid pair
+      std::vector<Vector2> pixels1, pixels2; ///< The valid pairs
+      std::vector<Vector3> centers1, directions1, centers2, directions2;
+    };
+
+    /// Triangulate a batch of pixel pairs, giving for each pair the same
+    /// point and error vector as the two pixel operator().
+    /// - The rays are found for the whole batch with one call to
+    ///   CameraModel::pixels_to_rays() per camera.
+    /// - Models with more than two cameras triangulate each pair with operator().
+    /// - Derived models that change operator() should override this as well.
+    virtual void triangulate(std::vector<Vector2> const& pixels1,
+                             std::vector<Vector2> const& pixels2,
+                             std::vector<Vector3>      & points,
+                             std::vector<Vector3>      & errors,
+                             BatchBuffers              & buffers) const;
+
     /// Returns the dot product of the two rays emanating from camera
     /// 1 and camera 2 through pix1 and pix2 respectively.  This can
     /// effectively be interpreted as the angle (in radians) between
@@ -98,7 +120,15 @@ namespace stereo {
     static Vector3 triangulate_point(std::vector<Vector3> const& camDirs,
                                      std::vector<Vector3> const& camCtrs,
                                      Vector3& errorVec);
-    
+
+    /// Two ray version of triangulate_point().
+    static Vector3 triangulate_pair(Vector3 const& dir1, Vector3 const& ctr1,
+                                    Vector3 const& dir2, Vector3 const& ctr2,
+                                    Vector3& errorVec);
+
+    /// Rays with 1 - dot product below this are considered parallel.
+    static double parallel_tolerance(bool least_squares, double angle_tol);
+
     static bool are_nearly_parallel(bool least_squares, double angle_tol,
                                     std::vector<Vector3> const& camDirs);
 
@@ -20,10 +20,13 @@
 #define __VW_STEREO_STEREOVIEW_H__
 
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Stereo/StereoModel.h>
 #include <limits>
+#include <vector>
 
 namespace vw {
 
@@ -120,8 +123,37 @@ namespace stereo {
     DisparityImageT const& disparity_map() const { return m_disparity_map; }
 
     /// \cond INTERNAL
-    typedef StereoView<typename DisparityImageT::prerasterize_type> prerasterize_type;
-    inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return prerasterize_type( m_disparity_map.prerasterize(bbox), m_stereo_model ); }
+    // Triangulates the whole region as one batch through
+    // StereoModel::triangulate(), so the cameras see all the pixels at once.
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<dpixel_type> disparity = crop( m_disparity_map, bbox );
+
+      std::vector<Vector2> pixels1, pixels2;
+      pixels1.reserve( disparity.cols() * disparity.rows() );
+      pixels2.reserve( disparity.cols() * disparity.rows() );
+      for ( int32 j = 0; j < disparity.rows(); j++ )
+        for ( int32 i = 0; i < disparity.cols(); i++ )
+          if ( is_valid(disparity(i,j)) ) {
+            Vector2 pix( bbox.min().x() + i, bbox.min().y() + j );
+            pixels1.push_back( pix );
+            pixels2.push_back( pix + DispHelper(disparity(i,j)) );
+          }
+
+      std::vector<Vector3> points, errors;
+      StereoModel::BatchBuffers buffers;
+      m_stereo_model.triangulate( pixels1, pixels2, points, errors, buffers );
+
+      // For missing pixels in the disparity map, we return a null 3D position.
+      ImageView<pixel_type> result( disparity.cols(), disparity.rows() );
+      size_t count = 0;
+      for ( int32 j = 0; j < disparity.rows(); j++ )
+        for ( int32 i = 0; i < disparity.cols(); i++ )
+          if ( is_valid(disparity(i,j)) )
+            result(i,j) = points[count++];
+
+      return prerasterize_type( result, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
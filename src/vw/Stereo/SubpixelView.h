@@ -42,12 +42,11 @@ namespace stereo {
     PrefilterModeType m_prefilter_mode; ///< See Prefilter.h for the types
     float m_prefilter_width;     ///< Preprocessing filter width
 
-    Matrix<float,6,9> m_p_A_matrix;
-
     /// Compute the subpixel disparity for each input integer disparity
     /// - This function is written in a roundabout way to maximize the benefit from our
     ///   fast_box_sum() function.  Of course, we already performed all of these computations
-    ///   back when we generated the integer disparity!!!
+    ///   back when we generated the integer disparity!!!  Pass cost patches from the
+    ///   correlator to the other parabola_subpixel() to avoid doing them again.
     template <class FImage1T, class FImage2T>
     ImageView<PixelMask<Vector2f> >
     evaluate( ImageView<PixelMask<Vector2i> > const& integer_disparity, ///< Input disparity, cropped to disparity_region
@@ -66,7 +65,7 @@ namespace stereo {
       // Allocate a buffer to store the costs of the 9 nearest disparities for each 
       //  pixel in the integer disparity image.
       // - This will use 2.25 MB for a 256^2 pixel region
-      ImageView<Vector<float,9> > cost_patch( integer_disparity.cols(),
+      ImageView<CostPatch> cost_patch( integer_disparity.cols(),
                                               integer_disparity.rows() );
       
       // TODO: Why is this hard-coded to a cost function that we did not use
@@ -76,7 +75,7 @@ namespace stereo {
       
       typedef typename CostType::accumulator_type                      AccumChannelT;
       typedef typename PixelChannelCast<typename FImage1T::pixel_type,AccumChannelT>::type AccumT;
-      typedef typename ImageView<Vector<float,9> >::pixel_accessor     PatchAcc;
+      typedef typename ImageView<CostPatch>::pixel_accessor            PatchAcc;
       typedef typename ImageView<AccumT>::pixel_accessor               MetricAcc;
       typedef typename ImageView<PixelMask<Vector2i> >::pixel_accessor IDispAcc;
 
@@ -256,35 +255,7 @@ namespace stereo {
           // Given our 9 points of cost around our disparity pixel
           // (patch_col), find the 2D minimum and that will be our
           // floating point update.
-          if ( is_valid( *idisp_col ) ) {
-            if ( !std::equal( (*patch_col).begin()+1, (*patch_col).end(),
-                              (*patch_col).begin() ) ) {
-              // First, compute the parameters of the hyperbolic surface by
-              // fitting the nine points in 'points' using a linear least
-              // squares fit.  This process is fairly fast, since we have
-              // already pre-computed the inverse of the A matrix in Ax = b.
-              Vector<float,6> x( m_p_A_matrix * (*patch_col) );
-              // With these parameters, we have a closed form expression for
-              // the surface.  We compute the derivative, and find the point
-              // where the slope is zero.  This is our maximum.
-              //
-              //  Max is at [x,y] where:
-              //   dz/dx = 2ax + cy + d = 0
-              //   dz/dy = 2by + cx + e = 0
-              float denom = 4 * x[0] * x[1] - ( x[2] * x[2] ); // = 4ab - c^2
-              Vector2f offset( ( x[2] * x[4] - 2 * x[1] * x[3] ) / denom,
-                               ( x[2] * x[3] - 2 * x[0] * x[4] ) / denom );
-              const float MAX_SUBPIXEL_SHIFT = 5.0; // TODO: Experiment with this!
-              if ( norm_2(offset) < MAX_SUBPIXEL_SHIFT )
-                *result_col = PixelMask<Vector2f>( remove_mask(*idisp_col) + offset );
-              else
-                *result_col = PixelMask<Vector2f>(*idisp_col);
-            } else {
-              *result_col = PixelMask<Vector2f>(*idisp_col);
-            }
-          } else {
-            *result_col = PixelMask<Vector2f>();
-          }
+          *result_col = fit_cost_patch( *idisp_col, *patch_col );
           result_col.next_col();
           idisp_col.next_col();
           patch_col.next_col();
@@ -315,25 +286,6 @@ namespace stereo {
       VW_ASSERT( m_disparity.cols() == m_left_image.cols() &&
                  m_disparity.rows() == m_left_image.rows(),
                  ArgumentErr() << "SubpixelView: Disparity image must match left image." );
-
-      // We get a considerable speedup in our 2d subpixel correlation if
-      // we go ahead and compute the pseudoinverse of the A matrix (where
-      // each row in A is [ x^2 y^2 xy x y 1] (our 2d parabolic surface)
-      // for the range of x = [-1:1] and y = [-1:1].
-      static float pinvA_data[] =/*
-        { 1.0/6,  1.0/6,  1.0/6, -1.0/3, -1.0/3, -1.0/3,  1.0/6,  1.0/6,  1.0/6,
-          1.0/6, -1.0/3,  1.0/6,  1.0/6, -1.0/3,  1.0/6,  1.0/6, -1.0/3,  1.0/6,
-          1.0/4,    0.0, -1.0/4,    0.0,    0.0,    0.0, -1.0/4,    0.0,  1.0/4,
-          -1.0/6, -1.0/6, -1.0/6,    0.0,    0.0,   0.0,  1.0/6,  1.0/6,  1.0/6,
-          -1.0/6,    0.0,  1.0/6, -1.0/6,    0.0, 1.0/6, -1.0/6,    0.0,  1.0/6,
-          -1.0/9,  2.0/9, -1.0/9,  2.0/9,  5.0/9, 2.0/9, -1.0/9,  2.0/9, -1.0/9 };*/
-        {  1.0/6, -1.0/3,  1.0/6,  1.0/6, -1.0/3,  1.0/6,   1.0/6, -1.0/3,  1.0/6,  // = a
-         1.0/6,  1.0/6,  1.0/6, -1.0/3, -1.0/3, -1.0/3,   1.0/6,  1.0/6,  1.0/6,  // = b
-         1.0/4,    0.0, -1.0/4,    0.0,    0.0,    0.0,  -1.0/4,    0.0,  1.0/4,  // = c
-        -1.0/6,    0.0,  1.0/6, -1.0/6,    0.0,  1.0/6,  -1.0/6,    0.0,  1.0/6,  // = d
-        -1.0/6, -1.0/6, -1.0/6,    0.0,    0.0,    0.0,   1.0/6,  1.0/6,  1.0/6,  // = e
-        -1.0/9,  2.0/9, -1.0/9,  2.0/9,   5.0/9, 2.0/9,  -1.0/9,  2.0/9, -1.0/9 };// = f
-      m_p_A_matrix = Matrix<float,6,9>( pinvA_data );
     }
 
     inline int32 cols  () const { return m_disparity.cols(); }
@@ -419,6 +371,26 @@ namespace stereo {
                         prefilter_mode, prefilter_width, kernel_size );
   }
 
+  /// Functor that refines an integer disparity using its cost patch.
+  struct CostPatchSubpixelFunc : public ReturnFixedType<PixelMask<Vector2f> > {
+    PixelMask<Vector2f> operator()( PixelMask<Vector2i> const& disparity,
+                                    CostPatch           const& patch ) const {
+      return fit_cost_patch( disparity, patch );
+    }
+  };
+
+  /// Parabola subpixel refinement using the cost patches recorded by
+  /// the integer correlator (see calc_disparity() and
+  /// SemiGlobalMatcher::create_cost_patches()), so no correlation needs
+  /// to be redone.
+  template <class DImageT, class PatchImageT>
+  BinaryPerPixelView<DImageT, PatchImageT, CostPatchSubpixelFunc>
+  parabola_subpixel( ImageViewBase<DImageT>     const& disparity,
+                     ImageViewBase<PatchImageT> const& cost_patches ) {
+    typedef BinaryPerPixelView<DImageT, PatchImageT, CostPatchSubpixelFunc> result_type;
+    return result_type( disparity.impl(), cost_patches.impl(), CostPatchSubpixelFunc() );
+  }
+
 //----------------------------------------------------------------
 
   enum PyramidSubpixelView_Algorithm {
@@ -212,3 +212,127 @@ TEST_F( CorrelationU8, CrossCorrelation ) {
   ASSERT_TRUE( is_valid(disparity(10,10)) );
   CheckResult( disparity );
 }
+
+// The fused correlator should give exactly what the original
+// crop / cost / fast_box_sum / cost_modification sequence gives.
+template <template<class,bool> class CostFuncT, class PixelT>
+ImageView<PixelMask<Vector2i> >
+reference_search( ImageView<PixelT> const& left, ImageView<PixelT> const& right,
+                  Vector2i const& search_volume, Vector2i const& kernel_size,
+                  std::vector<ImageView<float> >* costs = 0 ) {
+  typedef ImageView<PixelT> ImageType;
+  typedef CostFuncT<ImageType,boost::is_integral<typename PixelChannelType<PixelT>::type>::value> CostT;
+  typedef typename CostT::accumulator_type AccumChannelT;
+  typedef typename PixelChannelCast<PixelT,AccumChannelT>::type AccumT;
+
+  CostT cost_function( left, right, kernel_size );
+  Vector2i result_size = bounding_box(left).size() - kernel_size + Vector2i(1,1);
+  ImageView<PixelMask<Vector2i> > result( result_size[0], result_size[1] );
+  ImageView<AccumT> best( result_size[0], result_size[1] ), worst( result_size[0], result_size[1] );
+  for ( int32 dy = 0; dy < search_volume[1]; dy++ ) {
+    for ( int32 dx = 0; dx < search_volume[0]; dx++ ) {
+      Vector2i disparity(dx,dy);
+      ImageView<PixelT> right_crop = crop(right, bounding_box(left)+disparity);
+      ImageView<AccumT> cost_applied = cost_function( left, right_crop );
+      ImageView<AccumT> cost = fast_box_sum<AccumChannelT>(cost_applied, kernel_size);
+      cost_function.cost_modification( cost, disparity );
+      if ( costs )
+        costs->push_back( channel_cast<float>( cost ) );
+      for ( int32 j = 0; j < result.rows(); j++ ) {
+        for ( int32 i = 0; i < result.cols(); i++ ) {
+          if ( dx == 0 && dy == 0 ) {
+            best(i,j) = worst(i,j) = cost(i,j);
+            result(i,j) = PixelMask<Vector2i>(Vector2i());
+          } else if ( cost_function.quality_comparison( cost(i,j), best(i,j) ) ) {
+            best(i,j) = cost(i,j);
+            result(i,j).child() = disparity;
+          } else if ( !cost_function.quality_comparison( cost(i,j), worst(i,j) ) ) {
+            worst(i,j) = cost(i,j);
+          }
+        }
+      }
+    }
+  }
+  for ( int32 j = 0; j < result.rows(); j++ )
+    for ( int32 i = 0; i < result.cols(); i++ )
+      if ( best(i,j) == worst(i,j) )
+        invalidate( result(i,j) );
+  return result;
+}
+
+template <template<class,bool> class CostFuncT, class PixelT>
+void check_against_reference() {
+  boost::rand48 gen(5);
+  Vector2i kernel_size(5,7), search_volume(6,4);
+  ImageView<PixelT> left  = pixel_cast_rescale<PixelT>(uniform_noise_view(gen,40,30));
+  ImageView<PixelT> right = pixel_cast_rescale<PixelT>(uniform_noise_view(gen,40+search_volume[0]-1,
+                                                                           30+search_volume[1]-1));
+  ImageView<PixelMask<Vector2i> > expected =
+    reference_search<CostFuncT>( left, right, search_volume, kernel_size );
+  ImageView<PixelMask<Vector2i> > result =
+    best_of_search_convolution<CostFuncT>( left, right, bounding_box(left),
+                                           search_volume, kernel_size );
+  ASSERT_EQ( expected.cols(), result.cols() );
+  ASSERT_EQ( expected.rows(), result.rows() );
+  for ( int32 j = 0; j < result.rows(); j++ ) {
+    for ( int32 i = 0; i < result.cols(); i++ ) {
+      EXPECT_EQ( is_valid(expected(i,j)), is_valid(result(i,j)) );
+      EXPECT_VW_EQ( expected(i,j).child(), result(i,j).child() );
+    }
+  }
+}
+
+TEST( Correlation, FusedMatchesReference ) {
+  check_against_reference<AbsoluteCost, uint8>();
+  check_against_reference<SquaredCost,  uint8>();
+  check_against_reference<NCCCost,      uint8>();
+  check_against_reference<AbsoluteCost, PixelGray<int16> >();
+  check_against_reference<NCCCost,      PixelGray<int16> >();
+  check_against_reference<AbsoluteCost, PixelGray<float> >();
+  check_against_reference<SquaredCost,  PixelGray<float> >();
+  check_against_reference<NCCCost,      PixelGray<float> >();
+}
+
+// The cost patches recorded during the search should hold the costs
+// of the disparities around the best one.
+template <template<class,bool> class CostFuncT, class PixelT>
+void check_cost_patches( Vector2i const& search_volume ) {
+  boost::rand48 gen(7);
+  Vector2i kernel_size(5,3);
+  ImageView<PixelT> left  = pixel_cast_rescale<PixelT>(uniform_noise_view(gen,30,20));
+  ImageView<PixelT> right = pixel_cast_rescale<PixelT>(uniform_noise_view(gen,30+search_volume[0]-1,
+                                                                           20+search_volume[1]-1));
+  std::vector<ImageView<float> > costs;
+  ImageView<PixelMask<Vector2i> > expected =
+    reference_search<CostFuncT>( left, right, search_volume, kernel_size, &costs );
+  ImageView<CostPatch> patches;
+  ImageView<PixelMask<Vector2i> > result =
+    best_of_search_convolution<CostFuncT>( left, right, bounding_box(left),
+                                           search_volume, kernel_size, &patches );
+  ASSERT_EQ( result.cols(), patches.cols() );
+  ASSERT_EQ( result.rows(), patches.rows() );
+  for ( int32 j = 0; j < result.rows(); j++ ) {
+    for ( int32 i = 0; i < result.cols(); i++ ) {
+      EXPECT_VW_EQ( expected(i,j).child(), result(i,j).child() );
+      if ( !is_valid(result(i,j)) )
+        continue;
+      for ( int32 y = -1; y <= 1; y++ ) {
+        for ( int32 x = -1; x <= 1; x++ ) {
+          Vector2i d = result(i,j).child() + Vector2i(x,y);
+          float patch_cost = patches(i,j)[4 + 3*y + x];
+          if ( d[0] < 0 || d[1] < 0 || d[0] >= search_volume[0] || d[1] >= search_volume[1] )
+            EXPECT_TRUE( patch_cost != patch_cost ) << "Expected NaN at " << i << "," << j;
+          else
+            EXPECT_EQ( costs[d[1]*search_volume[0] + d[0]](i,j), patch_cost );
+        }
+      }
+    }
+  }
+}
+
+TEST( Correlation, CostPatches ) {
+  check_cost_patches<AbsoluteCost, uint8>( Vector2i(6,4) );
+  check_cost_patches<AbsoluteCost, uint8>( Vector2i(7,1) );
+  check_cost_patches<SquaredCost,  PixelGray<float> >( Vector2i(1,5) );
+  check_cost_patches<NCCCost,      PixelGray<float> >( Vector2i(5,3) );
+}
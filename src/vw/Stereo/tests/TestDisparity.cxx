@@ -24,8 +24,11 @@
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Transform.h>
+#include <vw/Image/BlockRasterize.h>
 #include <test/Helpers.h>
 
+#include <boost/random/linear_congruential.hpp>
+
 using namespace vw;
 using namespace vw::stereo;
 
@@ -270,3 +273,106 @@ TEST( DisparityMap, DisparityFiltering ) {
   }
   EXPECT_EQ(INVALID_COUNT_ANS, invalid_count);
 }
+
+TEST( DisparityMap, CompactDisparity ) {
+  EXPECT_EQ( 6u, sizeof(CompactDisparity) );
+  EXPECT_TRUE ( fits_compact_disparity(BBox2i(Vector2i(-300,-20), Vector2i(400,20))) );
+  EXPECT_FALSE( fits_compact_disparity(BBox2i(Vector2i(-40000,0), Vector2i(0,1))) );
+
+  const int IMAGE_SIZE = 20;
+  ImageView<PixelMask<Vector2i> > image(IMAGE_SIZE, IMAGE_SIZE);
+  for (int r=0; r<IMAGE_SIZE; ++r)
+    for (int c=0; c<IMAGE_SIZE; ++c)
+      image(c,r) = PixelMask<Vector2i>(c-IMAGE_SIZE/2, 3*r);
+  image(2,3).invalidate();
+  image(4,5) = PixelMask<Vector2i>(70000, 0);
+  image(6,7) = PixelMask<Vector2i>(0, -70000);
+
+  // Narrowing only loses the values that don't fit.
+  ImageView<CompactDisparity> compact = compact_disparity(image);
+  EXPECT_FALSE( is_valid(compact(2,3)) );
+  EXPECT_FALSE( is_valid(compact(4,5)) );
+  EXPECT_FALSE( is_valid(compact(6,7)) );
+  image(4,5).invalidate();
+  image(6,7).invalidate();
+
+  // Widening is lossless.
+  ImageView<PixelMask<Vector2i> > wide = pixel_cast<PixelMask<Vector2i> >(compact);
+  for (int r=0; r<IMAGE_SIZE; ++r)
+    for (int c=0; c<IMAGE_SIZE; ++c) {
+      ASSERT_EQ( is_valid(image(c,r)), is_valid(wide(c,r)) );
+      if ( is_valid(image(c,r)) )
+        EXPECT_VECTOR_EQ( image(c,r).child(), wide(c,r).child() );
+    }
+
+  // Subpixel disparities are rounded.
+  ImageView<PixelMask<Vector2f> > subpixel(1,1);
+  subpixel(0,0) = PixelMask<Vector2f>(Vector2f(-2.6, 4.4));
+  compact = compact_disparity(subpixel);
+  EXPECT_VECTOR_EQ( Vector2i(-3,4), Vector2i(compact(0,0).child()) );
+
+  // The compact type works with the disparity filters.
+  compact = compact_disparity(image);
+  BBox2f range = get_disparity_range(compact);
+  EXPECT_VECTOR_EQ( Vector2f(-IMAGE_SIZE/2, 0), range.min() );
+  EXPECT_VECTOR_EQ( Vector2f(IMAGE_SIZE/2-1, 3*(IMAGE_SIZE-1)), range.max() );
+
+  ImageView<uint8> mask(IMAGE_SIZE, IMAGE_SIZE);
+  fill(mask, 255);
+  mask(8,8) = 0;
+  ImageView<CompactDisparity> masked = disparity_mask(compact, mask, mask);
+  EXPECT_FALSE( is_valid(masked(8,8)) );  // Left pixel masked
+  EXPECT_FALSE( is_valid(masked(9,2)) );  // Matches (8,8) in the right image
+  EXPECT_TRUE ( is_valid(masked(10,1)) );
+
+  ImageView<CompactDisparity> filtered =
+    disparity_cleanup_using_thresh(compact, 2, 2, 10.0, 0.2);
+  EXPECT_TRUE( is_valid(filtered(10,10)) );
+}
+
+TEST( DisparityMap, IntegralOutlierFilters ) {
+  // Smooth disparities with holes and some gross outliers. Quarter pixel
+  // values keep the sums exact, so the results should match exactly.
+  boost::rand48 gen(42);
+  const int32 COLS = 90, ROWS = 70;
+  ImageView<PixelMask<Vector2f> > disparity(COLS, ROWS);
+  for (int32 r = 0; r < ROWS; ++r)
+    for (int32 c = 0; c < COLS; ++c) {
+      float dx = float(c/8) - 3 + float(gen() % 5)*0.25;
+      float dy = float(r/16) + float(gen() % 3)*0.25;
+      disparity(c,r) = PixelMask<Vector2f>(Vector2f(dx, dy));
+      if (gen() % 10 == 0)
+        disparity(c,r).invalidate();
+      else if (gen() % 25 == 0)
+        disparity(c,r) = PixelMask<Vector2f>(Vector2f(200 + gen() % 50, -float(gen() % 40)));
+    }
+
+  ImageView<PixelMask<Vector2f> > expected, actual;
+  for (int32 half_v = 1; half_v <= 4; half_v += 3) {
+    const int32 half_h = 3;
+    expected = rm_outliers_using_stddev(disparity, half_h, half_v, 2.0, 0.5);
+    actual   = block_rasterize(rm_outliers_using_stddev_integral(disparity, half_h, half_v, 2.0, 0.5),
+                               Vector2i(32,32), 1);
+    ASSERT_EQ( expected.cols(), actual.cols() );
+    int32 rejected = 0;
+    for (int32 r = 0; r < ROWS; ++r)
+      for (int32 c = 0; c < COLS; ++c) {
+        EXPECT_EQ( is_valid(expected(c,r)), is_valid(actual(c,r)) ) << c << " " << r;
+        if (is_valid(disparity(c,r)) && !is_valid(expected(c,r)))
+          rejected++;
+      }
+    EXPECT_GT( rejected, 0 );
+
+    expected = rm_outliers_using_mean(disparity, half_h, half_v, 3.0);
+    actual   = block_rasterize(rm_outliers_using_mean_integral(disparity, half_h, half_v, 3.0),
+                               Vector2i(32,32), 1);
+    rejected = 0;
+    for (int32 r = 0; r < ROWS; ++r)
+      for (int32 c = 0; c < COLS; ++c) {
+        EXPECT_EQ( is_valid(expected(c,r)), is_valid(actual(c,r)) ) << c << " " << r;
+        if (is_valid(disparity(c,r)) && !is_valid(expected(c,r)))
+          rejected++;
+      }
+    EXPECT_GT( rejected, 0 );
+  }
+}
@@ -408,3 +408,129 @@ TEST_F( PyramidViewU8, NullPreprocess ) {
   ASSERT_EQ( input1.rows(), disparity_map.rows() );
   check_error( disparity_map, .90, .990, "Cross Correlation" );
 }
+
+TEST_F( PyramidViewGRAYF32, PyramidCache ) {
+  // Rasterize in tiles so that the shared pyramids are actually reused,
+  // and compare with building the pyramids for every tile. The two are
+  // not identical, see CorrelationPyramid:
+  // - Nodata is filled with the mean of a cache block instead of the
+  //   mean of the tile's padded region.
+  // - The cached levels are edge extended after blurring, while a tile
+  //   blurs its own edge extended region.
+  // Both only reach pixels within two coarsest level pixels, plus the
+  // kernel radius, of a tile edge, the image edge or left nodata.
+  const int32 tile_size = 128;
+  const int32 coarsest  = 4; // Pyramid levels used with these settings
+  const int32 reach     = (2 << coarsest) + kernel_size[0]/2;
+  const BBox2i nodata(150,60,40,50);
+  ImageView<uint8> left_mask(input1.cols(), input1.rows());
+  fill(left_mask, 255);
+  fill(crop(left_mask, nodata), 0);
+
+  ImageView<PixelMask<Vector2i> > cached(input1.cols(), input1.rows()),
+                                  uncached(input1.cols(), input1.rows());
+  for ( int32 mode = PREFILTER_NONE; mode <= PREFILTER_LOG; mode++ ) {
+    for ( int32 use_cache = 0; use_cache < 2; use_cache++ ) {
+      ImageView<PixelMask<Vector2i> >& disparity_map = use_cache ? cached : uncached;
+      block_rasterize( pyramid_correlate( input1, input2, left_mask,
+                                          constant_view(uint8(255), input2),
+                                          PrefilterModeType(mode), 1.4,
+                                          search_volume, kernel_size,
+                                          ABSOLUTE_DIFFERENCE,
+                                          corr_timeout, seconds_per_op,
+                                          -1, max_levels,
+                                          CORRELATION_WINDOW, 0, 0, false,
+                                          bool(use_cache) ),
+                       Vector2i(tile_size,tile_size) ).rasterize( disparity_map, bounding_box(disparity_map) );
+    }
+    if ( mode == PREFILTER_NONE )
+      check_error( cached, .90, .90, "Pyramid Cache" );
+
+    int32 count_different = 0;
+    for ( int32 j = 0; j < cached.rows(); ++j ) {
+      for ( int32 i = 0; i < cached.cols(); ++i ) {
+        if ( is_valid(cached(i,j)) == is_valid(uncached(i,j)) &&
+             cached(i,j).child() == uncached(i,j).child() )
+          continue;
+        count_different++;
+
+        // Distance to the nearest tile edge, image edge or nodata
+        int32 dx = std::min( std::min(i % tile_size, tile_size-1 - i % tile_size), cached.cols()-1 - i );
+        int32 dy = std::min( std::min(j % tile_size, tile_size-1 - j % tile_size), cached.rows()-1 - j );
+        int32 dn = std::max( std::max(nodata.min().x() - i, i - (nodata.max().x()-1)),
+                             std::max(nodata.min().y() - j, j - (nodata.max().y()-1)) );
+        EXPECT_LE( std::min(std::min(dx, dy), dn), reach )
+          << "Prefilter mode " << mode << " at " << i << "," << j;
+        if ( is_valid(cached(i,j)) && is_valid(uncached(i,j)) )
+          EXPECT_LE( max(abs(cached(i,j).child() - uncached(i,j).child())), 1 << (coarsest-1) )
+            << "Prefilter mode " << mode << " at " << i << "," << j;
+      }
+    }
+    EXPECT_LT( float(count_different)/float(cached.cols()*cached.rows()), .02 ) << "Prefilter mode " << mode;
+  }
+}
+
+TEST_F( PyramidViewGRAYF32, TileCostEstimate ) {
+  // Mask out the left half of the left image.
+  ImageView<uint8> left_mask(input1.cols(), input1.rows());
+  fill(left_mask, 255);
+  fill(crop(left_mask, BBox2i(0,0,input1.cols()/2,input1.rows())), 0);
+
+  for ( int32 use_cache = 0; use_cache < 2; use_cache++ ) {
+    PyramidCorrelationView<ImageView<PixelGray<float> >, ImageView<PixelGray<float> >,
+                           ImageView<uint8>, PerPixelIndexView<ConstantIndexFunctor<uint8> > >
+      corr_view = pyramid_correlate( input1, input2, left_mask,
+                                     constant_view(uint8(255), input2),
+                                     PREFILTER_NONE, 0,
+                                     search_volume, kernel_size,
+                                     ABSOLUTE_DIFFERENCE,
+                                     corr_timeout, seconds_per_op,
+                                     -1, max_levels,
+                                     CORRELATION_WINDOW, 0, 0, false,
+                                     bool(use_cache) );
+    // At most the low resolution pass is left for the masked out tile.
+    double masked_cost = corr_view.tile_cost_estimate(BBox2i(0,   0,128,128));
+    double valid_cost  = corr_view.tile_cost_estimate(BBox2i(160,64,128,128));
+    EXPECT_LT( 10*masked_cost, valid_cost );
+    EXPECT_EQ( valid_cost, tile_cost_estimator(corr_view)(BBox2i(160,64,128,128)) );
+  }
+}
+
+TEST_F( PyramidViewGRAYF32, SubpixelFromCosts ) {
+  // Refining with the costs the correlator kept should get closer to the
+  // true disparity than the integer result.
+  ImageView<PixelMask<Vector2f> > integer_result =
+    pyramid_correlate( input1, input2,
+                       constant_view(uint8(255), input1),
+                       constant_view(uint8(255), input2),
+                       PREFILTER_NONE, 0, search_volume, kernel_size,
+                       ABSOLUTE_DIFFERENCE, corr_timeout, seconds_per_op,
+                       -1, max_levels );
+  ImageView<PixelMask<Vector2f> > subpixel_result =
+    pyramid_correlate( input1, input2,
+                       constant_view(uint8(255), input1),
+                       constant_view(uint8(255), input2),
+                       PREFILTER_NONE, 0, search_volume, kernel_size,
+                       ABSOLUTE_DIFFERENCE, corr_timeout, seconds_per_op,
+                       -1, max_levels, CORRELATION_WINDOW, 0, 0, false, false, true );
+
+  double integer_error = 0, subpixel_error = 0;
+  int32 count = 0, far_count = 0;
+  for ( int32 j = 0; j < input1.rows(); ++j ) {
+    for ( int32 i = 0; i < input1.cols(); ++i ) {
+      ASSERT_EQ( is_valid(integer_result(i,j)), is_valid(subpixel_result(i,j)) );
+      if ( !is_valid(integer_result(i,j)) )
+        continue;
+      Vector2 objective = scale*Vector2(i,j)+translation - Vector2(i,j);
+      if ( norm_2(subpixel_result(i,j).child() - integer_result(i,j).child()) > 1.5 )
+        far_count++;
+      integer_error  += norm_2(Vector2(integer_result (i,j).child()) - objective);
+      subpixel_error += norm_2(Vector2(subpixel_result(i,j).child()) - objective);
+      count++;
+    }
+  }
+  ASSERT_GT( count, 0 );
+  EXPECT_LT( subpixel_error / count, 0.8 * integer_error / count );
+  // Saddle shaped cost patches can move a few results further away.
+  EXPECT_LT( double(far_count) / count, 0.03 );
+}
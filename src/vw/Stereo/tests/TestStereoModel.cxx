@@ -21,6 +21,7 @@
 #include <test/Helpers.h>
 
 #include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Math/EulerAngles.h>
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Camera/CameraModel.h>
@@ -108,6 +109,74 @@ TEST( StereoModel, AdjustedStereo ) {
   }
 }
 
+TEST( StereoModel, BatchTriangulate ) {
+
+  boost::shared_ptr<CameraModel> pin1(new camera::PinholeModel( Vector3(), identity_matrix<3>(), 1, 1, 0, 0));
+  boost::shared_ptr<CameraModel> pin2(new camera::PinholeModel( Vector3(1,0,0), identity_matrix<3>(), 1, 1, 0, 0));
+  camera::AdjustedCameraModel adj1(pin1);
+  camera::AdjustedCameraModel adj2(pin2);
+  adj1.set_rotation(euler_to_quaternion(M_PI/8, M_PI/12, M_PI/15, "xyz"));
+  adj2.set_rotation(euler_to_quaternion(M_PI/9, M_PI/13, M_PI/9.9, "xyz"));
+  adj2.set_translation(Vector3(0.1, 0.04, 0.123));
+
+  std::vector<Vector2> pixels1, pixels2;
+  for (int i = 0; i < 20; i++) {
+    Vector3 point(0.3*i - 2, 0.1*i - 1, 3 + 0.2*i);
+    pixels1.push_back(adj1.point_to_pixel(point));
+    pixels2.push_back(adj2.point_to_pixel(point) + Vector2(0.01*i, -0.02*i));
+  }
+  // Missing pixels, and a pair of parallel rays
+  pixels1[3]  = CameraModel::invalid_pixel();
+  pixels2[7]  = Vector2(std::numeric_limits<double>::quiet_NaN(), 0);
+  pixels2[11] = adj2.point_to_pixel(adj2.camera_center(Vector2()) + adj1.pixel_to_vector(pixels1[11]));
+
+  for (int lsq = 0; lsq < 2; lsq++) {
+    StereoModel st(&adj1, &adj2, lsq);
+    std::vector<Vector3> points, errors;
+    StereoModel::BatchBuffers buffers;
+    st.triangulate(pixels1, pixels2, points, errors, buffers);
+    ASSERT_EQ(pixels1.size(), points.size());
+    ASSERT_EQ(pixels1.size(), errors.size());
+    for (size_t i = 0; i < pixels1.size(); i++) {
+      Vector3 error;
+      Vector3 point = st(pixels1[i], pixels2[i], error);
+      EXPECT_VECTOR_DOUBLE_EQ(point, points[i]);
+      EXPECT_VECTOR_DOUBLE_EQ(error, errors[i]);
+    }
+    EXPECT_VECTOR_DOUBLE_EQ(Vector3(), points[3]);
+    EXPECT_VECTOR_DOUBLE_EQ(Vector3(), points[7]);
+    EXPECT_VECTOR_DOUBLE_EQ(Vector3(), points[11]);
+  }
+}
+
+TEST( StereoView, BatchRasterize ) {
+  camera::PinholeModel pin1( Vector3(), identity_matrix<3>(), 20, 20, 10, 8);
+  camera::PinholeModel pin2( Vector3(1,0,0), identity_matrix<3>(), 20, 20, 10, 8);
+
+  ImageView<PixelMask<Vector2f> > disparity(21,17);
+  for (int j = 0; j < disparity.rows(); j++)
+    for (int i = 0; i < disparity.cols(); i++) {
+      disparity(i,j) = PixelMask<Vector2f>( Vector2f(-4 - 0.1*i - 0.05*j, 0.01*j) );
+      if ((i + 2*j) % 7 == 0)
+        invalidate(disparity(i,j));
+    }
+
+  for (int lsq = 0; lsq < 2; lsq++) {
+    StereoView<ImageView<PixelMask<Vector2f> > > sv( disparity, &pin1, &pin2, lsq );
+    ImageView<Vector3> pc = sv;
+    ImageView<Vector3> region = crop( sv, BBox2i(3,5,11,6) );
+    for (int j = 0; j < pc.rows(); j++)
+      for (int i = 0; i < pc.cols(); i++) {
+        EXPECT_VECTOR_DOUBLE_EQ( sv(i,j), pc(i,j) );
+        if ( !is_valid(disparity(i,j)) )
+          EXPECT_VECTOR_DOUBLE_EQ( Vector3(), pc(i,j) );
+      }
+    for (int j = 0; j < region.rows(); j++)
+      for (int i = 0; i < region.cols(); i++)
+        EXPECT_VECTOR_DOUBLE_EQ( sv(i+3,j+5), region(i,j) );
+  }
+}
+
 TEST( StereoView, PixelMaskVec2 ) {
   Vector3 pos1, pos2;
   pos2 = Vector3(1,0,0);
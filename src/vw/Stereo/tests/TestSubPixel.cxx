@@ -119,6 +119,38 @@ TEST( ParabolaSubpixel, NullTest ) {
   }
 }
 
+TEST( ParabolaSubpixel, CostPatch ) {
+  // A parabolic cost surface is fit exactly.
+  CostPatch patch;
+  for ( int32 y = -1; y <= 1; y++ )
+    for ( int32 x = -1; x <= 1; x++ )
+      patch[4 + 3*y + x] = 2 + (x-0.3)*(x-0.3) + 2*(y+0.2)*(y+0.2);
+  PixelMask<Vector2i> disparity( Vector2i(4,-2) );
+  EXPECT_VECTOR_NEAR( Vector2f(4.3,-2.2), fit_cost_patch( disparity, patch ).child(), 1e-5 );
+
+  // Without the rows above and below only x is refined.
+  CostPatch row_patch = patch;
+  for ( int32 k = 0; k < 3; k++ )
+    row_patch[k] = row_patch[6+k] = std::numeric_limits<float>::quiet_NaN();
+  EXPECT_VECTOR_NEAR( Vector2f(4.3,-2), fit_cost_patch( disparity, row_patch ).child(), 1e-5 );
+
+  // Nothing to fit
+  CostPatch flat;
+  std::fill( flat.begin(), flat.end(), 1 );
+  EXPECT_VECTOR_EQ( Vector2f(4,-2), fit_cost_patch( disparity, flat ).child() );
+  EXPECT_FALSE( is_valid( fit_cost_patch( PixelMask<Vector2i>(), patch ) ) );
+
+  ImageView<PixelMask<Vector2i> > disparities(3,2);
+  ImageView<CostPatch> patches(3,2);
+  fill( disparities, disparity );
+  fill( patches, patch );
+  invalidate( disparities(1,1) );
+  ImageView<PixelMask<Vector2f> > result = parabola_subpixel( disparities, patches );
+  EXPECT_VECTOR_NEAR( Vector2f(4.3,-2.2), result(2,1).child(), 1e-5 );
+  EXPECT_TRUE ( is_valid( result(0,0) ) );
+  EXPECT_FALSE( is_valid( result(1,1) ) );
+}
+
 typedef SubPixelCorrelateTest<95> SubPixelCorrelate95Test;
 typedef SubPixelCorrelateTest<90> SubPixelCorrelate90Test;
 typedef SubPixelCorrelateTest<80> SubPixelCorrelate80Test;
@@ -136,6 +168,33 @@ TEST_F( SubPixelCorrelate95Test, Parabola ) {
   EXPECT_LE(invalid_count, 0);
 }
 
+TEST_F( SubPixelCorrelate95Test, ParabolaCompact ) {
+  // A compact integer disparity input gives the same result.
+  ImageView<PixelMask<Vector2f> > expected =
+    parabola_subpixel( starting_disp, image1, image2,
+                       PREFILTER_LOG, 1.4, Vector2i(7,7) );
+  ImageView<PixelMask<Vector2f> > disparity_map =
+    parabola_subpixel( compact_disparity(starting_disp), image1, image2,
+                       PREFILTER_LOG, 1.4, Vector2i(7,7) );
+  for ( int32 i = 0; i < disparity_map.cols(); i++ )
+    for ( int32 j = 0; j < disparity_map.rows(); j++ ) {
+      EXPECT_EQ( is_valid(expected(i,j)), is_valid(disparity_map(i,j)) );
+      EXPECT_VECTOR_EQ( expected(i,j).child(), disparity_map(i,j).child() );
+    }
+
+  expected =
+    affine_subpixel( starting_disp, image1, image2,
+                     PREFILTER_LOG, 1.4, Vector2i(7,7) );
+  disparity_map =
+    affine_subpixel( compact_disparity(starting_disp), image1, image2,
+                     PREFILTER_LOG, 1.4, Vector2i(7,7) );
+  for ( int32 i = 0; i < disparity_map.cols(); i++ )
+    for ( int32 j = 0; j < disparity_map.rows(); j++ ) {
+      EXPECT_EQ( is_valid(expected(i,j)), is_valid(disparity_map(i,j)) );
+      EXPECT_VECTOR_EQ( expected(i,j).child(), disparity_map(i,j).child() );
+    }
+}
+
 // Testing Bayes EM SubPixel
 //--------------------------------------------------------------
 TEST_F( SubPixelCorrelate95Test, BayesEM95 ) {